@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2026 Fastly
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef _XOPEN_SOURCE
+#define _XOPEN_SOURCE 700 /* required for glibc to use getaddrinfo, etc. */
+#endif
+#include <errno.h>
+#include <getopt.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <openssl/pem.h>
+#include "picotls.h"
+#include "picotls/openssl.h"
+#include "quicly.h"
+#include "quicly/defaults.h"
+#include "quicly/mtserver.h"
+#include "quicly/streambuf.h"
+
+/**
+ * key used for encrypting the CIDs; shared among the workers so that every worker can decrypt the thread_id
+ */
+static uint8_t cid_key[16];
+
+static void usage(const char *progname)
+{
+    printf("Usage: %s [options] [host]\n"
+           "Options:\n"
+           "  -c <file>    specifies the certificate chain file (PEM format)\n"
+           "  -k <file>    specifies the private key file (PEM format)\n"
+           "  -p <number>  specifies the port number (default: 4433)\n"
+           "  -t <number>  specifies the number of worker threads (default: 4)\n"
+           "  -h           prints this help\n"
+           "\n"
+           "Runs a multi-threaded echo server on host:port. If omitted, host defaults to\n"
+           "127.0.0.1.\n",
+           progname);
+    exit(0);
+}
+
+static void on_stop_sending(quicly_stream_t *stream, quicly_error_t err)
+{
+    quicly_close(stream->conn, QUICLY_ERROR_FROM_APPLICATION_ERROR_CODE(0), "");
+}
+
+static void on_receive_reset(quicly_stream_t *stream, quicly_error_t err)
+{
+    quicly_close(stream->conn, QUICLY_ERROR_FROM_APPLICATION_ERROR_CODE(0), "");
+}
+
+static void on_receive(quicly_stream_t *stream, size_t off, const void *src, size_t len)
+{
+    /* read input to receive buffer */
+    if (quicly_streambuf_ingress_receive(stream, off, src, len) != 0)
+        return;
+
+    /* echo back to the client, shutting down the stream after echoing all data */
+    ptls_iovec_t input = quicly_streambuf_ingress_get(stream);
+    if (quicly_sendstate_is_open(&stream->sendstate) && input.len > 0) {
+        quicly_streambuf_egress_write(stream, input.base, input.len);
+        if (quicly_recvstate_transfer_complete(&stream->recvstate))
+            quicly_streambuf_egress_shutdown(stream);
+    }
+    quicly_streambuf_ingress_shift(stream, input.len);
+}
+
+static quicly_error_t on_stream_open(quicly_stream_open_t *self, quicly_stream_t *stream)
+{
+    static const quicly_stream_callbacks_t stream_callbacks = {
+        quicly_streambuf_destroy, quicly_streambuf_egress_shift, quicly_streambuf_egress_emit, on_stop_sending, on_receive,
+        on_receive_reset};
+    int ret;
+
+    if ((ret = quicly_streambuf_create(stream, sizeof(quicly_streambuf_t))) != 0)
+        return ret;
+    stream->callbacks = &stream_callbacks;
+    return 0;
+}
+
+static int init_context(quicly_mtserver_t *server, size_t thread_id, quicly_context_t *ctx)
+{
+    /* cipher contexts cannot be shared among threads, therefore each worker has its own CID encryptor */
+    if ((ctx->cid_encryptor = quicly_new_default_cid_encryptor(&ptls_openssl_quiclb, &ptls_openssl_aes128ecb, &ptls_openssl_sha256,
+                                                               ptls_iovec_init(cid_key, sizeof(cid_key)))) == NULL)
+        return -1;
+    return 0;
+}
+
+static void dispose_context(quicly_mtserver_t *server, size_t thread_id, quicly_context_t *ctx)
+{
+    quicly_free_default_cid_encryptor(ctx->cid_encryptor);
+}
+
+static void on_accept(quicly_mtserver_worker_t *worker, quicly_conn_t *conn)
+{
+    fprintf(stderr, "thread %zu: accepted connection %" PRIu32 "\n", quicly_mtserver_get_thread_id(worker),
+            quicly_get_master_id(conn)->master_id);
+}
+
+int main(int argc, char **argv)
+{
+    ptls_openssl_sign_certificate_t sign_certificate;
+    ptls_context_t tlsctx = {
+        .random_bytes = ptls_openssl_random_bytes,
+        .get_time = &ptls_get_time,
+        .key_exchanges = ptls_openssl_key_exchanges,
+        .cipher_suites = ptls_openssl_cipher_suites,
+    };
+    quicly_stream_open_t stream_open = {on_stream_open};
+    quicly_mtserver_callbacks_t callbacks = {
+        .init_context = init_context, .dispose_context = dispose_context, .on_accept = on_accept};
+    quicly_context_t ctx;
+    char *host = "127.0.0.1", *port = "4433";
+    size_t num_threads = 4;
+    struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_DGRAM, .ai_flags = AI_NUMERICSERV | AI_PASSIVE}, *res;
+    quicly_mtserver_t *server;
+    int ch, ret;
+
+    /* setup quic context */
+    ctx = quicly_spec_context;
+    ctx.tls = &tlsctx;
+    quicly_amend_ptls_context(ctx.tls);
+    ctx.stream_open = &stream_open;
+
+    /* resolve command line options and arguments */
+    while ((ch = getopt(argc, argv, "c:k:p:t:h")) != -1) {
+        switch (ch) {
+        case 'c': /* load certificate chain */
+            if ((ret = ptls_load_certificates(&tlsctx, optarg)) != 0) {
+                fprintf(stderr, "failed to load certificates from file %s:%d\n", optarg, ret);
+                exit(1);
+            }
+            break;
+        case 'k': /* load private key */ {
+            FILE *fp;
+            if ((fp = fopen(optarg, "r")) == NULL) {
+                fprintf(stderr, "failed to open file:%s:%s\n", optarg, strerror(errno));
+                exit(1);
+            }
+            EVP_PKEY *pkey = PEM_read_PrivateKey(fp, NULL, NULL, NULL);
+            fclose(fp);
+            if (pkey == NULL) {
+                fprintf(stderr, "failed to load private key from file:%s\n", optarg);
+                exit(1);
+            }
+            ptls_openssl_init_sign_certificate(&sign_certificate, pkey);
+            EVP_PKEY_free(pkey);
+            tlsctx.sign_certificate = &sign_certificate.super;
+        } break;
+        case 'p': /* port */
+            port = optarg;
+            break;
+        case 't': /* number of threads */
+            if (sscanf(optarg, "%zu", &num_threads) != 1 || num_threads == 0) {
+                fprintf(stderr, "invalid number of threads: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'h': /* help */
+            usage(argv[0]);
+            break;
+        default:
+            exit(1);
+            break;
+        }
+    }
+    if (tlsctx.certificates.count == 0 || tlsctx.sign_certificate == NULL) {
+        fprintf(stderr, "-c and -k options must be specified\n");
+        exit(1);
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc != 0)
+        host = *argv++;
+    if ((ret = getaddrinfo(host, port, &hints, &res)) != 0) {
+        fprintf(stderr, "failed to resolve address:%s:%s:%s\n", host, port, gai_strerror(ret));
+        exit(1);
+    }
+    tlsctx.random_bytes(cid_key, sizeof(cid_key));
+
+    /* open the sockets, and run the workers until being signalled */
+    if ((server = quicly_mtserver_create(&ctx, res->ai_addr, num_threads, 0, &callbacks, NULL)) == NULL) {
+        fprintf(stderr, "failed to open sockets:%s\n", strerror(errno));
+        exit(1);
+    }
+    freeaddrinfo(res);
+    /* signals are blocked before spawning the workers, so that they are received by sigwait below */
+    sigset_t sigs;
+    int sig;
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGINT);
+    sigaddset(&sigs, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &sigs, NULL);
+    if ((ret = quicly_mtserver_start(server)) != 0) {
+        fprintf(stderr, "failed to start workers:%d\n", ret);
+        exit(1);
+    }
+    sigwait(&sigs, &sig);
+    quicly_mtserver_stop(server);
+    quicly_mtserver_free(server);
+
+    return 0;
+}
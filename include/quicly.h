@@ -33,6 +33,7 @@ extern "C" {
 #include <sys/socket.h>
 #include <sys/types.h>
 #include "picotls.h"
+#include "quicly/alloc.h"
 #include "quicly/constants.h"
 #include "quicly/frame.h"
 #include "quicly/local_cid.h"
@@ -93,6 +94,7 @@ typedef struct st_quicly_context_t quicly_context_t;
 typedef struct st_quicly_stream_t quicly_stream_t;
 typedef struct st_quicly_send_context_t quicly_send_context_t;
 typedef struct st_quicly_address_token_plaintext_t quicly_address_token_plaintext_t;
+typedef struct st_quicly_conn_pool_t quicly_conn_pool_t;
 
 #define QUICLY_CALLBACK_TYPE0(ret, name)                                                                                           \
     typedef struct st_quicly_##name##_t {                                                                                          \
@@ -279,6 +281,179 @@ typedef struct st_quicly_salt_t {
     } retry;
 } quicly_salt_t;
 
+/**
+ * Receive-buffer budget that can be shared among connections. Each connection commits the size of its connection-level receive
+ * window to the budget. When sending the initial_max_data transport parameter, MAX_DATA, or MAX_STREAM_DATA, the grant is reduced
+ * so that the total commitment stays within the capacity (or to `QUICLY_RECVBUF_BUDGET_MIN_WINDOW` if the capacity has already
+ * been exhausted). As the initial window might become smaller than what the peer remembers, servers accepting 0-RTT should
+ * provision enough capacity. The object is not thread-safe; it must only be shared among connections that are handled by the same
+ * thread.
+ */
+typedef struct st_quicly_recvbuf_budget_t {
+    /**
+     * maximum amount of receive window (in bytes) to be committed by all the connections
+     */
+    uint64_t capacity;
+    /**
+     * amount of receive window being committed (in bytes)
+     */
+    uint64_t committed;
+} quicly_recvbuf_budget_t;
+
+/**
+ * Actions recommended by the admission control, in the order of severity.
+ */
+typedef enum en_quicly_admission_action_t {
+    /**
+     * accept the connection
+     */
+    QUICLY_ADMISSION_ACCEPT,
+    /**
+     * send a Retry packet, unless the client's address has already been validated
+     */
+    QUICLY_ADMISSION_RETRY,
+    /**
+     * close the connection with CONNECTION_REFUSED (see `quicly_send_close_connection_refused`)
+     */
+    QUICLY_ADMISSION_REFUSE,
+    /**
+     * drop the packet silently
+     */
+    QUICLY_ADMISSION_DROP,
+    QUICLY_NUM_ADMISSION_ACTIONS
+} quicly_admission_action_t;
+
+/**
+ * Admission control of the server-side handshakes that can be shared among contexts. The library tracks the number of handshakes in
+ * progress and the CPU time spent for processing the packets of those handshakes, and recommends an action as the thresholds are
+ * crossed. The object is not thread-safe; it must only be shared among connections that are handled by the same thread.
+ */
+typedef struct st_quicly_admission_t {
+    /**
+     * Thresholds of each action; the action is taken when any of the metrics reaches the threshold. Zero disables the comparison.
+     */
+    struct st_quicly_admission_thresholds_t {
+        /**
+         * number of handshakes in progress
+         */
+        uint32_t handshakes;
+        /**
+         * CPU time spent for handshakes, in microseconds per second (i.e., 1000000 corresponds to one CPU core being fully used)
+         */
+        uint32_t cpu_usec_per_sec;
+        /**
+         * memory usage in bytes, as is reported by `memory_in_use`
+         */
+        uint64_t memory;
+    } retry, refuse, drop;
+    /**
+     * if `quicly_accept` should apply the action by itself, returning QUICLY_ERROR_RETRY_REQUIRED,
+     * QUICLY_TRANSPORT_ERROR_CONNECTION_REFUSED, or QUICLY_ERROR_PACKET_IGNORED as the action is other than ACCEPT
+     */
+    unsigned enforce : 1;
+    /**
+     * memory being used, updated by the application (e.g., by accounting the usage of `quicly_allocator_t`)
+     */
+    uint64_t memory_in_use;
+    /**
+     * number of handshakes in progress (i.e., accepted but not yet confirmed)
+     */
+    uint32_t num_handshakes;
+    /**
+     * CPU time spent for handshakes, measured using CLOCK_THREAD_CPUTIME_ID
+     */
+    struct {
+        /**
+         * start of the current one-second window (in milliseconds)
+         */
+        int64_t window_start;
+        /**
+         * CPU time spent in the current window and in the previous one (in microseconds)
+         */
+        uint64_t current, previous;
+        /**
+         * CPU time spent in total (in microseconds)
+         */
+        uint64_t total;
+    } cpu_usec;
+    /**
+     * number of times each action has been recommended
+     */
+    uint64_t num_decisions[QUICLY_NUM_ADMISSION_ACTIONS];
+} quicly_admission_t;
+
+#define QUICLY_STATELESS_RATELIMIT_NUM_BUCKETS 1024
+
+/**
+ * Token-bucket rate limiter of the stateless responses (i.e., Stateless Reset and Version Negotiation packets), applied to each
+ * source address prefix (/24 for IPv4, /48 for IPv6). The prefixes are mapped to a fixed number of buckets using a keyed hash;
+ * prefixes sharing a bucket share the limit. The object is not thread-safe.
+ */
+typedef struct st_quicly_stateless_ratelimit_t {
+    /**
+     * number of responses permitted per second for each prefix
+     */
+    uint32_t rate;
+    /**
+     * maximum number of responses that can be sent at once for each prefix
+     */
+    uint32_t burst;
+    /**
+     * key of the hash function
+     */
+    uint64_t key;
+    /**
+     * number of responses that have been suppressed
+     */
+    uint64_t num_limited;
+    /**
+     * the buckets; `tokens` is expressed in 1/1000 of a response, and `updated_at` is zero for the buckets not used yet
+     */
+    struct st_quicly_stateless_ratelimit_bucket_t {
+        int64_t updated_at;
+        uint64_t tokens;
+    } buckets[QUICLY_STATELESS_RATELIMIT_NUM_BUCKETS];
+} quicly_stateless_ratelimit_t;
+
+#define QUICLY_RECVBUF_BUDGET_MIN_WINDOW (16 * 1024)
+
+/**
+ * Properties of a network path, remembered across connections by `quicly_path_profile_cache_t`.
+ */
+typedef struct st_quicly_path_profile_t {
+    /**
+     * delivery rate (in bytes/sec)
+     */
+    uint64_t delivery_rate;
+    /**
+     * minimum RTT (in milliseconds)
+     */
+    uint32_t min_rtt;
+    /**
+     * ratio of packets deemed lost, in the unit of 1/1000
+     */
+    uint16_t loss_permille;
+} quicly_path_profile_t;
+
+/**
+ * A cache of path profiles, used by the server to seed the initial RTT and jumpstart of new connections from networks it has
+ * recently talked to, when the client does not provide that information through a resumption token. Implementations are expected
+ * to key the entries by the client subnet (or anything else that identifies the network), and to be thread-safe if the object is
+ * shared among contexts that run on different threads. See `quicly_new_default_path_profile_cache`.
+ */
+typedef struct st_quicly_path_profile_cache_t {
+    /**
+     * Looks up the profile of the path being used by a new connection. Returns a boolean indicating if the profile was found.
+     */
+    int (*lookup)(struct st_quicly_path_profile_cache_t *self, quicly_conn_t *conn, const struct sockaddr *remote, int64_t now,
+                  quicly_path_profile_t *profile);
+    /**
+     * Records the profile of the path being observed by a connection that is being freed.
+     */
+    void (*store)(struct st_quicly_path_profile_cache_t *self, quicly_conn_t *conn, const struct sockaddr *remote, int64_t now,
+                  const quicly_path_profile_t *profile);
+} quicly_path_profile_cache_t;
+
 struct st_quicly_context_t {
     /**
      * tls context to use
@@ -311,6 +486,11 @@ struct st_quicly_context_t {
      * initial CWND in terms of packet numbers
      */
     uint32_t initcwnd_packets;
+    /**
+     * Maximum number of datagrams that the application can send at once using UDP GSO (or 0 if GSO is not used). When pacing is
+     * enabled, the burst size grows up to this value at high rates, capped to `QUICLY_PACER_BURST_QUANTUM` milliseconds of data.
+     */
+    uint32_t max_gso_segments;
     /**
      * (client-only) Initial QUIC protocol version used by the client. Setting this to a greased version will enforce version
      * negotiation.
@@ -344,6 +524,32 @@ struct st_quicly_context_t {
      * value to zero effectively disables the endpoint responding to path migration attempts.
      */
     uint64_t max_path_validation_failures;
+    /**
+     * Receive window autotuning. When the application consumes data fast enough that a window update is being sent within two
+     * round-trips of the previous one, the receive window is doubled, up to the ceilings specified below. Zero disables autotuning.
+     */
+    struct {
+        /**
+         * maximum size of the stream-level receive window
+         */
+        uint32_t max_stream_window;
+        /**
+         * maximum size of the connection-level receive window
+         */
+        uint64_t max_window;
+    } recv_window_autotune;
+    /**
+     * receive-buffer budget shared among connections (or NULL if not used)
+     */
+    quicly_recvbuf_budget_t *recvbuf_budget;
+    /**
+     * admission control of server-side handshakes (or NULL if not used)
+     */
+    quicly_admission_t *admission;
+    /**
+     * cache of path profiles consulted by the server when accepting connections (or NULL if not used)
+     */
+    quicly_path_profile_cache_t *path_profile_cache;
     /**
      * Jumpstart CWND to be used when there is no previous information. If set to zero, slow start is used. Note jumpstart is
      * possible only when the use_pacing flag is set.
@@ -431,6 +637,14 @@ struct st_quicly_context_t {
      *
      */
     quicly_async_handshake_t *async_handshake;
+    /**
+     * allocator of the data structures being associated to each connection (NULL to use malloc)
+     */
+    quicly_allocator_t *allocator;
+    /**
+     * optional pool of connection objects (see `quicly_new_conn_pool`)
+     */
+    quicly_conn_pool_t *conn_pool;
 };
 
 /**
@@ -608,6 +822,10 @@ struct st_quicly_conn_streamgroup_state_t {
          * number of migrations                                                                                                    \
          */                                                                                                                        \
         uint64_t promoted;                                                                                                         \
+        /**                                                                                                                        \
+         * number of migrations deemed as NAT rebinding (i.e., congestion state and RTT estimate were retained)                    \
+         */                                                                                                                        \
+        uint64_t nat_rebinding;                                                                                                    \
         /**                                                                                                                        \
          * number of alternate paths that were closed due to Connection ID being unavailable                                       \
          */                                                                                                                        \
@@ -648,7 +866,15 @@ struct st_quicly_conn_streamgroup_state_t {
     /**                                                                                                                            \
      * Total number of connections where app-limited state was respected by CC.                                                    \
      */                                                                                                                            \
-    uint64_t num_respected_app_limited
+    uint64_t num_respected_app_limited;                                                                                            \
+    /**                                                                                                                            \
+     * Number of times the connection-level receive window was shrunk due to the context-level receive-buffer budget.              \
+     */                                                                                                                            \
+    uint64_t num_recv_window_throttled;                                                                                            \
+    /**                                                                                                                            \
+     * Number of connections whose initial RTT (and possibly jumpstart) was seeded by the path profile cache.                      \
+     */                                                                                                                            \
+    uint64_t num_path_profile_seeded
 
 /**
  * Stats that do not need to be gathered upon the invocation of `quicly_get_stats`. This macro is used to define the same fields in
@@ -708,10 +934,21 @@ typedef struct st_quicly_stats_t {
      * Estimated delivery rate, in bytes/second.
      */
     quicly_rate_t delivery_rate;
+    /**
+     * Per-ACK delivery rate samples, in bytes/second; the most recent one, and the largest one not being application-limited.
+     */
+    struct {
+        uint64_t latest;
+        uint64_t max;
+    } delivery_rate_sample;
     /**
      * largest number of packets contained in the sentmap
      */
     size_t num_sentmap_packets_largest;
+    /**
+     * size of the connection-level receive window currently committed to the context-level receive-buffer budget
+     */
+    uint64_t recv_window_committed;
 } quicly_stats_t;
 
 /* clang-format off */
@@ -786,6 +1023,7 @@ typedef struct st_quicly_stats_t {
     apply(num_paths.validation_failed, "num-paths.validation-failed")                                                              \
     apply(num_paths.migration_elicited, "num-paths.migration-elicited")                                                            \
     apply(num_paths.promoted, "num-paths.promoted")                                                                                \
+    apply(num_paths.nat_rebinding, "num-paths.nat-rebinding")                                                                      \
     apply(num_paths.closed_no_dcid, "num-paths.closed-no-dcid")                                                                    \
     apply(num_paths.ecn_validated, "num-paths.ecn-validated")                                                                      \
     apply(num_paths.ecn_failed, "num-paths.ecn-failed")                                                                            \
@@ -795,7 +1033,9 @@ typedef struct st_quicly_stats_t {
     apply(num_jumpstart_applicable, "num-jumpstart-applicable")                                                                    \
     apply(num_rapid_start, "num-rapid-start")                                                                                      \
     apply(num_paced, "num-paced")                                                                                                  \
-    apply(num_respected_app_limited, "num-respected-app-limited")
+    apply(num_respected_app_limited, "num-respected-app-limited")                                                                  \
+    apply(num_recv_window_throttled, "num-recv-window-throttled")                                                                  \
+    apply(num_path_profile_seeded, "num-path-profile-seeded")
 
 /**
  * Macro for iterating QUICLY_STATS_PREBUILT_COUNTERS.
@@ -838,7 +1078,10 @@ typedef struct st_quicly_stats_t {
     apply(delivery_rate.latest, "delivery-rate.latest")                                                                            \
     apply(delivery_rate.smoothed, "delivery-rate.smoothed")                                                                        \
     apply(delivery_rate.stdev, "delivery-rate.stdev")                                                                              \
-    apply(num_sentmap_packets_largest, "num-sentmap-packets-largest")
+    apply(delivery_rate_sample.latest, "delivery-rate-sample.latest")                                                              \
+    apply(delivery_rate_sample.max, "delivery-rate-sample.max")                                                                    \
+    apply(num_sentmap_packets_largest, "num-sentmap-packets-largest")                                                              \
+    apply(recv_window_committed, "recv-window-committed")
 
 #define QUICLY_STATS_FOREACH(apply)                                                                                                \
     QUICLY_STATS_FOREACH_COUNTERS(apply)                                                                                           \
@@ -929,6 +1172,24 @@ typedef enum {
     QUICLY_SENDER_STATE_ACKED,
 } quicly_sender_state_t;
 
+/**
+ * A chunk of received stream data, as passed to `quicly_stream_callbacks_t::on_receive_batch`.
+ */
+typedef struct st_quicly_stream_recv_vec_t {
+    /**
+     * offset within the receive buffer (see `quicly_stream_callbacks_t::on_receive`)
+     */
+    size_t off;
+    /**
+     * the data
+     */
+    const void *src;
+    /**
+     * length of the data
+     */
+    size_t len;
+} quicly_stream_recv_vec_t;
+
 /**
  * API that allows applications to specify it's own send / receive buffer.  The callback should be assigned by the
  * `quicly_context_t::on_stream_open` callback.
@@ -965,6 +1226,13 @@ typedef struct st_quicly_stream_callbacks_t {
      * called when a RESET_STREAM frame is received
      */
     void (*on_receive_reset)(quicly_stream_t *stream, quicly_error_t err);
+    /**
+     * Optional. If set, `on_receive` is not used. Instead, data carried by consecutive STREAM frames of a packet is accumulated,
+     * and delivered by calling this callback once for each stream, with the chunks listed in the order they were received.
+     * `vecs[n].off` has the same semantics as the `off` argument of `on_receive`; an entry with zero `len` indicates that the FIN
+     * has been received.
+     */
+    void (*on_receive_batch)(quicly_stream_t *stream, const quicly_stream_recv_vec_t *vecs, size_t num_vecs);
 } quicly_stream_callbacks_t;
 
 struct st_quicly_stream_t {
@@ -1045,6 +1313,12 @@ struct st_quicly_stream_t {
          * size of the receive window
          */
         uint32_t window;
+        /**
+         * when MAX_STREAM_DATA was last sent (or when the stream was opened), and the value of `recvstate.data_off` at that moment;
+         * used for autotuning the receive window
+         */
+        int64_t window_updated_at;
+        uint64_t window_updated_data_off;
         /**
          * Maximum number of ranges (i.e. gaps + 1) permitted in `recvstate.ranges`.
          * As discussed in https://github.com/h2o/quicly/issues/278, this value should be proportional to the size of the receive
@@ -1132,6 +1406,14 @@ typedef struct st_quicly_decoded_packet_t {
     } _is_stateless_reset_cached;
 } quicly_decoded_packet_t;
 
+/**
+ * A received packet to which a stateless response is to be sent, along with the address of the sender.
+ */
+typedef struct st_quicly_stateless_request_t {
+    quicly_decoded_packet_t *packet;
+    struct sockaddr *addr;
+} quicly_stateless_request_t;
+
 struct st_quicly_address_token_plaintext_t {
     enum { QUICLY_ADDRESS_TOKEN_TYPE_RETRY, QUICLY_ADDRESS_TOKEN_TYPE_RESUMPTION } type;
     uint64_t issued_at;
@@ -1262,9 +1544,32 @@ static void **quicly_get_data(quicly_conn_t *conn);
  */
 static quicly_tracer_t *quicly_get_tracer(quicly_conn_t *conn);
 /**
- * destroys a connection object.
+ * destroys a connection object. If `quicly_context_t::conn_pool` is set and is not full, the memory is reset and retained in the
+ * pool.
  */
 void quicly_free(quicly_conn_t *conn);
+/**
+ * Creates a pool of connection objects to be used by the contexts that share the allocator with `ctx`, so that connections can be
+ * instantiated without calling the allocator for the connection object, the stream table and the pacer. `capacity` objects are
+ * allocated and initialized upfront, and objects released by `quicly_free` are reset and returned to the pool while it has room.
+ * The pool is not thread-safe; multi-threaded servers should create one pool for each thread.
+ * @return the pool, or NULL if failed to allocate memory
+ */
+quicly_conn_pool_t *quicly_new_conn_pool(quicly_context_t *ctx, size_t capacity);
+/**
+ * Releases the pool and the connection objects retained. The pool must not be used by any context thereafter.
+ */
+void quicly_free_conn_pool(quicly_conn_pool_t *pool);
+/**
+ * Releases the memory that an idle connection does not need, so that a large number of mostly idle connections can be kept with
+ * less RAM. The connection has to be confirmed, with all packets being acked and nothing to be sent; otherwise, this function does
+ * nothing. The connection can be used as usual after being hibernated (i.e., `quicly_receive`, `quicly_send`, and the stream APIs
+ * reallocate memory on demand), and it is the application's responsibility to release the buffers of the streams it owns. The TLS
+ * object is released as well; `quicly_get_tls` returns NULL thereafter, and the properties of the handshake can be obtained by
+ * calling `quicly_get_server_name` and `quicly_get_negotiated_protocol`.
+ * @return if the connection has been hibernated
+ */
+int quicly_hibernate(quicly_conn_t *conn);
 /**
  * closes the connection.  `err` is the application error code using the coalesced scheme (see QUICLY_ERROR_* macros), or zero (no
  * error; indicating idle close).  An application should continue calling quicly_receive and quicly_send, until they return
@@ -1349,10 +1654,46 @@ uint8_t quicly_send_get_ecn_bits(quicly_conn_t *conn);
  */
 size_t quicly_send_close_invalid_token(quicly_context_t *ctx, uint32_t protocol_version, ptls_iovec_t dest_cid,
                                        ptls_iovec_t src_cid, const char *err_desc, void *datagram);
+/**
+ * Builds a UDP datagram containing an Initial packet that closes the connection with CONNECTION_REFUSED, in response to an Initial
+ * packet that is not to be accepted.
+ */
+size_t quicly_send_close_connection_refused(quicly_context_t *ctx, uint32_t protocol_version, ptls_iovec_t dest_cid,
+                                            ptls_iovec_t src_cid, const char *err_desc, void *datagram);
 /**
  *
  */
 size_t quicly_send_stateless_reset(quicly_context_t *ctx, const void *src_cid, void *payload);
+/**
+ * Initializes the rate limiter of stateless responses.
+ */
+void quicly_stateless_ratelimit_init(quicly_stateless_ratelimit_t *limiter, uint32_t rate, uint32_t burst, ptls_context_t *tls);
+/**
+ * Consumes one token from the bucket of the address. Returns if a response can be sent.
+ */
+int quicly_stateless_ratelimit_consume(quicly_stateless_ratelimit_t *limiter, struct sockaddr *addr, int64_t now);
+/**
+ * Batch variant of `quicly_send_stateless_reset`. For each request, a Stateless Reset packet is built into `buf` contiguously and
+ * `datagrams[i]` is set to point to it. The length of `datagrams[i]` is set to zero if the packet is a long header packet, if the
+ * datagram being received is not larger than the Stateless Reset (so that loops cannot be formed), if the rate limiter rejects, or
+ * if `buf` is exhausted. The stateless reset tokens are generated using the batch interface of the CID encryptor when available.
+ * @param limiter  the rate limiter, or NULL if not used
+ * @return number of datagrams being built, or SIZE_MAX if the CID encryptor failed to generate the tokens
+ */
+size_t quicly_send_stateless_reset_batch(quicly_context_t *ctx, quicly_stateless_ratelimit_t *limiter, int64_t now,
+                                         const quicly_stateless_request_t *requests, size_t count, struct iovec *datagrams,
+                                         void *buf, size_t bufsize);
+/**
+ * Batch variant of `quicly_send_version_negotiation`, building the responses into `buf` contiguously with `datagrams[i]` pointing
+ * to each of them. The length of `datagrams[i]` is set to zero if the packet is not a long header packet, if it is a Version
+ * Negotiation packet, if the datagram being received is smaller than QUICLY_MIN_CLIENT_INITIAL_SIZE, if the rate limiter rejects,
+ * or if `buf` is exhausted.
+ * @param limiter  the rate limiter, or NULL if not used
+ * @return number of datagrams being built
+ */
+size_t quicly_send_version_negotiation_batch(quicly_context_t *ctx, quicly_stateless_ratelimit_t *limiter, int64_t now,
+                                             const quicly_stateless_request_t *requests, size_t count, const uint32_t *versions,
+                                             struct iovec *datagrams, void *buf, size_t bufsize);
 /**
  *
  */
@@ -1419,9 +1760,28 @@ quicly_error_t quicly_accept(quicly_conn_t **conn, quicly_context_t *ctx, struct
                              const quicly_cid_plaintext_t *new_cid, ptls_handshake_properties_t *handshake_properties,
                              void *appdata);
 /**
- *
+ * Returns the action that the admission control recommends for a new connection attempt, counting it in `num_decisions`.
+ * Applications not setting `quicly_admission_t::enforce` call this function before `quicly_accept`.
+ * @param address_validated  if the client's address has been validated using an address validation token
+ */
+quicly_admission_action_t quicly_admission_decide(quicly_admission_t *admission, int64_t now, int address_validated);
+/**
+ * Returns the TLS object, or NULL if it has been released by `quicly_hibernate`.
  */
 ptls_t *quicly_get_tls(quicly_conn_t *conn);
+/**
+ * Returns the log state of the connection; see `ptls_get_log_state`. Unlike the picotls functions, this function (as well as
+ * `quicly_get_server_name` and `quicly_get_negotiated_protocol`) can be used after `quicly_hibernate` releases the TLS object.
+ */
+ptls_log_conn_state_t *quicly_get_log_state(quicly_conn_t *conn);
+/**
+ * Returns the server name (SNI) of the connection, or NULL if not available.
+ */
+const char *quicly_get_server_name(quicly_conn_t *conn);
+/**
+ * Returns the negotiated application protocol (ALPN), or NULL if not negotiated.
+ */
+const char *quicly_get_negotiated_protocol(quicly_conn_t *conn);
 /**
  * Resumes an async TLS handshake, and returns a pointer to the QUIC connection or NULL if the corresponding QUIC connection has
  * been discarded. See `quicly_async_handshake_t`.
@@ -1591,12 +1951,11 @@ extern const quicly_stream_callbacks_t quicly_stream_noop_callbacks;
         if (PTLS_LIKELY(active == 0))                                                                                              \
             break;                                                                                                                 \
         quicly_conn_t *_c = (_conn);                                                                                               \
-        ptls_t *_tls = quicly_get_tls(_c);                                                                                         \
-        ptls_log_conn_state_t *conn_state = ptls_get_log_state(_tls);                                                              \
-        active &= ptls_log_conn_maybe_active(conn_state, (const char *(*)(void *))ptls_get_server_name, _tls);                     \
+        ptls_log_conn_state_t *conn_state = quicly_get_log_state(_c);                                                              \
+        active &= ptls_log_conn_maybe_active(conn_state, (const char *(*)(void *))quicly_get_server_name, _c);                     \
         if (PTLS_LIKELY(active == 0))                                                                                              \
             break;                                                                                                                 \
-        PTLS_LOG__DO_LOG(quicly, _name, conn_state, (const char *(*)(void *))ptls_get_server_name, _tls, _c->stash.now == 0, {     \
+        PTLS_LOG__DO_LOG(quicly, _name, conn_state, (const char *(*)(void *))quicly_get_server_name, _c, _c->stash.now == 0, {     \
             if (_c->stash.now != 0)                                                                                                \
                 PTLS_LOG_ELEMENT_SIGNED(time, _c->stash.now);                                                                      \
             PTLS_LOG_ELEMENT_PTR(conn, _c);                                                                                        \
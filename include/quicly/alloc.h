@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2026 Fastly
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef quicly_alloc_h
+#define quicly_alloc_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdlib.h>
+
+/**
+ * Identifies the subsystem for which memory is being allocated, so that allocators can choose the pool or the arena, or account
+ * the usage.
+ */
+typedef enum en_quicly_alloc_tag_t {
+    QUICLY_ALLOC_TAG_CONN,
+    QUICLY_ALLOC_TAG_PATH,
+    QUICLY_ALLOC_TAG_PN_SPACE,
+    QUICLY_ALLOC_TAG_STREAM,
+    QUICLY_ALLOC_TAG_STREAMBUF,
+    QUICLY_ALLOC_TAG_SENTMAP,
+    QUICLY_ALLOC_TAG_RANGES,
+    QUICLY_ALLOC_TAG_PACER,
+    QUICLY_ALLOC_TAG_TOKEN,
+    QUICLY_ALLOC_TAG_DELAYED_PACKET,
+    QUICLY_ALLOC_TAG_DATAGRAM_FRAME,
+    QUICLY_NUM_ALLOC_TAGS
+} quicly_alloc_tag_t;
+
+/**
+ * Memory allocator. The size of the memory block is passed to `realloc` and `free` as well as to `alloc`, so that allocators using
+ * size classes can locate the class without maintaining headers (as `sdallocx` of jemalloc does).
+ *
+ * The stream tables (khash) and the buffers of type `ptls_buffer_t` (e.g., the receive buffer of `quicly_streambuf_t`) are not
+ * routed through the allocator, as those libraries call the malloc family of functions directly, without taking a context.
+ */
+typedef struct st_quicly_allocator_t {
+    void *(*alloc)(struct st_quicly_allocator_t *self, size_t size, quicly_alloc_tag_t tag);
+    void *(*realloc)(struct st_quicly_allocator_t *self, void *p, size_t old_size, size_t new_size, quicly_alloc_tag_t tag);
+    void (*free)(struct st_quicly_allocator_t *self, void *p, size_t size, quicly_alloc_tag_t tag);
+} quicly_allocator_t;
+
+/**
+ * Allocates memory using the allocator, or malloc if `allocator` is NULL.
+ */
+static void *quicly_alloc(quicly_allocator_t *allocator, size_t size, quicly_alloc_tag_t tag);
+/**
+ * Resizes memory using the allocator, or realloc if `allocator` is NULL.
+ */
+static void *quicly_realloc(quicly_allocator_t *allocator, void *p, size_t old_size, size_t new_size, quicly_alloc_tag_t tag);
+/**
+ * Releases memory using the allocator, or free if `allocator` is NULL. `p` can be NULL.
+ */
+static void quicly_dealloc(quicly_allocator_t *allocator, void *p, size_t size, quicly_alloc_tag_t tag);
+
+/* inline definitions */
+
+inline void *quicly_alloc(quicly_allocator_t *allocator, size_t size, quicly_alloc_tag_t tag)
+{
+    return allocator != NULL ? allocator->alloc(allocator, size, tag) : malloc(size);
+}
+
+inline void *quicly_realloc(quicly_allocator_t *allocator, void *p, size_t old_size, size_t new_size, quicly_alloc_tag_t tag)
+{
+    return allocator != NULL ? allocator->realloc(allocator, p, old_size, new_size, tag) : realloc(p, new_size);
+}
+
+inline void quicly_dealloc(quicly_allocator_t *allocator, void *p, size_t size, quicly_alloc_tag_t tag)
+{
+    if (p == NULL)
+        return;
+    if (allocator != NULL) {
+        allocator->free(allocator, p, size, tag);
+    } else {
+        free(p);
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
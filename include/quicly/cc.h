@@ -44,6 +44,27 @@ extern "C" {
 #define QUICLY_RAPID_START_ACK_FACTOR (QUICLY_RAPID_START_K * (1 - QUICLY_RENO_BETA))
 #define QUICLY_RAPID_START_LOSS_FACTOR (QUICLY_RENO_BETA + QUICLY_RAPID_START_ACK_FACTOR)
 
+/* duration of the Non-Validated Period (in milliseconds), see RFC 7661 Section 4.4 */
+#define QUICLY_CC_CWV_NVP_DURATION 300000
+
+/* HyStart++ constants, see RFC 9406 Section 4.3 */
+#define QUICLY_HYSTART_MIN_RTT_THRESH 4  /* in milliseconds */
+#define QUICLY_HYSTART_MAX_RTT_THRESH 16 /* in milliseconds */
+#define QUICLY_HYSTART_MIN_RTT_DIVISOR 8
+#define QUICLY_HYSTART_N_RTT_SAMPLE 8
+#define QUICLY_HYSTART_CSS_GROWTH_DIVISOR 4
+#define QUICLY_HYSTART_CSS_ROUNDS 5
+
+/* Prague constants, see draft-briscoe-iccrg-prague-congestion-control */
+#define QUICLY_PRAGUE_ALPHA_GAIN (1. / 16) /* EWMA gain (g) of the CE-marked fraction, as in DCTCP (RFC 8257) */
+#define QUICLY_PRAGUE_RTT_REF 25           /* reference RTT (in milliseconds) below which the additive increase is scaled down */
+
+/* LEDBAT++ constants, see draft-irtf-iccrg-ledbat-plus-plus */
+#define QUICLY_LEDBAT_TARGET 60                 /* target queueing delay (in milliseconds) */
+#define QUICLY_LEDBAT_MAX_GAIN_DIVISOR 16       /* GAIN = 1 / min(16, ceil(2 * TARGET / base_delay)) */
+#define QUICLY_LEDBAT_DELAY_FILTER 4            /* current delay is the minimum of this many latest RTT samples (RFC 6817) */
+#define QUICLY_LEDBAT_SLOWDOWN_INTERVAL_RATIO 9 /* next slowdown starts after 9x the duration of the previous one */
+
 /**
  * Holds pointers to concrete congestion control implementation functions.
  */
@@ -71,6 +92,45 @@ struct st_quicly_cc_rapid_start_t {
     };
 };
 
+#define QUICLY_CC_HYSTART_DISABLED 0
+#define QUICLY_CC_HYSTART_SLOW_START 1 /* standard slow start, sampling RTT of each round */
+#define QUICLY_CC_HYSTART_CSS 2        /* Conservative Slow Start; CWND grows at 1/CSS_GROWTH_DIVISOR the rate of slow start */
+#define QUICLY_CC_HYSTART_DONE 3       /* slow start has been exited, either by HyStart++ or due to congestion */
+
+/**
+ * state used by HyStart++ (RFC 9406)
+ */
+struct st_quicly_cc_hystart_t {
+    /**
+     * One of QUICLY_CC_HYSTART_*. Zero (i.e., `QUICLY_CC_HYSTART_DISABLED`) if HyStart++ is not used.
+     */
+    uint8_t phase;
+    /**
+     * number of RTT samples taken in the current round
+     */
+    uint32_t rtt_sample_count;
+    /**
+     * number of rounds that have been spent in CSS
+     */
+    uint32_t css_rounds;
+    /**
+     * packet number that ends the current round
+     */
+    uint64_t window_end;
+    /**
+     * minimum RTT observed in the previous and the current round
+     */
+    uint32_t last_round_min_rtt, current_round_min_rtt;
+    /**
+     * the value of `current_round_min_rtt` when CSS was entered; used to detect spurious exits from slow start
+     */
+    uint32_t css_baseline_min_rtt;
+    /**
+     * stash of acknowledged bytes not yet reflected to CWND during CSS
+     */
+    uint32_t css_stash;
+};
+
 typedef struct st_quicly_cc_t {
     /**
      * Congestion controller type.
@@ -123,9 +183,9 @@ typedef struct st_quicly_cc_t {
          */
         struct {
             /**
-             * Time offset from the latest congestion event until cwnd reaches W_max again.
+             * Time offset (in milliseconds) from the latest congestion event until cwnd reaches W_max again.
              */
-            double k;
+            uint32_t k;
             /**
              * Last cwnd value before the latest congestion event.
              */
@@ -143,6 +203,183 @@ typedef struct st_quicly_cc_t {
              */
             int64_t last_sent_time;
         } cubic;
+        /**
+         * State information for BBR (version 3) congestion control.
+         */
+        struct {
+            /**
+             * Current state of the state machine (one of the `QUICLY_CC_BBR_MODE_*` values defined in lib/cc-bbr.c).
+             */
+            uint8_t mode;
+            /**
+             * Number of consecutive rounds in STARTUP without significant growth of the bandwidth estimate.
+             */
+            uint8_t full_bw_count;
+            /**
+             * If STARTUP has determined that the pipe is full.
+             */
+            unsigned full_bw_reached : 1;
+            /**
+             * If any of the acks received in the current round indicated that the sender was CC-limited.
+             */
+            unsigned cc_limited_in_round : 1;
+            /**
+             * If at least one round has been completed since the inflight reached the target in PROBE_RTT.
+             */
+            unsigned probe_rtt_round_done : 1;
+            /**
+             * If CWND has been collapsed by persistent congestion, to be restored to `prior_cwnd` upon exiting recovery.
+             */
+            unsigned restore_cwnd_on_recovery : 1;
+            /**
+             * Windowed max filter of delivery rate samples (in bytes/sec), indexed by ProbeBW cycle; [0] holds the current one.
+             */
+            uint64_t max_bw_filter[2];
+            /**
+             * Short-term lower bound of the delivery rate, adapted upon loss (UINT64_MAX if unset).
+             */
+            uint64_t bw_lo;
+            /**
+             * Bandwidth estimate recorded when the last significant growth in STARTUP was observed.
+             */
+            uint64_t full_bw;
+            /**
+             * Current pacing rate (in bytes/sec), or zero if no bandwidth sample has been taken yet.
+             */
+            uint64_t pacing_rate;
+            /**
+             * Windowed min RTT (10 seconds), and when it was sampled.
+             */
+            uint32_t min_rtt;
+            int64_t min_rtt_stamp;
+            /**
+             * Windowed min RTT used for scheduling PROBE_RTT (5 seconds), and when it was sampled.
+             */
+            uint32_t probe_rtt_min_delay;
+            int64_t probe_rtt_min_stamp;
+            /**
+             * When PROBE_RTT can be exitted (0 if inflight has not yet dropped to the PROBE_RTT target).
+             */
+            int64_t probe_rtt_done_stamp;
+            /**
+             * Round-trip counting; a round ends when a packet sent at or after `round_end_pn` is acknowledged.
+             */
+            uint64_t round_end_pn;
+            uint64_t round_count;
+            /**
+             * Total bytes acknowledged, and the value of that counter when the current round started.
+             */
+            uint64_t delivered;
+            uint64_t round_start_delivered;
+            /**
+             * Largest delivery rate sampled during the current round (in bytes/sec).
+             */
+            uint64_t bw_latest;
+            /**
+             * Bytes and number of loss events observed during the current round.
+             */
+            uint32_t lost_in_round;
+            uint32_t loss_events_in_round;
+            /**
+             * Number of ACK frames received during the current round, and the number of them that reported new CE marks.
+             */
+            uint32_t acks_in_round;
+            uint32_t ce_acks_in_round;
+            /**
+             * EWMA of `ce_acks_in_round / acks_in_round` being sampled at the end of each round.
+             */
+            double ecn_alpha;
+            /**
+             * Number of consecutive rounds in STARTUP with the ratio of CE marks exceeding the threshold.
+             */
+            uint8_t startup_ecn_rounds;
+            /**
+             * Long-term and short-term upper bounds of the volume of data in flight (UINT32_MAX if unset).
+             */
+            uint32_t inflight_hi;
+            uint32_t inflight_lo;
+            /**
+             * Start of the current ProbeBW cycle (or phase), in rounds and in wall-clock time.
+             */
+            uint64_t cycle_start_round;
+            uint64_t phase_start_round;
+            int64_t cycle_stamp;
+            /**
+             * Randomized wall-clock time (in milliseconds) to be spent before probing for more bandwidth.
+             */
+            uint32_t bw_probe_wait;
+            /**
+             * Number of rounds spent in PROBE_BW_UP, governing the growth rate of `inflight_hi`.
+             */
+            uint32_t probe_up_rounds;
+            /**
+             * CWND saved upon entering PROBE_RTT or upon persistent congestion.
+             */
+            uint32_t prior_cwnd;
+            /**
+             * Most recent max_udp_payload_size being reported.
+             */
+            uint32_t max_udp_payload_size;
+        } bbr;
+        /**
+         * State information for Prague (L4S) congestion control.
+         */
+        struct {
+            /**
+             * EWMA of the fraction of bytes being CE-marked per round trip (i.e., DCTCP's alpha), ranging from 0 to 1.
+             */
+            double alpha;
+            /**
+             * A round ends when a packet sent at or after `round_end_pn` is acknowledged.
+             */
+            uint64_t round_end_pn;
+            /**
+             * Bytes acknowledged and bytes reported as CE-marked during the current round.
+             */
+            uint32_t bytes_acked_in_round;
+            uint32_t bytes_marked_in_round;
+            /**
+             * Stash of acknowledged bytes, used during congestion avoidance.
+             */
+            uint64_t stash;
+            /**
+             * Most recent max_udp_payload_size being reported.
+             */
+            uint32_t max_udp_payload_size;
+        } prague;
+        /**
+         * State information for LEDBAT++.
+         */
+        struct {
+            /**
+             * Latest RTT samples, the minimum of which is used as the current delay.
+             */
+            uint32_t delay_samples[QUICLY_LEDBAT_DELAY_FILTER];
+            /**
+             * Number of RTT samples being recorded so far.
+             */
+            uint32_t num_delay_samples;
+            /**
+             * Most recent max_udp_payload_size being reported.
+             */
+            uint32_t max_udp_payload_size;
+            /**
+             * Stash of acknowledged bytes, used during congestion avoidance.
+             */
+            uint64_t stash;
+            /**
+             * When the next periodic slowdown is to begin, or INT64_MAX if not yet scheduled (i.e., in the initial slow start).
+             */
+            int64_t slowdown_at;
+            /**
+             * When the ongoing slowdown has begun, or INT64_MAX if not in a slowdown.
+             */
+            int64_t slowdown_started_at;
+            /**
+             * During a slowdown, CWND is kept at the minimum until this time, after which slow start is used to regain SSTHRESH.
+             */
+            int64_t slowdown_freeze_until;
+        } ledbat;
     } state;
     /**
      * jumpstart state
@@ -165,6 +402,24 @@ typedef struct st_quicly_cc_t {
      * rapid start
      */
     struct st_quicly_cc_rapid_start_t rapid_start;
+    /**
+     * HyStart++
+     */
+    struct st_quicly_cc_hystart_t hystart;
+    /**
+     * CWND validation (RFC 7661); used by Reno, CUBIC, and Pico
+     */
+    struct {
+        /**
+         * The time at which the sender became app-limited (i.e., started using less than half of CWND), or INT64_MAX if the sender
+         * is CC-limited. This is also the beginning of the current Non-Validated Period.
+         */
+        int64_t app_limited_since;
+        /**
+         * Largest amount of bytes in flight observed by the ACKs received since `app_limited_since` (i.e., pipeACK).
+         */
+        uint32_t pipe_ack;
+    } cwnd_validation;
     /**
      * Initial congestion window.
      */
@@ -210,9 +465,11 @@ struct st_quicly_cc_type_t {
     struct st_quicly_init_cc_t *cc_init;
     /**
      * Called when a packet is newly acknowledged.
+     * @param rs  delivery rate sample built from the packets being acknowledged (`rs->rate` is zero if the sample is invalid)
      */
     void (*cc_on_acked)(quicly_cc_t *cc, const quicly_loss_t *loss, uint32_t bytes, uint64_t largest_acked, uint32_t inflight,
-                        int cc_limited, uint64_t next_pn, int64_t now, uint32_t max_udp_payload_size);
+                        int cc_limited, const quicly_delivery_rate_sample_t *rs, uint64_t next_pn, int64_t now,
+                        uint32_t max_udp_payload_size);
     /**
      * Called when a packet is detected as lost.
      * @param bytes    bytes declared lost, or zero iff ECN_CE is observed
@@ -240,16 +497,35 @@ struct st_quicly_cc_type_t {
      * [optional] turns on rapid start
      */
     void (*enable_rapid_start)(quicly_cc_t *cc, int64_t now);
+    /**
+     * [optional] returns the pacing rate (in bytes/msec, no less than 1) determined by the congestion controller. When omitted,
+     * the rate is derived from CWND and the smoothed RTT.
+     */
+    uint32_t (*cc_pacing_rate)(quicly_cc_t *cc, const quicly_loss_t *loss);
+    /**
+     * [optional] Called when packets are newly reported as CE-marked, by CCs that respond to ECN in a scalable manner (L4S, RFC
+     * 9330). Packets sent by such CCs carry ECT(1) instead of ECT(0), and CE marks are not reported via `cc_on_lost`.
+     * @param num_packets    number of packets newly reported as CE-marked
+     * @param largest_acked  largest packet number being newly acknowledged by the ACK frame carrying the report
+     */
+    void (*cc_on_ecn_ce)(quicly_cc_t *cc, const quicly_loss_t *loss, uint32_t num_packets, uint64_t largest_acked, uint64_t next_pn,
+                         int64_t now, uint32_t max_udp_payload_size);
 };
 
 /**
  * The type objects for each CC. These can be used for testing the type of each `quicly_cc_t`.
  */
-extern quicly_cc_type_t quicly_cc_type_reno, quicly_cc_type_cubic, quicly_cc_type_pico;
+extern quicly_cc_type_t quicly_cc_type_reno, quicly_cc_type_cubic, quicly_cc_type_pico, quicly_cc_type_bbr, quicly_cc_type_prague,
+    quicly_cc_type_ledbat;
 /**
  * The factory methods for each CC.
  */
-extern struct st_quicly_init_cc_t quicly_cc_reno_init, quicly_cc_cubic_init, quicly_cc_pico_init;
+extern struct st_quicly_init_cc_t quicly_cc_reno_init, quicly_cc_cubic_init, quicly_cc_pico_init, quicly_cc_bbr_init,
+    quicly_cc_prague_init, quicly_cc_ledbat_init;
+/**
+ * The factory methods for Reno and CUBIC with HyStart++ turned on.
+ */
+extern struct st_quicly_init_cc_t quicly_cc_reno_hystart_init, quicly_cc_cubic_hystart_init;
 
 /**
  * A null-terminated list of all CC types.
@@ -305,6 +581,43 @@ static void quicly_cc_rapid_start_on_first_lost(struct st_quicly_cc_rapid_start_
 static void quicly_cc_rapid_start_on_recovery(struct st_quicly_cc_rapid_start_t *rs, uint32_t *cwnd, uint32_t bytes_acked,
                                               uint32_t bytes_lost);
 
+/**
+ * Resets the state of CWND validation.
+ */
+static void quicly_cc_cwv_reset(quicly_cc_t *cc);
+/**
+ * If the sender is app-limited, i.e., CWND has not been validated by the recent ACKs.
+ */
+static int quicly_cc_cwv_is_app_limited(quicly_cc_t *cc);
+/**
+ * Updates the state of CWND validation upon receiving an ACK. If the sender stays app-limited for longer than the Non-Validated
+ * Period, CWND is reduced as specified in RFC 7661 Section 4.4.4.
+ */
+static void quicly_cc_cwv_on_acked(quicly_cc_t *cc, int cc_limited, uint32_t inflight, int64_t now);
+/**
+ * Upon congestion, clamps CWND to the amount that has actually been used while app-limited, so that the multiplicative decrease
+ * that follows is applied to a validated value (RFC 7661 Section 4.4.3).
+ */
+static void quicly_cc_cwv_on_congestion(quicly_cc_t *cc, uint32_t bytes_in_flight);
+/**
+ * Turns on HyStart++.
+ */
+static void quicly_cc_init_hystart(struct st_quicly_cc_hystart_t *hs);
+/**
+ * If HyStart++ is used on the connection.
+ */
+static int quicly_cc_hystart_is_enabled(struct st_quicly_cc_hystart_t *hs);
+/**
+ * Updates the per-round RTT samples of HyStart++ and returns the amount by which CWND should be increased in slow start. When
+ * HyStart++ decides to exit slow start, `cc->ssthresh` is set to the current CWND. Must only be called while in slow start.
+ */
+static uint32_t quicly_cc_hystart_on_acked(quicly_cc_t *cc, uint32_t bytes, uint64_t largest_acked, uint64_t next_pn,
+                                           uint32_t latest_rtt, int64_t now);
+/**
+ * Stops HyStart++ upon congestion, returning a boolean indicating if the congestion was observed in Conservative Slow Start.
+ */
+static int quicly_cc_hystart_on_congestion(struct st_quicly_cc_hystart_t *hs);
+
 /* inline definitions */
 
 inline void quicly_cc__update_ecn_episodes(quicly_cc_t *cc, uint32_t lost_bytes, uint64_t lost_pn)
@@ -487,6 +800,155 @@ inline void quicly_cc_rapid_start_on_recovery(struct st_quicly_cc_rapid_start_t
         *cwnd = rs->cwnd_floor;
 }
 
+inline void quicly_cc_cwv_reset(quicly_cc_t *cc)
+{
+    cc->cwnd_validation.app_limited_since = INT64_MAX;
+    cc->cwnd_validation.pipe_ack = 0;
+}
+
+inline int quicly_cc_cwv_is_app_limited(quicly_cc_t *cc)
+{
+    return cc->cwnd_validation.app_limited_since != INT64_MAX;
+}
+
+inline void quicly_cc_cwv_on_acked(quicly_cc_t *cc, int cc_limited, uint32_t inflight, int64_t now)
+{
+    if (cc_limited) {
+        quicly_cc_cwv_reset(cc);
+        return;
+    }
+
+    if (cc->cwnd_validation.pipe_ack < inflight)
+        cc->cwnd_validation.pipe_ack = inflight;
+    if (cc->cwnd_validation.app_limited_since == INT64_MAX) {
+        cc->cwnd_validation.app_limited_since = now;
+        return;
+    }
+    if (now - cc->cwnd_validation.app_limited_since < QUICLY_CC_CWV_NVP_DURATION)
+        return;
+
+    /* Non-Validated Period has expired; reduce CWND to max(CWND / 2, pipeACK, IW), and start another period */
+    uint32_t new_cwnd = cc->cwnd / 2;
+    if (new_cwnd < cc->cwnd_validation.pipe_ack)
+        new_cwnd = cc->cwnd_validation.pipe_ack;
+    if (new_cwnd < cc->cwnd_initial)
+        new_cwnd = cc->cwnd_initial;
+    if (new_cwnd < cc->cwnd) {
+        if (cc->ssthresh < cc->cwnd / 4 * 3)
+            cc->ssthresh = cc->cwnd / 4 * 3;
+        cc->cwnd = new_cwnd;
+        if (cc->cwnd_minimum > cc->cwnd)
+            cc->cwnd_minimum = cc->cwnd;
+    }
+    cc->cwnd_validation.app_limited_since = now;
+    cc->cwnd_validation.pipe_ack = 0;
+}
+
+inline void quicly_cc_cwv_on_congestion(quicly_cc_t *cc, uint32_t bytes_in_flight)
+{
+    if (cc->cwnd_validation.app_limited_since == INT64_MAX)
+        return;
+
+    uint32_t validated = cc->cwnd_validation.pipe_ack;
+    if (validated < bytes_in_flight)
+        validated = bytes_in_flight;
+    if (validated < cc->cwnd_initial)
+        validated = cc->cwnd_initial;
+    if (cc->cwnd > validated)
+        cc->cwnd = validated;
+}
+
+inline void quicly_cc_init_hystart(struct st_quicly_cc_hystart_t *hs)
+{
+    *hs = (struct st_quicly_cc_hystart_t){
+        .phase = QUICLY_CC_HYSTART_SLOW_START,
+        .last_round_min_rtt = UINT32_MAX,
+        .current_round_min_rtt = UINT32_MAX,
+        .css_baseline_min_rtt = UINT32_MAX,
+    };
+}
+
+inline int quicly_cc_hystart_is_enabled(struct st_quicly_cc_hystart_t *hs)
+{
+    return hs->phase != QUICLY_CC_HYSTART_DISABLED;
+}
+
+inline uint32_t quicly_cc_hystart_on_acked(quicly_cc_t *cc, uint32_t bytes, uint64_t largest_acked, uint64_t next_pn,
+                                           uint32_t latest_rtt, int64_t now)
+{
+    struct st_quicly_cc_hystart_t *hs = &cc->hystart;
+
+    if (!(hs->phase == QUICLY_CC_HYSTART_SLOW_START || hs->phase == QUICLY_CC_HYSTART_CSS))
+        return bytes;
+
+    /* Leave the unvalidated phase of jumpstart alone, as the RTT samples are inflated by the jump. */
+    if (cc->jumpstart.enter_pn != UINT64_MAX && largest_acked < cc->jumpstart.exit_pn)
+        return bytes;
+
+    /* at the beginning of each round, rotate the samples; CSS rounds are counted as well */
+    if (largest_acked >= hs->window_end) {
+        hs->window_end = next_pn;
+        hs->last_round_min_rtt = hs->current_round_min_rtt;
+        hs->current_round_min_rtt = UINT32_MAX;
+        hs->rtt_sample_count = 0;
+        if (hs->phase == QUICLY_CC_HYSTART_CSS && ++hs->css_rounds >= QUICLY_HYSTART_CSS_ROUNDS) {
+            /* CSS lasted long enough; the increase of RTT is real, exit slow start */
+            hs->phase = QUICLY_CC_HYSTART_DONE;
+            cc->ssthresh = cc->cwnd;
+            if (cc->cwnd_exiting_slow_start == 0) {
+                cc->cwnd_exiting_slow_start = cc->cwnd;
+                cc->exit_slow_start_at = now;
+            }
+            return 0;
+        }
+    }
+
+    /* take RTT sample */
+    if (hs->current_round_min_rtt > latest_rtt)
+        hs->current_round_min_rtt = latest_rtt;
+    ++hs->rtt_sample_count;
+
+    if (hs->rtt_sample_count >= QUICLY_HYSTART_N_RTT_SAMPLE) {
+        if (hs->phase == QUICLY_CC_HYSTART_SLOW_START) {
+            /* enter CSS if RTT increased by more than max(4ms, min(16ms, last_round_min_rtt / 8)) */
+            if (hs->last_round_min_rtt != UINT32_MAX && hs->current_round_min_rtt != UINT32_MAX) {
+                uint32_t thresh = hs->last_round_min_rtt / QUICLY_HYSTART_MIN_RTT_DIVISOR;
+                if (thresh < QUICLY_HYSTART_MIN_RTT_THRESH)
+                    thresh = QUICLY_HYSTART_MIN_RTT_THRESH;
+                if (thresh > QUICLY_HYSTART_MAX_RTT_THRESH)
+                    thresh = QUICLY_HYSTART_MAX_RTT_THRESH;
+                if (hs->current_round_min_rtt >= hs->last_round_min_rtt + thresh) {
+                    hs->phase = QUICLY_CC_HYSTART_CSS;
+                    hs->css_baseline_min_rtt = hs->current_round_min_rtt;
+                    hs->css_rounds = 0;
+                    hs->css_stash = 0;
+                }
+            }
+        } else if (hs->current_round_min_rtt < hs->css_baseline_min_rtt) {
+            /* RTT went back down; the exit from slow start was spurious */
+            hs->phase = QUICLY_CC_HYSTART_SLOW_START;
+            hs->css_baseline_min_rtt = UINT32_MAX;
+        }
+    }
+
+    if (hs->phase != QUICLY_CC_HYSTART_CSS)
+        return bytes;
+
+    /* in CSS, CWND grows at 1/CSS_GROWTH_DIVISOR the rate of slow start */
+    hs->css_stash += bytes;
+    uint32_t increase = hs->css_stash / QUICLY_HYSTART_CSS_GROWTH_DIVISOR;
+    hs->css_stash -= increase * QUICLY_HYSTART_CSS_GROWTH_DIVISOR;
+    return increase;
+}
+
+inline int quicly_cc_hystart_on_congestion(struct st_quicly_cc_hystart_t *hs)
+{
+    int in_css = hs->phase == QUICLY_CC_HYSTART_CSS;
+    if (hs->phase != QUICLY_CC_HYSTART_DISABLED)
+        hs->phase = QUICLY_CC_HYSTART_DONE;
+    return in_css;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -93,6 +93,23 @@ typedef struct st_quicly_cid_encryptor_t {
      * generates a stateless reset token (returns if generated)
      */
     int (*generate_stateless_reset_token)(struct st_quicly_cid_encryptor_t *self, void *token, const void *cid);
+    /**
+     * Optional batch variant of `encrypt_cid`, encrypting `count` CIDs at once. Each element of `stateless_reset_tokens` can be
+     * NULL, as can be `stateless_reset_tokens` itself.
+     */
+    void (*encrypt_cid_batch)(struct st_quicly_cid_encryptor_t *self, quicly_cid_t *const *encrypted,
+                              void *const *stateless_reset_tokens, const quicly_cid_plaintext_t *plaintexts, size_t count);
+    /**
+     * Optional batch variant of `decrypt_cid`, decrypting `count` CIDs at once. Each element of `lens` is the `len` argument of
+     * `decrypt_cid` upon input, and is overwritten by the return value of `decrypt_cid` upon return.
+     */
+    void (*decrypt_cid_batch)(struct st_quicly_cid_encryptor_t *self, quicly_cid_plaintext_t *const *plaintexts,
+                              const void *const *encrypted, size_t *lens, size_t count);
+    /**
+     * Optional batch variant of `generate_stateless_reset_token`, generating `count` tokens at once (returns if generated).
+     */
+    int (*generate_stateless_reset_token_batch)(struct st_quicly_cid_encryptor_t *self, void *const *tokens,
+                                                const void *const *cids, size_t count);
 } quicly_cid_encryptor_t;
 
 static void quicly_set_cid(quicly_cid_t *dest, ptls_iovec_t src);
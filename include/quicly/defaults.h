@@ -44,6 +44,54 @@ quicly_cid_encryptor_t *quicly_new_default_cid_encryptor(ptls_cipher_algorithm_t
  *
  */
 void quicly_free_default_cid_encryptor(quicly_cid_encryptor_t *self);
+/**
+ * Configuration of the QUIC-LB CID encryptor (draft-ietf-quic-load-balancers). The length of the CIDs is `1 + server_id_len +
+ * nonce_len`.
+ */
+typedef struct st_quicly_quiclb_config_t {
+    /**
+     * config rotation bits (0 to 6) being stored in the upper 3 bits of the first octet
+     */
+    uint8_t config_rotation;
+    /**
+     * if the lower 5 bits of the first octet should encode the length of the CID minus one
+     */
+    uint8_t encode_length;
+    /**
+     * length of the server ID (1 to 8), which carries the lower bytes of `quicly_cid_plaintext_t::node_id`
+     */
+    uint8_t server_id_len;
+    /**
+     * length of the nonce, which is the server-private part that carries `master_id` (4 bytes), `thread_id` (`nonce_len - 5` bytes,
+     * up to 3 being significant), and `path_id` (1 byte). MUST be no less than 6.
+     */
+    uint8_t nonce_len;
+} quicly_quiclb_config_t;
+
+/**
+ * Instantiates a CID encryptor that generates CIDs decodable by QUIC-LB load balancers. When `cid_cipher` is non-NULL, it MUST be
+ * AES-128-ECB, and `cid_key` is the key shared with the load balancers; the single-pass mode is used when the server ID and the
+ * nonce add up to 16 bytes, otherwise the four-pass mode is used. When `cid_cipher` is NULL, the CIDs are not encrypted. The
+ * stateless reset tokens are derived from `reset_token_key`, which MUST be kept secret from the load balancers. Returns NULL if
+ * the configuration is invalid.
+ */
+quicly_cid_encryptor_t *quicly_new_quiclb_cid_encryptor(const quicly_quiclb_config_t *config, ptls_cipher_algorithm_t *cid_cipher,
+                                                        ptls_iovec_t cid_key, ptls_cipher_algorithm_t *reset_token_cipher,
+                                                        ptls_hash_algorithm_t *hash, ptls_iovec_t reset_token_key);
+/**
+ * frees the CID encryptor being created by `quicly_new_quiclb_cid_encryptor`
+ */
+void quicly_free_quiclb_cid_encryptor(quicly_cid_encryptor_t *self);
+/**
+ * Instantiates a thread-safe path profile cache that can hold up to `capacity` entries. Entries are keyed by the client subnet
+ * (using the specified prefix lengths), and are discarded `lifetime` milliseconds after being stored.
+ */
+quicly_path_profile_cache_t *quicly_new_default_path_profile_cache(size_t capacity, unsigned ipv4_prefix_len,
+                                                                   unsigned ipv6_prefix_len, int64_t lifetime);
+/**
+ *
+ */
+void quicly_free_default_path_profile_cache(quicly_path_profile_cache_t *self);
 /**
  *
  */
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2026 Fastly
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef quicly_mtserver_h
+#define quicly_mtserver_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include "quicly.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Multi-threaded server runtime. Each worker thread owns a UDP socket bound to the same address using SO_REUSEPORT, runs its own
+ * event loop, and exclusively owns the connections that it accepts; the `thread_id` field of the CIDs being issued is set to the
+ * index of the worker. As the kernel distributes datagrams by the 4-tuple, a datagram might arrive at a worker that does not own
+ * the connection (e.g., after the client migrates). Such datagrams are handed off to the owner based on the decrypted `thread_id`,
+ * so that a connection is never touched by more than one thread and no locking is required.
+ *
+ * Steering by `thread_id` requires a CID encryptor (see `quicly_mtserver_callbacks_t::init_context`); without one, datagrams are
+ * routed by the hash of the destination CID, which is only stable until the handshake completes.
+ */
+typedef struct st_quicly_mtserver_t quicly_mtserver_t;
+typedef struct st_quicly_mtserver_worker_t quicly_mtserver_worker_t;
+
+typedef struct st_quicly_mtserver_callbacks_t {
+    /**
+     * Called by `quicly_mtserver_start` for each worker before the threads are spawned. `ctx` is a copy of the context being
+     * supplied to `quicly_mtserver_create` and is used only by that worker. Properties that are not thread-safe (e.g.,
+     * `cid_encryptor`) should be instantiated for each worker by this callback. Returning a non-zero value aborts the start. This
+     * callback is optional, and is invoked at most once for each worker even if the server is restarted.
+     */
+    int (*init_context)(quicly_mtserver_t *server, size_t thread_id, quicly_context_t *ctx);
+    /**
+     * Called by `quicly_mtserver_free` for each worker whose context has been set up successfully by `init_context`, so that the
+     * properties being instantiated can be released. This callback is optional.
+     */
+    void (*dispose_context)(quicly_mtserver_t *server, size_t thread_id, quicly_context_t *ctx);
+    /**
+     * called on the worker thread when a new connection is accepted (optional)
+     */
+    void (*on_accept)(quicly_mtserver_worker_t *worker, quicly_conn_t *conn);
+    /**
+     * called on the worker thread right before a connection is freed (optional)
+     */
+    void (*on_close)(quicly_mtserver_worker_t *worker, quicly_conn_t *conn);
+} quicly_mtserver_callbacks_t;
+
+/**
+ * Creates a server with `num_threads` workers, each owning a socket bound to `addr`. When the port number is zero, an ephemeral
+ * port is chosen and shared among the workers. `node_id` is embedded into the CIDs being issued. Returns NULL on failure, with
+ * `errno` being set.
+ */
+quicly_mtserver_t *quicly_mtserver_create(const quicly_context_t *ctx, struct sockaddr *addr, size_t num_threads, uint64_t node_id,
+                                          const quicly_mtserver_callbacks_t *callbacks, void *data);
+/**
+ * Spawns the worker threads. Returns zero on success, or an error number.
+ */
+int quicly_mtserver_start(quicly_mtserver_t *server);
+/**
+ * Stops the workers and waits for them to exit. Connections being owned by the workers are discarded without being closed.
+ */
+void quicly_mtserver_stop(quicly_mtserver_t *server);
+/**
+ * Frees the server. The workers must not be running.
+ */
+void quicly_mtserver_free(quicly_mtserver_t *server);
+/**
+ * returns the address being bound
+ */
+struct sockaddr *quicly_mtserver_get_sockname(quicly_mtserver_t *server);
+/**
+ * returns the pointer supplied to `quicly_mtserver_create`
+ */
+void *quicly_mtserver_get_data(quicly_mtserver_t *server);
+/**
+ * returns the server that the worker belongs to
+ */
+quicly_mtserver_t *quicly_mtserver_get_server(quicly_mtserver_worker_t *worker);
+/**
+ * returns the index of the worker, which is also the `thread_id` of the CIDs being issued by the worker
+ */
+size_t quicly_mtserver_get_thread_id(quicly_mtserver_worker_t *worker);
+/**
+ * returns the context being used by the worker
+ */
+quicly_context_t *quicly_mtserver_get_context(quicly_mtserver_worker_t *worker);
+/**
+ * Determines the worker that should handle the packet. Packets carrying a CID issued by this node are routed by the `thread_id`
+ * embedded in the CID. Other packets (e.g., Initial packets carrying CIDs chosen by the client) are routed by the hash of the
+ * destination CID, so that all packets carrying the same CID reach the same worker regardless of the socket they arrive at.
+ */
+static size_t quicly_mtserver_route(const quicly_decoded_packet_t *packet, uint64_t node_id, size_t num_threads);
+
+/* inline definitions */
+
+inline size_t quicly_mtserver_route(const quicly_decoded_packet_t *packet, uint64_t node_id, size_t num_threads)
+{
+    if (packet->cid.dest.plaintext.node_id == node_id && packet->cid.dest.plaintext.thread_id < num_threads)
+        return packet->cid.dest.plaintext.thread_id;
+
+    /* FNV-1a */
+    uint32_t hash = 2166136261;
+    for (size_t i = 0; i != packet->cid.dest.encrypted.len; ++i)
+        hash = (hash ^ packet->cid.dest.encrypted.base[i]) * 16777619;
+    return hash % num_threads;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -33,7 +33,9 @@ extern "C" {
 /**
  * Simple pacer. The design guarantees that the formula below is met for any given pacer-restricted period:
  *
- *   flow_rate * duration + 8 * mtu <= bytes_sent < flow_rate * duration + 10 * mtu
+ *   flow_rate * duration + burst * mtu <= bytes_sent < flow_rate * duration + (burst + 2) * mtu
+ *
+ * The burst size can be obtained by calling `quicly_pacer_calc_burst`.
  */
 typedef struct st_quicly_pacer_t {
     /**
@@ -46,8 +48,11 @@ typedef struct st_quicly_pacer_t {
     size_t bytes_sent;
 } quicly_pacer_t;
 
-#define QUICLY_PACER_BURST_LOW 8   /* lower bound in packets */
-#define QUICLY_PACER_BURST_HIGH 10 /* high bound in packets */
+#define QUICLY_PACER_BURST_MIN 2         /* minimum burst size in packets */
+#define QUICLY_PACER_BURST_LOW 8         /* default burst size in packets */
+#define QUICLY_PACER_BURST_HIGH 10       /* high bound in packets, when the default burst size is used */
+#define QUICLY_PACER_BURST_QUANTUM 1     /* maximum duration of a burst (in milliseconds), when the burst exceeds the default */
+#define QUICLY_PACER_BURST_CWND_DIVISOR 4 /* burst is capped to CWND divided by this value */
 
 /**
  * resets the pacer
@@ -56,11 +61,11 @@ static void quicly_pacer_reset(quicly_pacer_t *pacer);
 /**
  * returns when the next chunk of data can be sent
  */
-static int64_t quicly_pacer_can_send_at(quicly_pacer_t *pacer, uint32_t bytes_per_msec, uint16_t mtu);
+static int64_t quicly_pacer_can_send_at(quicly_pacer_t *pacer, uint32_t bytes_per_msec, uint16_t mtu, uint32_t burst);
 /**
  * returns the number of bytes that can be sent at this moment
  */
-static uint64_t quicly_pacer_get_window(quicly_pacer_t *pacer, int64_t now, uint32_t bytes_per_msec, uint16_t mtu);
+static uint64_t quicly_pacer_get_window(quicly_pacer_t *pacer, int64_t now, uint32_t bytes_per_msec, uint16_t mtu, uint32_t burst);
 /**
  * updates the window size available at current time
  */
@@ -69,6 +74,14 @@ static void quicly_pacer_consume_window(quicly_pacer_t *pacer, size_t delta);
  * Calculates the flow rate as `bytes_per_msec`. The returned value is no less than 1.
  */
 static uint32_t quicly_pacer_calc_send_rate(uint32_t multiplier, uint32_t cwnd, uint32_t rtt);
+/**
+ * Calculates the burst size in packets. When the sender can emit GSO batches (i.e., `max_gso_segments` is greater than the default
+ * burst size), bursts are allowed to grow up to the batch size, as long as they do not exceed the amount of data being sent in
+ * `QUICLY_PACER_BURST_QUANTUM` milliseconds. At low rates, the burst is capped to a fraction of CWND so that it does not consume
+ * the entire CWND at once. The cap is derived from CWND rather than from `bytes_per_msec`, as the latter includes the pacing
+ * multiplier (e.g., 2x or 3x during slow start). `cwnd` can be zero if RTT has not been observed yet.
+ */
+static uint32_t quicly_pacer_calc_burst(uint32_t bytes_per_msec, uint32_t cwnd, uint16_t mtu, uint32_t max_gso_segments);
 
 /* inline definitions */
 
@@ -78,10 +91,10 @@ inline void quicly_pacer_reset(quicly_pacer_t *pacer)
     pacer->bytes_sent = 0;
 }
 
-inline int64_t quicly_pacer_can_send_at(quicly_pacer_t *pacer, uint32_t bytes_per_msec, uint16_t mtu)
+inline int64_t quicly_pacer_can_send_at(quicly_pacer_t *pacer, uint32_t bytes_per_msec, uint16_t mtu, uint32_t burst)
 {
     /* return "now" if we have room in current msec */
-    size_t burst_size = QUICLY_PACER_BURST_LOW * mtu + 1;
+    size_t burst_size = (size_t)burst * mtu + 1;
     size_t burst_credit = burst_size > bytes_per_msec ? burst_size - bytes_per_msec : 0;
     if (pacer->bytes_sent < bytes_per_msec + burst_credit)
         return 0;
@@ -92,17 +105,17 @@ inline int64_t quicly_pacer_can_send_at(quicly_pacer_t *pacer, uint32_t bytes_pe
     return pacer->at + delay;
 }
 
-inline uint64_t quicly_pacer_get_window(quicly_pacer_t *pacer, int64_t now, uint32_t bytes_per_msec, uint16_t mtu)
+inline uint64_t quicly_pacer_get_window(quicly_pacer_t *pacer, int64_t now, uint32_t bytes_per_msec, uint16_t mtu, uint32_t burst)
 {
     assert(pacer->at <= now);
 
     /* Determine when it is possible to sent one packet. Return if that is a moment in future. */
-    int64_t can_send_at = quicly_pacer_can_send_at(pacer, bytes_per_msec, mtu);
+    int64_t can_send_at = quicly_pacer_can_send_at(pacer, bytes_per_msec, mtu, burst);
     if (now < can_send_at)
         return 0;
 
     /* Calculate the upper bound of burst window (the size is later rounded up) */
-    size_t burst_window = (QUICLY_PACER_BURST_HIGH - 1) * mtu + 1;
+    size_t burst_window = ((size_t)burst + QUICLY_PACER_BURST_HIGH - QUICLY_PACER_BURST_LOW - 1) * mtu + 1;
     if (burst_window < bytes_per_msec)
         burst_window = bytes_per_msec;
 
@@ -144,6 +157,29 @@ inline uint32_t quicly_pacer_calc_send_rate(uint32_t multiplier, uint32_t cwnd,
     return ret;
 }
 
+inline uint32_t quicly_pacer_calc_burst(uint32_t bytes_per_msec, uint32_t cwnd, uint16_t mtu, uint32_t max_gso_segments)
+{
+    uint64_t burst = QUICLY_PACER_BURST_LOW;
+
+    /* grow up to the GSO batch size, capped by the amount of data being sent in a quantum */
+    if (max_gso_segments > burst) {
+        uint64_t quantum = (uint64_t)bytes_per_msec * QUICLY_PACER_BURST_QUANTUM / mtu;
+        if (quantum > burst)
+            burst = quantum < max_gso_segments ? quantum : max_gso_segments;
+    }
+
+    /* cap by CWND, so that small-CWND flows are not sent out as single bursts */
+    if (cwnd != 0) {
+        uint64_t cwnd_cap = cwnd / ((uint64_t)mtu * QUICLY_PACER_BURST_CWND_DIVISOR);
+        if (burst > cwnd_cap)
+            burst = cwnd_cap;
+    }
+
+    if (burst < QUICLY_PACER_BURST_MIN)
+        burst = QUICLY_PACER_BURST_MIN;
+    return (uint32_t)burst;
+}
+
 #ifdef __cplusplus
 }
 #endif
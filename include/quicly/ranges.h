@@ -29,6 +29,7 @@ extern "C" {
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include "quicly/alloc.h"
 
 typedef struct st_quicly_range_t {
     uint64_t start;
@@ -39,6 +40,11 @@ typedef struct st_quicly_ranges_t {
     quicly_range_t *ranges;
     size_t num_ranges, capacity;
     quicly_range_t _initial;
+    /**
+     * allocator being used when the ranges do not fit in `_initial` (NULL to use malloc); set to NULL by `quicly_ranges_init`, and
+     * can be changed by the owner until the ranges grow
+     */
+    quicly_allocator_t *allocator;
 } quicly_ranges_t;
 
 /**
@@ -65,6 +71,10 @@ int quicly_ranges_subtract(quicly_ranges_t *ranges, uint64_t start, uint64_t end
  * removes ranges->ranges[I] where begin_index <= I && I < end_index
  */
 void quicly_ranges_drop_by_range_indices(quicly_ranges_t *ranges, size_t begin_index, size_t end_index);
+/**
+ * shrinks the capacity to the number of ranges being stored, releasing the heap allocation when up to one range is stored
+ */
+void quicly_ranges_shrink(quicly_ranges_t *ranges);
 /**
  * returns the next missing number from ranges greater than or equal to lower_bound. Sets *slots_traversed, if not null, to number
  * of slots traversed before finding the next missing number. We traverse slots in reverse order.
@@ -78,12 +88,13 @@ inline void quicly_ranges_init(quicly_ranges_t *ranges)
     ranges->ranges = &ranges->_initial;
     ranges->num_ranges = 0;
     ranges->capacity = 1;
+    ranges->allocator = NULL;
 }
 
 inline void quicly_ranges_clear(quicly_ranges_t *ranges)
 {
     if (ranges->ranges != &ranges->_initial) {
-        free(ranges->ranges);
+        quicly_dealloc(ranges->allocator, ranges->ranges, ranges->capacity * sizeof(*ranges->ranges), QUICLY_ALLOC_TAG_RANGES);
         ranges->ranges = &ranges->_initial;
     }
     ranges->num_ranges = 0;
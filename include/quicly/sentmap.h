@@ -28,6 +28,7 @@ extern "C" {
 
 #include <assert.h>
 #include <stdint.h>
+#include "quicly/alloc.h"
 #include "quicly/constants.h"
 #include "quicly/maxsender.h"
 #include "quicly/sendstate.h"
@@ -64,12 +65,32 @@ typedef struct st_quicly_sent_packet_t {
      * if sent on a promoted path
      */
     uint8_t promoted_path : 1;
+    /**
+     * if the sender was application-limited when the packet was sent
+     */
+    uint8_t app_limited : 1;
     /**
      * number of bytes in-flight for the packet, from the context of CC (becomes zero when deemed lost, but not when PTO fires)
      */
     uint16_t cc_bytes_in_flight;
 } quicly_sent_packet_t;
 
+/**
+ * Delivery state of the connection at the moment an ack-eliciting packet was sent. To retain the size of `quicly_sent_t`, the
+ * state is stored outside of `quicly_sent_packet_t`, in `quicly_sentmap_t::rate.packets`.
+ */
+typedef struct st_quicly_sent_rate_t {
+    /**
+     * lower 32 bits of `quicly_sentmap_t::rate.delivered`
+     */
+    uint32_t delivered;
+    /**
+     * `sent_at` minus `quicly_sentmap_t::rate.delivered_time` and `quicly_sentmap_t::rate.first_sent_time` (in milliseconds)
+     */
+    uint32_t delivered_time_delta;
+    uint32_t first_sent_time_delta;
+} quicly_sent_rate_t;
+
 typedef enum en_quicly_sentmap_event_t {
     /**
      * a packet has been acked
@@ -231,8 +252,69 @@ struct st_quicly_sentmap_t {
      * is non-NULL between prepare and commit, pointing to the packet header that is being written to
      */
     quicly_sent_t *_pending_packet;
+    /**
+     * allocator of the blocks and of `rate.packets` (NULL to use malloc); set to NULL by `quicly_sentmap_init`, and can be changed
+     * until the first packet is registered
+     */
+    quicly_allocator_t *allocator;
+    /**
+     * connection-level state for delivery rate estimation (draft-cheng-iccrg-delivery-rate-estimation)
+     */
+    struct {
+        /**
+         * total number of bytes acknowledged
+         */
+        uint64_t delivered;
+        /**
+         * when `delivered` was last updated
+         */
+        int64_t delivered_time;
+        /**
+         * send time of the packet most recently acknowledged
+         */
+        int64_t first_sent_time;
+        /**
+         * value of `delivered` at which the current application-limited period ends, or zero if not application-limited
+         */
+        uint64_t app_limited;
+        /**
+         * Per-packet delivery state, indexed by `packet_number & (capacity - 1)`. The capacity is a power of two, and is grown by
+         * `quicly_sentmap_prepare` so that it covers every packet number from that of the oldest packet in the map.
+         */
+        quicly_sent_rate_t *packets;
+        size_t capacity;
+    } rate;
 };
 
+/**
+ * Delivery rate sample, built from the packets newly acknowledged by an ACK frame.
+ */
+typedef struct st_quicly_delivery_rate_sample_t {
+    /**
+     * delivery rate in bytes/second, or zero if no valid sample was obtained
+     */
+    uint64_t rate;
+    /**
+     * number of bytes delivered during `interval`
+     */
+    uint64_t delivered;
+    /**
+     * length of the sampling interval, in milliseconds
+     */
+    uint32_t interval;
+    /**
+     * if the sample was taken while the sender was application-limited; such samples underestimate the available bandwidth
+     */
+    unsigned is_app_limited : 1;
+    /**
+     * state used while building the sample (`prior_time` is INT64_MIN if no packet has been accounted)
+     */
+    uint64_t _prior_delivered;
+    int64_t _prior_time;
+    uint32_t _send_elapsed;
+    uint32_t _ack_elapsed;
+} quicly_delivery_rate_sample_t;
+
 typedef struct st_quicly_sentmap_iter_t {
     quicly_sent_t *p;
     size_t count;
@@ -283,10 +365,34 @@ void quicly_sentmap_skip(quicly_sentmap_iter_t *iter);
  * updates the state of the packet being pointed to by the iterator, _and advances to the next packet_
  */
 quicly_error_t quicly_sentmap_update(quicly_sentmap_t *map, quicly_sentmap_iter_t *iter, quicly_sentmap_event_t event);
+/**
+ * Releases the memory used for recording the per-packet delivery state, if the map is empty.
+ */
+void quicly_sentmap_shrink(quicly_sentmap_t *map);
+/**
+ * Marks the sender as application-limited; delivery rate samples are flagged as such until the data in flight gets acknowledged.
+ */
+static void quicly_sentmap_on_app_limited(quicly_sentmap_t *map);
+/**
+ * initializes a delivery rate sample to be built
+ */
+static void quicly_sentmap_init_rate_sample(quicly_delivery_rate_sample_t *rs);
+/**
+ * Accounts a newly acknowledged packet to the delivery rate sample. Must be called before the packet is removed by
+ * `quicly_sentmap_update`.
+ */
+void quicly_sentmap_update_rate_sample(quicly_sentmap_t *map, quicly_delivery_rate_sample_t *rs, const quicly_sent_packet_t *packet,
+                                       int64_t now);
+/**
+ * Finishes building the delivery rate sample, after all the packets acknowledged by an ACK frame have been accounted.
+ */
+void quicly_sentmap_generate_rate_sample(quicly_sentmap_t *map, quicly_delivery_rate_sample_t *rs, uint32_t min_rtt);
 
 struct st_quicly_sent_block_t *quicly_sentmap__new_block(quicly_sentmap_t *map);
 quicly_error_t quicly_sentmap__type_packet(quicly_sentmap_t *map, const quicly_sent_packet_t *packet, int acked,
                                            quicly_sent_t *sent);
+static uint32_t quicly_sentmap__time_delta(int64_t later, int64_t earlier);
+static quicly_sent_rate_t *quicly_sentmap__get_rate(quicly_sentmap_t *map, const quicly_sent_packet_t *packet);
 
 /* inline definitions */
 
@@ -300,11 +406,32 @@ inline int quicly_sentmap_is_open(quicly_sentmap_t *map)
     return map->_pending_packet != NULL;
 }
 
+inline uint32_t quicly_sentmap__time_delta(int64_t later, int64_t earlier)
+{
+    int64_t delta = later - earlier;
+    return delta <= 0 ? 0 : delta < UINT32_MAX ? (uint32_t)delta : UINT32_MAX;
+}
+
+inline quicly_sent_rate_t *quicly_sentmap__get_rate(quicly_sentmap_t *map, const quicly_sent_packet_t *packet)
+{
+    assert(map->rate.capacity != 0);
+    return map->rate.packets + (packet->packet_number & (map->rate.capacity - 1));
+}
+
 inline void quicly_sentmap_commit(quicly_sentmap_t *map, uint16_t bytes_in_flight, int cc_limited, int promoted_path)
 {
     assert(quicly_sentmap_is_open(map));
 
     if (bytes_in_flight != 0) {
+        quicly_sent_packet_t *packet = &map->_pending_packet->data.packet;
+        quicly_sent_rate_t *rate = quicly_sentmap__get_rate(map, packet);
+        /* record the delivery state, resetting the clocks if the sender is starting from quiescence */
+        if (map->bytes_in_flight == 0)
+            map->rate.first_sent_time = map->rate.delivered_time = packet->sent_at;
+        rate->delivered = (uint32_t)map->rate.delivered;
+        rate->delivered_time_delta = quicly_sentmap__time_delta(packet->sent_at, map->rate.delivered_time);
+        rate->first_sent_time_delta = quicly_sentmap__time_delta(packet->sent_at, map->rate.first_sent_time);
+        packet->app_limited = map->rate.app_limited != 0;
         map->_pending_packet->data.packet.ack_eliciting = 1;
         map->_pending_packet->data.packet.cc_bytes_in_flight = bytes_in_flight;
         map->_pending_packet->data.packet.cc_limited = cc_limited;
@@ -320,6 +447,17 @@ inline void quicly_sentmap_commit(quicly_sentmap_t *map, uint16_t bytes_in_fligh
         map->num_packets_largest = map->num_packets;
 }
 
+inline void quicly_sentmap_on_app_limited(quicly_sentmap_t *map)
+{
+    if ((map->rate.app_limited = map->rate.delivered + map->bytes_in_flight) == 0)
+        map->rate.app_limited = 1;
+}
+
+inline void quicly_sentmap_init_rate_sample(quicly_delivery_rate_sample_t *rs)
+{
+    *rs = (quicly_delivery_rate_sample_t){.rate = 0, ._prior_time = INT64_MIN};
+}
+
 inline quicly_sent_t *quicly_sentmap_allocate(quicly_sentmap_t *map, quicly_sent_acked_cb acked)
 {
     struct st_quicly_sent_block_t *block;
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2026 Fastly
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef quicly_sessioncache_h
+#define quicly_sessioncache_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include "picotls.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Thread-safe store of session tickets being received by clients, keyed by the server name (or by anything else that identifies
+ * the server). The value is opaque; applications can store the address token and the transport parameters being remembered
+ * along with the ticket. The store is divided into shards each having its own lock, so that workers running on different threads
+ * rarely contend. Each shard holds up to `capacity / num_shards` tickets; when a shard is full, the oldest ticket is evicted.
+ */
+typedef struct st_quicly_ticket_store_t quicly_ticket_store_t;
+/**
+ * Thread-safe filter that detects the reuse of single-use identifiers, such as session tickets being used for 0-RTT and address
+ * validation tokens, within a time window. An identifier is remembered for at least `window` milliseconds and at most twice as
+ * long. The filter is a pair of Bloom filters per shard; as false positives are possible, the filter must only be used for
+ * decisions where a false positive is harmless (e.g., falling back to a full handshake or to address validation).
+ *
+ * To prevent replay of 0-RTT data across workers (RFC 8446 Section 8.1), a server that issues tickets through
+ * `ptls_encrypt_ticket_t` calls `quicly_replay_filter_test_and_set` with the ticket being decrypted, and rejects the ticket when
+ * it has been seen. For this to be effective, tickets must not be accepted for 0-RTT when their age exceeds `window`. Likewise,
+ * servers can call the function with the address token found in an Initial packet, and accept the connection without the token
+ * (i.e. without considering the address as validated) when the token is being reused.
+ */
+typedef struct st_quicly_replay_filter_t quicly_replay_filter_t;
+
+/**
+ * Instantiates a ticket store that can hold up to `capacity` tickets. Returns NULL if memory allocation fails.
+ */
+quicly_ticket_store_t *quicly_new_ticket_store(size_t capacity, size_t num_shards);
+/**
+ *
+ */
+void quicly_free_ticket_store(quicly_ticket_store_t *store);
+/**
+ * Saves a ticket that expires at `expires_at` (in milliseconds). Multiple tickets can be saved for one key, as servers might issue
+ * more than one so that the client can resume multiple connections. Returns zero on success, or PTLS_ERROR_NO_MEMORY.
+ */
+int quicly_ticket_store_save(quicly_ticket_store_t *store, ptls_iovec_t key, ptls_iovec_t ticket, int64_t expires_at);
+/**
+ * Removes the most recently saved ticket that has not expired for the key, and returns it. The ownership of the returned memory is
+ * transferred to the caller, which must release it using `free`. If none is found, `{NULL, 0}` is returned. Tickets are handed
+ * out only once, as clients should not reuse tickets (RFC 8446 Appendix C.4).
+ */
+ptls_iovec_t quicly_ticket_store_take(quicly_ticket_store_t *store, ptls_iovec_t key, int64_t now);
+/**
+ * Instantiates a replay filter that remembers up to `capacity` identifiers per window with a low false positive rate (about
+ * 0.1%). `random_bytes` is used for generating the hash key. Returns NULL if memory allocation fails.
+ */
+quicly_replay_filter_t *quicly_new_replay_filter(size_t capacity, int64_t window, size_t num_shards,
+                                                 void (*random_bytes)(void *, size_t));
+/**
+ *
+ */
+void quicly_free_replay_filter(quicly_replay_filter_t *filter);
+/**
+ * Records `id`, returning a boolean indicating if it has been recorded before within the window.
+ */
+int quicly_replay_filter_test_and_set(quicly_replay_filter_t *filter, ptls_iovec_t id, int64_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -47,10 +47,16 @@ typedef quicly_error_t (*quicly_sendbuf_flatten_vec_cb)(quicly_sendbuf_vec_t *ve
  * An optional callback that is called when an iovec is discarded.
  */
 typedef void (*quicly_sendbuf_discard_vec_cb)(quicly_sendbuf_vec_t *vec);
+/**
+ * An optional callback that is called when the first `off` bytes of an iovec have been retired (i.e., they will never be flattened
+ * again), while the rest of the iovec is still in use.
+ */
+typedef void (*quicly_sendbuf_shift_vec_cb)(quicly_sendbuf_vec_t *vec, size_t off);
 
 typedef struct st_quicly_streambuf_sendvec_callbacks_t {
     quicly_sendbuf_flatten_vec_cb flatten_vec;
     quicly_sendbuf_discard_vec_cb discard_vec;
+    quicly_sendbuf_shift_vec_cb shift_vec;
 } quicly_streambuf_sendvec_callbacks_t;
 
 struct st_quicly_sendbuf_vec_t {
@@ -59,6 +65,30 @@ struct st_quicly_sendbuf_vec_t {
     void *cbdata;
 };
 
+/**
+ * Size of the region of a file being memory-mapped at once by the file vector.
+ */
+#define QUICLY_SENDBUF_FILE_WINDOW_SIZE (16 * 1024 * 1024)
+/**
+ * Amount of data that the file vector asks the kernel to read ahead of the send cursor.
+ */
+#define QUICLY_SENDBUF_FILE_READAHEAD_SIZE (1024 * 1024)
+
+/**
+ * Callbacks of the file vector (see `quicly_sendbuf_init_file_vec`).
+ */
+extern const quicly_streambuf_sendvec_callbacks_t quicly_sendbuf_file_vec_callbacks;
+
+/**
+ * Initializes a vector that emits `len` bytes read from file descriptor `fd` starting at offset `off`. Instead of calling `pread`
+ * for every STREAM frame being built, the file is memory-mapped in windows of QUICLY_SENDBUF_FILE_WINDOW_SIZE bytes, and the
+ * kernel is advised to read ahead of the send cursor. Pages are unmapped as the data is retired by `quicly_sendbuf_shift`. Once
+ * this function succeeds, `fd` is owned by the vector and is closed when the vector is discarded. Applications MUST NOT truncate
+ * the file while it is being sent. The state of the vector is allocated using `allocator` (NULL to use malloc).
+ * @return 0 if successful, otherwise an error code
+ */
+int quicly_sendbuf_init_file_vec(quicly_sendbuf_vec_t *vec, quicly_allocator_t *allocator, int fd, uint64_t off, size_t len);
+
 /**
  * A simple stream-level send buffer that can be used to store data to be sent.
  */
@@ -69,6 +99,10 @@ typedef struct st_quicly_sendbuf_t {
     } vecs;
     size_t off_in_first_vec;
     uint64_t bytes_written;
+    /**
+     * allocator of `vecs.entries` and of the vectors created by the send buffer (NULL to use malloc)
+     */
+    quicly_allocator_t *allocator;
 } quicly_sendbuf_t;
 
 /**
@@ -96,6 +130,11 @@ int quicly_sendbuf_write(quicly_stream_t *stream, quicly_sendbuf_t *sb, const vo
  * Appends a vector to the send buffer.  Members of the `quicly_sendbuf_vec_t` are copied.
  */
 int quicly_sendbuf_write_vec(quicly_stream_t *stream, quicly_sendbuf_t *sb, quicly_sendbuf_vec_t *vec);
+/**
+ * Appends `len` bytes of a file starting at `off` to the send buffer, using the file vector. The ownership of `fd` is transferred
+ * to the send buffer, regardless of the function succeeding or not.
+ */
+int quicly_sendbuf_write_file(quicly_stream_t *stream, quicly_sendbuf_t *sb, int fd, uint64_t off, size_t len);
 
 /**
  * Pops the specified amount of bytes at the beginning of the simple stream-level receive buffer (which in fact is `ptls_buffer_t`).
@@ -111,6 +150,11 @@ ptls_iovec_t quicly_recvbuf_get(quicly_stream_t *stream, ptls_buffer_t *rb);
  * The concrete function for `quicly_stream_callbacks_t::on_receive`.
  */
 int quicly_recvbuf_receive(quicly_stream_t *stream, ptls_buffer_t *rb, size_t off, const void *src, size_t len);
+/**
+ * The concrete function for `quicly_stream_callbacks_t::on_receive_batch`. The buffer is expanded at most once.
+ */
+int quicly_recvbuf_receive_batch(quicly_stream_t *stream, ptls_buffer_t *rb, const quicly_stream_recv_vec_t *vecs,
+                                 size_t num_vecs);
 
 /**
  * The simple stream buffer.  The API assumes that stream->data points to quicly_streambuf_t.  Applications can extend the structure
@@ -119,14 +163,23 @@ int quicly_recvbuf_receive(quicly_stream_t *stream, ptls_buffer_t *rb, size_t of
 typedef struct st_quicly_streambuf_t {
     quicly_sendbuf_t egress;
     ptls_buffer_t ingress;
+    /**
+     * size of the object being allocated by `quicly_streambuf_create`
+     */
+    size_t size;
 } quicly_streambuf_t;
 
 int quicly_streambuf_create(quicly_stream_t *stream, size_t sz);
 void quicly_streambuf_destroy(quicly_stream_t *stream, quicly_error_t err);
+/**
+ * Releases the memory held by the send and receive buffers when they are empty; see `quicly_hibernate`.
+ */
+void quicly_streambuf_shrink(quicly_stream_t *stream);
 static void quicly_streambuf_egress_shift(quicly_stream_t *stream, size_t delta);
 void quicly_streambuf_egress_emit(quicly_stream_t *stream, size_t off, void *dst, size_t *len, int *wrote_all);
 static int quicly_streambuf_egress_write(quicly_stream_t *stream, const void *src, size_t len);
 static int quicly_streambuf_egress_write_vec(quicly_stream_t *stream, quicly_sendbuf_vec_t *vec);
+static int quicly_streambuf_egress_write_file(quicly_stream_t *stream, int fd, uint64_t off, size_t len);
 int quicly_streambuf_egress_shutdown(quicly_stream_t *stream);
 static void quicly_streambuf_ingress_shift(quicly_stream_t *stream, size_t delta);
 static ptls_iovec_t quicly_streambuf_ingress_get(quicly_stream_t *stream);
@@ -136,6 +189,10 @@ static ptls_iovec_t quicly_streambuf_ingress_get(quicly_stream_t *stream);
  * the information stored in the ingress buffer.
  */
 int quicly_streambuf_ingress_receive(quicly_stream_t *stream, size_t off, const void *src, size_t len);
+/**
+ * Batched variant of `quicly_streambuf_ingress_receive`, to be used as `quicly_stream_callbacks_t::on_receive_batch`.
+ */
+int quicly_streambuf_ingress_receive_batch(quicly_stream_t *stream, const quicly_stream_recv_vec_t *vecs, size_t num_vecs);
 
 /* inline definitions */
 
@@ -162,6 +219,12 @@ inline int quicly_streambuf_egress_write_vec(quicly_stream_t *stream, quicly_sen
     return quicly_sendbuf_write_vec(stream, &sbuf->egress, vec);
 }
 
+inline int quicly_streambuf_egress_write_file(quicly_stream_t *stream, int fd, uint64_t off, size_t len)
+{
+    quicly_streambuf_t *sbuf = (quicly_streambuf_t *)stream->data;
+    return quicly_sendbuf_write_file(stream, &sbuf->egress, fd, off, len);
+}
+
 inline void quicly_streambuf_ingress_shift(quicly_stream_t *stream, size_t delta)
 {
     quicly_streambuf_t *sbuf = (quicly_streambuf_t *)stream->data;
@@ -0,0 +1,655 @@
+/*
+ * Copyright (c) 2025 Fastly
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+/**
+ * BBR version 3, following draft-ietf-ccwg-bbr. The model consists of a windowed max filter of the delivery rate and a windowed
+ * min filter of the RTT; the two determine the pacing rate and CWND, which are further capped by the upper / lower bounds of
+ * inflight adapted upon loss.
+ *
+ * The model is fed by the per-ACK delivery rate samples built by the sentmap. Samples taken while the sender was
+ * application-limited are used only when they exceed the current estimate.
+ *
+ * CE marks are responded to as BBRv3 does: the EWMA of the ratio of marks (ecn_alpha) scales down inflight_lo at the end of each
+ * round, and a round in which the ratio exceeds the threshold bounds inflight_hi, or ends STARTUP. As CE marks are reported to
+ * this CC per ACK frame rather than per packet, the ratio is calculated from the number of ACK frames carrying new marks.
+ * Unlike Linux, the response is not limited to paths with small RTT.
+ */
+#include "quicly/cc.h"
+#include "quicly.h"
+
+#define QUICLY_CC_BBR_MODE_STARTUP 0
+#define QUICLY_CC_BBR_MODE_DRAIN 1
+#define QUICLY_CC_BBR_MODE_PROBE_BW_DOWN 2
+#define QUICLY_CC_BBR_MODE_PROBE_BW_CRUISE 3
+#define QUICLY_CC_BBR_MODE_PROBE_BW_REFILL 4
+#define QUICLY_CC_BBR_MODE_PROBE_BW_UP 5
+#define QUICLY_CC_BBR_MODE_PROBE_RTT 6
+
+#define BBR_STARTUP_PACING_GAIN 2.77 /* 4 * ln(2) */
+#define BBR_STARTUP_CWND_GAIN 2.0
+#define BBR_DRAIN_PACING_GAIN 0.35
+#define BBR_DEFAULT_CWND_GAIN 2.0
+#define BBR_PROBE_UP_PACING_GAIN 1.25
+#define BBR_PROBE_UP_CWND_GAIN 2.25
+#define BBR_PROBE_DOWN_PACING_GAIN 0.9
+#define BBR_PROBE_RTT_CWND_GAIN 0.5
+#define BBR_PACING_MARGIN 0.99
+#define BBR_LOSS_THRESH 0.02
+#define BBR_BETA 0.7
+#define BBR_HEADROOM 0.15
+#define BBR_FULL_BW_THRESH 1.25
+#define BBR_FULL_BW_COUNT 3
+#define BBR_STARTUP_FULL_LOSS_COUNT 6
+#define BBR_MIN_PIPE_CWND 4 /* in packets */
+#define BBR_MIN_RTT_FILTER_LEN 10000
+#define BBR_PROBE_RTT_INTERVAL 5000
+#define BBR_PROBE_RTT_DURATION 200
+#define BBR_PROBE_WAIT_BASE 2000
+#define BBR_PROBE_WAIT_RAND 1000
+#define BBR_MAX_RENO_ROUNDS 63
+#define BBR_ECN_ALPHA_GAIN (1. / 16)
+#define BBR_ECN_FACTOR (1. / 3)
+#define BBR_ECN_THRESH 0.5
+#define BBR_STARTUP_FULL_ECN_COUNT 2
+
+static int bbr_is_probe_bw(const quicly_cc_t *cc)
+{
+    return QUICLY_CC_BBR_MODE_PROBE_BW_DOWN <= cc->state.bbr.mode && cc->state.bbr.mode <= QUICLY_CC_BBR_MODE_PROBE_BW_UP;
+}
+
+static int bbr_is_probing_bw(const quicly_cc_t *cc)
+{
+    return cc->state.bbr.mode == QUICLY_CC_BBR_MODE_STARTUP || cc->state.bbr.mode == QUICLY_CC_BBR_MODE_PROBE_BW_REFILL ||
+           cc->state.bbr.mode == QUICLY_CC_BBR_MODE_PROBE_BW_UP;
+}
+
+static uint64_t bbr_max_bw(const quicly_cc_t *cc)
+{
+    uint64_t a = cc->state.bbr.max_bw_filter[0], b = cc->state.bbr.max_bw_filter[1];
+    return a > b ? a : b;
+}
+
+/**
+ * returns the bandwidth estimate (in bytes/sec) being used for pacing and for calculating BDP
+ */
+static uint64_t bbr_bw(const quicly_cc_t *cc)
+{
+    uint64_t bw = bbr_max_bw(cc);
+    if (bw > cc->state.bbr.bw_lo)
+        bw = cc->state.bbr.bw_lo;
+    return bw;
+}
+
+static uint32_t bbr_min_pipe_cwnd(const quicly_cc_t *cc)
+{
+    return BBR_MIN_PIPE_CWND * cc->state.bbr.max_udp_payload_size;
+}
+
+static double bbr_pacing_gain(const quicly_cc_t *cc)
+{
+    switch (cc->state.bbr.mode) {
+    case QUICLY_CC_BBR_MODE_STARTUP:
+        return BBR_STARTUP_PACING_GAIN;
+    case QUICLY_CC_BBR_MODE_DRAIN:
+        return BBR_DRAIN_PACING_GAIN;
+    case QUICLY_CC_BBR_MODE_PROBE_BW_DOWN:
+        return BBR_PROBE_DOWN_PACING_GAIN;
+    case QUICLY_CC_BBR_MODE_PROBE_BW_UP:
+        return BBR_PROBE_UP_PACING_GAIN;
+    default:
+        return 1;
+    }
+}
+
+static double bbr_cwnd_gain(const quicly_cc_t *cc)
+{
+    switch (cc->state.bbr.mode) {
+    case QUICLY_CC_BBR_MODE_STARTUP:
+        return BBR_STARTUP_CWND_GAIN;
+    case QUICLY_CC_BBR_MODE_PROBE_BW_UP:
+        return BBR_PROBE_UP_CWND_GAIN;
+    case QUICLY_CC_BBR_MODE_PROBE_RTT:
+        return BBR_PROBE_RTT_CWND_GAIN;
+    default:
+        return BBR_DEFAULT_CWND_GAIN;
+    }
+}
+
+/**
+ * Returns the BDP multiplied by `gain`, or the initial CWND if the model is not yet available.
+ */
+static uint32_t bbr_bdp(const quicly_cc_t *cc, double gain)
+{
+    uint64_t bw = bbr_bw(cc);
+    if (bw == 0 || cc->state.bbr.min_rtt == UINT32_MAX)
+        return cc->cwnd_initial;
+    double bdp = (double)bw * cc->state.bbr.min_rtt / 1000 * gain;
+    return bdp < UINT32_MAX ? (uint32_t)bdp : UINT32_MAX;
+}
+
+/**
+ * Returns the amount of inflight required for fully utilizing the path at given gain, accounting for the burstiness of the sender
+ * (i.e., the pacer emitting roughly 1ms worth of data at once).
+ */
+static uint32_t bbr_inflight(const quicly_cc_t *cc, double gain)
+{
+    uint32_t inflight = bbr_bdp(cc, gain), quantum = cc->state.bbr.pacing_rate / 1000;
+    if (quantum < 2 * cc->state.bbr.max_udp_payload_size)
+        quantum = 2 * cc->state.bbr.max_udp_payload_size;
+    if (quantum > 65536)
+        quantum = 65536;
+    inflight = quicly_u32_add_saturating(inflight, 3 * quantum);
+    if (cc->state.bbr.mode == QUICLY_CC_BBR_MODE_PROBE_BW_UP)
+        inflight = quicly_u32_add_saturating(inflight, 2 * cc->state.bbr.max_udp_payload_size);
+    return inflight;
+}
+
+/**
+ * Upper bound of inflight leaving room for other flows to grab bandwidth, used while not probing.
+ */
+static uint32_t bbr_inflight_with_headroom(const quicly_cc_t *cc)
+{
+    if (cc->state.bbr.inflight_hi == UINT32_MAX)
+        return UINT32_MAX;
+    uint32_t headroom = cc->state.bbr.inflight_hi * BBR_HEADROOM, ret = cc->state.bbr.inflight_hi - headroom;
+    if (ret < bbr_min_pipe_cwnd(cc))
+        ret = bbr_min_pipe_cwnd(cc);
+    return ret;
+}
+
+static void bbr_set_pacing_rate(quicly_cc_t *cc)
+{
+    uint64_t bw = bbr_bw(cc);
+    if (bw == 0)
+        return;
+    uint64_t rate = bw * bbr_pacing_gain(cc) * BBR_PACING_MARGIN;
+    /* do not slow down during STARTUP, as the bandwidth estimate might be affected by a short round */
+    if (cc->state.bbr.full_bw_reached || rate > cc->state.bbr.pacing_rate)
+        cc->state.bbr.pacing_rate = rate;
+}
+
+static void bbr_update_min_rtt(quicly_cc_t *cc, uint32_t rtt, int64_t now, int *probe_rtt_expired)
+{
+    *probe_rtt_expired = cc->state.bbr.probe_rtt_min_delay != UINT32_MAX &&
+                         now > cc->state.bbr.probe_rtt_min_stamp + BBR_PROBE_RTT_INTERVAL;
+    if (rtt < cc->state.bbr.probe_rtt_min_delay || *probe_rtt_expired) {
+        cc->state.bbr.probe_rtt_min_delay = rtt;
+        cc->state.bbr.probe_rtt_min_stamp = now;
+    }
+
+    int min_rtt_expired = cc->state.bbr.min_rtt != UINT32_MAX && now > cc->state.bbr.min_rtt_stamp + BBR_MIN_RTT_FILTER_LEN;
+    if (cc->state.bbr.probe_rtt_min_delay < cc->state.bbr.min_rtt || min_rtt_expired) {
+        cc->state.bbr.min_rtt = cc->state.bbr.probe_rtt_min_delay;
+        cc->state.bbr.min_rtt_stamp = cc->state.bbr.probe_rtt_min_stamp;
+    }
+}
+
+static void bbr_enter_probe_bw_phase(quicly_cc_t *cc, uint8_t mode)
+{
+    cc->state.bbr.mode = mode;
+    cc->state.bbr.phase_start_round = cc->state.bbr.round_count;
+}
+
+static void bbr_start_probe_bw_cycle(quicly_cc_t *cc, int64_t now)
+{
+    /* the max filter covers the two most recent cycles */
+    cc->state.bbr.max_bw_filter[1] = cc->state.bbr.max_bw_filter[0];
+    cc->state.bbr.max_bw_filter[0] = 0;
+    cc->state.bbr.cycle_start_round = cc->state.bbr.round_count;
+    cc->state.bbr.cycle_stamp = now;
+    /* randomize the wait time to avoid flows synchronizing their probes; the low bits of the counters are good enough */
+    cc->state.bbr.bw_probe_wait = BBR_PROBE_WAIT_BASE + (uint32_t)((cc->state.bbr.delivered ^ (uint64_t)now) % BBR_PROBE_WAIT_RAND);
+    bbr_enter_probe_bw_phase(cc, QUICLY_CC_BBR_MODE_PROBE_BW_DOWN);
+}
+
+static void bbr_exit_startup(quicly_cc_t *cc, int64_t now)
+{
+    cc->state.bbr.full_bw_reached = 1;
+    if (cc->cwnd_exiting_slow_start == 0) {
+        cc->cwnd_exiting_slow_start = cc->cwnd;
+        cc->exit_slow_start_at = now;
+    }
+    cc->ssthresh = cc->cwnd;
+    if (cc->state.bbr.mode == QUICLY_CC_BBR_MODE_STARTUP)
+        cc->state.bbr.mode = QUICLY_CC_BBR_MODE_DRAIN;
+}
+
+/**
+ * Returns if it is time to leave PROBE_BW_DOWN / PROBE_BW_CRUISE to probe for bandwidth, either because wall-clock time has
+ * elapsed or because a Reno flow sharing the bottleneck would have grown its CWND back to the BDP by now.
+ */
+static int bbr_is_time_to_probe_bw(const quicly_cc_t *cc, int64_t now)
+{
+    if (now - cc->state.bbr.cycle_stamp >= cc->state.bbr.bw_probe_wait)
+        return 1;
+    uint64_t reno_rounds = bbr_bdp(cc, 1) / cc->state.bbr.max_udp_payload_size;
+    if (reno_rounds > BBR_MAX_RENO_ROUNDS)
+        reno_rounds = BBR_MAX_RENO_ROUNDS;
+    return cc->state.bbr.round_count - cc->state.bbr.cycle_start_round >= reno_rounds;
+}
+
+static void bbr_update_probe_bw(quicly_cc_t *cc, uint32_t inflight, int round_start, int64_t now)
+{
+    switch (cc->state.bbr.mode) {
+    case QUICLY_CC_BBR_MODE_PROBE_BW_DOWN:
+        if (bbr_is_time_to_probe_bw(cc, now))
+            goto Refill;
+        if (inflight <= bbr_inflight_with_headroom(cc) && inflight <= bbr_bdp(cc, 1))
+            bbr_enter_probe_bw_phase(cc, QUICLY_CC_BBR_MODE_PROBE_BW_CRUISE);
+        break;
+    case QUICLY_CC_BBR_MODE_PROBE_BW_CRUISE:
+        if (bbr_is_time_to_probe_bw(cc, now))
+            goto Refill;
+        break;
+    case QUICLY_CC_BBR_MODE_PROBE_BW_REFILL:
+        /* refill the pipe for one round before probing, so that the probe would not be misled by a queue being drained */
+        if (round_start && cc->state.bbr.round_count > cc->state.bbr.phase_start_round) {
+            cc->state.bbr.probe_up_rounds = 0;
+            bbr_enter_probe_bw_phase(cc, QUICLY_CC_BBR_MODE_PROBE_BW_UP);
+        }
+        break;
+    case QUICLY_CC_BBR_MODE_PROBE_BW_UP:
+        /* leave once the probe has put enough data in flight for at least one round */
+        if (cc->state.bbr.round_count > cc->state.bbr.phase_start_round && inflight > bbr_inflight(cc, BBR_PROBE_UP_PACING_GAIN))
+            bbr_start_probe_bw_cycle(cc, now);
+        break;
+    default:
+        assert(!"unexpected mode");
+        break;
+    }
+    return;
+
+Refill:
+    /* forget the short-term bounds, as probing would otherwise be capped by them */
+    cc->state.bbr.bw_lo = UINT64_MAX;
+    cc->state.bbr.inflight_lo = UINT32_MAX;
+    bbr_enter_probe_bw_phase(cc, QUICLY_CC_BBR_MODE_PROBE_BW_REFILL);
+}
+
+/**
+ * Saves CWND to be restored later. If CWND has already been reduced by either PROBE_RTT or persistent congestion, the larger value
+ * is retained.
+ */
+static void bbr_save_cwnd(quicly_cc_t *cc)
+{
+    if (cc->state.bbr.mode == QUICLY_CC_BBR_MODE_PROBE_RTT || cc->state.bbr.restore_cwnd_on_recovery) {
+        if (cc->state.bbr.prior_cwnd < cc->cwnd)
+            cc->state.bbr.prior_cwnd = cc->cwnd;
+    } else {
+        cc->state.bbr.prior_cwnd = cc->cwnd;
+    }
+}
+
+static void bbr_restore_cwnd(quicly_cc_t *cc)
+{
+    if (cc->cwnd < cc->state.bbr.prior_cwnd)
+        cc->cwnd = cc->state.bbr.prior_cwnd;
+}
+
+static void bbr_check_probe_rtt(quicly_cc_t *cc, uint32_t inflight, int round_start, int probe_rtt_expired, int64_t now)
+{
+    if (cc->state.bbr.mode != QUICLY_CC_BBR_MODE_PROBE_RTT) {
+        if (!probe_rtt_expired)
+            return;
+        bbr_save_cwnd(cc);
+        cc->state.bbr.probe_rtt_done_stamp = 0;
+        cc->state.bbr.mode = QUICLY_CC_BBR_MODE_PROBE_RTT;
+    }
+
+    if (cc->state.bbr.probe_rtt_done_stamp == 0) {
+        if (inflight <= bbr_inflight(cc, BBR_PROBE_RTT_CWND_GAIN)) {
+            cc->state.bbr.probe_rtt_done_stamp = now + BBR_PROBE_RTT_DURATION;
+            cc->state.bbr.probe_rtt_round_done = 0;
+            cc->state.bbr.phase_start_round = cc->state.bbr.round_count;
+        }
+        return;
+    }
+    if (round_start && cc->state.bbr.round_count > cc->state.bbr.phase_start_round)
+        cc->state.bbr.probe_rtt_round_done = 1;
+    if (!(cc->state.bbr.probe_rtt_round_done && now >= cc->state.bbr.probe_rtt_done_stamp))
+        return;
+
+    /* exit PROBE_RTT */
+    cc->state.bbr.probe_rtt_min_stamp = now;
+    bbr_restore_cwnd(cc);
+    if (cc->state.bbr.full_bw_reached) {
+        bbr_start_probe_bw_cycle(cc, now);
+    } else {
+        cc->state.bbr.mode = QUICLY_CC_BBR_MODE_STARTUP;
+    }
+}
+
+/**
+ * Called at the end of each round; updates the model using the delivery rate observed during the round.
+ */
+static void bbr_on_round_end(quicly_cc_t *cc, int64_t now)
+{
+    uint64_t delivered_in_round = cc->state.bbr.delivered - cc->state.bbr.round_start_delivered,
+             bw_latest = cc->state.bbr.bw_latest;
+
+    /* check if the bandwidth has plateaued during STARTUP */
+    if (!cc->state.bbr.full_bw_reached && cc->state.bbr.cc_limited_in_round) {
+        uint64_t max_bw = bbr_max_bw(cc);
+        if (max_bw >= cc->state.bbr.full_bw * BBR_FULL_BW_THRESH) {
+            cc->state.bbr.full_bw = max_bw;
+            cc->state.bbr.full_bw_count = 0;
+        } else if (++cc->state.bbr.full_bw_count >= BBR_FULL_BW_COUNT) {
+            bbr_exit_startup(cc, now);
+        }
+    }
+
+    /* update the EWMA of the ratio of CE marks; in STARTUP, consecutive rounds with high ratio indicate that the pipe is full */
+    double ce_ratio = 0;
+    if (cc->state.bbr.acks_in_round != 0) {
+        ce_ratio = (double)cc->state.bbr.ce_acks_in_round / cc->state.bbr.acks_in_round;
+        cc->state.bbr.ecn_alpha += BBR_ECN_ALPHA_GAIN * (ce_ratio - cc->state.bbr.ecn_alpha);
+    }
+    if (!cc->state.bbr.full_bw_reached) {
+        if (ce_ratio < BBR_ECN_THRESH) {
+            cc->state.bbr.startup_ecn_rounds = 0;
+        } else if (++cc->state.bbr.startup_ecn_rounds >= BBR_STARTUP_FULL_ECN_COUNT) {
+            uint32_t bdp = bbr_bdp(cc, 1);
+            cc->state.bbr.inflight_hi = cc->cwnd > bdp ? cc->cwnd : bdp;
+            bbr_exit_startup(cc, now);
+        }
+    }
+
+    /* adapt the short-term bounds upon loss or CE marks, unless we are deliberately probing */
+    if ((cc->state.bbr.lost_in_round != 0 || cc->state.bbr.ce_acks_in_round != 0) && !bbr_is_probing_bw(cc)) {
+        if (cc->state.bbr.bw_lo == UINT64_MAX)
+            cc->state.bbr.bw_lo = bbr_max_bw(cc);
+        if (cc->state.bbr.inflight_lo == UINT32_MAX)
+            cc->state.bbr.inflight_lo = cc->cwnd;
+        uint32_t ecn_inflight_lo = UINT32_MAX;
+        if (cc->state.bbr.ce_acks_in_round != 0)
+            ecn_inflight_lo = cc->state.bbr.inflight_lo * (1 - cc->state.bbr.ecn_alpha * BBR_ECN_FACTOR);
+        if (cc->state.bbr.lost_in_round != 0) {
+            uint64_t bw_lo = cc->state.bbr.bw_lo * BBR_BETA;
+            uint32_t inflight_lo = cc->state.bbr.inflight_lo * BBR_BETA;
+            cc->state.bbr.bw_lo = bw_latest > bw_lo ? bw_latest : bw_lo;
+            cc->state.bbr.inflight_lo = delivered_in_round > inflight_lo ? (uint32_t)delivered_in_round : inflight_lo;
+        }
+        if (cc->state.bbr.inflight_lo > ecn_inflight_lo)
+            cc->state.bbr.inflight_lo = ecn_inflight_lo;
+    }
+
+    /* in PROBE_BW_UP, grow inflight_hi exponentially (1, 2, 4, ... packets per round) while the sender is CC-limited */
+    if (cc->state.bbr.mode == QUICLY_CC_BBR_MODE_PROBE_BW_UP && cc->state.bbr.inflight_hi != UINT32_MAX &&
+        cc->state.bbr.cc_limited_in_round) {
+        uint32_t shift = cc->state.bbr.probe_up_rounds < 10 ? cc->state.bbr.probe_up_rounds : 10;
+        cc->state.bbr.inflight_hi =
+            quicly_u32_add_saturating(cc->state.bbr.inflight_hi, cc->state.bbr.max_udp_payload_size << shift);
+        ++cc->state.bbr.probe_up_rounds;
+    }
+
+    /* start next round */
+    ++cc->state.bbr.round_count;
+    cc->state.bbr.round_start_delivered = cc->state.bbr.delivered;
+    cc->state.bbr.bw_latest = 0;
+    cc->state.bbr.cc_limited_in_round = 0;
+    cc->state.bbr.lost_in_round = 0;
+    cc->state.bbr.loss_events_in_round = 0;
+    cc->state.bbr.acks_in_round = 0;
+    cc->state.bbr.ce_acks_in_round = 0;
+}
+
+static void bbr_set_cwnd(quicly_cc_t *cc, uint32_t bytes)
+{
+    uint32_t target = bbr_inflight(cc, bbr_cwnd_gain(cc));
+
+    /* grow CWND by the amount being acked, capped by the target once the pipe is full */
+    if (cc->state.bbr.full_bw_reached) {
+        cc->cwnd = quicly_u32_add_saturating(cc->cwnd, bytes);
+        if (cc->cwnd > target)
+            cc->cwnd = target;
+    } else if (cc->cwnd < target || cc->state.bbr.delivered < cc->cwnd_initial) {
+        cc->cwnd = quicly_u32_add_saturating(cc->cwnd, bytes);
+    }
+
+    /* apply the bounds */
+    uint32_t cap = UINT32_MAX;
+    if (cc->state.bbr.mode == QUICLY_CC_BBR_MODE_PROBE_RTT) {
+        cap = bbr_inflight(cc, BBR_PROBE_RTT_CWND_GAIN);
+    } else if (bbr_is_probing_bw(cc)) {
+        cap = cc->state.bbr.inflight_hi;
+    } else if (bbr_is_probe_bw(cc)) {
+        cap = bbr_inflight_with_headroom(cc);
+    }
+    if (cap > cc->state.bbr.inflight_lo)
+        cap = cc->state.bbr.inflight_lo;
+    if (cc->cwnd > cap)
+        cc->cwnd = cap;
+    if (cc->cwnd < bbr_min_pipe_cwnd(cc))
+        cc->cwnd = bbr_min_pipe_cwnd(cc);
+
+    if (cc->cwnd_maximum < cc->cwnd)
+        cc->cwnd_maximum = cc->cwnd;
+    if (cc->cwnd_minimum > cc->cwnd)
+        cc->cwnd_minimum = cc->cwnd;
+}
+
+static void bbr_on_acked(quicly_cc_t *cc, const quicly_loss_t *loss, uint32_t bytes, uint64_t largest_acked, uint32_t inflight,
+                         int cc_limited, const quicly_delivery_rate_sample_t *rs, uint64_t next_pn, int64_t now,
+                         uint32_t max_udp_payload_size)
+{
+    int round_start = 0, probe_rtt_expired;
+
+    assert(inflight >= bytes);
+
+    cc->state.bbr.max_udp_payload_size = max_udp_payload_size;
+    cc->state.bbr.delivered += bytes;
+    ++cc->state.bbr.acks_in_round;
+    if (cc_limited)
+        cc->state.bbr.cc_limited_in_round = 1;
+
+    /* update max filter, using app-limited samples only when they raise the estimate */
+    if (rs->rate != 0) {
+        if ((!rs->is_app_limited || rs->rate > bbr_max_bw(cc)) && cc->state.bbr.max_bw_filter[0] < rs->rate)
+            cc->state.bbr.max_bw_filter[0] = rs->rate;
+        if (cc->state.bbr.bw_latest < rs->rate)
+            cc->state.bbr.bw_latest = rs->rate;
+    }
+
+    /* round trip counting */
+    if (largest_acked >= cc->state.bbr.round_end_pn) {
+        bbr_on_round_end(cc, now);
+        cc->state.bbr.round_end_pn = next_pn;
+        round_start = 1;
+    }
+
+    bbr_update_min_rtt(cc, loss->rtt.latest, now, &probe_rtt_expired);
+
+    /* state transitions */
+    switch (cc->state.bbr.mode) {
+    case QUICLY_CC_BBR_MODE_STARTUP:
+        break;
+    case QUICLY_CC_BBR_MODE_DRAIN:
+        if (inflight - bytes <= bbr_inflight(cc, 1))
+            bbr_start_probe_bw_cycle(cc, now);
+        break;
+    case QUICLY_CC_BBR_MODE_PROBE_RTT:
+        break;
+    default:
+        bbr_update_probe_bw(cc, inflight - bytes, round_start, now);
+        break;
+    }
+    bbr_check_probe_rtt(cc, inflight - bytes, round_start, probe_rtt_expired, now);
+
+    /* upon exiting recovery, CWND being collapsed by persistent congestion is restored (then bounded by the model below) */
+    if (cc->state.bbr.restore_cwnd_on_recovery && largest_acked >= cc->recovery_end) {
+        cc->state.bbr.restore_cwnd_on_recovery = 0;
+        bbr_restore_cwnd(cc);
+    }
+
+    bbr_set_pacing_rate(cc);
+    bbr_set_cwnd(cc, bytes);
+}
+
+/**
+ * Called when loss or CE marks indicate that the path cannot hold `inflight`; bounds inflight_hi, and ends bandwidth probing.
+ */
+static void bbr_handle_inflight_too_high(quicly_cc_t *cc, uint32_t inflight, int64_t now)
+{
+    uint32_t floor = bbr_bdp(cc, 1) * BBR_BETA;
+
+    switch (cc->state.bbr.mode) {
+    case QUICLY_CC_BBR_MODE_STARTUP:
+        /* loss in STARTUP is handled by the caller, and CE marks at the end of each round */
+        return;
+    case QUICLY_CC_BBR_MODE_PROBE_BW_REFILL:
+    case QUICLY_CC_BBR_MODE_PROBE_BW_UP:
+        cc->state.bbr.inflight_hi = inflight > floor ? inflight : floor;
+        bbr_start_probe_bw_cycle(cc, now);
+        break;
+    default:
+        if (cc->state.bbr.inflight_hi == UINT32_MAX || cc->state.bbr.inflight_hi > inflight)
+            cc->state.bbr.inflight_hi = inflight > floor ? inflight : floor;
+        break;
+    }
+
+    bbr_set_cwnd(cc, 0);
+}
+
+static void bbr_on_lost(quicly_cc_t *cc, const quicly_loss_t *loss, uint32_t bytes, uint64_t lost_pn, uint64_t next_pn, int64_t now,
+                        uint32_t max_udp_payload_size)
+{
+    quicly_cc__update_ecn_episodes(cc, bytes, lost_pn);
+
+    cc->state.bbr.max_udp_payload_size = max_udp_payload_size;
+
+    if (lost_pn >= cc->recovery_end) {
+        cc->recovery_end = next_pn;
+        ++cc->num_loss_episodes;
+    }
+
+    /* CE marks (reported with `bytes` being zero) indicate that inflight is too high, if the ratio within the round exceeds the
+     * threshold; in STARTUP, the ratio is checked at the end of each round */
+    if (bytes == 0) {
+        ++cc->state.bbr.ce_acks_in_round;
+        if (!cc->state.bbr.full_bw_reached ||
+            cc->state.bbr.ce_acks_in_round < (cc->state.bbr.acks_in_round != 0 ? cc->state.bbr.acks_in_round : 1) * BBR_ECN_THRESH)
+            return;
+        bbr_handle_inflight_too_high(cc, (uint32_t)loss->sentmap.bytes_in_flight, now);
+        return;
+    }
+
+    cc->state.bbr.lost_in_round += bytes;
+    ++cc->state.bbr.loss_events_in_round;
+
+    /* check if the loss rate of the round exceeds the threshold */
+    uint64_t delivered_in_round = cc->state.bbr.delivered - cc->state.bbr.round_start_delivered;
+    if (cc->state.bbr.lost_in_round <= (delivered_in_round + cc->state.bbr.lost_in_round) * BBR_LOSS_THRESH)
+        return;
+
+    /* inflight is too high; the volume of data in flight when the loss was detected is a good estimate of what the path can hold */
+    uint32_t inflight_at_loss = quicly_u32_add_saturating((uint32_t)loss->sentmap.bytes_in_flight, bytes);
+    if (cc->state.bbr.mode == QUICLY_CC_BBR_MODE_STARTUP) {
+        if (cc->state.bbr.loss_events_in_round < BBR_STARTUP_FULL_LOSS_COUNT)
+            return;
+        cc->state.bbr.inflight_hi = inflight_at_loss > bbr_bdp(cc, 1) ? inflight_at_loss : bbr_bdp(cc, 1);
+        bbr_exit_startup(cc, now);
+        bbr_set_cwnd(cc, 0);
+        return;
+    }
+    bbr_handle_inflight_too_high(cc, inflight_at_loss, now);
+}
+
+static void bbr_on_persistent_congestion(quicly_cc_t *cc, const quicly_loss_t *loss, int64_t now)
+{
+    /* the model is retained, but data in flight is collapsed until recovery is exitted */
+    bbr_save_cwnd(cc);
+    cc->state.bbr.restore_cwnd_on_recovery = 1;
+    cc->cwnd = bbr_min_pipe_cwnd(cc);
+    if (cc->cwnd_minimum > cc->cwnd)
+        cc->cwnd_minimum = cc->cwnd;
+}
+
+static void bbr_on_sent(quicly_cc_t *cc, const quicly_loss_t *loss, uint32_t bytes, int64_t now)
+{
+    /* When restarting from idle, pace at the estimated bandwidth (rather than with the gain of the current phase), as the pipe is
+     * known to be empty. */
+    if (loss->sentmap.bytes_in_flight <= bytes && bbr_is_probe_bw(cc)) {
+        uint64_t bw = bbr_bw(cc);
+        if (bw != 0)
+            cc->state.bbr.pacing_rate = bw;
+    }
+}
+
+static uint32_t bbr_pacing_rate(quicly_cc_t *cc, const quicly_loss_t *loss)
+{
+    uint64_t bytes_per_msec;
+
+    if (cc->state.bbr.pacing_rate != 0) {
+        bytes_per_msec = cc->state.bbr.pacing_rate / 1000;
+    } else {
+        /* no bandwidth sample yet; pace the initial window with the STARTUP gain */
+        bytes_per_msec = cc->cwnd * BBR_STARTUP_PACING_GAIN / loss->rtt.smoothed;
+    }
+
+    if (bytes_per_msec < 1)
+        bytes_per_msec = 1;
+    if (bytes_per_msec > UINT32_MAX)
+        bytes_per_msec = UINT32_MAX;
+    return (uint32_t)bytes_per_msec;
+}
+
+static void bbr_reset(quicly_cc_t *cc, uint32_t initcwnd)
+{
+    memset(cc, 0, sizeof(quicly_cc_t));
+    cc->type = &quicly_cc_type_bbr;
+    cc->cwnd = cc->cwnd_initial = cc->cwnd_maximum = initcwnd;
+    cc->ssthresh = cc->cwnd_minimum = UINT32_MAX;
+    cc->exit_slow_start_at = INT64_MAX;
+
+    cc->state.bbr.mode = QUICLY_CC_BBR_MODE_STARTUP;
+    cc->state.bbr.bw_lo = UINT64_MAX;
+    cc->state.bbr.min_rtt = UINT32_MAX;
+    cc->state.bbr.probe_rtt_min_delay = UINT32_MAX;
+    cc->state.bbr.inflight_hi = UINT32_MAX;
+    cc->state.bbr.inflight_lo = UINT32_MAX;
+    cc->state.bbr.max_udp_payload_size = QUICLY_MIN_CLIENT_INITIAL_SIZE;
+
+    quicly_cc_jumpstart_reset(cc);
+}
+
+static int bbr_on_switch(quicly_cc_t *cc)
+{
+    if (cc->type == &quicly_cc_type_bbr)
+        return 1;
+
+    if (cc->type == &quicly_cc_type_reno || cc->type == &quicly_cc_type_cubic || cc->type == &quicly_cc_type_pico) {
+        /* the model cannot be constructed from the state of loss-based CCs; start from scratch */
+        bbr_reset(cc, cc->cwnd_initial);
+        return 1;
+    }
+
+    return 0;
+}
+
+static void bbr_init(quicly_init_cc_t *self, quicly_cc_t *cc, uint32_t initcwnd, int64_t now)
+{
+    bbr_reset(cc, initcwnd);
+}
+
+quicly_cc_type_t quicly_cc_type_bbr = {
+    "bbr", &quicly_cc_bbr_init, bbr_on_acked, bbr_on_lost, bbr_on_persistent_congestion, bbr_on_sent, bbr_on_switch, NULL, NULL,
+    bbr_pacing_rate};
+quicly_init_cc_t quicly_cc_bbr_init = {bbr_init};
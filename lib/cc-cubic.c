@@ -20,49 +20,108 @@
  * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
  * IN THE SOFTWARE.
  */
-#include <math.h>
 #include "quicly/cc.h"
 #include "quicly.h"
 #include "quicly/pacer.h"
 
 #define QUICLY_MIN_CWND 2
 
-typedef double cubic_float_t;
-#define QUICLY_CUBIC_C ((cubic_float_t)0.4)
-#define QUICLY_CUBIC_BETA ((cubic_float_t)0.7)
+/* CUBIC constants (C = 0.4, beta = 0.7) expressed as fractions, so that the calculation can be done using integer arithmetic */
+#define QUICLY_CUBIC_C_NUM 2
+#define QUICLY_CUBIC_C_DEN 5
+#define QUICLY_CUBIC_BETA_NUM 7
+#define QUICLY_CUBIC_BETA_DEN 10
 
-/* Calculates the time elapsed since the last congestion event (parameter t) */
-static cubic_float_t calc_cubic_t(const quicly_cc_t *cc, int64_t now)
+/**
+ * Returns floor(cbrt(x)). The initial estimate is taken from a lookup table indexed by the bit length of `x` (the table holding
+ * ceil(cbrt(2^i))), then refined by Newton-Raphson iterations. As the initial estimate is never below the answer, the iterations
+ * converge monotonically, typically in two or three rounds.
+ */
+static uint32_t cubic_cbrt(uint64_t x)
+{
+    static const uint32_t seeds[65] = {
+        1, 2, 2, 2, 3, 4, 4, 6,
+        7, 8, 11, 13, 16, 21, 26, 32,
+        41, 51, 64, 81, 102, 128, 162, 204,
+        256, 323, 407, 512, 646, 813, 1024, 1291,
+        1626, 2048, 2581, 3251, 4096, 5161, 6502, 8192,
+        10322, 13004, 16384, 20643, 26008, 32768, 41286, 52016,
+        65536, 82571, 104032, 131072, 165141, 208064, 262144, 330281,
+        416128, 524288, 660562, 832256, 1048576, 1321123, 1664511, 2097152,
+        2642246,
+    };
+
+    if (x == 0)
+        return 0;
+
+    uint64_t y = seeds[64 - quicly_clz64(x)];
+    while (1) {
+        uint64_t next = (2 * y + x / (y * y)) / 3;
+        if (next >= y)
+            break;
+        y = next;
+    }
+    return (uint32_t)y;
+}
+
+/* Calculates the time elapsed since the last congestion event (parameter t), in milliseconds */
+static int64_t calc_cubic_t(const quicly_cc_t *cc, int64_t now)
 {
-    cubic_float_t clock_delta = now - cc->state.cubic.avoidance_start;
-    return clock_delta / 1000; /* ms -> s */
+    return now - cc->state.cubic.avoidance_start;
 }
 
-/* RFC 8312, Equation 1; using bytes as unit instead of MSS */
-static uint32_t calc_w_cubic(const quicly_cc_t *cc, cubic_float_t t_sec, uint32_t max_udp_payload_size)
+/* RFC 8312, Equation 1; using bytes as unit instead of MSS, and milliseconds instead of seconds */
+static uint32_t calc_w_cubic(const quicly_cc_t *cc, int64_t t_msec, uint32_t max_udp_payload_size)
 {
-    cubic_float_t tk = t_sec - cc->state.cubic.k;
-    return (QUICLY_CUBIC_C * (tk * tk * tk) * max_udp_payload_size) + cc->state.cubic.w_max;
+    /* |t - K| is capped so that its cube fits in 63 bits; the cap is far beyond any value that can be reached by W_cubic */
+    static const uint64_t max_abs_tk = (1 << 21) - 1;
+
+    int64_t tk = t_msec - cc->state.cubic.k;
+    uint64_t abs_tk = tk >= 0 ? (uint64_t)tk : (uint64_t)-tk;
+    if (abs_tk > max_abs_tk)
+        abs_tk = max_abs_tk;
+
+    /* C * (t - K)^3 * MSS, converting msec^3 to sec^3 in two steps to avoid overflow */
+    uint64_t tk3 = abs_tk * abs_tk * abs_tk / 1000, delta;
+    if (tk3 > UINT64_MAX / (QUICLY_CUBIC_C_NUM * max_udp_payload_size)) {
+        delta = UINT64_MAX;
+    } else {
+        delta = tk3 * QUICLY_CUBIC_C_NUM * max_udp_payload_size / (QUICLY_CUBIC_C_DEN * 1000000);
+    }
+
+    if (tk < 0)
+        return delta < cc->state.cubic.w_max ? cc->state.cubic.w_max - (uint32_t)delta : 0;
+    return delta <= UINT32_MAX - cc->state.cubic.w_max ? cc->state.cubic.w_max + (uint32_t)delta : UINT32_MAX;
 }
 
 /* RFC 8312, Equation 2 */
 /* K depends solely on W_max, so we update both together on congestion events */
 static void update_cubic_k(quicly_cc_t *cc, uint32_t max_udp_payload_size)
 {
-    cubic_float_t w_max_mss = cc->state.cubic.w_max / (cubic_float_t)max_udp_payload_size;
-    cc->state.cubic.k = cbrt(w_max_mss * ((1 - QUICLY_CUBIC_BETA) / QUICLY_CUBIC_C));
+    /* K = cbrt(W_max * (1 - beta) / C) seconds = cbrt(W_max * (1 - beta) / C * 10^9) milliseconds */
+    static const uint64_t factor = (uint64_t)(QUICLY_CUBIC_BETA_DEN - QUICLY_CUBIC_BETA_NUM) * QUICLY_CUBIC_C_DEN * 1000000000 /
+                                   (QUICLY_CUBIC_BETA_DEN * QUICLY_CUBIC_C_NUM);
+    cc->state.cubic.k = cubic_cbrt((uint64_t)cc->state.cubic.w_max * factor / max_udp_payload_size);
 }
 
 /* RFC 8312, Equation 4; using bytes as unit instead of MSS */
-static uint32_t calc_w_est(const quicly_cc_t *cc, cubic_float_t t_sec, cubic_float_t rtt_sec, uint32_t max_udp_payload_size)
+static uint32_t calc_w_est(const quicly_cc_t *cc, int64_t t_msec, uint32_t rtt_msec, uint32_t max_udp_payload_size)
 {
-    return (cc->state.cubic.w_max * QUICLY_CUBIC_BETA) +
-           ((3 * (1 - QUICLY_CUBIC_BETA) / (1 + QUICLY_CUBIC_BETA)) * (t_sec / rtt_sec) * max_udp_payload_size);
+    /* 3 * (1 - beta) / (1 + beta) */
+    static const uint64_t alpha_num = 3 * (QUICLY_CUBIC_BETA_DEN - QUICLY_CUBIC_BETA_NUM),
+                          alpha_den = QUICLY_CUBIC_BETA_DEN + QUICLY_CUBIC_BETA_NUM;
+
+    if (rtt_msec == 0)
+        rtt_msec = 1;
+    uint64_t w_est = (uint64_t)cc->state.cubic.w_max * QUICLY_CUBIC_BETA_NUM / QUICLY_CUBIC_BETA_DEN;
+    if (t_msec > 0)
+        w_est += alpha_num * (uint64_t)t_msec * max_udp_payload_size / (alpha_den * rtt_msec);
+    return w_est <= UINT32_MAX ? (uint32_t)w_est : UINT32_MAX;
 }
 
-/* TODO: Avoid increase if sender was application limited. */
 static void cubic_on_acked(quicly_cc_t *cc, const quicly_loss_t *loss, uint32_t bytes, uint64_t largest_acked, uint32_t inflight,
-                           int cc_limited, uint64_t next_pn, int64_t now, uint32_t max_udp_payload_size)
+                           int cc_limited, const quicly_delivery_rate_sample_t *rs, uint64_t next_pn, int64_t now,
+                           uint32_t max_udp_payload_size)
 {
     assert(inflight >= bytes);
     /* Do not increase congestion window while in recovery (but jumpstart may do something different). */
@@ -73,22 +132,48 @@ static void cubic_on_acked(quicly_cc_t *cc, const quicly_loss_t *loss, uint32_t
 
     quicly_cc_jumpstart_on_acked(cc, 0, bytes, largest_acked, inflight, next_pn);
 
-    /* TODO: respect cc_limited */
+    /* When leaving an app-limited period, exclude its duration from the CUBIC epoch so that W_cubic does not grow while CWND is
+     * not being used (RFC 9438, Section 5.8). */
+    if (cc_limited && quicly_cc_cwv_is_app_limited(cc) && cc->state.cubic.avoidance_start != 0) {
+        cc->state.cubic.avoidance_start += now - cc->cwnd_validation.app_limited_since;
+        if (cc->state.cubic.avoidance_start > now)
+            cc->state.cubic.avoidance_start = now;
+    }
+    /* If CWND is reduced due to the expiry of the Non-Validated Period, start a new epoch aiming at the CWND before reduction. */
+    uint32_t cwnd_before_validation = cc->cwnd;
+    quicly_cc_cwv_on_acked(cc, cc_limited, inflight, now);
+    if (cc->cwnd < cwnd_before_validation) {
+        cc->state.cubic.avoidance_start = now;
+        cc->state.cubic.w_max = cwnd_before_validation;
+        update_cubic_k(cc, max_udp_payload_size);
+    }
 
     /* Slow start. */
     if (cc->cwnd < cc->ssthresh) {
-        cc->cwnd = quicly_u32_add_saturating(cc->cwnd, bytes);
+        uint32_t increase = quicly_cc_hystart_is_enabled(&cc->hystart)
+                                ? quicly_cc_hystart_on_acked(cc, bytes, largest_acked, next_pn, loss->rtt.latest, now)
+                                : bytes;
+        if (cc_limited)
+            cc->cwnd = quicly_u32_add_saturating(cc->cwnd, increase);
+        if (cc->cwnd >= cc->ssthresh) {
+            /* exited slow start without loss (by HyStart++, or by reaching ssthresh set by CWND validation); start the CUBIC epoch
+             * from current CWND (RFC 9438, Section 4.10) */
+            cc->state.cubic.avoidance_start = now;
+            cc->state.cubic.w_max = cc->cwnd;
+            cc->state.cubic.k = 0;
+        }
         if (cc->cwnd_maximum < cc->cwnd)
             cc->cwnd_maximum = cc->cwnd;
         return;
     }
 
     /* Congestion avoidance. */
-    cubic_float_t t_sec = calc_cubic_t(cc, now);
-    cubic_float_t rtt_sec = loss->rtt.smoothed / (cubic_float_t)1000; /* ms -> s */
+    if (!cc_limited)
+        return;
+    int64_t t_msec = calc_cubic_t(cc, now);
 
-    uint32_t w_cubic = calc_w_cubic(cc, t_sec, max_udp_payload_size);
-    uint32_t w_est = calc_w_est(cc, t_sec, rtt_sec, max_udp_payload_size);
+    uint32_t w_cubic = calc_w_cubic(cc, t_msec, max_udp_payload_size);
+    uint32_t w_est = calc_w_est(cc, t_msec, loss->rtt.smoothed, max_udp_payload_size);
 
     if (w_cubic < w_est) {
         /* RFC 8312, Section 4.2; TCP-Friendly Region */
@@ -97,12 +182,13 @@ static void cubic_on_acked(quicly_cc_t *cc, const quicly_loss_t *loss, uint32_t
             cc->cwnd = w_est;
     } else {
         /* RFC 8312, Section 4.3/4.4; CUBIC Region */
-        cubic_float_t w_cubic_target = calc_w_cubic(cc, t_sec + rtt_sec, max_udp_payload_size);
+        uint32_t w_cubic_target = calc_w_cubic(cc, t_msec + loss->rtt.smoothed, max_udp_payload_size);
         /* After fast convergence W_max < W_last_max holds, and hence W_cubic(0) = beta * W_max < beta * W_last_max = cwnd.
          * cwnd could thus shrink without this check (but only after fast convergence). */
         if (w_cubic_target > cc->cwnd)
-            /* (W_cubic(t+RTT) - cwnd)/cwnd * MSS = (W_cubic(t+RTT)/cwnd - 1) * MSS */
-            cc->cwnd = quicly_u32_add_saturating(cc->cwnd, ((w_cubic_target / cc->cwnd) - 1) * max_udp_payload_size);
+            /* (W_cubic(t+RTT) - cwnd)/cwnd * MSS */
+            cc->cwnd = quicly_u32_add_saturating(
+                cc->cwnd, (uint32_t)((uint64_t)(w_cubic_target - cc->cwnd) * max_udp_payload_size / cc->cwnd));
     }
 
     if (cc->cwnd_maximum < cc->cwnd)
@@ -129,6 +215,9 @@ static void cubic_on_lost(quicly_cc_t *cc, const quicly_loss_t *loss, uint32_t b
         cc->exit_slow_start_at = now;
     }
 
+    /* If app-limited, W_max and the reduction are based on the portion of CWND that has been validated. */
+    quicly_cc_cwv_on_congestion(cc, loss->sentmap.bytes_in_flight);
+
     cc->state.cubic.avoidance_start = now;
     cc->state.cubic.w_max = cc->cwnd;
 
@@ -136,14 +225,21 @@ static void cubic_on_lost(quicly_cc_t *cc, const quicly_loss_t *loss, uint32_t b
     /* w_last_max is initialized to zero; therefore this condition is false when exiting slow start */
     if (cc->state.cubic.w_max < cc->state.cubic.w_last_max) {
         cc->state.cubic.w_last_max = cc->state.cubic.w_max;
-        cc->state.cubic.w_max *= (1.0 + QUICLY_CUBIC_BETA) / 2.0;
+        cc->state.cubic.w_max = (uint64_t)cc->state.cubic.w_max * (QUICLY_CUBIC_BETA_DEN + QUICLY_CUBIC_BETA_NUM) /
+                                (2 * QUICLY_CUBIC_BETA_DEN);
     } else {
         cc->state.cubic.w_last_max = cc->state.cubic.w_max;
     }
     update_cubic_k(cc, max_udp_payload_size);
 
-    /* RFC 8312, Section 4.5; Multiplicative Decrease */
-    cc->cwnd *= cc->ssthresh == UINT32_MAX ? 0.5 : QUICLY_CUBIC_BETA; /* without HyStart++, we overshoot by 2x in slowstart */
+    /* RFC 8312, Section 4.5; Multiplicative Decrease. Without HyStart++ (or when it is yet to enter CSS), we overshoot by 2x in
+     * slowstart. */
+    int in_css = quicly_cc_hystart_on_congestion(&cc->hystart);
+    if (cc->ssthresh == UINT32_MAX && !in_css) {
+        cc->cwnd /= 2;
+    } else {
+        cc->cwnd = (uint64_t)cc->cwnd * QUICLY_CUBIC_BETA_NUM / QUICLY_CUBIC_BETA_DEN;
+    }
     if (cc->cwnd < QUICLY_MIN_CWND * max_udp_payload_size)
         cc->cwnd = QUICLY_MIN_CWND * max_udp_payload_size;
     cc->ssthresh = cc->cwnd;
@@ -162,11 +258,16 @@ static void cubic_on_sent(quicly_cc_t *cc, const quicly_loss_t *loss, uint32_t b
     /* Prevent extreme cwnd growth following an idle period caused by application limit.
      * This fixes the W_cubic/W_est calculations by effectively subtracting the idle period
      * The sender is coming out of quiescence if the current packet is the only one in flight.
-     * (see https://github.com/torvalds/linux/commit/30927520dbae297182990bb21d08762bcc35ce1d). */
-    if (loss->sentmap.bytes_in_flight <= bytes && cc->state.cubic.avoidance_start != 0 && cc->state.cubic.last_sent_time != 0) {
+     * (see https://github.com/torvalds/linux/commit/30927520dbae297182990bb21d08762bcc35ce1d).
+     * When already app-limited, the idle period is excluded by `cubic_on_acked` as part of the app-limited period. */
+    if (loss->sentmap.bytes_in_flight <= bytes && cc->state.cubic.avoidance_start != 0 && cc->state.cubic.last_sent_time != 0 &&
+        !quicly_cc_cwv_is_app_limited(cc)) {
         int64_t delta = now - cc->state.cubic.last_sent_time;
-        if (delta > 0)
+        if (delta > 0) {
             cc->state.cubic.avoidance_start += delta;
+            if (cc->state.cubic.avoidance_start > now)
+                cc->state.cubic.avoidance_start = now;
+        }
     }
 
     cc->state.cubic.last_sent_time = now;
@@ -181,6 +282,7 @@ static void cubic_reset(quicly_cc_t *cc, uint32_t initcwnd)
     cc->exit_slow_start_at = INT64_MAX;
 
     quicly_cc_jumpstart_reset(cc);
+    quicly_cc_cwv_reset(cc);
 }
 
 static int cubic_on_switch(quicly_cc_t *cc)
@@ -206,7 +308,14 @@ static void cubic_init(quicly_init_cc_t *self, quicly_cc_t *cc, uint32_t initcwn
     cubic_reset(cc, initcwnd);
 }
 
+static void cubic_hystart_init(quicly_init_cc_t *self, quicly_cc_t *cc, uint32_t initcwnd, int64_t now)
+{
+    cubic_reset(cc, initcwnd);
+    quicly_cc_init_hystart(&cc->hystart);
+}
+
 quicly_cc_type_t quicly_cc_type_cubic = {"cubic",         &quicly_cc_cubic_init,          cubic_on_acked,
                                          cubic_on_lost,   cubic_on_persistent_congestion, cubic_on_sent,
                                          cubic_on_switch, quicly_cc_jumpstart_enter};
 quicly_init_cc_t quicly_cc_cubic_init = {cubic_init};
+quicly_init_cc_t quicly_cc_cubic_hystart_init = {cubic_hystart_init};
@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2026 Fastly
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "quicly/cc.h"
+#include "quicly.h"
+
+/* LEDBAT++ (draft-irtf-iccrg-ledbat-plus-plus), a less-than-best-effort congestion controller for background transfers. The
+ * queueing delay is estimated as the difference between the current RTT and the base delay (the minimum RTT), and CWND is reduced
+ * in proportion to the amount by which the queueing delay exceeds the target. Both slow start and additive increase are slowed
+ * down by GAIN, and CWND is periodically reduced to the minimum so that the base delay can be re-measured and so that latecomers
+ * are not starved. */
+
+static uint32_t ledbat_queueing_delay(quicly_cc_t *cc, const quicly_loss_t *loss)
+{
+    uint32_t current = UINT32_MAX;
+
+    for (size_t i = 0; i < QUICLY_LEDBAT_DELAY_FILTER && i < cc->state.ledbat.num_delay_samples; ++i)
+        if (current > cc->state.ledbat.delay_samples[i])
+            current = cc->state.ledbat.delay_samples[i];
+
+    if (current == UINT32_MAX || current <= loss->rtt.minimum)
+        return 0;
+    return current - loss->rtt.minimum;
+}
+
+/**
+ * Returns the inverse of GAIN, which is dynamically set so that flows on paths with small base delay ramp up slowly.
+ */
+static uint32_t ledbat_gain_divisor(const quicly_loss_t *loss)
+{
+    if (loss->rtt.minimum == 0 || loss->rtt.minimum == UINT32_MAX)
+        return QUICLY_LEDBAT_MAX_GAIN_DIVISOR;
+    uint32_t divisor = (2 * QUICLY_LEDBAT_TARGET + loss->rtt.minimum - 1) / loss->rtt.minimum;
+    return divisor < QUICLY_LEDBAT_MAX_GAIN_DIVISOR ? divisor : QUICLY_LEDBAT_MAX_GAIN_DIVISOR;
+}
+
+/**
+ * Slow start with the increase scaled by GAIN. Returns if slow start has ended, either by CWND reaching SSTHRESH or by queueing
+ * delay exceeding 3/4 of the target.
+ */
+static int ledbat_slow_start(quicly_cc_t *cc, uint32_t bytes, int cc_limited, uint32_t queueing_delay, uint32_t gain_divisor)
+{
+    if (queueing_delay > QUICLY_LEDBAT_TARGET * 3 / 4) {
+        cc->ssthresh = cc->cwnd;
+        return 1;
+    }
+
+    if (cc_limited) {
+        cc->cwnd = quicly_u32_add_saturating(cc->cwnd, bytes / gain_divisor);
+        if (cc->cwnd >= cc->ssthresh)
+            cc->cwnd = cc->ssthresh;
+        if (cc->cwnd_maximum < cc->cwnd)
+            cc->cwnd_maximum = cc->cwnd;
+    }
+
+    return cc->cwnd == cc->ssthresh;
+}
+
+static void ledbat_end_slowdown(quicly_cc_t *cc, int64_t now)
+{
+    cc->state.ledbat.slowdown_at = now + (now - cc->state.ledbat.slowdown_started_at) * QUICLY_LEDBAT_SLOWDOWN_INTERVAL_RATIO;
+    cc->state.ledbat.slowdown_started_at = INT64_MAX;
+}
+
+static void ledbat_set_cwnd(quicly_cc_t *cc, uint32_t cwnd, uint32_t max_udp_payload_size)
+{
+    if (cwnd < QUICLY_MIN_CWND * max_udp_payload_size)
+        cwnd = QUICLY_MIN_CWND * max_udp_payload_size;
+    cc->cwnd = cwnd;
+    if (cc->cwnd_minimum > cc->cwnd)
+        cc->cwnd_minimum = cc->cwnd;
+}
+
+static void ledbat_on_acked(quicly_cc_t *cc, const quicly_loss_t *loss, uint32_t bytes, uint64_t largest_acked, uint32_t inflight,
+                            int cc_limited, const quicly_delivery_rate_sample_t *rs, uint64_t next_pn, int64_t now,
+                            uint32_t max_udp_payload_size)
+{
+    assert(inflight >= bytes);
+
+    cc->state.ledbat.max_udp_payload_size = max_udp_payload_size;
+    cc->state.ledbat.delay_samples[cc->state.ledbat.num_delay_samples++ % QUICLY_LEDBAT_DELAY_FILTER] = loss->rtt.latest;
+
+    /* Do not increase congestion window while in recovery. */
+    if (largest_acked < cc->recovery_end)
+        return;
+
+    uint32_t queueing_delay = ledbat_queueing_delay(cc, loss), gain_divisor = ledbat_gain_divisor(loss);
+
+    /* Periodic slowdown; CWND is kept at the minimum for two RTTs, then slow start is used for regaining SSTHRESH. */
+    if (cc->state.ledbat.slowdown_started_at != INT64_MAX) {
+        if (now < cc->state.ledbat.slowdown_freeze_until)
+            return;
+        if (ledbat_slow_start(cc, bytes, cc_limited, queueing_delay, gain_divisor))
+            ledbat_end_slowdown(cc, now);
+        return;
+    }
+    if (now >= cc->state.ledbat.slowdown_at) {
+        cc->ssthresh = cc->cwnd;
+        ledbat_set_cwnd(cc, 0, max_udp_payload_size);
+        cc->state.ledbat.stash = 0;
+        cc->state.ledbat.slowdown_started_at = now;
+        cc->state.ledbat.slowdown_freeze_until = now + 2 * loss->rtt.smoothed;
+        return;
+    }
+
+    /* Slow start. Upon exitting the initial slow start, the initial slowdown is scheduled two RTTs later. */
+    if (cc->cwnd < cc->ssthresh) {
+        if (ledbat_slow_start(cc, bytes, cc_limited, queueing_delay, gain_divisor)) {
+            if (cc->cwnd_exiting_slow_start == 0) {
+                cc->cwnd_exiting_slow_start = cc->cwnd;
+                cc->exit_slow_start_at = now;
+            }
+            if (cc->state.ledbat.slowdown_at == INT64_MAX)
+                cc->state.ledbat.slowdown_at = now + 2 * loss->rtt.smoothed;
+        }
+        return;
+    }
+
+    /* Congestion avoidance. Below the target, CWND grows by GAIN MTUs per CWND being acked. */
+    if (queueing_delay <= QUICLY_LEDBAT_TARGET) {
+        if (!cc_limited)
+            return;
+        cc->state.ledbat.stash += bytes;
+        uint64_t bytes_per_mtu_increase = (uint64_t)cc->cwnd * gain_divisor;
+        if (cc->state.ledbat.stash < bytes_per_mtu_increase)
+            return;
+        uint64_t count = cc->state.ledbat.stash / bytes_per_mtu_increase;
+        cc->state.ledbat.stash -= count * bytes_per_mtu_increase;
+        cc->cwnd = quicly_u32_add_saturating(cc->cwnd, (uint32_t)(count * max_udp_payload_size));
+        if (cc->cwnd_maximum < cc->cwnd)
+            cc->cwnd_maximum = cc->cwnd;
+        return;
+    }
+
+    /* Above the target, for each packet being acked, `W += max(GAIN - W * (delay / target - 1), -W / 2) / W` (in packets). */
+    uint64_t increase = (uint64_t)bytes * max_udp_payload_size / ((uint64_t)cc->cwnd * gain_divisor),
+             decrease = (uint64_t)bytes * (queueing_delay - QUICLY_LEDBAT_TARGET) / QUICLY_LEDBAT_TARGET;
+    if (decrease > increase + bytes / 2)
+        decrease = increase + bytes / 2;
+    if (decrease > increase) {
+        decrease -= increase;
+        ledbat_set_cwnd(cc, decrease < cc->cwnd ? cc->cwnd - (uint32_t)decrease : 0, max_udp_payload_size);
+        cc->ssthresh = cc->cwnd; /* stay in congestion avoidance */
+    }
+}
+
+static void ledbat_on_lost(quicly_cc_t *cc, const quicly_loss_t *loss, uint32_t bytes, uint64_t lost_pn, uint64_t next_pn,
+                           int64_t now, uint32_t max_udp_payload_size)
+{
+    cc->state.ledbat.max_udp_payload_size = max_udp_payload_size;
+    quicly_cc__update_ecn_episodes(cc, bytes, lost_pn);
+
+    /* Nothing to do if loss is in recovery window. */
+    if (lost_pn < cc->recovery_end)
+        return;
+    cc->recovery_end = next_pn;
+
+    ++cc->num_loss_episodes;
+    if (cc->cwnd_exiting_slow_start == 0) {
+        cc->cwnd_exiting_slow_start = cc->cwnd;
+        cc->exit_slow_start_at = now;
+    }
+
+    /* loss terminates the slowdown being in progress, or schedules the initial one */
+    if (cc->state.ledbat.slowdown_started_at != INT64_MAX) {
+        ledbat_end_slowdown(cc, now);
+    } else if (cc->state.ledbat.slowdown_at == INT64_MAX) {
+        cc->state.ledbat.slowdown_at = now + 2 * loss->rtt.smoothed;
+    }
+
+    /* Reduce congestion window like Reno. */
+    ledbat_set_cwnd(cc, cc->cwnd / 2, max_udp_payload_size);
+    cc->ssthresh = cc->cwnd;
+    cc->state.ledbat.stash = 0;
+}
+
+static void ledbat_on_persistent_congestion(quicly_cc_t *cc, const quicly_loss_t *loss, int64_t now)
+{
+    /* CWND is collapsed to the minimum; the slowdown being in progress is cancelled, and the next one is scheduled after exiting
+     * the slow start that follows, as is the case with the initial slowdown */
+    ledbat_set_cwnd(cc, 0, cc->state.ledbat.max_udp_payload_size);
+    cc->state.ledbat.stash = 0;
+    cc->state.ledbat.slowdown_at = INT64_MAX;
+    cc->state.ledbat.slowdown_started_at = INT64_MAX;
+    cc->state.ledbat.slowdown_freeze_until = 0;
+}
+
+static int ledbat_on_switch(quicly_cc_t *cc)
+{
+    return cc->type == &quicly_cc_type_ledbat;
+}
+
+static void ledbat_init(quicly_init_cc_t *self, quicly_cc_t *cc, uint32_t initcwnd, int64_t now)
+{
+    memset(cc, 0, sizeof(quicly_cc_t));
+    cc->type = &quicly_cc_type_ledbat;
+    cc->cwnd = cc->cwnd_initial = cc->cwnd_maximum = initcwnd;
+    cc->exit_slow_start_at = INT64_MAX;
+    cc->ssthresh = cc->cwnd_minimum = UINT32_MAX;
+    cc->state.ledbat.slowdown_at = INT64_MAX;
+    cc->state.ledbat.slowdown_started_at = INT64_MAX;
+    cc->state.ledbat.max_udp_payload_size = QUICLY_MIN_CLIENT_INITIAL_SIZE;
+
+    quicly_cc_jumpstart_reset(cc);
+}
+
+quicly_cc_type_t quicly_cc_type_ledbat = {"ledbat",
+                                          &quicly_cc_ledbat_init,
+                                          ledbat_on_acked,
+                                          ledbat_on_lost,
+                                          ledbat_on_persistent_congestion,
+                                          quicly_cc_reno_on_sent,
+                                          ledbat_on_switch};
+quicly_init_cc_t quicly_cc_ledbat_init = {ledbat_init};
@@ -60,9 +60,9 @@ static uint32_t calc_bytes_per_mtu_increase(uint32_t cwnd, uint32_t rtt, uint32_
     return reno < cubic ? reno : cubic;
 }
 
-/* TODO: Avoid increase if sender was application limited. */
 static void pico_on_acked(quicly_cc_t *cc, const quicly_loss_t *loss, uint32_t bytes, uint64_t largest_acked, uint32_t inflight,
-                          int cc_limited, uint64_t next_pn, int64_t now, uint32_t max_udp_payload_size)
+                          int cc_limited, const quicly_delivery_rate_sample_t *rs, uint64_t next_pn, int64_t now,
+                          uint32_t max_udp_payload_size)
 {
     assert(inflight >= bytes);
 
@@ -78,6 +78,7 @@ static void pico_on_acked(quicly_cc_t *cc, const quicly_loss_t *loss, uint32_t b
     }
 
     quicly_cc_jumpstart_on_acked(cc, 0, bytes, largest_acked, inflight, next_pn);
+    quicly_cc_cwv_on_acked(cc, cc_limited, inflight, now);
 
     if (!cc_limited)
         return;
@@ -136,6 +137,9 @@ static void pico_on_lost(quicly_cc_t *cc, const quicly_loss_t *loss, uint32_t by
         cc->exit_slow_start_at = now;
     }
 
+    /* If app-limited, the reduction is applied to the portion of CWND that has been validated. */
+    quicly_cc_cwv_on_congestion(cc, loss->sentmap.bytes_in_flight);
+
     { /* Calculate increase rate based on CWND before reduction. When rapid start is on but the loss is observed while jump start is
        * in action, CWND is not adjusted in the code above, therefore jumpstart.bytes_acked is adopted here. */
         uint32_t bdp = cc->cwnd;
@@ -212,6 +216,7 @@ static void pico_reset(quicly_cc_t *cc, uint32_t initcwnd)
     pico_init_pico_state(cc, 0);
 
     quicly_cc_jumpstart_reset(cc);
+    quicly_cc_cwv_reset(cc);
 }
 
 static int pico_on_switch(quicly_cc_t *cc)
@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2026 Fastly
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "quicly/cc.h"
+#include "quicly.h"
+
+/* Prague congestion control (draft-briscoe-iccrg-prague-congestion-control). The sender marks packets as ECT(1), maintains the
+ * EWMA of the fraction of bytes being CE-marked per round trip (alpha, as defined in RFC 8257), and reduces CWND by alpha / 2 at
+ * most once per round trip when CE marks are reported. Packet loss is responded to like Reno (i.e., by halving CWND). */
+
+static void prague_update_alpha(quicly_cc_t *cc, uint64_t largest_acked, uint64_t next_pn)
+{
+    if (largest_acked < cc->state.prague.round_end_pn)
+        return;
+
+    if (cc->state.prague.bytes_acked_in_round != 0) {
+        double frac = (double)cc->state.prague.bytes_marked_in_round / cc->state.prague.bytes_acked_in_round;
+        if (frac > 1)
+            frac = 1;
+        cc->state.prague.alpha += QUICLY_PRAGUE_ALPHA_GAIN * (frac - cc->state.prague.alpha);
+    }
+    cc->state.prague.round_end_pn = next_pn;
+    cc->state.prague.bytes_acked_in_round = 0;
+    cc->state.prague.bytes_marked_in_round = 0;
+}
+
+/**
+ * Returns the number of bytes that have to be acked in congestion avoidance for increasing CWND by 1 MTU. To be RTT-independent,
+ * the increase is scaled down by (RTT / RTT_ref)^2 when the RTT is below the reference, so that the rate grows as fast as it would
+ * on a path with the reference RTT.
+ */
+static uint64_t prague_bytes_per_mtu_increase(quicly_cc_t *cc, const quicly_loss_t *loss)
+{
+    uint64_t rtt = loss->rtt.smoothed != 0 ? loss->rtt.smoothed : 1;
+
+    if (rtt >= QUICLY_PRAGUE_RTT_REF)
+        return cc->cwnd;
+    return (uint64_t)cc->cwnd * QUICLY_PRAGUE_RTT_REF * QUICLY_PRAGUE_RTT_REF / (rtt * rtt);
+}
+
+static void prague_on_acked(quicly_cc_t *cc, const quicly_loss_t *loss, uint32_t bytes, uint64_t largest_acked, uint32_t inflight,
+                            int cc_limited, const quicly_delivery_rate_sample_t *rs, uint64_t next_pn, int64_t now,
+                            uint32_t max_udp_payload_size)
+{
+    assert(inflight >= bytes);
+
+    cc->state.prague.max_udp_payload_size = max_udp_payload_size;
+
+    /* the packet ending the round belongs to the next round */
+    prague_update_alpha(cc, largest_acked, next_pn);
+    cc->state.prague.bytes_acked_in_round = quicly_u32_add_saturating(cc->state.prague.bytes_acked_in_round, bytes);
+
+    /* Do not increase congestion window while in recovery (but jumpstart may do something different). */
+    if (largest_acked < cc->recovery_end) {
+        quicly_cc_jumpstart_on_acked(cc, 1, bytes, largest_acked, inflight, next_pn);
+        return;
+    }
+
+    quicly_cc_jumpstart_on_acked(cc, 0, bytes, largest_acked, inflight, next_pn);
+
+    if (!cc_limited)
+        return;
+
+    /* Slow start. */
+    if (cc->cwnd < cc->ssthresh) {
+        cc->cwnd = quicly_u32_add_saturating(cc->cwnd, bytes);
+        if (cc->cwnd_maximum < cc->cwnd)
+            cc->cwnd_maximum = cc->cwnd;
+        return;
+    }
+    /* Congestion avoidance. */
+    cc->state.prague.stash += bytes;
+    uint64_t bytes_per_mtu_increase = prague_bytes_per_mtu_increase(cc, loss);
+    if (cc->state.prague.stash < bytes_per_mtu_increase)
+        return;
+    uint64_t count = cc->state.prague.stash / bytes_per_mtu_increase;
+    cc->state.prague.stash -= count * bytes_per_mtu_increase;
+    cc->cwnd = quicly_u32_add_saturating(cc->cwnd, (uint32_t)(count * max_udp_payload_size));
+    if (cc->cwnd_maximum < cc->cwnd)
+        cc->cwnd_maximum = cc->cwnd;
+}
+
+/**
+ * Starts a new congestion episode unless `pn` belongs to the current one, returning if it did.
+ */
+static int prague_enter_episode(quicly_cc_t *cc, uint32_t bytes, uint64_t pn, uint64_t next_pn, int64_t now)
+{
+    quicly_cc__update_ecn_episodes(cc, bytes, pn);
+
+    if (pn < cc->recovery_end)
+        return 0;
+    cc->recovery_end = next_pn;
+
+    /* if detected congestion before receiving all acks for jumpstart, restore original CWND */
+    if (cc->ssthresh == UINT32_MAX)
+        quicly_cc_jumpstart_on_first_loss(cc, pn, 0);
+
+    ++cc->num_loss_episodes;
+    if (cc->cwnd_exiting_slow_start == 0) {
+        cc->cwnd_exiting_slow_start = cc->cwnd;
+        cc->exit_slow_start_at = now;
+    }
+
+    return 1;
+}
+
+static void prague_set_reduced_cwnd(quicly_cc_t *cc, uint32_t cwnd, uint32_t max_udp_payload_size)
+{
+    if (cwnd < QUICLY_MIN_CWND * max_udp_payload_size)
+        cwnd = QUICLY_MIN_CWND * max_udp_payload_size;
+    cc->cwnd = cwnd;
+    cc->ssthresh = cwnd;
+    cc->state.prague.stash = 0;
+    if (cc->cwnd_minimum > cc->cwnd)
+        cc->cwnd_minimum = cc->cwnd;
+}
+
+static void prague_on_lost(quicly_cc_t *cc, const quicly_loss_t *loss, uint32_t bytes, uint64_t lost_pn, uint64_t next_pn,
+                           int64_t now, uint32_t max_udp_payload_size)
+{
+    cc->state.prague.max_udp_payload_size = max_udp_payload_size;
+
+    if (!prague_enter_episode(cc, bytes, lost_pn, next_pn, now))
+        return;
+
+    prague_set_reduced_cwnd(cc, cc->cwnd / 2, max_udp_payload_size);
+}
+
+static void prague_on_ecn_ce(quicly_cc_t *cc, const quicly_loss_t *loss, uint32_t num_packets, uint64_t largest_acked,
+                             uint64_t next_pn, int64_t now, uint32_t max_udp_payload_size)
+{
+    cc->state.prague.max_udp_payload_size = max_udp_payload_size;
+
+    /* the number of bytes being marked is estimated, as the ACK frame only carries the number of packets */
+    uint64_t bytes_marked = cc->state.prague.bytes_marked_in_round + (uint64_t)num_packets * max_udp_payload_size;
+    cc->state.prague.bytes_marked_in_round = bytes_marked <= UINT32_MAX ? (uint32_t)bytes_marked : UINT32_MAX;
+
+    if (!prague_enter_episode(cc, 0, largest_acked, next_pn, now))
+        return;
+
+    /* reduce CWND in proportion to the extent of congestion */
+    prague_set_reduced_cwnd(cc, cc->cwnd - (uint32_t)(cc->cwnd * cc->state.prague.alpha / 2), max_udp_payload_size);
+}
+
+static void prague_on_persistent_congestion(quicly_cc_t *cc, const quicly_loss_t *loss, int64_t now)
+{
+    /* collapse CWND to the minimum, and as the path might have changed, start over from the conservative estimate of alpha */
+    cc->cwnd = QUICLY_MIN_CWND * cc->state.prague.max_udp_payload_size;
+    if (cc->cwnd_minimum > cc->cwnd)
+        cc->cwnd_minimum = cc->cwnd;
+    cc->state.prague.alpha = 1;
+    cc->state.prague.bytes_acked_in_round = 0;
+    cc->state.prague.bytes_marked_in_round = 0;
+    cc->state.prague.stash = 0;
+}
+
+static uint32_t prague_pacing_rate(quicly_cc_t *cc, const quicly_loss_t *loss)
+{
+    /* Pacing is mandatory for Prague, as bursts are enough to build up the shallow L4S queue. Following Linux, the multiplier is 2x
+     * during slow start and 1.25x otherwise (both expressed in quarters below); the 2x margin used by other CCs for accommodating
+     * the inflated SRTT after a loss is unnecessary, because the queueing delay is kept small. */
+    uint32_t quarters;
+    if (quicly_cc_in_jumpstart(cc)) {
+        quarters = 4;
+    } else if (cc->cwnd < cc->ssthresh) {
+        quarters = 8;
+    } else {
+        quarters = 5;
+    }
+    return quicly_pacer_calc_send_rate(quarters, cc->cwnd, loss->rtt.smoothed * 4);
+}
+
+static int prague_on_switch(quicly_cc_t *cc)
+{
+    /* switching from or to other CCs is not supported, as the ECN codepoint being used differs */
+    return cc->type == &quicly_cc_type_prague;
+}
+
+static void prague_init(quicly_init_cc_t *self, quicly_cc_t *cc, uint32_t initcwnd, int64_t now)
+{
+    memset(cc, 0, sizeof(quicly_cc_t));
+    cc->type = &quicly_cc_type_prague;
+    cc->cwnd = cc->cwnd_initial = cc->cwnd_maximum = initcwnd;
+    cc->exit_slow_start_at = INT64_MAX;
+    cc->ssthresh = cc->cwnd_minimum = UINT32_MAX;
+    /* start conservatively, assuming that all packets would be marked (RFC 8257 Section 3.3) */
+    cc->state.prague.alpha = 1;
+    cc->state.prague.max_udp_payload_size = QUICLY_MIN_CLIENT_INITIAL_SIZE;
+
+    quicly_cc_jumpstart_reset(cc);
+}
+
+quicly_cc_type_t quicly_cc_type_prague = {"prague",
+                                          &quicly_cc_prague_init,
+                                          prague_on_acked,
+                                          prague_on_lost,
+                                          prague_on_persistent_congestion,
+                                          quicly_cc_reno_on_sent,
+                                          prague_on_switch,
+                                          quicly_cc_jumpstart_enter,
+                                          NULL,
+                                          prague_pacing_rate,
+                                          prague_on_ecn_ce};
+quicly_init_cc_t quicly_cc_prague_init = {prague_init};
@@ -22,9 +22,9 @@
 #include "quicly/cc.h"
 #include "quicly.h"
 
-/* TODO: Avoid increase if sender was application limited. */
 static void reno_on_acked(quicly_cc_t *cc, const quicly_loss_t *loss, uint32_t bytes, uint64_t largest_acked, uint32_t inflight,
-                          int cc_limited, uint64_t next_pn, int64_t now, uint32_t max_udp_payload_size)
+                          int cc_limited, const quicly_delivery_rate_sample_t *rs, uint64_t next_pn, int64_t now,
+                          uint32_t max_udp_payload_size)
 {
     assert(inflight >= bytes);
 
@@ -35,11 +35,15 @@ static void reno_on_acked(quicly_cc_t *cc, const quicly_loss_t *loss, uint32_t b
     }
 
     quicly_cc_jumpstart_on_acked(cc, 0, bytes, largest_acked, inflight, next_pn);
+    quicly_cc_cwv_on_acked(cc, cc_limited, inflight, now);
 
     /* Slow start. */
     if (cc->cwnd < cc->ssthresh) {
+        uint32_t increase = quicly_cc_hystart_is_enabled(&cc->hystart)
+                                ? quicly_cc_hystart_on_acked(cc, bytes, largest_acked, next_pn, loss->rtt.latest, now)
+                                : bytes;
         if (cc_limited) {
-            cc->cwnd = quicly_u32_add_saturating(cc->cwnd, bytes);
+            cc->cwnd = quicly_u32_add_saturating(cc->cwnd, increase);
             if (cc->cwnd_maximum < cc->cwnd)
                 cc->cwnd_maximum = cc->cwnd;
         }
@@ -79,8 +83,11 @@ void quicly_cc_reno_on_lost(quicly_cc_t *cc, const quicly_loss_t *loss, uint32_t
         cc->exit_slow_start_at = now;
     }
 
-    /* Reduce congestion window. */
-    cc->cwnd *= cc->ssthresh == UINT32_MAX ? 0.5 : QUICLY_RENO_BETA; /* without HyStart++, we overshoot by 2x in slowstart */
+    /* Reduce congestion window. If app-limited, reduction is applied to the portion of CWND that has been validated. Without
+     * HyStart++ (or when it is yet to enter CSS), we overshoot by 2x in slowstart. */
+    quicly_cc_cwv_on_congestion(cc, loss->sentmap.bytes_in_flight);
+    int in_css = quicly_cc_hystart_on_congestion(&cc->hystart);
+    cc->cwnd *= cc->ssthresh == UINT32_MAX && !in_css ? 0.5 : QUICLY_RENO_BETA;
     if (cc->cwnd < QUICLY_MIN_CWND * max_udp_payload_size)
         cc->cwnd = QUICLY_MIN_CWND * max_udp_payload_size;
     cc->ssthresh = cc->cwnd;
@@ -108,6 +115,7 @@ static void reno_reset(quicly_cc_t *cc, uint32_t initcwnd)
     cc->ssthresh = cc->cwnd_minimum = UINT32_MAX;
 
     quicly_cc_jumpstart_reset(cc);
+    quicly_cc_cwv_reset(cc);
 }
 
 static int reno_on_switch(quicly_cc_t *cc)
@@ -136,6 +144,12 @@ static void reno_init(quicly_init_cc_t *self, quicly_cc_t *cc, uint32_t initcwnd
     reno_reset(cc, initcwnd);
 }
 
+static void reno_hystart_init(quicly_init_cc_t *self, quicly_cc_t *cc, uint32_t initcwnd, int64_t now)
+{
+    reno_reset(cc, initcwnd);
+    quicly_cc_init_hystart(&cc->hystart);
+}
+
 quicly_cc_type_t quicly_cc_type_reno = {"reno",
                                         &quicly_cc_reno_init,
                                         reno_on_acked,
@@ -145,8 +159,10 @@ quicly_cc_type_t quicly_cc_type_reno = {"reno",
                                         reno_on_switch,
                                         quicly_cc_jumpstart_enter};
 quicly_init_cc_t quicly_cc_reno_init = {reno_init};
+quicly_init_cc_t quicly_cc_reno_hystart_init = {reno_hystart_init};
 
-quicly_cc_type_t *quicly_cc_all_types[] = {&quicly_cc_type_reno, &quicly_cc_type_cubic, &quicly_cc_type_pico, NULL};
+quicly_cc_type_t *quicly_cc_all_types[] = {&quicly_cc_type_reno, &quicly_cc_type_cubic, &quicly_cc_type_pico, &quicly_cc_type_bbr,
+                                           &quicly_cc_type_prague, &quicly_cc_type_ledbat, NULL};
 
 uint32_t quicly_cc_calc_initial_cwnd(uint32_t max_packets, uint16_t max_udp_payload_size)
 {
@@ -19,6 +19,7 @@
  * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
  * IN THE SOFTWARE.
  */
+#include <pthread.h>
 #include <sys/time.h>
 #include "quicly/defaults.h"
 
@@ -118,8 +119,25 @@ const quicly_context_t quicly_performant_context = {
 struct st_quicly_default_encrypt_cid_t {
     quicly_cid_encryptor_t super;
     ptls_cipher_context_t *cid_encrypt_ctx, *cid_decrypt_ctx, *reset_token_ctx;
+    /**
+     * if the ciphers are ECB; if so, multiple blocks are transformed by one call to the cipher, which allows the backend to process
+     * them in parallel (e.g., OpenSSL processes 8 blocks at once when AES-NI is available)
+     */
+    unsigned cid_is_ecb : 1;
+    unsigned reset_token_is_ecb : 1;
 };
 
+/**
+ * maximum number of blocks being transformed by one call to the cipher
+ */
+#define DEFAULT_CID_BATCH_SIZE 8
+
+static int cipher_is_ecb(ptls_cipher_algorithm_t *algo)
+{
+    size_t len = strlen(algo->name);
+    return len >= 4 && strcmp(algo->name + len - 4, "-ECB") == 0;
+}
+
 static void generate_reset_token(struct st_quicly_default_encrypt_cid_t *self, void *token, const void *cid)
 {
     uint8_t expandbuf[QUICLY_STATELESS_RESET_TOKEN_LEN];
@@ -138,14 +156,11 @@ static void generate_reset_token(struct st_quicly_default_encrypt_cid_t *self, v
     ptls_cipher_encrypt(self->reset_token_ctx, token, cid, QUICLY_STATELESS_RESET_TOKEN_LEN);
 }
 
-static void default_encrypt_cid(quicly_cid_encryptor_t *_self, quicly_cid_t *encrypted, void *reset_token,
-                                const quicly_cid_plaintext_t *plaintext)
+static void encode_cid_plaintext(struct st_quicly_default_encrypt_cid_t *self, uint8_t *buf,
+                                 const quicly_cid_plaintext_t *plaintext)
 {
-    struct st_quicly_default_encrypt_cid_t *self = (void *)_self;
-    uint8_t buf[16], *p;
+    uint8_t *p = buf;
 
-    /* encode */
-    p = buf;
     switch (self->cid_encrypt_ctx->algo->block_size) {
     case 8:
         break;
@@ -159,6 +174,30 @@ static void default_encrypt_cid(quicly_cid_encryptor_t *_self, quicly_cid_t *enc
     p = quicly_encode32(p, plaintext->master_id);
     p = quicly_encode32(p, (plaintext->thread_id << 8) | plaintext->path_id);
     assert(p - buf == self->cid_encrypt_ctx->algo->block_size);
+}
+
+static void decode_cid_plaintext(quicly_cid_plaintext_t *plaintext, const uint8_t *buf, size_t len)
+{
+    const uint8_t *p = buf;
+
+    if (len == 16) {
+        plaintext->node_id = quicly_decode64(&p);
+    } else {
+        plaintext->node_id = 0;
+    }
+    plaintext->master_id = quicly_decode32(&p);
+    plaintext->thread_id = quicly_decode24(&p);
+    plaintext->path_id = *p++;
+    assert(p - buf == len);
+}
+
+static void default_encrypt_cid(quicly_cid_encryptor_t *_self, quicly_cid_t *encrypted, void *reset_token,
+                                const quicly_cid_plaintext_t *plaintext)
+{
+    struct st_quicly_default_encrypt_cid_t *self = (void *)_self;
+    uint8_t buf[16];
+
+    encode_cid_plaintext(self, buf, plaintext);
 
     /* generate CID */
     ptls_cipher_encrypt(self->cid_encrypt_ctx, encrypted->cid, buf, self->cid_encrypt_ctx->algo->block_size);
@@ -174,7 +213,6 @@ static size_t default_decrypt_cid(quicly_cid_encryptor_t *_self, quicly_cid_plai
 {
     struct st_quicly_default_encrypt_cid_t *self = (void *)_self;
     uint8_t ptbuf[16];
-    const uint8_t *p;
 
     if (len != 0) {
         /* long header packet; decrypt only if given Connection ID matches the expected size */
@@ -188,21 +226,90 @@ static size_t default_decrypt_cid(quicly_cid_encryptor_t *_self, quicly_cid_plai
     /* decrypt */
     ptls_cipher_encrypt(self->cid_decrypt_ctx, ptbuf, encrypted, len);
 
-    /* decode */
-    p = ptbuf;
-    if (len == 16) {
-        plaintext->node_id = quicly_decode64(&p);
-    } else {
-        plaintext->node_id = 0;
-    }
-    plaintext->master_id = quicly_decode32(&p);
-    plaintext->thread_id = quicly_decode24(&p);
-    plaintext->path_id = *p++;
-    assert(p - ptbuf == len);
+    decode_cid_plaintext(plaintext, ptbuf, len);
 
     return len;
 }
 
+static void default_encrypt_cid_batch(quicly_cid_encryptor_t *_self, quicly_cid_t *const *encrypted, void *const *reset_tokens,
+                                      const quicly_cid_plaintext_t *plaintexts, size_t count)
+{
+    struct st_quicly_default_encrypt_cid_t *self = (void *)_self;
+    size_t block_size = self->cid_encrypt_ctx->algo->block_size;
+
+    if (!self->cid_is_ecb) {
+        for (size_t i = 0; i < count; ++i)
+            default_encrypt_cid(_self, encrypted[i], reset_tokens != NULL ? reset_tokens[i] : NULL, plaintexts + i);
+        return;
+    }
+
+    for (size_t off = 0; off < count; off += DEFAULT_CID_BATCH_SIZE) {
+        size_t num_blocks = count - off < DEFAULT_CID_BATCH_SIZE ? count - off : DEFAULT_CID_BATCH_SIZE;
+        uint8_t buf[DEFAULT_CID_BATCH_SIZE * QUICLY_STATELESS_RESET_TOKEN_LEN],
+            tokens[DEFAULT_CID_BATCH_SIZE * QUICLY_STATELESS_RESET_TOKEN_LEN];
+
+        /* generate CIDs */
+        for (size_t i = 0; i < num_blocks; ++i)
+            encode_cid_plaintext(self, buf + i * block_size, plaintexts + off + i);
+        ptls_cipher_encrypt(self->cid_encrypt_ctx, buf, buf, num_blocks * block_size);
+        for (size_t i = 0; i < num_blocks; ++i)
+            quicly_set_cid(encrypted[off + i], ptls_iovec_init(buf + i * block_size, block_size));
+
+        /* generate stateless reset tokens if requested */
+        if (reset_tokens == NULL)
+            continue;
+        if (!self->reset_token_is_ecb) {
+            for (size_t i = 0; i < num_blocks; ++i)
+                if (reset_tokens[off + i] != NULL)
+                    generate_reset_token(self, reset_tokens[off + i], encrypted[off + i]->cid);
+            continue;
+        }
+        memset(tokens, 0, sizeof(tokens));
+        for (size_t i = 0; i < num_blocks; ++i)
+            memcpy(tokens + i * QUICLY_STATELESS_RESET_TOKEN_LEN, encrypted[off + i]->cid, block_size);
+        ptls_cipher_encrypt(self->reset_token_ctx, tokens, tokens, num_blocks * QUICLY_STATELESS_RESET_TOKEN_LEN);
+        for (size_t i = 0; i < num_blocks; ++i)
+            if (reset_tokens[off + i] != NULL)
+                memcpy(reset_tokens[off + i], tokens + i * QUICLY_STATELESS_RESET_TOKEN_LEN, QUICLY_STATELESS_RESET_TOKEN_LEN);
+    }
+}
+
+static void default_decrypt_cid_batch(quicly_cid_encryptor_t *_self, quicly_cid_plaintext_t *const *plaintexts,
+                                      const void *const *encrypted, size_t *lens, size_t count)
+{
+    struct st_quicly_default_encrypt_cid_t *self = (void *)_self;
+    size_t block_size = self->cid_decrypt_ctx->algo->block_size;
+
+    if (!self->cid_is_ecb) {
+        for (size_t i = 0; i < count; ++i)
+            lens[i] = default_decrypt_cid(_self, plaintexts[i], encrypted[i], lens[i]);
+        return;
+    }
+
+    for (size_t off = 0; off < count;) {
+        uint8_t buf[DEFAULT_CID_BATCH_SIZE * 16];
+        size_t indexes[DEFAULT_CID_BATCH_SIZE], num_blocks = 0;
+
+        /* gather the CIDs that have the expected size (or the ones found in short header packets) */
+        for (; off < count && num_blocks < DEFAULT_CID_BATCH_SIZE; ++off) {
+            if (lens[off] != 0 && lens[off] != block_size) {
+                lens[off] = SIZE_MAX;
+                continue;
+            }
+            lens[off] = block_size;
+            memcpy(buf + num_blocks * block_size, encrypted[off], block_size);
+            indexes[num_blocks++] = off;
+        }
+        if (num_blocks == 0)
+            break;
+
+        /* decrypt, then decode */
+        ptls_cipher_encrypt(self->cid_decrypt_ctx, buf, buf, num_blocks * block_size);
+        for (size_t i = 0; i < num_blocks; ++i)
+            decode_cid_plaintext(plaintexts[indexes[i]], buf + i * block_size, block_size);
+    }
+}
+
 static int default_generate_reset_token(quicly_cid_encryptor_t *_self, void *token, const void *cid)
 {
     struct st_quicly_default_encrypt_cid_t *self = (void *)_self;
@@ -210,6 +317,33 @@ static int default_generate_reset_token(quicly_cid_encryptor_t *_self, void *tok
     return 1;
 }
 
+static int default_generate_reset_token_batch(quicly_cid_encryptor_t *_self, void *const *tokens, const void *const *cids,
+                                              size_t count)
+{
+    struct st_quicly_default_encrypt_cid_t *self = (void *)_self;
+    size_t cid_len = self->cid_encrypt_ctx->algo->block_size;
+
+    if (!self->reset_token_is_ecb) {
+        for (size_t i = 0; i < count; ++i)
+            generate_reset_token(self, tokens[i], cids[i]);
+        return 1;
+    }
+
+    for (size_t off = 0; off < count; off += DEFAULT_CID_BATCH_SIZE) {
+        size_t num_blocks = count - off < DEFAULT_CID_BATCH_SIZE ? count - off : DEFAULT_CID_BATCH_SIZE;
+        uint8_t buf[DEFAULT_CID_BATCH_SIZE * QUICLY_STATELESS_RESET_TOKEN_LEN];
+        /* expand each CID to the size of the reset token, as `generate_reset_token` does, then transform at once */
+        memset(buf, 0, sizeof(buf));
+        for (size_t i = 0; i < num_blocks; ++i)
+            memcpy(buf + i * QUICLY_STATELESS_RESET_TOKEN_LEN, cids[off + i], cid_len);
+        ptls_cipher_encrypt(self->reset_token_ctx, buf, buf, num_blocks * QUICLY_STATELESS_RESET_TOKEN_LEN);
+        for (size_t i = 0; i < num_blocks; ++i)
+            memcpy(tokens[off + i], buf + i * QUICLY_STATELESS_RESET_TOKEN_LEN, QUICLY_STATELESS_RESET_TOKEN_LEN);
+    }
+
+    return 1;
+}
+
 quicly_cid_encryptor_t *quicly_new_default_cid_encryptor(ptls_cipher_algorithm_t *cid_cipher,
                                                          ptls_cipher_algorithm_t *reset_token_cipher, ptls_hash_algorithm_t *hash,
                                                          ptls_iovec_t key)
@@ -227,7 +361,12 @@ quicly_cid_encryptor_t *quicly_new_default_cid_encryptor(ptls_cipher_algorithm_t
 
     if ((self = malloc(sizeof(*self))) == NULL)
         goto Fail;
-    *self = (struct st_quicly_default_encrypt_cid_t){{default_encrypt_cid, default_decrypt_cid, default_generate_reset_token}};
+    *self = (struct st_quicly_default_encrypt_cid_t){
+        .super = {default_encrypt_cid, default_decrypt_cid, default_generate_reset_token, default_encrypt_cid_batch,
+                  default_decrypt_cid_batch, default_generate_reset_token_batch},
+        .cid_is_ecb = cipher_is_ecb(cid_cipher),
+        .reset_token_is_ecb = cipher_is_ecb(reset_token_cipher),
+    };
 
     if (ptls_hkdf_expand_label(hash, keybuf, cid_cipher->key_size, key, "cid", ptls_iovec_init(NULL, 0), "") != 0)
         goto Fail;
@@ -269,6 +408,242 @@ void quicly_free_default_cid_encryptor(quicly_cid_encryptor_t *_self)
     free(self);
 }
 
+struct st_quicly_quiclb_encrypt_cid_t {
+    quicly_cid_encryptor_t super;
+    quicly_quiclb_config_t config;
+    /**
+     * AES-ECB contexts being used for encrypting the CIDs; NULL if the CIDs are not encrypted. The decryption context is used only
+     * by the single-pass mode.
+     */
+    ptls_cipher_context_t *cid_encrypt_ctx, *cid_decrypt_ctx;
+    ptls_cipher_context_t *reset_token_ctx;
+};
+
+static size_t quiclb_cid_len(struct st_quicly_quiclb_encrypt_cid_t *self)
+{
+    return 1 + self->config.server_id_len + self->config.nonce_len;
+}
+
+/**
+ * Runs one round of the four-pass mode; `dst ^= truncate(AES-ECB(expand(src, index)))`, with the odd nibble being masked.
+ */
+static void quiclb_four_pass_round(struct st_quicly_quiclb_encrypt_cid_t *self, uint8_t *dst, const uint8_t *src, size_t half_len,
+                                   uint8_t odd_mask_off, uint8_t odd_mask, uint8_t index)
+{
+    uint8_t block[16] = {0};
+
+    memcpy(block, src, half_len);
+    block[14] = (uint8_t)(self->config.server_id_len + self->config.nonce_len);
+    block[15] = index;
+    ptls_cipher_encrypt(self->cid_encrypt_ctx, block, block, sizeof(block));
+    block[odd_mask_off] &= odd_mask;
+    for (size_t i = 0; i < half_len; ++i)
+        dst[i] ^= block[i];
+}
+
+/**
+ * Applies the four-pass mode of QUIC-LB to `bytes` in place. The plaintext is split into left and right halves (that share the
+ * middle octet when the length is odd, each taking one nibble) and a Feistel network with four rounds is applied.
+ */
+static void quiclb_four_pass(struct st_quicly_quiclb_encrypt_cid_t *self, uint8_t *bytes, int is_enc)
+{
+    size_t len = self->config.server_id_len + self->config.nonce_len, half_len = (len + 1) / 2;
+    int is_odd = len % 2 != 0;
+    uint8_t left[10], right[10];
+    /* when the length is odd, the middle octet is shared; the upper nibble belongs to the left half, lower to the right */
+    uint8_t left_mask_off = half_len - 1, left_mask = is_odd ? 0xf0 : 0xff, right_mask = is_odd ? 0x0f : 0xff;
+
+    memcpy(left, bytes, half_len);
+    left[left_mask_off] &= left_mask;
+    memcpy(right, bytes + len - half_len, half_len);
+    right[0] &= right_mask;
+
+    if (is_enc) {
+        quiclb_four_pass_round(self, right, left, half_len, 0, right_mask, 1);
+        quiclb_four_pass_round(self, left, right, half_len, left_mask_off, left_mask, 2);
+        quiclb_four_pass_round(self, right, left, half_len, 0, right_mask, 3);
+        quiclb_four_pass_round(self, left, right, half_len, left_mask_off, left_mask, 4);
+    } else {
+        quiclb_four_pass_round(self, left, right, half_len, left_mask_off, left_mask, 4);
+        quiclb_four_pass_round(self, right, left, half_len, 0, right_mask, 3);
+        quiclb_four_pass_round(self, left, right, half_len, left_mask_off, left_mask, 2);
+        quiclb_four_pass_round(self, right, left, half_len, 0, right_mask, 1);
+    }
+
+    memcpy(bytes, left, half_len);
+    memcpy(bytes + half_len, right + is_odd, half_len - is_odd);
+    if (is_odd)
+        bytes[half_len - 1] |= right[0];
+}
+
+/**
+ * Generates the stateless reset token by running CBC-MAC over the CID. As the length of the CIDs is fixed for each encryptor, the
+ * construction is secure.
+ */
+static void quiclb_generate_reset_token(struct st_quicly_quiclb_encrypt_cid_t *self, void *token, const uint8_t *cid)
+{
+    size_t cid_len = quiclb_cid_len(self);
+    uint8_t block[QUICLY_STATELESS_RESET_TOKEN_LEN] = {0};
+
+    for (size_t off = 0; off < cid_len; off += sizeof(block)) {
+        for (size_t i = 0; i < sizeof(block) && off + i < cid_len; ++i)
+            block[i] ^= cid[off + i];
+        ptls_cipher_encrypt(self->reset_token_ctx, block, block, sizeof(block));
+    }
+    memcpy(token, block, sizeof(block));
+}
+
+static void quiclb_encrypt_cid(quicly_cid_encryptor_t *_self, quicly_cid_t *encrypted, void *reset_token,
+                               const quicly_cid_plaintext_t *plaintext)
+{
+    struct st_quicly_quiclb_encrypt_cid_t *self = (void *)_self;
+    size_t thread_id_len = self->config.nonce_len - 5;
+    uint8_t *p = encrypted->cid + 1;
+
+    /* encode server ID (the lower bytes of node_id), followed by the nonce carrying master_id, thread_id, path_id */
+    for (size_t i = self->config.server_id_len; i != 0; --i)
+        *p++ = (uint8_t)(plaintext->node_id >> (8 * (i - 1)));
+    p = quicly_encode32(p, plaintext->master_id);
+    assert(thread_id_len >= 3 || plaintext->thread_id >> (8 * thread_id_len) == 0);
+    for (size_t i = thread_id_len; i != 0; --i)
+        *p++ = i <= 3 ? (uint8_t)(plaintext->thread_id >> (8 * (i - 1))) : 0;
+    *p++ = (uint8_t)plaintext->path_id;
+    encrypted->len = (uint8_t)(p - encrypted->cid);
+    assert(encrypted->len == quiclb_cid_len(self));
+
+    /* encrypt */
+    if (self->cid_encrypt_ctx != NULL) {
+        if (encrypted->len == 17) {
+            ptls_cipher_encrypt(self->cid_encrypt_ctx, encrypted->cid + 1, encrypted->cid + 1, 16);
+        } else {
+            quiclb_four_pass(self, encrypted->cid + 1, 1);
+        }
+    }
+
+    /* set the first octet; the lower 5 bits are either the self-encoded length or taken from the ciphertext, which is unpredictable
+     * as long as the CIDs are encrypted */
+    encrypted->cid[0] = (uint8_t)(self->config.config_rotation << 5) |
+                        (self->config.encode_length ? encrypted->len - 1 : encrypted->cid[encrypted->len - 1] & 0x1f);
+
+    if (reset_token != NULL)
+        quiclb_generate_reset_token(self, reset_token, encrypted->cid);
+}
+
+static size_t quiclb_decrypt_cid(quicly_cid_encryptor_t *_self, quicly_cid_plaintext_t *plaintext, const void *_encrypted,
+                                 size_t len)
+{
+    struct st_quicly_quiclb_encrypt_cid_t *self = (void *)_self;
+    const uint8_t *encrypted = _encrypted, *p;
+    uint8_t buf[QUICLY_MAX_CID_LEN_V1 - 1];
+    size_t cid_len = quiclb_cid_len(self);
+
+    /* check the length (when given) and the config rotation bits */
+    if (len != 0 && len != cid_len)
+        return SIZE_MAX;
+    if (encrypted[0] >> 5 != self->config.config_rotation)
+        return SIZE_MAX;
+
+    /* decrypt */
+    memcpy(buf, encrypted + 1, cid_len - 1);
+    if (self->cid_encrypt_ctx != NULL) {
+        if (cid_len == 17) {
+            ptls_cipher_encrypt(self->cid_decrypt_ctx, buf, buf, 16);
+        } else {
+            quiclb_four_pass(self, buf, 0);
+        }
+    }
+
+    /* decode */
+    p = buf;
+    plaintext->node_id = 0;
+    for (size_t i = 0; i < self->config.server_id_len; ++i)
+        plaintext->node_id = (plaintext->node_id << 8) | *p++;
+    plaintext->master_id = quicly_decode32(&p);
+    plaintext->thread_id = 0;
+    for (size_t i = 5; i < self->config.nonce_len; ++i)
+        plaintext->thread_id = ((plaintext->thread_id << 8) | *p++) & 0xffffff;
+    plaintext->path_id = *p++;
+    assert(p - buf == cid_len - 1);
+
+    return cid_len;
+}
+
+static int quiclb_generate_reset_token_cb(quicly_cid_encryptor_t *_self, void *token, const void *cid)
+{
+    struct st_quicly_quiclb_encrypt_cid_t *self = (void *)_self;
+    quiclb_generate_reset_token(self, token, cid);
+    return 1;
+}
+
+quicly_cid_encryptor_t *quicly_new_quiclb_cid_encryptor(const quicly_quiclb_config_t *config, ptls_cipher_algorithm_t *cid_cipher,
+                                                        ptls_iovec_t cid_key, ptls_cipher_algorithm_t *reset_token_cipher,
+                                                        ptls_hash_algorithm_t *hash, ptls_iovec_t reset_token_key)
+{
+    struct st_quicly_quiclb_encrypt_cid_t *self;
+    uint8_t digestbuf[PTLS_MAX_DIGEST_SIZE], keybuf[PTLS_MAX_SECRET_SIZE];
+
+    assert(reset_token_cipher->block_size == 16);
+
+    /* validate the configuration */
+    if (config->config_rotation >= 7)
+        return NULL;
+    if (!(1 <= config->server_id_len && config->server_id_len <= 8))
+        return NULL;
+    if (!(6 <= config->nonce_len && config->server_id_len + config->nonce_len < QUICLY_MAX_CID_LEN_V1))
+        return NULL;
+    if (cid_cipher != NULL && !(cid_cipher->block_size == 16 && cid_key.len == cid_cipher->key_size))
+        return NULL;
+
+    if (reset_token_key.len > hash->block_size) {
+        ptls_calc_hash(hash, digestbuf, reset_token_key.base, reset_token_key.len);
+        reset_token_key = ptls_iovec_init(digestbuf, hash->digest_size);
+    }
+
+    if ((self = malloc(sizeof(*self))) == NULL)
+        goto Fail;
+    *self = (struct st_quicly_quiclb_encrypt_cid_t){
+        .super = {quiclb_encrypt_cid, quiclb_decrypt_cid, quiclb_generate_reset_token_cb},
+        .config = *config,
+    };
+
+    /* the CID key is shared with the load balancers, and is therefore used as is */
+    if (cid_cipher != NULL) {
+        if ((self->cid_encrypt_ctx = ptls_cipher_new(cid_cipher, 1, cid_key.base)) == NULL)
+            goto Fail;
+        if ((self->cid_decrypt_ctx = ptls_cipher_new(cid_cipher, 0, cid_key.base)) == NULL)
+            goto Fail;
+    }
+    if (ptls_hkdf_expand_label(hash, keybuf, reset_token_cipher->key_size, reset_token_key, "reset", ptls_iovec_init(NULL, 0),
+                               "") != 0)
+        goto Fail;
+    if ((self->reset_token_ctx = ptls_cipher_new(reset_token_cipher, 1, keybuf)) == NULL)
+        goto Fail;
+
+    ptls_clear_memory(digestbuf, sizeof(digestbuf));
+    ptls_clear_memory(keybuf, sizeof(keybuf));
+    return &self->super;
+
+Fail:
+    if (self != NULL)
+        quicly_free_quiclb_cid_encryptor(&self->super);
+    ptls_clear_memory(digestbuf, sizeof(digestbuf));
+    ptls_clear_memory(keybuf, sizeof(keybuf));
+    return NULL;
+}
+
+void quicly_free_quiclb_cid_encryptor(quicly_cid_encryptor_t *_self)
+{
+    struct st_quicly_quiclb_encrypt_cid_t *self = (void *)_self;
+
+    if (self->cid_encrypt_ctx != NULL)
+        ptls_cipher_free(self->cid_encrypt_ctx);
+    if (self->cid_decrypt_ctx != NULL)
+        ptls_cipher_free(self->cid_decrypt_ctx);
+    if (self->reset_token_ctx != NULL)
+        ptls_cipher_free(self->reset_token_ctx);
+    free(self);
+}
+
 /**
  * See doc-comment of `st_quicly_default_scheduler_state_t` to understand the logic.
  */
@@ -459,3 +834,170 @@ static void default_finalize_send_packet(quicly_crypto_engine_t *engine, quicly_
 }
 
 quicly_crypto_engine_t quicly_default_crypto_engine = {default_setup_cipher, default_finalize_send_packet};
+
+#define PATH_PROFILE_CACHE_WAYS 4
+
+/**
+ * The default path profile cache is a set-associative table protected by a mutex. Entries are keyed by the client subnet; when
+ * all the slots of a set are occupied, the oldest entry is replaced.
+ */
+struct st_quicly_default_path_profile_cache_t {
+    quicly_path_profile_cache_t super;
+    pthread_mutex_t mutex;
+    unsigned ipv4_prefix_len;
+    unsigned ipv6_prefix_len;
+    int64_t lifetime;
+    size_t num_sets;
+    struct st_quicly_default_path_profile_entry_t {
+        /**
+         * the subnet; first byte is the address family (4 or 6), followed by the address with host bits cleared
+         */
+        uint8_t key[17];
+        /**
+         * when the entry was stored, or INT64_MIN if the slot is unused
+         */
+        int64_t stored_at;
+        quicly_path_profile_t profile;
+    } entries[1];
+};
+
+static int build_path_profile_key(struct st_quicly_default_path_profile_cache_t *self, const struct sockaddr *sa, uint8_t *key)
+{
+    const uint8_t *addr;
+    unsigned prefix_len;
+
+    memset(key, 0, sizeof(((struct st_quicly_default_path_profile_entry_t *)NULL)->key));
+
+    switch (sa->sa_family) {
+    case AF_INET:
+        key[0] = 4;
+        addr = (const uint8_t *)&((const struct sockaddr_in *)sa)->sin_addr;
+        prefix_len = self->ipv4_prefix_len;
+        break;
+    case AF_INET6:
+        addr = (const uint8_t *)&((const struct sockaddr_in6 *)sa)->sin6_addr;
+        if (IN6_IS_ADDR_V4MAPPED(&((const struct sockaddr_in6 *)sa)->sin6_addr)) {
+            /* IPv4 clients of dual-stack sockets */
+            key[0] = 4;
+            addr += 12;
+            prefix_len = self->ipv4_prefix_len;
+        } else {
+            key[0] = 6;
+            prefix_len = self->ipv6_prefix_len;
+        }
+        break;
+    default:
+        return 0;
+    }
+
+    memcpy(key + 1, addr, prefix_len / 8);
+    if (prefix_len % 8 != 0)
+        key[1 + prefix_len / 8] = addr[prefix_len / 8] & (0xff00 >> (prefix_len % 8));
+
+    return 1;
+}
+
+static struct st_quicly_default_path_profile_entry_t *get_path_profile_set(struct st_quicly_default_path_profile_cache_t *self,
+                                                                           const uint8_t *key)
+{
+    /* FNV-1a */
+    uint32_t hash = 2166136261;
+    for (size_t i = 0; i < sizeof(((struct st_quicly_default_path_profile_entry_t *)NULL)->key); ++i)
+        hash = (hash ^ key[i]) * 16777619;
+
+    return self->entries + hash % self->num_sets * PATH_PROFILE_CACHE_WAYS;
+}
+
+static int default_path_profile_lookup(quicly_path_profile_cache_t *_self, quicly_conn_t *conn, const struct sockaddr *remote,
+                                       int64_t now, quicly_path_profile_t *profile)
+{
+    struct st_quicly_default_path_profile_cache_t *self = (void *)_self;
+    uint8_t key[sizeof(self->entries[0].key)];
+    int found = 0;
+
+    if (!build_path_profile_key(self, remote, key))
+        return 0;
+
+    pthread_mutex_lock(&self->mutex);
+
+    struct st_quicly_default_path_profile_entry_t *set = get_path_profile_set(self, key);
+    for (size_t i = 0; i < PATH_PROFILE_CACHE_WAYS; ++i) {
+        if (set[i].stored_at != INT64_MIN && memcmp(set[i].key, key, sizeof(key)) == 0) {
+            if (now - set[i].stored_at < self->lifetime) {
+                *profile = set[i].profile;
+                found = 1;
+            } else {
+                set[i].stored_at = INT64_MIN;
+            }
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&self->mutex);
+
+    return found;
+}
+
+static void default_path_profile_store(quicly_path_profile_cache_t *_self, quicly_conn_t *conn, const struct sockaddr *remote,
+                                       int64_t now, const quicly_path_profile_t *profile)
+{
+    struct st_quicly_default_path_profile_cache_t *self = (void *)_self;
+    uint8_t key[sizeof(self->entries[0].key)];
+
+    if (!build_path_profile_key(self, remote, key))
+        return;
+
+    pthread_mutex_lock(&self->mutex);
+
+    /* use the slot with the same key, or the oldest one */
+    struct st_quicly_default_path_profile_entry_t *set = get_path_profile_set(self, key), *slot = set;
+    for (size_t i = 0; i < PATH_PROFILE_CACHE_WAYS; ++i) {
+        if (set[i].stored_at != INT64_MIN && memcmp(set[i].key, key, sizeof(key)) == 0) {
+            slot = set + i;
+            break;
+        }
+        if (set[i].stored_at < slot->stored_at)
+            slot = set + i;
+    }
+    memcpy(slot->key, key, sizeof(key));
+    slot->stored_at = now;
+    slot->profile = *profile;
+
+    pthread_mutex_unlock(&self->mutex);
+}
+
+quicly_path_profile_cache_t *quicly_new_default_path_profile_cache(size_t capacity, unsigned ipv4_prefix_len,
+                                                                   unsigned ipv6_prefix_len, int64_t lifetime)
+{
+    struct st_quicly_default_path_profile_cache_t *self;
+
+    assert(ipv4_prefix_len <= 32 && ipv6_prefix_len <= 128);
+
+    size_t num_sets = (capacity + PATH_PROFILE_CACHE_WAYS - 1) / PATH_PROFILE_CACHE_WAYS;
+    if (num_sets == 0)
+        num_sets = 1;
+
+    if ((self = malloc(offsetof(struct st_quicly_default_path_profile_cache_t, entries) +
+                       sizeof(self->entries[0]) * num_sets * PATH_PROFILE_CACHE_WAYS)) == NULL)
+        return NULL;
+    *self = (struct st_quicly_default_path_profile_cache_t){
+        .super = {default_path_profile_lookup, default_path_profile_store},
+        .ipv4_prefix_len = ipv4_prefix_len,
+        .ipv6_prefix_len = ipv6_prefix_len,
+        .lifetime = lifetime,
+        .num_sets = num_sets,
+    };
+    pthread_mutex_init(&self->mutex, NULL);
+    for (size_t i = 0; i < num_sets * PATH_PROFILE_CACHE_WAYS; ++i)
+        self->entries[i].stored_at = INT64_MIN;
+
+    return &self->super;
+}
+
+void quicly_free_default_path_profile_cache(quicly_path_profile_cache_t *_self)
+{
+    struct st_quicly_default_path_profile_cache_t *self = (void *)_self;
+
+    pthread_mutex_destroy(&self->mutex);
+    free(self);
+}
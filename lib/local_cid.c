@@ -40,6 +40,37 @@ static int generate_cid(quicly_local_cid_set_t *set, size_t idx)
     return 1;
 }
 
+/**
+ * Generates CIDs for the specified slots in one batch, if supported by the encryptor. Returns the number of CIDs being generated,
+ * which might be smaller than `count` when the path_id space is exhausted.
+ */
+static size_t generate_cids(quicly_local_cid_set_t *set, const size_t *indexes, size_t count)
+{
+    if (set->_encryptor == NULL || set->plaintext.path_id >= QUICLY_MAX_PATH_ID)
+        return 0;
+    if (count > QUICLY_MAX_PATH_ID - set->plaintext.path_id)
+        count = QUICLY_MAX_PATH_ID - set->plaintext.path_id;
+
+    if (count == 1 || set->_encryptor->encrypt_cid_batch == NULL) {
+        for (size_t i = 0; i < count; ++i)
+            generate_cid(set, indexes[i]);
+        return count;
+    }
+
+    quicly_cid_t *encrypted[PTLS_ELEMENTSOF(set->cids)];
+    void *reset_tokens[PTLS_ELEMENTSOF(set->cids)];
+    quicly_cid_plaintext_t plaintexts[PTLS_ELEMENTSOF(set->cids)];
+    for (size_t i = 0; i < count; ++i) {
+        encrypted[i] = &set->cids[indexes[i]].cid;
+        reset_tokens[i] = set->cids[indexes[i]].stateless_reset_token;
+        plaintexts[i] = set->plaintext;
+        set->cids[indexes[i]].sequence = set->plaintext.path_id++;
+    }
+    set->_encryptor->encrypt_cid_batch(set->_encryptor, encrypted, reset_tokens, plaintexts, count);
+
+    return count;
+}
+
 static void swap_cids(quicly_local_cid_t *a, quicly_local_cid_t *b)
 {
     quicly_local_cid_t tmp = *b;
@@ -113,14 +144,15 @@ int quicly_local_cid_set_size(quicly_local_cid_set_t *set, size_t size)
 
     /* First we prepare N CIDs (to be precise here we prepare N-1, as we already had one upon initialization).
      * Later, every time one of the CIDs is retired, we immediately prepare one additional CID
-     * to always fill the CID list. */
+     * to always fill the CID list. The CIDs are generated in one batch, then marked as pending in the order of the slots. */
+    size_t indexes[PTLS_ELEMENTSOF(set->cids)], num_indexes = 0;
     for (size_t i = 0; i < size; i++) {
-        if (set->cids[i].state != QUICLY_LOCAL_CID_STATE_IDLE)
-            continue;
-
-        if (!generate_cid(set, i))
-            break;
-        do_mark_pending(set, i);
+        if (set->cids[i].state == QUICLY_LOCAL_CID_STATE_IDLE)
+            indexes[num_indexes++] = i;
+    }
+    num_indexes = generate_cids(set, indexes, num_indexes);
+    for (size_t i = 0; i < num_indexes; i++) {
+        do_mark_pending(set, indexes[i]);
         is_pending = 1;
     }
 
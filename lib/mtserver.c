@@ -0,0 +1,737 @@
+/*
+ * Copyright (c) 2026 Fastly
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+#include "khash.h"
+#include "quicly/mtserver.h"
+
+#define QUICLY_MTSERVER_RECV_BATCH 64 /* maximum number of datagrams being read from the socket per each wakeup */
+#define QUICLY_MTSERVER_SEND_BATCH 10 /* maximum number of datagrams being built per each call to `quicly_send` */
+#define QUICLY_MTSERVER_RING_SIZE 64  /* number of slots in each hand-off ring; must be a power of 2 */
+#define QUICLY_MTSERVER_CACHELINE 64
+
+/**
+ * a connection owned by a worker, along with its position in the timeout heap
+ */
+struct st_quicly_mtserver_conn_t {
+    quicly_conn_t *conn;
+    /**
+     * value of `quicly_get_first_timeout` being cached; refreshed whenever the connection is handled by the worker
+     */
+    int64_t timeout_at;
+    size_t heap_index;
+};
+
+static inline khint_t hash_cid(const quicly_cid_t *cid)
+{
+    /* FNV-1a */
+    uint32_t hash = 2166136261;
+    for (size_t i = 0; i != cid->len; ++i)
+        hash = (hash ^ cid->cid[i]) * 16777619;
+    return hash;
+}
+
+static inline int cid_is_equal(const quicly_cid_t *x, const quicly_cid_t *y)
+{
+    return quicly_cid_is_equal(x, ptls_iovec_init(y->cid, y->len));
+}
+
+KHASH_MAP_INIT_INT64(quicly_mtserver_conn_by_master_id, struct st_quicly_mtserver_conn_t *)
+KHASH_INIT(quicly_mtserver_conn_by_odcid, const quicly_cid_t *, struct st_quicly_mtserver_conn_t *, 1, hash_cid, cid_is_equal)
+
+/**
+ * a datagram being handed off to another worker, along with the first QUIC packet that has already been decoded
+ */
+struct st_quicly_mtserver_handoff_t {
+    quicly_address_t remote;
+    quicly_decoded_packet_t packet;
+    size_t off;
+    size_t len;
+    uint8_t *bytes;
+};
+
+/**
+ * Single-producer, single-consumer ring used for handing off datagrams from one worker to another. `tail` is advanced by the
+ * producer and `head` by the consumer, each of them residing on a separate cache line. Each slot has its own buffer, so that the
+ * datagram is copied only once.
+ */
+struct st_quicly_mtserver_ring_t {
+    size_t tail;
+    uint8_t _pad1[QUICLY_MTSERVER_CACHELINE - sizeof(size_t)];
+    size_t head;
+    uint8_t _pad2[QUICLY_MTSERVER_CACHELINE - sizeof(size_t)];
+    struct st_quicly_mtserver_handoff_t slots[QUICLY_MTSERVER_RING_SIZE];
+};
+
+struct st_quicly_mtserver_worker_t {
+    quicly_mtserver_t *server;
+    size_t thread_id;
+    pthread_t tid;
+    int fd;
+    /**
+     * context being used by the worker
+     */
+    quicly_context_t ctx;
+    /**
+     * if `init_context` has been called successfully for `ctx`
+     */
+    int ctx_initialized;
+    /**
+     * CID seed; thread_id is set to the index of the worker
+     */
+    quicly_cid_plaintext_t next_cid;
+    /**
+     * Connections owned by the worker. They are indexed by the master_id being assigned by the worker, as well as by the original
+     * destination CID chosen by the client, which is used by Initial and 0-RTT packets until the client learns the CID issued by
+     * the server. `heap` is a binary min-heap ordered by `timeout_at`.
+     */
+    struct {
+        khash_t(quicly_mtserver_conn_by_master_id) * by_master_id;
+        khash_t(quicly_mtserver_conn_by_odcid) * by_odcid;
+        struct {
+            struct st_quicly_mtserver_conn_t **entries;
+            size_t size;
+            size_t capacity;
+        } heap;
+    } conns;
+    /**
+     * Datagrams being handed off by other workers. `rings` is indexed by the thread_id of the producer, and each ring is
+     * allocated by the producer upon first use. The producer writes to the wakeup fd (an eventfd on Linux, or a pipe) only when
+     * `notified` is cleared, so that a burst of hand-offs results in one wakeup.
+     */
+    struct {
+        struct st_quicly_mtserver_ring_t **rings;
+        int notified;
+        int wakeup_fds[2];
+    } inbox;
+};
+
+struct st_quicly_mtserver_t {
+    quicly_mtserver_callbacks_t callbacks;
+    void *data;
+    uint64_t node_id;
+    quicly_address_t sockname;
+    int shutdown_requested;
+    size_t num_running;
+    size_t num_workers;
+    quicly_mtserver_worker_t workers[1];
+};
+
+static int open_socket(struct sockaddr *addr)
+{
+    int fd, on = 1;
+
+    if ((fd = socket(addr->sa_family, SOCK_DGRAM, 0)) == -1)
+        return -1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0 || bind(fd, addr, quicly_get_socklen(addr)) != 0 ||
+        fcntl(fd, F_SETFL, O_NONBLOCK) != 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+
+    return fd;
+}
+
+static int open_wakeup_fds(int *fds)
+{
+#ifdef __linux__
+    if ((fds[0] = eventfd(0, EFD_NONBLOCK)) == -1)
+        return -1;
+    fds[1] = fds[0];
+#else
+    if (pipe(fds) != 0)
+        return -1;
+    if (fcntl(fds[0], F_SETFL, O_NONBLOCK) != 0 || fcntl(fds[1], F_SETFL, O_NONBLOCK) != 0) {
+        int err = errno;
+        close(fds[0]);
+        close(fds[1]);
+        fds[0] = fds[1] = -1;
+        errno = err;
+        return -1;
+    }
+#endif
+    return 0;
+}
+
+static void wakeup_worker(quicly_mtserver_worker_t *worker)
+{
+    /* eventfd requires 8-byte writes. EAGAIN is ignored, as it means that the worker is going to wake up. */
+    uint64_t one = 1;
+    while (write(worker->inbox.wakeup_fds[1], &one, sizeof(one)) == -1 && errno == EINTR)
+        ;
+}
+
+static void send_datagrams(quicly_mtserver_worker_t *worker, quicly_address_t *dest, struct iovec *datagrams, size_t num_datagrams)
+{
+    for (size_t i = 0; i != num_datagrams; ++i) {
+        struct msghdr mess = {.msg_name = &dest->sa, .msg_namelen = quicly_get_socklen(&dest->sa), .msg_iov = datagrams + i,
+                              .msg_iovlen = 1};
+        while (sendmsg(worker->fd, &mess, 0) == -1 && errno == EINTR)
+            ;
+    }
+}
+
+static void heap_set(quicly_mtserver_worker_t *worker, size_t index, struct st_quicly_mtserver_conn_t *entry)
+{
+    worker->conns.heap.entries[index] = entry;
+    entry->heap_index = index;
+}
+
+/**
+ * moves the entry at given index to the right position, after its `timeout_at` being changed
+ */
+static void heap_update(quicly_mtserver_worker_t *worker, size_t index)
+{
+    struct st_quicly_mtserver_conn_t **entries = worker->conns.heap.entries, *entry = entries[index];
+
+    while (index != 0) {
+        size_t parent = (index - 1) / 2;
+        if (entries[parent]->timeout_at <= entry->timeout_at)
+            break;
+        heap_set(worker, index, entries[parent]);
+        index = parent;
+    }
+    while (1) {
+        size_t child = index * 2 + 1;
+        if (child >= worker->conns.heap.size)
+            break;
+        if (child + 1 < worker->conns.heap.size && entries[child + 1]->timeout_at < entries[child]->timeout_at)
+            ++child;
+        if (entry->timeout_at <= entries[child]->timeout_at)
+            break;
+        heap_set(worker, index, entries[child]);
+        index = child;
+    }
+    heap_set(worker, index, entry);
+}
+
+static void heap_remove(quicly_mtserver_worker_t *worker, size_t index)
+{
+    struct st_quicly_mtserver_conn_t *last = worker->conns.heap.entries[--worker->conns.heap.size];
+
+    if (index != worker->conns.heap.size) {
+        heap_set(worker, index, last);
+        heap_update(worker, index);
+    }
+}
+
+static void update_timeout(quicly_mtserver_worker_t *worker, struct st_quicly_mtserver_conn_t *entry)
+{
+    entry->timeout_at = quicly_get_first_timeout(entry->conn);
+    heap_update(worker, entry->heap_index);
+}
+
+static void add_conn(quicly_mtserver_worker_t *worker, quicly_conn_t *conn)
+{
+    struct st_quicly_mtserver_conn_t *entry;
+    khiter_t master_iter, odcid_iter;
+    int r;
+
+    if (worker->conns.heap.size == worker->conns.heap.capacity) {
+        size_t new_capacity = worker->conns.heap.capacity < 16 ? 16 : worker->conns.heap.capacity * 2;
+        struct st_quicly_mtserver_conn_t **new_entries;
+        if ((new_entries = realloc(worker->conns.heap.entries, sizeof(*new_entries) * new_capacity)) == NULL)
+            goto Fail;
+        worker->conns.heap.entries = new_entries;
+        worker->conns.heap.capacity = new_capacity;
+    }
+    if ((entry = malloc(sizeof(*entry))) == NULL)
+        goto Fail;
+    *entry = (struct st_quicly_mtserver_conn_t){.conn = conn, .timeout_at = quicly_get_first_timeout(conn)};
+
+    /* register to the indexes */
+    master_iter = kh_put(quicly_mtserver_conn_by_master_id, worker->conns.by_master_id, quicly_get_master_id(conn)->master_id, &r);
+    if (r < 0) {
+        free(entry);
+        goto Fail;
+    }
+    kh_val(worker->conns.by_master_id, master_iter) = entry;
+    odcid_iter = kh_put(quicly_mtserver_conn_by_odcid, worker->conns.by_odcid, quicly_get_original_dcid(conn), &r);
+    if (r < 0) {
+        kh_del(quicly_mtserver_conn_by_master_id, worker->conns.by_master_id, master_iter);
+        free(entry);
+        goto Fail;
+    }
+    kh_val(worker->conns.by_odcid, odcid_iter) = entry;
+    heap_set(worker, worker->conns.heap.size++, entry);
+    heap_update(worker, entry->heap_index);
+
+    if (worker->server->callbacks.on_accept != NULL) {
+        worker->server->callbacks.on_accept(worker, conn);
+        update_timeout(worker, entry);
+    }
+    return;
+
+Fail:
+    quicly_free(conn);
+}
+
+static void destroy_conn(quicly_mtserver_worker_t *worker, struct st_quicly_mtserver_conn_t *entry)
+{
+    quicly_conn_t *conn = entry->conn;
+    khiter_t iter;
+
+    iter = kh_get(quicly_mtserver_conn_by_master_id, worker->conns.by_master_id, quicly_get_master_id(conn)->master_id);
+    assert(iter != kh_end(worker->conns.by_master_id));
+    kh_del(quicly_mtserver_conn_by_master_id, worker->conns.by_master_id, iter);
+    /* the entry might have been overwritten by another connection that was opened using the same CID */
+    iter = kh_get(quicly_mtserver_conn_by_odcid, worker->conns.by_odcid, quicly_get_original_dcid(conn));
+    if (iter != kh_end(worker->conns.by_odcid) && kh_val(worker->conns.by_odcid, iter) == entry)
+        kh_del(quicly_mtserver_conn_by_odcid, worker->conns.by_odcid, iter);
+    heap_remove(worker, entry->heap_index);
+
+    if (worker->server->callbacks.on_close != NULL)
+        worker->server->callbacks.on_close(worker, conn);
+    quicly_free(conn);
+    free(entry);
+}
+
+static struct st_quicly_mtserver_conn_t *find_conn(quicly_mtserver_worker_t *worker, quicly_decoded_packet_t *packet,
+                                                   quicly_address_t *remote)
+{
+    struct st_quicly_mtserver_conn_t *entry;
+    khiter_t iter;
+
+    /* Initial and 0-RTT packets might carry the CID chosen by the client */
+    if (QUICLY_PACKET_IS_LONG_HEADER(packet->octets.base[0]) && packet->cid.dest.might_be_client_generated) {
+        quicly_cid_t odcid;
+        quicly_set_cid(&odcid, packet->cid.dest.encrypted);
+        if ((iter = kh_get(quicly_mtserver_conn_by_odcid, worker->conns.by_odcid, &odcid)) != kh_end(worker->conns.by_odcid) &&
+            quicly_is_destination((entry = kh_val(worker->conns.by_odcid, iter))->conn, NULL, &remote->sa, packet))
+            return entry;
+    }
+
+    if (worker->ctx.cid_encryptor != NULL) {
+        /* CIDs issued by the worker carry the master_id */
+        if (packet->cid.dest.plaintext.node_id != worker->server->node_id ||
+            packet->cid.dest.plaintext.thread_id != worker->thread_id)
+            return NULL;
+        if ((iter = kh_get(quicly_mtserver_conn_by_master_id, worker->conns.by_master_id, packet->cid.dest.plaintext.master_id)) !=
+                kh_end(worker->conns.by_master_id) &&
+            quicly_is_destination((entry = kh_val(worker->conns.by_master_id, iter))->conn, NULL, &remote->sa, packet))
+            return entry;
+    } else {
+        /* without a CID encryptor, master_id cannot be recovered and the connections are identified by the peer address */
+        kh_foreach_value(worker->conns.by_master_id, entry, {
+            if (quicly_is_destination(entry->conn, NULL, &remote->sa, packet))
+                return entry;
+        });
+    }
+
+    return NULL;
+}
+
+static void handle_packet(quicly_mtserver_worker_t *worker, quicly_decoded_packet_t *packet, quicly_address_t *remote)
+{
+    quicly_mtserver_t *server = worker->server;
+    struct st_quicly_mtserver_conn_t *entry;
+    quicly_conn_t *conn;
+
+    if (QUICLY_PACKET_IS_LONG_HEADER(packet->octets.base[0])) {
+        if (packet->version != 0 && !quicly_is_supported_version(packet->version)) {
+            uint8_t payload[worker->ctx.transport_params.max_udp_payload_size];
+            size_t payload_len = quicly_send_version_negotiation(&worker->ctx, packet->cid.src, packet->cid.dest.encrypted,
+                                                                 quicly_supported_versions, payload);
+            assert(payload_len != SIZE_MAX);
+            struct iovec vec = {.iov_base = payload, .iov_len = payload_len};
+            send_datagrams(worker, remote, &vec, 1);
+            return;
+        }
+        /* there is no way to send response to these v1 packets */
+        if (packet->cid.dest.encrypted.len > QUICLY_MAX_CID_LEN_V1 || packet->cid.src.len > QUICLY_MAX_CID_LEN_V1)
+            return;
+    }
+
+    if ((entry = find_conn(worker, packet, remote)) != NULL) {
+        /* existing connection */
+        quicly_receive(entry->conn, NULL, &remote->sa, packet);
+        update_timeout(worker, entry);
+    } else if (QUICLY_PACKET_IS_INITIAL(packet->octets.base[0])) {
+        /* new connection */
+        if (quicly_accept(&conn, &worker->ctx, NULL, &remote->sa, packet, NULL, &worker->next_cid, NULL, NULL) == 0) {
+            ++worker->next_cid.master_id;
+            add_conn(worker, conn);
+        }
+    } else if (!QUICLY_PACKET_IS_LONG_HEADER(packet->octets.base[0])) {
+        /* Short header packet of a connection that no longer exists. Stateless reset is sent only if the CID is authenticated as
+         * one issued by this worker, which also prevents loops. */
+        if (worker->ctx.cid_encryptor != NULL && packet->cid.dest.plaintext.node_id == server->node_id &&
+            packet->cid.dest.plaintext.thread_id == worker->thread_id) {
+            uint8_t payload[worker->ctx.transport_params.max_udp_payload_size];
+            size_t payload_len = quicly_send_stateless_reset(&worker->ctx, packet->cid.dest.encrypted.base, payload);
+            assert(payload_len != SIZE_MAX);
+            struct iovec vec = {.iov_base = payload, .iov_len = payload_len};
+            send_datagrams(worker, remote, &vec, 1);
+        }
+    }
+}
+
+/**
+ * Processes all the QUIC packets in a datagram, the first of which has already been decoded. Coalesced packets share the same
+ * destination CID, therefore they belong to the same worker.
+ */
+static void handle_datagram(quicly_mtserver_worker_t *worker, quicly_decoded_packet_t *packet, uint8_t *bytes, size_t len,
+                            size_t off, quicly_address_t *remote)
+{
+    while (1) {
+        handle_packet(worker, packet, remote);
+        if (off == len || quicly_decode_packet(&worker->ctx, packet, bytes, len, &off) == SIZE_MAX)
+            break;
+    }
+}
+
+static void rebase_iovec(ptls_iovec_t *vec, const uint8_t *from, uint8_t *to)
+{
+    if (vec->base != NULL)
+        vec->base = to + (vec->base - from);
+}
+
+static void handoff_datagram(quicly_mtserver_worker_t *worker, quicly_mtserver_worker_t *dest, quicly_decoded_packet_t *packet,
+                             const uint8_t *bytes, size_t len, size_t off, quicly_address_t *remote)
+{
+    struct st_quicly_mtserver_ring_t *ring = dest->inbox.rings[worker->thread_id];
+
+    /* instantiate the ring upon first use; only this thread writes to the slot */
+    if (ring == NULL) {
+        size_t bufsize = worker->ctx.transport_params.max_udp_payload_size;
+        uint8_t *bufs;
+        if ((ring = malloc(sizeof(*ring))) == NULL)
+            return;
+        if ((bufs = malloc(bufsize * QUICLY_MTSERVER_RING_SIZE)) == NULL) {
+            free(ring);
+            return;
+        }
+        ring->head = 0;
+        ring->tail = 0;
+        for (size_t i = 0; i != QUICLY_MTSERVER_RING_SIZE; ++i)
+            ring->slots[i].bytes = bufs + bufsize * i;
+        __atomic_store_n(&dest->inbox.rings[worker->thread_id], ring, __ATOMIC_RELEASE);
+    }
+
+    /* enqueue, or drop the datagram if the ring is full */
+    size_t tail = ring->tail;
+    if (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == QUICLY_MTSERVER_RING_SIZE)
+        return;
+    struct st_quicly_mtserver_handoff_t *slot = ring->slots + tail % QUICLY_MTSERVER_RING_SIZE;
+    slot->remote = *remote;
+    slot->packet = *packet;
+    slot->off = off;
+    slot->len = len;
+    memcpy(slot->bytes, bytes, len);
+    /* the decoded packet points to the receive buffer; move the pointers to the copy */
+    rebase_iovec(&slot->packet.octets, bytes, slot->bytes);
+    rebase_iovec(&slot->packet.cid.dest.encrypted, bytes, slot->bytes);
+    rebase_iovec(&slot->packet.cid.src, bytes, slot->bytes);
+    rebase_iovec(&slot->packet.token, bytes, slot->bytes);
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+
+    if (!__atomic_exchange_n(&dest->inbox.notified, 1, __ATOMIC_ACQ_REL))
+        wakeup_worker(dest);
+}
+
+static void on_datagram(quicly_mtserver_worker_t *worker, uint8_t *bytes, size_t len, quicly_address_t *remote)
+{
+    quicly_mtserver_t *server = worker->server;
+    quicly_decoded_packet_t packet;
+    size_t off = 0;
+
+    if (quicly_decode_packet(&worker->ctx, &packet, bytes, len, &off) == SIZE_MAX)
+        return;
+
+    size_t owner = quicly_mtserver_route(&packet, server->node_id, server->num_workers);
+    if (owner != worker->thread_id) {
+        handoff_datagram(worker, server->workers + owner, &packet, bytes, len, off, remote);
+        return;
+    }
+
+    handle_datagram(worker, &packet, bytes, len, off, remote);
+}
+
+static void read_socket(quicly_mtserver_worker_t *worker)
+{
+    uint8_t buf[worker->ctx.transport_params.max_udp_payload_size];
+
+    for (size_t i = 0; i != QUICLY_MTSERVER_RECV_BATCH; ++i) {
+        quicly_address_t remote;
+        struct iovec vec = {.iov_base = buf, .iov_len = sizeof(buf)};
+        struct msghdr mess = {.msg_name = &remote, .msg_namelen = sizeof(remote), .msg_iov = &vec, .msg_iovlen = 1};
+        ssize_t rret;
+        while ((rret = recvmsg(worker->fd, &mess, 0)) == -1 && errno == EINTR)
+            ;
+        if (rret == -1)
+            break;
+        on_datagram(worker, buf, rret, &remote);
+    }
+}
+
+static void drain_inbox(quicly_mtserver_worker_t *worker)
+{
+    uint8_t junk[64];
+
+    while (read(worker->inbox.wakeup_fds[0], junk, sizeof(junk)) > 0)
+        ;
+
+    /* Clear the flag before draining, so that datagrams being handed off from now on trigger another wakeup. Being an RMW, the
+     * exchange also synchronizes with the producers that have observed the flag being set. */
+    __atomic_exchange_n(&worker->inbox.notified, 0, __ATOMIC_ACQ_REL);
+
+    /* Process all the datagrams being queued. They are processed without being routed or decoded again, as that has been done by
+     * the producer. */
+    for (size_t i = 0; i != worker->server->num_workers; ++i) {
+        struct st_quicly_mtserver_ring_t *ring = __atomic_load_n(&worker->inbox.rings[i], __ATOMIC_ACQUIRE);
+        if (ring == NULL)
+            continue;
+        size_t head = ring->head, tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            struct st_quicly_mtserver_handoff_t *slot = ring->slots + head % QUICLY_MTSERVER_RING_SIZE;
+            handle_datagram(worker, &slot->packet, slot->bytes, slot->len, slot->off, &slot->remote);
+        }
+        __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+    }
+}
+
+static void send_pending(quicly_mtserver_worker_t *worker)
+{
+    int64_t now = worker->ctx.now->cb(worker->ctx.now);
+
+    /* Visit the connections whose timeouts have been reached, earliest first. The number of visits is capped by the number of
+     * connections, so that a connection having more to send than one batch does not starve the event loop. */
+    for (size_t num_visits = worker->conns.heap.size; num_visits != 0 && worker->conns.heap.size != 0; --num_visits) {
+        struct st_quicly_mtserver_conn_t *entry = worker->conns.heap.entries[0];
+        if (entry->timeout_at > now)
+            break;
+        quicly_address_t dest, src;
+        struct iovec datagrams[QUICLY_MTSERVER_SEND_BATCH];
+        uint8_t buf[QUICLY_MTSERVER_SEND_BATCH * worker->ctx.transport_params.max_udp_payload_size];
+        size_t num_datagrams = QUICLY_MTSERVER_SEND_BATCH;
+        if (quicly_send(entry->conn, &dest, &src, datagrams, &num_datagrams, buf, sizeof(buf)) == 0) {
+            send_datagrams(worker, &dest, datagrams, num_datagrams);
+            update_timeout(worker, entry);
+        } else {
+            /* connection has been closed (or failed), free */
+            destroy_conn(worker, entry);
+        }
+    }
+}
+
+static int calc_poll_timeout(quicly_mtserver_worker_t *worker)
+{
+    int64_t timeout_at = worker->conns.heap.size != 0 ? worker->conns.heap.entries[0]->timeout_at : INT64_MAX;
+
+    if (timeout_at == INT64_MAX)
+        return -1;
+
+    int64_t delta = timeout_at - worker->ctx.now->cb(worker->ctx.now);
+    if (delta <= 0)
+        return 0;
+    return delta < INT_MAX ? (int)delta : INT_MAX;
+}
+
+static void *worker_main(void *_worker)
+{
+    quicly_mtserver_worker_t *worker = _worker;
+
+    while (!__atomic_load_n(&worker->server->shutdown_requested, __ATOMIC_ACQUIRE)) {
+        struct pollfd pfds[2] = {{.fd = worker->fd, .events = POLLIN}, {.fd = worker->inbox.wakeup_fds[0], .events = POLLIN}};
+        if (poll(pfds, 2, calc_poll_timeout(worker)) > 0) {
+            if ((pfds[1].revents & POLLIN) != 0)
+                drain_inbox(worker);
+            if ((pfds[0].revents & POLLIN) != 0)
+                read_socket(worker);
+        }
+        send_pending(worker);
+    }
+
+    while (worker->conns.heap.size != 0)
+        destroy_conn(worker, worker->conns.heap.entries[worker->conns.heap.size - 1]);
+
+    return NULL;
+}
+
+quicly_mtserver_t *quicly_mtserver_create(const quicly_context_t *ctx, struct sockaddr *addr, size_t num_threads, uint64_t node_id,
+                                          const quicly_mtserver_callbacks_t *callbacks, void *data)
+{
+    quicly_mtserver_t *server;
+    struct st_quicly_mtserver_ring_t **rings;
+    socklen_t socklen;
+    int err;
+
+    assert(num_threads != 0 && num_threads < 0xffffff);
+
+    if ((server = malloc(offsetof(quicly_mtserver_t, workers) + sizeof(server->workers[0]) * num_threads)) == NULL)
+        return NULL;
+    if ((rings = calloc(num_threads * num_threads, sizeof(*rings))) == NULL) {
+        free(server);
+        return NULL;
+    }
+    *server = (quicly_mtserver_t){.callbacks = *callbacks, .data = data, .node_id = node_id, .num_workers = num_threads};
+    for (size_t i = 0; i != num_threads; ++i) {
+        quicly_mtserver_worker_t *worker = server->workers + i;
+        *worker = (quicly_mtserver_worker_t){
+            .server = server,
+            .thread_id = i,
+            .fd = -1,
+            .ctx = *ctx,
+            .next_cid = {.thread_id = (uint32_t)i, .node_id = node_id},
+            .inbox = {.rings = rings + num_threads * i, .wakeup_fds = {-1, -1}},
+        };
+    }
+    for (size_t i = 0; i != num_threads; ++i) {
+        quicly_mtserver_worker_t *worker = server->workers + i;
+        if ((worker->conns.by_master_id = kh_init(quicly_mtserver_conn_by_master_id)) == NULL ||
+            (worker->conns.by_odcid = kh_init(quicly_mtserver_conn_by_odcid)) == NULL) {
+            errno = ENOMEM;
+            goto Fail;
+        }
+    }
+
+    /* open the sockets; the address of the first one is used by the others, so that the ephemeral port is shared */
+    memcpy(&server->sockname, addr, quicly_get_socklen(addr));
+    for (size_t i = 0; i != num_threads; ++i) {
+        quicly_mtserver_worker_t *worker = server->workers + i;
+        if ((worker->fd = open_socket(&server->sockname.sa)) == -1 || open_wakeup_fds(worker->inbox.wakeup_fds) != 0)
+            goto Fail;
+        if (i == 0) {
+            socklen = sizeof(server->sockname);
+            if (getsockname(worker->fd, &server->sockname.sa, &socklen) != 0)
+                goto Fail;
+        }
+    }
+
+    return server;
+
+Fail:
+    err = errno;
+    quicly_mtserver_free(server);
+    errno = err;
+    return NULL;
+}
+
+int quicly_mtserver_start(quicly_mtserver_t *server)
+{
+    int ret;
+
+    assert(server->num_running == 0);
+    __atomic_store_n(&server->shutdown_requested, 0, __ATOMIC_RELEASE);
+
+    /* set up the context of each worker, before any of the workers start handing off datagrams */
+    if (server->callbacks.init_context != NULL) {
+        for (size_t i = 0; i != server->num_workers; ++i) {
+            quicly_mtserver_worker_t *worker = server->workers + i;
+            if (worker->ctx_initialized)
+                continue;
+            if ((ret = server->callbacks.init_context(server, i, &worker->ctx)) != 0)
+                return ret;
+            worker->ctx_initialized = 1;
+        }
+    }
+
+    for (; server->num_running != server->num_workers; ++server->num_running) {
+        quicly_mtserver_worker_t *worker = server->workers + server->num_running;
+        if ((ret = pthread_create(&worker->tid, NULL, worker_main, worker)) != 0) {
+            quicly_mtserver_stop(server);
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
+void quicly_mtserver_stop(quicly_mtserver_t *server)
+{
+    __atomic_store_n(&server->shutdown_requested, 1, __ATOMIC_RELEASE);
+    for (size_t i = 0; i != server->num_running; ++i)
+        wakeup_worker(server->workers + i);
+    for (size_t i = 0; i != server->num_running; ++i)
+        pthread_join(server->workers[i].tid, NULL);
+    server->num_running = 0;
+}
+
+void quicly_mtserver_free(quicly_mtserver_t *server)
+{
+    assert(server->num_running == 0);
+
+    for (size_t i = 0; i != server->num_workers; ++i) {
+        quicly_mtserver_worker_t *worker = server->workers + i;
+        for (size_t j = 0; j != server->num_workers; ++j) {
+            struct st_quicly_mtserver_ring_t *ring = worker->inbox.rings[j];
+            if (ring != NULL) {
+                free(ring->slots[0].bytes);
+                free(ring);
+            }
+        }
+        if (worker->inbox.wakeup_fds[0] != -1) {
+            close(worker->inbox.wakeup_fds[0]);
+            if (worker->inbox.wakeup_fds[1] != worker->inbox.wakeup_fds[0])
+                close(worker->inbox.wakeup_fds[1]);
+        }
+        if (worker->fd != -1)
+            close(worker->fd);
+        if (worker->conns.by_master_id != NULL)
+            kh_destroy(quicly_mtserver_conn_by_master_id, worker->conns.by_master_id);
+        if (worker->conns.by_odcid != NULL)
+            kh_destroy(quicly_mtserver_conn_by_odcid, worker->conns.by_odcid);
+        free(worker->conns.heap.entries);
+        if (worker->ctx_initialized && server->callbacks.dispose_context != NULL)
+            server->callbacks.dispose_context(server, i, &worker->ctx);
+    }
+    free(server->workers[0].inbox.rings);
+    free(server);
+}
+
+struct sockaddr *quicly_mtserver_get_sockname(quicly_mtserver_t *server)
+{
+    return &server->sockname.sa;
+}
+
+void *quicly_mtserver_get_data(quicly_mtserver_t *server)
+{
+    return server->data;
+}
+
+quicly_mtserver_t *quicly_mtserver_get_server(quicly_mtserver_worker_t *worker)
+{
+    return worker->server;
+}
+
+size_t quicly_mtserver_get_thread_id(quicly_mtserver_worker_t *worker)
+{
+    return worker->thread_id;
+}
+
+quicly_context_t *quicly_mtserver_get_context(quicly_mtserver_worker_t *worker)
+{
+    return &worker->ctx;
+}
@@ -31,6 +31,7 @@
 #include <stdlib.h>
 #include <sys/socket.h>
 #include <sys/time.h>
+#include <time.h>
 #include "khash.h"
 #include "quicly.h"
 #include "quicly/defaults.h"
@@ -78,6 +79,14 @@
  * maximum number of undecryptable packets to buffer
  */
 #define QUICLY_MAX_DELAYED_PACKETS 10
+/**
+ * number of buckets of the stream table retained by the connection objects in the pool
+ */
+#define QUICLY_CONN_POOL_STREAM_BUCKETS 16
+/**
+ * maximum number of stateless reset tokens to be generated at once by `quicly_send_stateless_reset_batch`
+ */
+#define QUICLY_STATELESS_RESET_BATCH_SIZE 16
 
 KHASH_MAP_INIT_INT64(quicly_stream_t, quicly_stream_t *)
 
@@ -224,13 +233,18 @@ struct st_quicly_conn_path_t {
     uint64_t packet_last_received;
     /**
      * `send_at` indicates when a PATH_CHALLENGE frame carrying `data` should be sent, or if the value is INT64_MAX the path is
-     * validated
+     * validated. `last_sent_at` is when the most recent PATH_CHALLENGE frame was sent.
      */
     struct {
         int64_t send_at;
+        int64_t last_sent_at;
         uint64_t num_sent;
         uint8_t data[QUICLY_PATH_CHALLENGE_DATA_LEN];
     } path_challenge;
+    /**
+     * RTT of the path measured using the PATH_CHALLENGE / PATH_RESPONSE exchange, or UINT32_MAX if unavailable
+     */
+    uint32_t rtt;
     /**
      * path response to be sent, if `send_` is set
      */
@@ -262,6 +276,8 @@ struct st_quicly_delayed_packet_t {
     uint8_t bytes[1];
 };
 
+#define DELAYED_PACKET_SIZE(octets_len) (offsetof(struct st_quicly_delayed_packet_t, bytes) + (octets_len))
+
 struct st_quicly_conn_t {
     struct _st_quicly_conn_public_t super;
     /**
@@ -294,6 +310,25 @@ struct st_quicly_conn_t {
         struct {
             uint64_t bytes_consumed;
             quicly_maxsender_t sender;
+            /**
+             * size of the connection-level receive window; grows when autotuning is enabled
+             */
+            uint64_t window;
+            /**
+             * size of the connection-level receive window in effect; equals to `window` unless being reduced due to `budget`
+             */
+            uint64_t committed;
+            /**
+             * the receive-buffer budget to which `committed` is being charged (or NULL)
+             */
+            quicly_recvbuf_budget_t *budget;
+            /**
+             * when MAX_DATA was last sent (or when the connection was created), and the value of `bytes_consumed` at that moment
+             */
+            struct {
+                int64_t at;
+                uint64_t bytes_consumed;
+            } last_update;
         } max_data;
         /**
          *
@@ -446,17 +481,38 @@ struct st_quicly_conn_t {
          * delivery rate estimator
          */
         quicly_ratemeter_t ratemeter;
+        /**
+         * most recent and largest (non-app-limited) per-ACK delivery rate samples, in bytes/second
+         */
+        struct {
+            uint64_t latest;
+            uint64_t max;
+        } delivery_rate_sample;
     } egress;
     /**
      * crypto data
      */
     struct {
+        /**
+         * the TLS object; NULL once released by `quicly_hibernate`
+         */
         ptls_t *tls;
         ptls_handshake_properties_t handshake_properties;
         struct {
             ptls_raw_extension_t ext[2];
             ptls_buffer_t buf;
         } transport_params;
+        /**
+         * properties of `tls` being retained after it is released by `quicly_hibernate`
+         */
+        struct {
+            ptls_cipher_suite_t *cipher;
+            ptls_log_conn_state_t log_state;
+            /**
+             * the server name and the negotiated protocol, serialized as two NUL-terminated strings (empty if unavailable)
+             */
+            ptls_iovec_t names;
+        } hibernated;
         unsigned async_in_progress : 1;
     } crypto;
     /**
@@ -485,6 +541,10 @@ struct st_quicly_conn_t {
      * records the time when this connection was created
      */
     int64_t created_at;
+    /**
+     * if the connection is counted by `quicly_context_t::admission` as a handshake in progress
+     */
+    uint8_t admission_in_handshake : 1;
     /**
      *
      */
@@ -527,9 +587,40 @@ struct st_quicly_conn_t {
                 quicly_sendstate_sent_t args;
             } active_acked_cache;
         } on_ack_stream;
+        /**
+         * Received stream data being accumulated for the streams that use `on_receive_batch`. The entries refer to the payload of
+         * the packet being processed; they are flushed before a frame other than STREAM is handled, before a STREAM frame is
+         * handled when the batch is full, and at the end of the packet.
+         */
+        struct {
+            struct st_quicly_recv_batch_entry_t {
+                quicly_stream_t *stream;
+                uint64_t off;
+                const void *src;
+                size_t len;
+            } entries[16];
+            size_t count;
+        } recv_batch;
     } stash;
 };
 
+struct st_quicly_conn_pool_t {
+    /**
+     * allocator of the contexts using the pool
+     */
+    quicly_allocator_t *allocator;
+    /**
+     * connection objects being retained; `conn` is zero-cleared and `streams` is empty
+     */
+    struct st_quicly_conn_pool_entry_t {
+        quicly_conn_t *conn;
+        khash_t(quicly_stream_t) * streams;
+        quicly_pacer_t *pacer;
+    } *entries;
+    size_t count;
+    size_t capacity;
+};
+
 #if QUICLY_USE_TRACER
 #include "quicly-tracer.h"
 #endif
@@ -698,7 +789,8 @@ static void dispose_cipher(struct st_quicly_cipher_context_t *ctx)
 static void clear_datagram_frame_payloads(quicly_conn_t *conn)
 {
     for (size_t i = 0; i != conn->egress.datagram_frame_payloads.count; ++i) {
-        free(conn->egress.datagram_frame_payloads.payloads[i].base);
+        quicly_dealloc(conn->super.ctx->allocator, conn->egress.datagram_frame_payloads.payloads[i].base,
+                       conn->egress.datagram_frame_payloads.payloads[i].len, QUICLY_ALLOC_TAG_DATAGRAM_FRAME);
         conn->egress.datagram_frame_payloads.payloads[i] = ptls_iovec_init(NULL, 0);
     }
     conn->egress.datagram_frame_payloads.count = 0;
@@ -1030,8 +1122,94 @@ static void resched_stream_data(quicly_stream_t *stream)
 
 static int should_send_max_data(quicly_conn_t *conn)
 {
+    uint64_t window = conn->ingress.max_data.committed;
     return quicly_maxsender_should_send_max(&conn->ingress.max_data.sender, conn->ingress.max_data.bytes_consumed,
-                                            (uint32_t)conn->super.ctx->transport_params.max_data, 512);
+                                            window <= UINT32_MAX ? (uint32_t)window : UINT32_MAX, 512);
+}
+
+/**
+ * Determines the size of the connection-level receive window to be used, by charging `window` to the receive-buffer budget. When
+ * the budget is exhausted, the window is reduced.
+ */
+static void commit_max_data_window(quicly_conn_t *conn)
+{
+    quicly_recvbuf_budget_t *budget = conn->ingress.max_data.budget;
+    uint64_t window = conn->ingress.max_data.window;
+
+    if (budget != NULL) {
+        uint64_t others = budget->committed - conn->ingress.max_data.committed,
+                 available = budget->capacity > others ? budget->capacity - others : 0;
+        if (available < QUICLY_RECVBUF_BUDGET_MIN_WINDOW)
+            available = QUICLY_RECVBUF_BUDGET_MIN_WINDOW;
+        if (window > available) {
+            window = available;
+            if (window < conn->ingress.max_data.committed)
+                ++conn->super.stats.num_recv_window_throttled;
+        }
+        budget->committed = others + window;
+    }
+
+    conn->ingress.max_data.committed = window;
+}
+
+static void grow_max_data_window(quicly_conn_t *conn, uint64_t new_window)
+{
+    uint64_t ceiling = conn->super.ctx->recv_window_autotune.max_window;
+
+    if (new_window > ceiling)
+        new_window = ceiling;
+    if (new_window <= conn->ingress.max_data.window)
+        return;
+
+    conn->ingress.max_data.window = new_window;
+    commit_max_data_window(conn);
+    /* send MAX_DATA now if the new window crosses the update threshold */
+    if (should_send_max_data(conn))
+        conn->egress.pending_flows |= QUICLY_PENDING_FLOW_OTHERS_BIT;
+}
+
+/**
+ * Grows the connection-level receive window so that it can cover the bandwidth-delay product observed since the last MAX_DATA
+ * frame, with twice the headroom so that the next update can be sent before the peer gets blocked. If MAX_DATA is being sent
+ * within two round-trips of the previous one, the window is doubled as well. Called right before sending MAX_DATA; retransmissions
+ * of MAX_DATA being lost are ignored, as no data has been consumed since the previous one.
+ */
+static void autotune_max_data_window(quicly_conn_t *conn)
+{
+    int64_t since_last_update = conn->stash.now - conn->ingress.max_data.last_update.at;
+    uint64_t bytes_received = conn->ingress.max_data.bytes_consumed - conn->ingress.max_data.last_update.bytes_consumed;
+    uint32_t rtt = conn->egress.loss.rtt.smoothed;
+
+    if (bytes_received == 0)
+        return;
+    conn->ingress.max_data.last_update.at = conn->stash.now;
+    conn->ingress.max_data.last_update.bytes_consumed = conn->ingress.max_data.bytes_consumed;
+
+    if (conn->ingress.max_data.window >= conn->super.ctx->recv_window_autotune.max_window)
+        return;
+
+    uint64_t new_window = conn->ingress.max_data.window;
+    if (since_last_update < 2 * (int64_t)rtt)
+        new_window *= 2;
+    if (since_last_update > 0) {
+        uint64_t bdp = bytes_received * rtt / since_last_update;
+        if (new_window < bdp * 2)
+            new_window = bdp * 2;
+    }
+    grow_max_data_window(conn, new_window);
+}
+
+/**
+ * Returns the size of the stream-level receive window to be advertised. When a receive-buffer budget is in use, it is capped by the
+ * connection-level window in effect, so that stream-level grants shrink as well under memory pressure.
+ */
+static uint32_t get_stream_receive_window(quicly_stream_t *stream)
+{
+    uint32_t window = stream->_recv_aux.window;
+
+    if (stream->conn->ingress.max_data.budget != NULL && window > stream->conn->ingress.max_data.committed)
+        window = (uint32_t)stream->conn->ingress.max_data.committed;
+    return window;
 }
 
 static int should_send_max_stream_data(quicly_stream_t *stream)
@@ -1039,7 +1217,7 @@ static int should_send_max_stream_data(quicly_stream_t *stream)
     if (stream->recvstate.eos != UINT64_MAX)
         return 0;
     return quicly_maxsender_should_send_max(&stream->_send_aux.max_stream_data_sender, stream->recvstate.data_off,
-                                            stream->_recv_aux.window, 512);
+                                            get_stream_receive_window(stream), 512);
 }
 
 int quicly_stream_sync_sendbuf(quicly_stream_t *stream, int activate)
@@ -1236,6 +1414,54 @@ quicly_conn_t *quicly_resume_handshake(ptls_t *tls)
     return conn;
 }
 
+static void update_max_ranges(quicly_stream_t *stream)
+{
+    /* Set the number of max ranges to be capable of handling following case:
+     * * every one of the two packets being sent are lost
+     * * average size of a STREAM frame found in a packet is >= ~512 bytes, or small STREAM frame is sent for every other stream
+     *   being opened (e.g., sending QPACK encoder/decoder stream frame for each HTTP/3 request)
+     * See also: the doc-comment on `_recv_aux.max_ranges`. The value is never reduced, as ranges might already have been
+     * accepted based on the previous value.
+     */
+    uint32_t max_ranges = (uint32_t)(stream->conn->super.ctx->transport_params.max_streams_uni +
+                                     stream->conn->super.ctx->transport_params.max_streams_bidi);
+    if (max_ranges < 63)
+        max_ranges = 63;
+    if (max_ranges < stream->_recv_aux.window / 1024)
+        max_ranges = stream->_recv_aux.window / 1024;
+    if (stream->_recv_aux.max_ranges < max_ranges)
+        stream->_recv_aux.max_ranges = max_ranges;
+}
+
+/**
+ * Grows the receive window of the stream if the application is consuming data at a pace that would be throttled by flow control,
+ * i.e., if MAX_STREAM_DATA is being sent within two round-trips of the previous one. Called right before sending MAX_STREAM_DATA.
+ * Retransmissions of MAX_STREAM_DATA being lost are not taken into account, as no data has been consumed since the previous one.
+ */
+static void autotune_stream_receive_window(quicly_stream_t *stream)
+{
+    quicly_conn_t *conn = stream->conn;
+    uint32_t ceiling = conn->super.ctx->recv_window_autotune.max_stream_window;
+    int64_t since_last_update = conn->stash.now - stream->_recv_aux.window_updated_at;
+
+    if (stream->recvstate.data_off == stream->_recv_aux.window_updated_data_off)
+        return;
+    stream->_recv_aux.window_updated_at = conn->stash.now;
+    stream->_recv_aux.window_updated_data_off = stream->recvstate.data_off;
+
+    if (stream->_recv_aux.window >= ceiling)
+        return;
+    if (since_last_update >= 2 * (int64_t)conn->egress.loss.rtt.smoothed)
+        return;
+
+    uint32_t new_window = stream->_recv_aux.window <= ceiling / 2 ? stream->_recv_aux.window * 2 : ceiling;
+    stream->_recv_aux.window = new_window;
+    update_max_ranges(stream);
+
+    /* make sure that the connection-level window does not become the bottleneck */
+    grow_max_data_window(conn, (uint64_t)new_window * 3 / 2);
+}
+
 static void init_stream_properties(quicly_stream_t *stream, uint32_t initial_max_stream_data_local,
                                    uint64_t initial_max_stream_data_remote)
 {
@@ -1251,6 +1477,9 @@ static void init_stream_properties(quicly_stream_t *stream, uint32_t initial_max
     } else {
         quicly_recvstate_init_closed(&stream->recvstate);
     }
+    stream->sendstate.acked.allocator = stream->conn->super.ctx->allocator;
+    stream->sendstate.pending.allocator = stream->conn->super.ctx->allocator;
+    stream->recvstate.received.allocator = stream->conn->super.ctx->allocator;
     stream->streams_blocked = 0;
 
     stream->_send_aux.max_stream_data = initial_max_stream_data_remote;
@@ -1264,19 +1493,10 @@ static void init_stream_properties(quicly_stream_t *stream, uint32_t initial_max
     quicly_linklist_init(&stream->_send_aux.pending_link.default_scheduler);
 
     stream->_recv_aux.window = initial_max_stream_data_local;
-
-    /* Set the number of max ranges to be capable of handling following case:
-     * * every one of the two packets being sent are lost
-     * * average size of a STREAM frame found in a packet is >= ~512 bytes, or small STREAM frame is sent for every other stream
-     *   being opened (e.g., sending QPACK encoder/decoder stream frame for each HTTP/3 request)
-     * See also: the doc-comment on `_recv_aux.max_ranges`.
-     */
-    uint32_t fragments_minmax = (uint32_t)(stream->conn->super.ctx->transport_params.max_streams_uni +
-                                           stream->conn->super.ctx->transport_params.max_streams_bidi);
-    if (fragments_minmax < 63)
-        fragments_minmax = 63;
-    if ((stream->_recv_aux.max_ranges = initial_max_stream_data_local / 1024) < fragments_minmax)
-        stream->_recv_aux.max_ranges = fragments_minmax;
+    stream->_recv_aux.window_updated_at = stream->conn->stash.now;
+    stream->_recv_aux.window_updated_data_off = 0;
+    stream->_recv_aux.max_ranges = 0;
+    update_max_ranges(stream);
 }
 
 static void dispose_stream_properties(quicly_stream_t *stream)
@@ -1293,7 +1513,7 @@ static quicly_stream_t *open_stream(quicly_conn_t *conn, uint64_t stream_id, uin
 {
     quicly_stream_t *stream;
 
-    if ((stream = malloc(sizeof(*stream))) == NULL)
+    if ((stream = quicly_alloc(conn->super.ctx->allocator, sizeof(*stream), QUICLY_ALLOC_TAG_STREAM)) == NULL)
         return NULL;
     stream->conn = conn;
     stream->stream_id = stream_id;
@@ -1377,7 +1597,7 @@ static void destroy_stream(quicly_stream_t *stream, quicly_error_t err)
     if (conn->application != NULL && should_send_max_streams(conn, quicly_stream_is_unidirectional(stream->stream_id)))
         conn->egress.pending_flows |= QUICLY_PENDING_FLOW_OTHERS_BIT;
 
-    free(stream);
+    quicly_dealloc(conn->super.ctx->allocator, stream, sizeof(*stream), QUICLY_ALLOC_TAG_STREAM);
 }
 
 static void destroy_all_streams(quicly_conn_t *conn, quicly_error_t err, int including_crypto_streams)
@@ -1417,6 +1637,33 @@ ptls_t *quicly_get_tls(quicly_conn_t *conn)
     return conn->crypto.tls;
 }
 
+static ptls_cipher_suite_t *get_cipher(quicly_conn_t *conn)
+{
+    return conn->crypto.tls != NULL ? ptls_get_cipher(conn->crypto.tls) : conn->crypto.hibernated.cipher;
+}
+
+ptls_log_conn_state_t *quicly_get_log_state(quicly_conn_t *conn)
+{
+    return conn->crypto.tls != NULL ? ptls_get_log_state(conn->crypto.tls) : &conn->crypto.hibernated.log_state;
+}
+
+const char *quicly_get_server_name(quicly_conn_t *conn)
+{
+    if (conn->crypto.tls != NULL)
+        return ptls_get_server_name(conn->crypto.tls);
+    return conn->crypto.hibernated.names.base[0] != '\0' ? (const char *)conn->crypto.hibernated.names.base : NULL;
+}
+
+const char *quicly_get_negotiated_protocol(quicly_conn_t *conn)
+{
+    const char *protocol;
+
+    if (conn->crypto.tls != NULL)
+        return ptls_get_negotiated_protocol(conn->crypto.tls);
+    protocol = (const char *)conn->crypto.hibernated.names.base + strlen((const char *)conn->crypto.hibernated.names.base) + 1;
+    return protocol[0] != '\0' ? protocol : NULL;
+}
+
 uint32_t quicly_num_streams_by_group(quicly_conn_t *conn, int uni, int locally_initiated)
 {
     int server_initiated = quicly_is_client(conn) != locally_initiated;
@@ -1449,7 +1696,10 @@ quicly_error_t quicly_get_stats(quicly_conn_t *conn, quicly_stats_t *stats)
         stats->cc.exit_slow_start_at -= conn->created_at;
     }
     quicly_ratemeter_report(&conn->egress.ratemeter, &stats->delivery_rate);
+    stats->delivery_rate_sample.latest = conn->egress.delivery_rate_sample.latest;
+    stats->delivery_rate_sample.max = conn->egress.delivery_rate_sample.max;
     stats->num_sentmap_packets_largest = conn->egress.loss.sentmap.num_packets_largest;
+    stats->recv_window_committed = conn->ingress.max_data.committed;
 
     return 0;
 }
@@ -1538,6 +1788,10 @@ static void update_ratemeter(quicly_conn_t *conn, int is_cc_limited)
             QUICLY_LOG_CONN(exit_cc_limited, conn, { PTLS_LOG_ELEMENT_UNSIGNED(pn, conn->egress.packet_number); });
         }
     }
+
+    /* per-packet delivery rate samples are flagged as app-limited until the data in flight at this moment gets acked */
+    if (!is_cc_limited)
+        quicly_sentmap_on_app_limited(&conn->egress.loss.sentmap);
 }
 
 /**
@@ -1578,14 +1832,15 @@ static void destroy_handshake_flow(quicly_conn_t *conn, size_t epoch)
         destroy_stream(stream, 0);
 }
 
-static struct st_quicly_pn_space_t *alloc_pn_space(size_t sz, uint32_t packet_tolerance)
+static struct st_quicly_pn_space_t *alloc_pn_space(quicly_allocator_t *allocator, size_t sz, uint32_t packet_tolerance)
 {
     struct st_quicly_pn_space_t *space;
 
-    if ((space = malloc(sz)) == NULL)
+    if ((space = quicly_alloc(allocator, sz, QUICLY_ALLOC_TAG_PN_SPACE)) == NULL)
         return NULL;
 
     quicly_ranges_init(&space->ack_queue);
+    space->ack_queue.allocator = allocator;
     space->largest_pn_received_at = INT64_MAX;
     space->next_expected_packet_number = 0;
     space->unacked_count = 0;
@@ -1602,10 +1857,10 @@ static struct st_quicly_pn_space_t *alloc_pn_space(size_t sz, uint32_t packet_to
     return space;
 }
 
-static void do_free_pn_space(struct st_quicly_pn_space_t *space)
+static void do_free_pn_space(quicly_allocator_t *allocator, struct st_quicly_pn_space_t *space, size_t sz)
 {
     quicly_ranges_clear(&space->ack_queue);
-    free(space);
+    quicly_dealloc(allocator, space, sz, QUICLY_ALLOC_TAG_PN_SPACE);
 }
 
 static void update_smallest_unreported_missing_on_send_ack(quicly_ranges_t *ranges, uint64_t *largest_acked_unacked,
@@ -1752,14 +2007,14 @@ Exit:
     return ret;
 }
 
-static void free_handshake_space(struct st_quicly_handshake_space_t **space)
+static void free_handshake_space(quicly_conn_t *conn, struct st_quicly_handshake_space_t **space)
 {
     if (*space != NULL) {
         if ((*space)->cipher.ingress.aead != NULL)
             dispose_cipher(&(*space)->cipher.ingress);
         if ((*space)->cipher.egress.aead != NULL)
             dispose_cipher(&(*space)->cipher.egress);
-        do_free_pn_space(&(*space)->super);
+        do_free_pn_space(conn->super.ctx->allocator, &(*space)->super, sizeof(**space));
         *space = NULL;
     }
 }
@@ -1777,12 +2032,12 @@ static int setup_cipher(quicly_conn_t *conn, size_t epoch, int is_enc, ptls_ciph
 static int setup_handshake_space_and_flow(quicly_conn_t *conn, size_t epoch)
 {
     struct st_quicly_handshake_space_t **space = epoch == QUICLY_EPOCH_INITIAL ? &conn->initial : &conn->handshake;
-    if ((*space = (void *)alloc_pn_space(sizeof(struct st_quicly_handshake_space_t), 1)) == NULL)
+    if ((*space = (void *)alloc_pn_space(conn->super.ctx->allocator, sizeof(struct st_quicly_handshake_space_t), 1)) == NULL)
         return PTLS_ERROR_NO_MEMORY;
     return create_handshake_flow(conn, epoch);
 }
 
-static void free_application_space(struct st_quicly_application_space_t **space)
+static void free_application_space(quicly_conn_t *conn, struct st_quicly_application_space_t **space)
 {
     if (*space != NULL) {
 #define DISPOSE_INGRESS(label, func)                                                                                               \
@@ -1796,15 +2051,15 @@ static void free_application_space(struct st_quicly_application_space_t **space)
         if ((*space)->cipher.egress.key.aead != NULL)
             dispose_cipher(&(*space)->cipher.egress.key);
         ptls_clear_memory((*space)->cipher.egress.secret, sizeof((*space)->cipher.egress.secret));
-        do_free_pn_space(&(*space)->super);
+        do_free_pn_space(conn->super.ctx->allocator, &(*space)->super, sizeof(**space));
         *space = NULL;
     }
 }
 
 static int setup_application_space(quicly_conn_t *conn)
 {
-    if ((conn->application =
-             (void *)alloc_pn_space(sizeof(struct st_quicly_application_space_t), QUICLY_DEFAULT_PACKET_TOLERANCE)) == NULL)
+    if ((conn->application = (void *)alloc_pn_space(conn->super.ctx->allocator, sizeof(struct st_quicly_application_space_t),
+                                                    QUICLY_DEFAULT_PACKET_TOLERANCE)) == NULL)
         return PTLS_ERROR_NO_MEMORY;
 
     /* prohibit key-update until receiving an ACK for an 1-RTT packet */
@@ -1814,6 +2069,69 @@ static int setup_application_space(quicly_conn_t *conn)
     return create_handshake_flow(conn, QUICLY_EPOCH_1RTT);
 }
 
+static uint64_t admission_get_cpu_usec(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+        return 0;
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void admission_update_window(quicly_admission_t *admission, int64_t now)
+{
+    if (now - admission->cpu_usec.window_start < 1000)
+        return;
+    admission->cpu_usec.previous = now - admission->cpu_usec.window_start < 2000 ? admission->cpu_usec.current : 0;
+    admission->cpu_usec.current = 0;
+    admission->cpu_usec.window_start = now;
+}
+
+static void admission_add_cpu_time(quicly_admission_t *admission, int64_t now, uint64_t usec)
+{
+    admission_update_window(admission, now);
+    admission->cpu_usec.current += usec;
+    admission->cpu_usec.total += usec;
+}
+
+static int admission_exceeds(quicly_admission_t *admission, const struct st_quicly_admission_thresholds_t *thresholds)
+{
+    uint64_t cpu_usec = admission->cpu_usec.current > admission->cpu_usec.previous ? admission->cpu_usec.current
+                                                                                    : admission->cpu_usec.previous;
+
+    return (thresholds->handshakes != 0 && admission->num_handshakes >= thresholds->handshakes) ||
+           (thresholds->cpu_usec_per_sec != 0 && cpu_usec >= thresholds->cpu_usec_per_sec) ||
+           (thresholds->memory != 0 && admission->memory_in_use >= thresholds->memory);
+}
+
+quicly_admission_action_t quicly_admission_decide(quicly_admission_t *admission, int64_t now, int address_validated)
+{
+    quicly_admission_action_t action;
+
+    admission_update_window(admission, now);
+
+    if (admission_exceeds(admission, &admission->drop)) {
+        action = QUICLY_ADMISSION_DROP;
+    } else if (admission_exceeds(admission, &admission->refuse)) {
+        action = QUICLY_ADMISSION_REFUSE;
+    } else if (!address_validated && admission_exceeds(admission, &admission->retry)) {
+        action = QUICLY_ADMISSION_RETRY;
+    } else {
+        action = QUICLY_ADMISSION_ACCEPT;
+    }
+
+    ++admission->num_decisions[action];
+    return action;
+}
+
+static void admission_on_handshake_end(quicly_conn_t *conn)
+{
+    if (!conn->admission_in_handshake)
+        return;
+    --conn->super.ctx->admission->num_handshakes;
+    conn->admission_in_handshake = 0;
+}
+
 static quicly_error_t discard_handshake_context(quicly_conn_t *conn, size_t epoch)
 {
     quicly_error_t ret;
@@ -1826,8 +2144,9 @@ static quicly_error_t discard_handshake_context(quicly_conn_t *conn, size_t epoc
     if (epoch == QUICLY_EPOCH_HANDSHAKE) {
         assert(conn->stash.now != 0);
         conn->super.stats.handshake_confirmed_msec = conn->stash.now - conn->created_at;
+        admission_on_handshake_end(conn);
     }
-    free_handshake_space(epoch == QUICLY_EPOCH_INITIAL ? &conn->initial : &conn->handshake);
+    free_handshake_space(conn, epoch == QUICLY_EPOCH_INITIAL ? &conn->initial : &conn->handshake);
 
     return 0;
 }
@@ -1878,7 +2197,7 @@ Exit:
 static int update_1rtt_egress_key(quicly_conn_t *conn)
 {
     struct st_quicly_application_space_t *space = conn->application;
-    ptls_cipher_suite_t *cipher = ptls_get_cipher(conn->crypto.tls);
+    ptls_cipher_suite_t *cipher = get_cipher(conn);
     int ret;
 
     /* generate next AEAD key, and increment key phase if it succeeds */
@@ -1910,11 +2229,10 @@ static int received_key_update(quicly_conn_t *conn, uint64_t newly_decrypted_key
     space->cipher.ingress.key_phase.decrypted = newly_decrypted_key_phase;
 
     QUICLY_PROBE(CRYPTO_RECEIVE_KEY_UPDATE, conn, conn->stash.now, space->cipher.ingress.key_phase.decrypted,
-                 QUICLY_PROBE_HEXDUMP(space->cipher.ingress.secret, ptls_get_cipher(conn->crypto.tls)->hash->digest_size));
+                 QUICLY_PROBE_HEXDUMP(space->cipher.ingress.secret, get_cipher(conn)->hash->digest_size));
     QUICLY_LOG_CONN(crypto_receive_key_update, conn, {
         PTLS_LOG_ELEMENT_UNSIGNED(phase, space->cipher.ingress.key_phase.decrypted);
-        PTLS_LOG_APPDATA_ELEMENT_HEXDUMP(secret, space->cipher.ingress.secret,
-                                         ptls_get_cipher(conn->crypto.tls)->hash->digest_size);
+        PTLS_LOG_APPDATA_ELEMENT_HEXDUMP(secret, space->cipher.ingress.secret, get_cipher(conn)->hash->digest_size);
     });
 
     if (space->cipher.egress.key_phase < space->cipher.ingress.key_phase.decrypted) {
@@ -1939,6 +2257,52 @@ static void calc_resume_sendrate(quicly_conn_t *conn, uint64_t *rate, uint32_t *
     }
 }
 
+/**
+ * Profiles with a loss rate at or above this threshold (in permille) are used for seeding the initial RTT but not jumpstart.
+ */
+#define PATH_PROFILE_MAX_JUMPSTART_LOSS_PERMILLE 50
+
+/**
+ * Seeds the initial RTT and the jumpstart target of a new server-side connection using the path profile cache.
+ */
+static void apply_path_profile(quicly_conn_t *conn)
+{
+    quicly_path_profile_cache_t *cache = conn->super.ctx->path_profile_cache;
+    quicly_path_profile_t profile;
+
+    if (!cache->lookup(cache, conn, &conn->paths[0]->address.remote.sa, conn->stash.now, &profile) || profile.min_rtt == 0)
+        return;
+
+    /* RFC 9002 Section 6.2.2 allows connections over the same network to use the RTT observed by previous connections */
+    quicly_rtt_init(&conn->egress.loss.rtt, &conn->super.ctx->loss, profile.min_rtt);
+    /* setup jumpstart as if the information had been provided by a resumption token, unless the path was lossy */
+    if (profile.delivery_rate != 0 && profile.loss_permille < PATH_PROFILE_MAX_JUMPSTART_LOSS_PERMILLE) {
+        conn->super.stats.jumpstart.prev_rate = profile.delivery_rate;
+        conn->super.stats.jumpstart.prev_rtt = profile.min_rtt;
+    }
+    conn->super.stats.num_path_profile_seeded = 1;
+}
+
+/**
+ * Records the profile of the path being used by a server-side connection to the path profile cache.
+ */
+static void store_path_profile(quicly_conn_t *conn)
+{
+    quicly_path_profile_cache_t *cache = conn->super.ctx->path_profile_cache;
+    quicly_path_profile_t profile = {};
+    uint32_t rtt;
+
+    calc_resume_sendrate(conn, &profile.delivery_rate, &rtt);
+    if ((profile.min_rtt = conn->egress.loss.rtt.minimum) == UINT32_MAX)
+        return;
+    if (conn->super.stats.num_packets.sent != 0) {
+        uint64_t permille = conn->super.stats.num_packets.lost * 1000 / conn->super.stats.num_packets.sent;
+        profile.loss_permille = permille < 1000 ? (uint16_t)permille : 1000;
+    }
+
+    cache->store(cache, conn, &conn->paths[0]->address.remote.sa, conn->stash.now, &profile);
+}
+
 static inline void update_open_count(quicly_context_t *ctx, ssize_t delta)
 {
     if (ctx->update_open_count != NULL)
@@ -1979,7 +2343,7 @@ static int new_path(quicly_conn_t *conn, size_t path_index, struct sockaddr *rem
 
     assert(conn->paths[path_index] == NULL);
 
-    if ((path = malloc(sizeof(*conn->paths[path_index]))) == NULL)
+    if ((path = quicly_alloc(conn->super.ctx->allocator, sizeof(*path), QUICLY_ALLOC_TAG_PATH)) == NULL)
         return PTLS_ERROR_NO_MEMORY;
 
     if (path_index == 0) {
@@ -1987,6 +2351,7 @@ static int new_path(quicly_conn_t *conn, size_t path_index, struct sockaddr *rem
         *path = (struct st_quicly_conn_path_t){
             .dcid = 0,
             .path_challenge.send_at = INT64_MAX,
+            .rtt = UINT32_MAX,
             .initial = 1,
             .probe_only = 0,
         };
@@ -1994,6 +2359,7 @@ static int new_path(quicly_conn_t *conn, size_t path_index, struct sockaddr *rem
         *path = (struct st_quicly_conn_path_t){
             .dcid = UINT64_MAX,
             .path_challenge.send_at = 0,
+            .rtt = UINT32_MAX,
             .probe_only = 1,
         };
         conn->super.ctx->tls->random_bytes(path->path_challenge.data, sizeof(path->path_challenge.data));
@@ -2006,9 +2372,8 @@ static int new_path(quicly_conn_t *conn, size_t path_index, struct sockaddr *rem
 
     PTLS_LOG_DEFINE_POINT(quicly, new_path, new_path_logpoint);
     if (QUICLY_PROBE_ENABLED(NEW_PATH) ||
-        (ptls_log_point_maybe_active(&new_path_logpoint) & ptls_log_conn_maybe_active(ptls_get_log_state(conn->crypto.tls),
-                                                                                      (const char *(*)(void *))ptls_get_server_name,
-                                                                                      conn->crypto.tls)) != 0) {
+        (ptls_log_point_maybe_active(&new_path_logpoint) &
+         ptls_log_conn_maybe_active(quicly_get_log_state(conn), (const char *(*)(void *))quicly_get_server_name, conn)) != 0) {
         char remote[sizeof(LONGEST_ADDRESS_STR)];
         stringify_address(remote, &path->address.remote.sa);
         QUICLY_PROBE(NEW_PATH, conn, conn->stash.now, path_index, remote);
@@ -2033,7 +2398,7 @@ static int do_delete_path(quicly_conn_t *conn, struct st_quicly_conn_path_t *pat
         conn->egress.pending_flows |= QUICLY_PENDING_FLOW_OTHERS_BIT;
     }
 
-    free(path);
+    quicly_dealloc(conn->super.ctx->allocator, path, sizeof(*path), QUICLY_ALLOC_TAG_PATH);
 
     return ret;
 }
@@ -2051,6 +2416,38 @@ static int delete_path(quicly_conn_t *conn, size_t path_index)
     return do_delete_path(conn, path);
 }
 
+/**
+ * Returns if the two addresses belong to the same /24 (IPv4) or /64 (IPv6) subnet.
+ */
+static int is_same_subnet(struct sockaddr *x, struct sockaddr *y)
+{
+    if (x->sa_family != y->sa_family)
+        return 0;
+
+    switch (x->sa_family) {
+    case AF_INET:
+        return memcmp(&((struct sockaddr_in *)x)->sin_addr, &((struct sockaddr_in *)y)->sin_addr, 3) == 0;
+    case AF_INET6:
+        return memcmp(&((struct sockaddr_in6 *)x)->sin6_addr, &((struct sockaddr_in6 *)y)->sin6_addr, 8) == 0;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Returns if the migration from `from` to `to` is likely to be a NAT rebinding (i.e., the port number or the address changed
+ * within the same subnet) rather than the peer moving to a different network.
+ */
+static int is_nat_rebinding(struct st_quicly_conn_path_t *from, struct st_quicly_conn_path_t *to)
+{
+    if (!is_same_subnet(&from->address.remote.sa, &to->address.remote.sa))
+        return 0;
+    if (from->address.local.sa.sa_family != AF_UNSPEC && to->address.local.sa.sa_family != AF_UNSPEC &&
+        !is_same_subnet(&from->address.local.sa, &to->address.local.sa))
+        return 0;
+    return 1;
+}
+
 /**
  * paths[0] (the default path) is freed and the path specified by `path_index` is promoted
  */
@@ -2061,39 +2458,53 @@ static quicly_error_t promote_path(quicly_conn_t *conn, size_t path_index)
     QUICLY_PROBE(PROMOTE_PATH, conn, conn->stash.now, path_index);
     QUICLY_LOG_CONN(promote_path, conn, { PTLS_LOG_ELEMENT_UNSIGNED(path_index, path_index); });
 
-    { /* mark all packets as lost, as it is unlikely that packets sent on the old path would be acknowledged */
-        quicly_sentmap_iter_t iter;
-        if ((ret = quicly_loss_init_sentmap_iter(&conn->egress.loss, &iter, conn->stash.now,
-                                                 conn->super.remote.transport_params.max_ack_delay, 0)) != 0)
-            return ret;
-        const quicly_sent_packet_t *sent;
-        while ((sent = quicly_sentmap_get(&iter))->packet_number != UINT64_MAX) {
-            if ((ret = quicly_sentmap_update(&conn->egress.loss.sentmap, &iter, QUICLY_SENTMAP_EVENT_PTO)) != 0)
+    if (is_nat_rebinding(conn->paths[0], conn->paths[path_index])) {
+        /* The peer is still on the same network, hence the path characteristics are unlikely to have changed. Congestion state,
+         * the RTT estimate, and the packets in flight (which may still be acknowledged) are retained. */
+        conn->super.stats.num_paths.nat_rebinding += 1;
+    } else {
+        /* Peer has moved to a different network; reset congestion state and loss recovery (RFC 9000 Section 9.4). */
+        { /* mark all packets as lost, as it is unlikely that packets sent on the old path would be acknowledged */
+            quicly_sentmap_iter_t iter;
+            if ((ret = quicly_loss_init_sentmap_iter(&conn->egress.loss, &iter, conn->stash.now,
+                                                     conn->super.remote.transport_params.max_ack_delay, 0)) != 0)
                 return ret;
+            const quicly_sent_packet_t *sent;
+            while ((sent = quicly_sentmap_get(&iter))->packet_number != UINT64_MAX) {
+                if ((ret = quicly_sentmap_update(&conn->egress.loss.sentmap, &iter, QUICLY_SENTMAP_EVENT_PTO)) != 0)
+                    return ret;
+            }
         }
-    }
 
-    /* reset CC (FIXME flush sentmap and reset loss recovery) */
-    conn->egress.cc.type->cc_init->cb(
-        conn->egress.cc.type->cc_init, &conn->egress.cc,
-        quicly_cc_calc_initial_cwnd(conn->super.ctx->initcwnd_packets, conn->egress.max_udp_payload_size), conn->stash.now);
-    if (conn->super.stats.num_rapid_start != 0 && conn->egress.cc.type->enable_rapid_start != NULL)
-        conn->egress.cc.type->enable_rapid_start(&conn->egress.cc, conn->stash.now);
+        /* reset CC */
+        int use_hystart = quicly_cc_hystart_is_enabled(&conn->egress.cc.hystart);
+        conn->egress.cc.type->cc_init->cb(
+            conn->egress.cc.type->cc_init, &conn->egress.cc,
+            quicly_cc_calc_initial_cwnd(conn->super.ctx->initcwnd_packets, conn->egress.max_udp_payload_size), conn->stash.now);
+        if (conn->super.stats.num_rapid_start != 0 && conn->egress.cc.type->enable_rapid_start != NULL)
+            conn->egress.cc.type->enable_rapid_start(&conn->egress.cc, conn->stash.now);
+        if (use_hystart)
+            quicly_cc_init_hystart(&conn->egress.cc.hystart);
 
-    /* set jumpstart target */
-    calc_resume_sendrate(conn, &conn->super.stats.jumpstart.prev_rate, &conn->super.stats.jumpstart.prev_rtt);
+        /* set jumpstart target */
+        calc_resume_sendrate(conn, &conn->super.stats.jumpstart.prev_rate, &conn->super.stats.jumpstart.prev_rtt);
 
-    /* reset RTT estimate, adopting SRTT of the original path as initial RTT (TODO calculate RTT based on path challenge RT) */
-    quicly_rtt_init(&conn->egress.loss.rtt, &conn->super.ctx->loss,
-                    conn->egress.loss.rtt.smoothed < conn->super.ctx->loss.default_initial_rtt
-                        ? conn->egress.loss.rtt.smoothed
-                        : conn->super.ctx->loss.default_initial_rtt);
+        /* Reset RTT estimate. The round-trip time of PATH_CHALLENGE is used as the first sample if it has been measured; otherwise,
+         * SRTT of the original path is adopted as the initial RTT. */
+        uint32_t path_rtt = conn->paths[path_index]->rtt;
+        quicly_rtt_init(&conn->egress.loss.rtt, &conn->super.ctx->loss,
+                        conn->egress.loss.rtt.smoothed < conn->super.ctx->loss.default_initial_rtt
+                            ? conn->egress.loss.rtt.smoothed
+                            : conn->super.ctx->loss.default_initial_rtt);
+        if (path_rtt != UINT32_MAX)
+            quicly_rtt_update(&conn->egress.loss.rtt, path_rtt, 0);
 
-    /* reset ratemeter */
-    quicly_ratemeter_init(&conn->egress.ratemeter);
+        /* reset ratemeter */
+        quicly_ratemeter_init(&conn->egress.ratemeter);
 
-    /* remember PN when the path was promoted */
-    conn->egress.pn_path_start = conn->egress.packet_number;
+        /* remember PN when the path was promoted */
+        conn->egress.pn_path_start = conn->egress.packet_number;
+    }
 
     /* update path mapping */
     struct st_quicly_conn_path_t *path = conn->paths[0];
@@ -2103,7 +2514,7 @@ static quicly_error_t promote_path(quicly_conn_t *conn, size_t path_index)
 
     ret = do_delete_path(conn, path);
 
-    /* rearm the loss timer, now that the RTT estimate has been changed */
+    /* rearm the loss timer, now that the RTT estimate might have been changed */
     setup_next_send(conn);
 
     return ret;
@@ -2159,6 +2570,101 @@ static void recalc_send_probe_at(quicly_conn_t *conn)
     }
 }
 
+static void dispose_conn_pool_entry(quicly_allocator_t *allocator, struct st_quicly_conn_pool_entry_t *entry)
+{
+    if (entry->streams != NULL)
+        kh_destroy(quicly_stream_t, entry->streams);
+    quicly_dealloc(allocator, entry->pacer, sizeof(*entry->pacer), QUICLY_ALLOC_TAG_PACER);
+    quicly_dealloc(allocator, entry->conn, sizeof(*entry->conn), QUICLY_ALLOC_TAG_CONN);
+}
+
+/**
+ * Obtains a zero-cleared connection object, either from the pool or from the allocator. When the object is obtained from the pool,
+ * the stream table and the pacer being retained are returned as well.
+ */
+static quicly_conn_t *alloc_conn_memory(quicly_context_t *ctx, khash_t(quicly_stream_t) * *streams, quicly_pacer_t **pacer)
+{
+    quicly_conn_pool_t *pool = ctx->conn_pool;
+    quicly_conn_t *conn;
+
+    if (pool != NULL && pool->count != 0) {
+        assert(pool->allocator == ctx->allocator);
+        struct st_quicly_conn_pool_entry_t *entry = &pool->entries[--pool->count];
+        *streams = entry->streams;
+        *pacer = entry->pacer;
+        return entry->conn;
+    }
+
+    *streams = NULL;
+    *pacer = NULL;
+    if ((conn = quicly_alloc(ctx->allocator, sizeof(*conn), QUICLY_ALLOC_TAG_CONN)) != NULL)
+        memset(conn, 0, sizeof(*conn));
+    return conn;
+}
+
+/**
+ * Returns the connection object to the pool after resetting it, or releases the memory if the pool does not exist or is full.
+ */
+static void release_conn_memory(quicly_context_t *ctx, quicly_conn_t *conn, khash_t(quicly_stream_t) * streams,
+                                quicly_pacer_t *pacer)
+{
+    quicly_conn_pool_t *pool = ctx->conn_pool;
+    struct st_quicly_conn_pool_entry_t entry = {conn, streams, pacer};
+
+    if (pool != NULL && pool->count < pool->capacity) {
+        assert(pool->allocator == ctx->allocator);
+        if (entry.streams != NULL) {
+            kh_clear(quicly_stream_t, entry.streams);
+            if (kh_n_buckets(entry.streams) > QUICLY_CONN_POOL_STREAM_BUCKETS)
+                kh_resize(quicly_stream_t, entry.streams, QUICLY_CONN_POOL_STREAM_BUCKETS);
+        }
+        memset(entry.conn, 0, sizeof(*entry.conn));
+        pool->entries[pool->count++] = entry;
+    } else {
+        dispose_conn_pool_entry(ctx->allocator, &entry);
+    }
+}
+
+quicly_conn_pool_t *quicly_new_conn_pool(quicly_context_t *ctx, size_t capacity)
+{
+    quicly_conn_pool_t *pool;
+
+    if ((pool = quicly_alloc(ctx->allocator, sizeof(*pool), QUICLY_ALLOC_TAG_CONN)) == NULL)
+        return NULL;
+    *pool = (quicly_conn_pool_t){.allocator = ctx->allocator, .capacity = capacity};
+    if ((pool->entries = quicly_alloc(pool->allocator, sizeof(*pool->entries) * capacity, QUICLY_ALLOC_TAG_CONN)) == NULL)
+        goto Fail;
+
+    /* instantiate the objects, with the stream table and the pacer (if used) being ready */
+    while (pool->count < pool->capacity) {
+        struct st_quicly_conn_pool_entry_t entry = {NULL};
+        if ((entry.conn = quicly_alloc(pool->allocator, sizeof(*entry.conn), QUICLY_ALLOC_TAG_CONN)) == NULL ||
+            (entry.streams = kh_init(quicly_stream_t)) == NULL ||
+            kh_resize(quicly_stream_t, entry.streams, QUICLY_CONN_POOL_STREAM_BUCKETS) < 0 ||
+            (ctx->enable_ratio.pacing != 0 &&
+             (entry.pacer = quicly_alloc(pool->allocator, sizeof(*entry.pacer), QUICLY_ALLOC_TAG_PACER)) == NULL)) {
+            dispose_conn_pool_entry(pool->allocator, &entry);
+            goto Fail;
+        }
+        memset(entry.conn, 0, sizeof(*entry.conn));
+        pool->entries[pool->count++] = entry;
+    }
+
+    return pool;
+
+Fail:
+    quicly_free_conn_pool(pool);
+    return NULL;
+}
+
+void quicly_free_conn_pool(quicly_conn_pool_t *pool)
+{
+    while (pool->count != 0)
+        dispose_conn_pool_entry(pool->allocator, &pool->entries[--pool->count]);
+    quicly_dealloc(pool->allocator, pool->entries, sizeof(*pool->entries) * pool->capacity, QUICLY_ALLOC_TAG_CONN);
+    quicly_dealloc(pool->allocator, pool, sizeof(*pool), QUICLY_ALLOC_TAG_CONN);
+}
+
 void quicly_free(quicly_conn_t *conn)
 {
     lock_now(conn, 0);
@@ -2169,8 +2675,7 @@ void quicly_free(quicly_conn_t *conn)
     PTLS_LOG_DEFINE_POINT(quicly, conn_stats, conn_stats_logpoint);
     if (QUICLY_PROBE_ENABLED(CONN_STATS) ||
         (ptls_log_point_maybe_active(&conn_stats_logpoint) &
-         ptls_log_conn_maybe_active(ptls_get_log_state(conn->crypto.tls), (const char *(*)(void *))ptls_get_server_name,
-                                    conn->crypto.tls)) != 0) {
+         ptls_log_conn_maybe_active(quicly_get_log_state(conn), (const char *(*)(void *))quicly_get_server_name, conn)) != 0) {
         quicly_stats_t stats;
         if (quicly_get_stats(conn, &stats) == 0) {
             QUICLY_PROBE(CONN_STATS, conn, conn->stash.now, &stats, sizeof(stats));
@@ -2180,34 +2685,39 @@ void quicly_free(quicly_conn_t *conn)
         }
     }
 
+    if (conn->super.ctx->path_profile_cache != NULL && !quicly_is_client(conn))
+        store_path_profile(conn);
+
     destroy_all_streams(conn, 0, 1);
     update_open_count(conn->super.ctx, -1);
+    admission_on_handshake_end(conn);
     clear_datagram_frame_payloads(conn);
 
     for (size_t i = 0; i != PTLS_ELEMENTSOF(conn->delayed_packets.as_array); ++i) {
         while (conn->delayed_packets.as_array[i].head != NULL) {
             struct st_quicly_delayed_packet_t *delayed = conn->delayed_packets.as_array[i].head;
             conn->delayed_packets.as_array[i].head = delayed->next;
-            free(delayed);
+            quicly_dealloc(conn->super.ctx->allocator, delayed, DELAYED_PACKET_SIZE(delayed->packet.octets.len),
+                           QUICLY_ALLOC_TAG_DELAYED_PACKET);
         }
     }
 
     quicly_maxsender_dispose(&conn->ingress.max_data.sender);
+    if (conn->ingress.max_data.budget != NULL)
+        conn->ingress.max_data.budget->committed -= conn->ingress.max_data.committed;
     quicly_maxsender_dispose(&conn->ingress.max_streams.uni);
     quicly_maxsender_dispose(&conn->ingress.max_streams.bidi);
     quicly_loss_dispose(&conn->egress.loss);
 
-    kh_destroy(quicly_stream_t, conn->streams);
-
     assert(!quicly_linklist_is_linked(&conn->egress.pending_streams.blocked.uni));
     assert(!quicly_linklist_is_linked(&conn->egress.pending_streams.blocked.bidi));
     assert(!quicly_linklist_is_linked(&conn->egress.pending_streams.control));
     assert(!quicly_linklist_is_linked(&conn->super._default_scheduler.active));
     assert(!quicly_linklist_is_linked(&conn->super._default_scheduler.blocked));
 
-    free_handshake_space(&conn->initial);
-    free_handshake_space(&conn->handshake);
-    free_application_space(&conn->application);
+    free_handshake_space(conn, &conn->initial);
+    free_handshake_space(conn, &conn->handshake);
+    free_application_space(conn, &conn->application);
 
     ptls_buffer_dispose(&conn->crypto.transport_params.buf);
 
@@ -2220,16 +2730,91 @@ void quicly_free(quicly_conn_t *conn)
     if (conn->crypto.async_in_progress) {
         /* When async signature generation is inflight, `ptls_free` will be called from `quicly_resume_handshake` laterwards. */
         *ptls_get_data_ptr(conn->crypto.tls) = NULL;
-    } else {
+    } else if (conn->crypto.tls != NULL) {
         ptls_free(conn->crypto.tls);
+    } else {
+        quicly_dealloc(conn->super.ctx->allocator, conn->crypto.hibernated.names.base, conn->crypto.hibernated.names.len,
+                       QUICLY_ALLOC_TAG_CONN);
     }
 
     unlock_now(conn);
 
-    if (conn->egress.pacer != NULL)
-        free(conn->egress.pacer);
-    free(conn->token.base);
-    free(conn);
+    quicly_dealloc(conn->super.ctx->allocator, conn->token.base, conn->token.len, QUICLY_ALLOC_TAG_TOKEN);
+    release_conn_memory(conn->super.ctx, conn, conn->streams, conn->egress.pacer);
+}
+
+/**
+ * Releases the TLS object along with the 1-RTT crypto stream, after serializing the properties that are used once the handshake is
+ * confirmed. The TLS object is not rehydrated, as key updates rely only on the traffic secrets retained by the application space.
+ */
+static void hibernate_tls(quicly_conn_t *conn)
+{
+    const char *server_name = ptls_get_server_name(conn->crypto.tls), *protocol = ptls_get_negotiated_protocol(conn->crypto.tls);
+    size_t server_name_len = server_name != NULL ? strlen(server_name) : 0, protocol_len = protocol != NULL ? strlen(protocol) : 0;
+    uint8_t *names;
+
+    if ((names = quicly_alloc(conn->super.ctx->allocator, server_name_len + protocol_len + 2, QUICLY_ALLOC_TAG_CONN)) == NULL)
+        return;
+    if (server_name_len != 0)
+        memcpy(names, server_name, server_name_len);
+    names[server_name_len] = '\0';
+    if (protocol_len != 0)
+        memcpy(names + server_name_len + 1, protocol, protocol_len);
+    names[server_name_len + 1 + protocol_len] = '\0';
+
+    conn->crypto.hibernated.cipher = ptls_get_cipher(conn->crypto.tls);
+    conn->crypto.hibernated.log_state = *ptls_get_log_state(conn->crypto.tls);
+    conn->crypto.hibernated.names = ptls_iovec_init(names, server_name_len + protocol_len + 2);
+    ptls_free(conn->crypto.tls);
+    conn->crypto.tls = NULL;
+    conn->crypto.handshake_properties = (ptls_handshake_properties_t){{{{NULL}}}};
+    destroy_handshake_flow(conn, QUICLY_EPOCH_1RTT);
+}
+
+int quicly_hibernate(quicly_conn_t *conn)
+{
+    quicly_stream_t *stream;
+
+    /* hibernate only when the handshake has been confirmed, all packets have been acked, and there is nothing to be sent */
+    if (!(conn->super.state == QUICLY_STATE_CONNECTED && conn->initial == NULL && conn->handshake == NULL &&
+          !conn->crypto.async_in_progress && conn->stash.lock_count == 0))
+        return 0;
+    if (conn->egress.loss.sentmap.bytes_in_flight != 0 || conn->application->super.unacked_count != 0 ||
+        conn->egress.pending_flows != 0 || conn->egress.datagram_frame_payloads.count != 0 ||
+        quicly_linklist_is_linked(&conn->egress.pending_streams.control) ||
+        quicly_linklist_is_linked(&conn->egress.pending_streams.blocked.uni) ||
+        quicly_linklist_is_linked(&conn->egress.pending_streams.blocked.bidi) || scheduler_can_send(conn))
+        return 0;
+
+    /* discard the packets that are not inflight (i.e., those carrying only ACK frames and those deemed lost), as the peer might
+     * never acknowledge them */
+    lock_now(conn, 0);
+    quicly_error_t ret = discard_sentmap_by_epoch(conn, 1u << QUICLY_EPOCH_1RTT);
+    unlock_now(conn);
+    if (ret != 0)
+        return 0;
+    quicly_sentmap_shrink(&conn->egress.loss.sentmap);
+
+    /* shrink the ranges retained by the ack queue and the streams, as well as the stream table */
+    quicly_ranges_shrink(&conn->application->super.ack_queue);
+    kh_foreach_value(conn->streams, stream, {
+        quicly_ranges_shrink(&stream->sendstate.acked);
+        quicly_ranges_shrink(&stream->sendstate.pending);
+        quicly_ranges_shrink(&stream->recvstate.received);
+    });
+    if (kh_n_buckets(conn->streams) > 4 && kh_size(conn->streams) * 4 < kh_n_buckets(conn->streams))
+        kh_resize(quicly_stream_t, conn->streams, kh_size(conn->streams) * 2);
+
+    /* the TLS object, transport parameters, and the address token are needed only during the handshake */
+    if (conn->crypto.tls != NULL)
+        hibernate_tls(conn);
+    conn->crypto.handshake_properties.additional_extensions = NULL;
+    ptls_buffer_dispose(&conn->crypto.transport_params.buf);
+    ptls_buffer_init(&conn->crypto.transport_params.buf, "", 0);
+    quicly_dealloc(conn->super.ctx->allocator, conn->token.base, conn->token.len, QUICLY_ALLOC_TAG_TOKEN);
+    conn->token = ptls_iovec_init(NULL, 0);
+
+    return 1;
 }
 
 static int calc_initial_key(ptls_cipher_suite_t *cs, uint8_t *traffic_secret, const void *master_secret, const char *label)
@@ -2308,6 +2893,43 @@ static quicly_error_t reinstall_initial_encryption(quicly_conn_t *conn, quicly_e
         ptls_iovec_init(salt->initial, sizeof(salt->initial)), NULL);
 }
 
+/**
+ * Delivers the stream data accumulated in `conn->stash.recv_batch`, calling `on_receive_batch` once for each stream.
+ */
+static quicly_error_t flush_recv_batch(quicly_conn_t *conn)
+{
+    struct st_quicly_recv_batch_entry_t *entries = conn->stash.recv_batch.entries;
+    size_t count = conn->stash.recv_batch.count, i, j;
+
+    conn->stash.recv_batch.count = 0;
+
+    for (i = 0; i != count; ++i) {
+        quicly_stream_t *stream = entries[i].stream;
+        quicly_stream_recv_vec_t vecs[PTLS_ELEMENTSOF(conn->stash.recv_batch.entries)];
+        size_t num_vecs = 0;
+        if (stream == NULL)
+            continue;
+        /* gather the entries of the stream */
+        for (j = i; j != count; ++j) {
+            if (entries[j].stream != stream)
+                continue;
+            vecs[num_vecs++] = (quicly_stream_recv_vec_t){(size_t)(entries[j].off - stream->recvstate.data_off), entries[j].src,
+                                                          entries[j].len};
+            entries[j].stream = NULL;
+        }
+        /* deliver, then do what apply_stream_frame does after calling `on_receive` */
+        stream->callbacks->on_receive_batch(stream, vecs, num_vecs);
+        if (conn->super.state >= QUICLY_STATE_CLOSING)
+            return QUICLY_ERROR_IS_CLOSING;
+        if (should_send_max_stream_data(stream))
+            sched_stream_control(stream);
+        if (stream_is_destroyable(stream))
+            destroy_stream(stream, 0);
+    }
+
+    return 0;
+}
+
 static quicly_error_t apply_stream_frame(quicly_stream_t *stream, quicly_stream_frame_t *frame)
 {
     quicly_error_t ret;
@@ -2337,7 +2959,8 @@ static quicly_error_t apply_stream_frame(quicly_stream_t *stream, quicly_stream_
                 stream->conn->ingress.max_data.sender.max_committed)
                 return QUICLY_TRANSPORT_ERROR_FLOW_CONTROL;
             stream->conn->ingress.max_data.bytes_consumed += newly_received;
-            /* FIXME send MAX_DATA if necessary */
+            if (should_send_max_data(stream->conn))
+                stream->conn->egress.pending_flows |= QUICLY_PENDING_FLOW_OTHERS_BIT;
         }
     } else {
         /* CRYPTO streams; maybe add different limit for 1-RTT CRYPTO? */
@@ -2361,6 +2984,15 @@ static quicly_error_t apply_stream_frame(quicly_stream_t *stream, quicly_stream_
             PTLS_LOG_ELEMENT_UNSIGNED(apply_off, apply_off);
             PTLS_LOG_ELEMENT_UNSIGNED(apply_len, apply_len);
         });
+        if (stream->callbacks->on_receive_batch != NULL) {
+            /* the batch is never flushed here, as that might destroy the stream being updated */
+            quicly_conn_t *conn = stream->conn;
+            assert(conn->stash.recv_batch.count < PTLS_ELEMENTSOF(conn->stash.recv_batch.entries));
+            conn->stash.recv_batch.entries[conn->stash.recv_batch.count++] = (struct st_quicly_recv_batch_entry_t){
+                stream, stream->recvstate.data_off + buf_offset, frame->data.base + apply_off, apply_len};
+            /* MAX_STREAM_DATA and the destruction of the stream are handled when the batch is flushed */
+            return 0;
+        }
         stream->callbacks->on_receive(stream, (size_t)buf_offset, frame->data.base + apply_off, apply_len);
         if (stream->conn->super.state >= QUICLY_STATE_CLOSING)
             return QUICLY_ERROR_IS_CLOSING;
@@ -2698,7 +3330,8 @@ static quicly_conn_t *create_connection(quicly_context_t *ctx, uint32_t protocol
     ptls_log_conn_state_t log_state_override;
     ptls_t *tls;
     quicly_conn_t *conn;
-    quicly_pacer_t *pacer = NULL;
+    khash_t(quicly_stream_t) * streams;
+    quicly_pacer_t *pacer;
 
     /* consistency checks */
     assert(remote_addr != NULL && remote_addr->sa_family != AF_UNSPEC);
@@ -2730,16 +3363,20 @@ static quicly_conn_t *create_connection(quicly_context_t *ctx, uint32_t protocol
     }
 
     /* allocate memory and start creating QUIC context */
-    if ((conn = malloc(sizeof(*conn))) == NULL) {
+    if ((conn = alloc_conn_memory(ctx, &streams, &pacer)) == NULL) {
         ptls_free(tls);
         return NULL;
     }
-    if (enable_with_ratio255(ctx->enable_ratio.pacing, ctx->tls->random_bytes) && (pacer = malloc(sizeof(*pacer))) == NULL) {
-        ptls_free(tls);
-        free(conn);
-        return NULL;
+    if (enable_with_ratio255(ctx->enable_ratio.pacing, ctx->tls->random_bytes)) {
+        if (pacer == NULL && (pacer = quicly_alloc(ctx->allocator, sizeof(*pacer), QUICLY_ALLOC_TAG_PACER)) == NULL) {
+            ptls_free(tls);
+            release_conn_memory(ctx, conn, streams, NULL);
+            return NULL;
+        }
+    } else if (pacer != NULL) {
+        quicly_dealloc(ctx->allocator, pacer, sizeof(*pacer), QUICLY_ALLOC_TAG_PACER);
+        pacer = NULL;
     }
-    memset(conn, 0, sizeof(*conn));
     conn->super.ctx = ctx;
     conn->super.data = appdata;
     lock_now(conn, 0);
@@ -2751,10 +3388,8 @@ static quicly_conn_t *create_connection(quicly_context_t *ctx, uint32_t protocol
     conn->crypto.tls = tls;
     if (new_path(conn, 0, remote_addr, local_addr) != 0) {
         unlock_now(conn);
-        if (pacer != NULL)
-            free(pacer);
         ptls_free(tls);
-        free(conn);
+        release_conn_memory(ctx, conn, streams, pacer);
         return NULL;
     }
     quicly_local_cid_init_set(&conn->super.local.cid_set, ctx->cid_encryptor, local_cid);
@@ -2778,13 +3413,19 @@ static quicly_conn_t *create_connection(quicly_context_t *ctx, uint32_t protocol
     conn->super.version = protocol_version;
     quicly_linklist_init(&conn->super._default_scheduler.active);
     quicly_linklist_init(&conn->super._default_scheduler.blocked);
-    conn->streams = kh_init(quicly_stream_t);
-    quicly_maxsender_init(&conn->ingress.max_data.sender, conn->super.ctx->transport_params.max_data);
+    conn->streams = streams != NULL ? streams : kh_init(quicly_stream_t);
+    /* the initial window is charged to the budget like any other, and the value being committed is the one advertised */
+    conn->ingress.max_data.window = conn->super.ctx->transport_params.max_data;
+    conn->ingress.max_data.budget = conn->super.ctx->recvbuf_budget;
+    commit_max_data_window(conn);
+    quicly_maxsender_init(&conn->ingress.max_data.sender, conn->ingress.max_data.committed);
+    conn->ingress.max_data.last_update.at = conn->stash.now;
     quicly_maxsender_init(&conn->ingress.max_streams.uni, conn->super.ctx->transport_params.max_streams_uni);
     quicly_maxsender_init(&conn->ingress.max_streams.bidi, conn->super.ctx->transport_params.max_streams_bidi);
     quicly_loss_init(&conn->egress.loss, &conn->super.ctx->loss,
                      conn->super.ctx->loss.default_initial_rtt /* FIXME remember initial_rtt in session ticket */,
                      &conn->super.remote.transport_params.max_ack_delay, &conn->super.remote.transport_params.ack_delay_exponent);
+    conn->egress.loss.sentmap.allocator = ctx->allocator;
     conn->egress.max_udp_payload_size = conn->super.ctx->initial_egress_max_udp_payload_size;
     init_max_streams(&conn->egress.max_streams.uni);
     init_max_streams(&conn->egress.max_streams.bidi);
@@ -2939,7 +3580,7 @@ quicly_error_t quicly_connect(quicly_conn_t **_conn, quicly_context_t *ctx, cons
     conn->super.remote.address_validation.validated = 1;
     conn->super.remote.address_validation.send_probe = 1;
     if (address_token.len != 0) {
-        if ((conn->token.base = malloc(address_token.len)) == NULL) {
+        if ((conn->token.base = quicly_alloc(ctx->allocator, address_token.len, QUICLY_ALLOC_TAG_TOKEN)) == NULL) {
             ret = PTLS_ERROR_NO_MEMORY;
             goto Exit;
         }
@@ -2961,9 +3602,11 @@ quicly_error_t quicly_connect(quicly_conn_t **_conn, quicly_context_t *ctx, cons
 
     /* handshake (we always encode authentication CIDs, as we do not (yet) regenerate ClientHello when receiving Retry) */
     ptls_buffer_init(&conn->crypto.transport_params.buf, "", 0);
+    quicly_transport_parameters_t local_params = conn->super.ctx->transport_params;
+    local_params.max_data = conn->ingress.max_data.committed;
     if ((ret = quicly_encode_transport_parameter_list(
-             &conn->crypto.transport_params.buf, &conn->super.ctx->transport_params, NULL, &conn->super.local.cid_set.cids[0].cid,
-             NULL, NULL, conn->super.ctx->expand_client_hello ? conn->super.ctx->initial_egress_max_udp_payload_size : 0)) != 0)
+             &conn->crypto.transport_params.buf, &local_params, NULL, &conn->super.local.cid_set.cids[0].cid, NULL, NULL,
+             conn->super.ctx->expand_client_hello ? conn->super.ctx->initial_egress_max_udp_payload_size : 0)) != 0)
         goto Exit;
     conn->crypto.transport_params.ext[0] =
         (ptls_raw_extension_t){get_transport_parameters_extension_id(conn->super.version),
@@ -3059,8 +3702,10 @@ static int server_collected_extensions(ptls_t *tls, ptls_handshake_properties_t
     assert(properties->additional_extensions == NULL);
     ptls_buffer_init(&conn->crypto.transport_params.buf, "", 0);
     assert(conn->super.local.cid_set.cids[0].sequence == 0 && "make sure that local_cid is in expected state before sending SRT");
+    quicly_transport_parameters_t local_params = conn->super.ctx->transport_params;
+    local_params.max_data = conn->ingress.max_data.committed;
     if ((ret = quicly_encode_transport_parameter_list(
-             &conn->crypto.transport_params.buf, &conn->super.ctx->transport_params,
+             &conn->crypto.transport_params.buf, &local_params,
              needs_cid_auth(conn) || is_retry(conn) ? &conn->super.original_dcid : NULL,
              needs_cid_auth(conn) ? &conn->super.local.cid_set.cids[0].cid : NULL,
              needs_cid_auth(conn) && is_retry(conn) ? &conn->retry_scid : NULL,
@@ -3110,7 +3755,7 @@ static int aead_decrypt_1rtt(void *ctx, uint64_t pn, quicly_decoded_packet_t *pa
             ptls_cipher_free(conn->application->cipher.ingress.header_protection.zero_rtt);
             conn->application->cipher.ingress.header_protection.zero_rtt = NULL;
         }
-        ptls_cipher_suite_t *cipher = ptls_get_cipher(conn->crypto.tls);
+        ptls_cipher_suite_t *cipher = get_cipher(conn);
         if ((ret = update_1rtt_key(conn, cipher, 0, &space->cipher.ingress.aead[aead_index], space->cipher.ingress.secret)) != 0)
             return ret;
         ++space->cipher.ingress.key_phase.prepared;
@@ -3588,6 +4233,10 @@ static uint32_t calc_pacer_send_rate(quicly_conn_t *conn)
 {
     uint32_t multiplier;
 
+    /* use the pacing rate calculated by the congestion controller, if provided (i.e., model-based CCs like BBR) */
+    if (conn->egress.cc.type->cc_pacing_rate != NULL)
+        return conn->egress.cc.type->cc_pacing_rate(&conn->egress.cc, &conn->egress.loss);
+
     if (conn->egress.cc.num_loss_episodes == 0) {
         if (quicly_cc_in_jumpstart(&conn->egress.cc)) {
             multiplier = 1;
@@ -3607,6 +4256,13 @@ static uint32_t calc_pacer_send_rate(quicly_conn_t *conn)
     return quicly_pacer_calc_send_rate(multiplier, conn->egress.cc.cwnd, conn->egress.loss.rtt.smoothed);
 }
 
+static uint32_t calc_pacer_burst(quicly_conn_t *conn, uint32_t bytes_per_msec)
+{
+    /* until RTT is observed, the default burst size is used, as bytes_per_msec is derived from the initial RTT */
+    uint32_t cwnd = conn->egress.loss.rtt.minimum != UINT32_MAX ? conn->egress.cc.cwnd : 0;
+    return quicly_pacer_calc_burst(bytes_per_msec, cwnd, conn->egress.max_udp_payload_size, conn->super.ctx->max_gso_segments);
+}
+
 static int should_send_datagram_frame(quicly_conn_t *conn)
 {
     if (conn->egress.datagram_frame_payloads.count == 0)
@@ -3678,7 +4334,8 @@ static int64_t pacer_can_send_at(quicly_conn_t *conn)
         return 0;
 
     uint32_t bytes_per_msec = calc_pacer_send_rate(conn);
-    return quicly_pacer_can_send_at(conn->egress.pacer, bytes_per_msec, conn->egress.max_udp_payload_size);
+    return quicly_pacer_can_send_at(conn->egress.pacer, bytes_per_msec, conn->egress.max_udp_payload_size,
+                                    calc_pacer_burst(conn, bytes_per_msec));
 }
 
 int64_t quicly_get_first_timeout(quicly_conn_t *conn)
@@ -4278,12 +4935,15 @@ static quicly_error_t send_control_frames_of_stream(quicly_stream_t *stream, qui
 
     /* send MAX_STREAM_DATA if necessary */
     if (should_send_max_stream_data(stream)) {
-        uint64_t new_value = stream->recvstate.data_off + stream->_recv_aux.window;
         quicly_sent_t *sent;
         /* prepare */
         if ((ret = allocate_ack_eliciting_frame(stream->conn, s, QUICLY_MAX_STREAM_DATA_FRAME_CAPACITY, &sent,
                                                 on_ack_max_stream_data)) != 0)
             return ret;
+        autotune_stream_receive_window(stream);
+        uint64_t new_value = stream->recvstate.data_off + get_stream_receive_window(stream);
+        if (new_value < (uint64_t)stream->_send_aux.max_stream_data_sender.max_committed)
+            new_value = stream->_send_aux.max_stream_data_sender.max_committed;
         /* send */
         s->dst = quicly_encode_max_stream_data_frame(s->dst, stream->stream_id, new_value);
         /* register ack */
@@ -5401,7 +6061,11 @@ static quicly_error_t send_other_control_frames(quicly_conn_t *conn, quicly_send
         quicly_sent_t *sent;
         if ((ret = allocate_ack_eliciting_frame(conn, s, QUICLY_MAX_DATA_FRAME_CAPACITY, &sent, on_ack_max_data)) != 0)
             return ret;
-        uint64_t new_value = conn->ingress.max_data.bytes_consumed + conn->super.ctx->transport_params.max_data;
+        autotune_max_data_window(conn);
+        commit_max_data_window(conn);
+        uint64_t new_value = conn->ingress.max_data.bytes_consumed + conn->ingress.max_data.committed;
+        if (new_value < (uint64_t)conn->ingress.max_data.sender.max_committed)
+            new_value = conn->ingress.max_data.sender.max_committed;
         s->dst = quicly_encode_max_data_frame(s->dst, new_value);
         quicly_maxsender_record(&conn->ingress.max_data.sender, new_value, &sent->data.max_data.args);
         ++conn->super.stats.num_frames_sent.max_data;
@@ -5523,8 +6187,8 @@ static quicly_error_t do_send(quicly_conn_t *conn, quicly_send_context_t *s)
         uint64_t pacer_window = SIZE_MAX;
         if (conn->egress.pacer != NULL) {
             uint32_t bytes_per_msec = calc_pacer_send_rate(conn);
-            pacer_window =
-                quicly_pacer_get_window(conn->egress.pacer, conn->stash.now, bytes_per_msec, conn->egress.max_udp_payload_size);
+            pacer_window = quicly_pacer_get_window(conn->egress.pacer, conn->stash.now, bytes_per_msec,
+                                                   conn->egress.max_udp_payload_size, calc_pacer_burst(conn, bytes_per_msec));
         }
         s->send_window = calc_send_window(conn, min_packets_to_send * conn->egress.max_udp_payload_size,
                                           calc_amplification_limit_allowance(conn), pacer_window, restrict_sending);
@@ -5560,6 +6224,7 @@ static quicly_error_t do_send(quicly_conn_t *conn, quicly_send_context_t *s)
                 if ((ret = send_path_challenge(conn, s, 0, path->path_challenge.data)) != 0)
                     goto Exit;
                 path->path_challenge.num_sent += 1;
+                path->path_challenge.last_sent_at = conn->stash.now;
                 path->path_challenge.send_at =
                     conn->stash.now + ((3 * conn->super.ctx->loss.default_initial_rtt) << (path->path_challenge.num_sent - 1));
                 s->recalc_send_probe_at = 1;
@@ -5673,7 +6338,7 @@ Exit:
         ret = 0;
         /* when the buffer becomes full for the first time, try to use jumpstart; acting after the buffer becomes full does not
          * delay switch to jump start, assuming that the buffer provided by the caller of quicly_send is no greater than the burst
-         * size of the pacer (10 packets) */
+         * size of the pacer (10 packets, or the GSO batch size) */
         if (conn->egress.try_jumpstart && conn->egress.loss.rtt.minimum != UINT32_MAX) {
             conn->egress.try_jumpstart = 0;
             conn->super.stats.jumpstart.new_rtt = 0;
@@ -5754,7 +6419,7 @@ void quicly_send_datagram_frames(quicly_conn_t *conn, ptls_iovec_t *datagrams, s
         if (conn->egress.datagram_frame_payloads.count == PTLS_ELEMENTSOF(conn->egress.datagram_frame_payloads.payloads))
             break;
         void *copied;
-        if ((copied = malloc(datagrams[i].len)) == NULL)
+        if ((copied = quicly_alloc(conn->super.ctx->allocator, datagrams[i].len, QUICLY_ALLOC_TAG_DATAGRAM_FRAME)) == NULL)
             break;
         memcpy(copied, datagrams[i].base, datagrams[i].len);
         conn->egress.datagram_frame_payloads.payloads[conn->egress.datagram_frame_payloads.count++] =
@@ -5837,9 +6502,8 @@ quicly_error_t quicly_send(quicly_conn_t *conn, quicly_address_t *dest, quicly_a
 
     PTLS_LOG_DEFINE_POINT(quicly, send, send_logpoint);
     if (QUICLY_PROBE_ENABLED(SEND) ||
-        (ptls_log_point_maybe_active(&send_logpoint) & ptls_log_conn_maybe_active(ptls_get_log_state(conn->crypto.tls),
-                                                                                  (const char *(*)(void *))ptls_get_server_name,
-                                                                                  conn->crypto.tls)) != 0) {
+        (ptls_log_point_maybe_active(&send_logpoint) &
+         ptls_log_conn_maybe_active(quicly_get_log_state(conn), (const char *(*)(void *))quicly_get_server_name, conn)) != 0) {
         const quicly_cid_t *dcid = get_dcid(conn, 0);
         QUICLY_PROBE(SEND, conn, conn->stash.now, conn->super.state, QUICLY_PROBE_HEXDUMP(dcid->cid, dcid->len));
         QUICLY_LOG_CONN(send, conn, {
@@ -5913,11 +6577,13 @@ Exit:
 
 uint8_t quicly_send_get_ecn_bits(quicly_conn_t *conn)
 {
-    return conn->egress.ecn.state == QUICLY_ECN_OFF ? 0 : 2; /* NON-ECT or ECT(0) */
+    if (conn->egress.ecn.state == QUICLY_ECN_OFF)
+        return 0; /* NON-ECT */
+    return conn->egress.cc.type->cc_on_ecn_ce != NULL ? 1 : 2; /* ECT(1) for L4S, otherwise ECT(0) */
 }
 
-size_t quicly_send_close_invalid_token(quicly_context_t *ctx, uint32_t protocol_version, ptls_iovec_t dest_cid,
-                                       ptls_iovec_t src_cid, const char *err_desc, void *datagram)
+static size_t send_stateless_initial_close(quicly_context_t *ctx, uint32_t protocol_version, ptls_iovec_t dest_cid,
+                                           ptls_iovec_t src_cid, quicly_error_t err, const char *err_desc, void *datagram)
 {
     struct st_quicly_cipher_context_t egress = {};
     const quicly_salt_t *salt;
@@ -5946,8 +6612,7 @@ size_t quicly_send_close_invalid_token(quicly_context_t *ctx, uint32_t protocol_
     *dst++ = 0;        /* PN = 0 */
     *dst++ = 0;        /* ditto */
     uint8_t *payload_from = dst;
-    dst = quicly_encode_close_frame(dst, QUICLY_ERROR_GET_ERROR_CODE(QUICLY_TRANSPORT_ERROR_INVALID_TOKEN),
-                                    QUICLY_FRAME_TYPE_PADDING, err_desc);
+    dst = quicly_encode_close_frame(dst, QUICLY_ERROR_GET_ERROR_CODE(err), QUICLY_FRAME_TYPE_PADDING, err_desc);
 
     /* determine the size of the packet, make adjustments */
     dst += egress.aead->algo->tag_size;
@@ -5965,6 +6630,20 @@ size_t quicly_send_close_invalid_token(quicly_context_t *ctx, uint32_t protocol_
     return datagram_len;
 }
 
+size_t quicly_send_close_invalid_token(quicly_context_t *ctx, uint32_t protocol_version, ptls_iovec_t dest_cid,
+                                       ptls_iovec_t src_cid, const char *err_desc, void *datagram)
+{
+    return send_stateless_initial_close(ctx, protocol_version, dest_cid, src_cid, QUICLY_TRANSPORT_ERROR_INVALID_TOKEN, err_desc,
+                                        datagram);
+}
+
+size_t quicly_send_close_connection_refused(quicly_context_t *ctx, uint32_t protocol_version, ptls_iovec_t dest_cid,
+                                            ptls_iovec_t src_cid, const char *err_desc, void *datagram)
+{
+    return send_stateless_initial_close(ctx, protocol_version, dest_cid, src_cid, QUICLY_TRANSPORT_ERROR_CONNECTION_REFUSED,
+                                        err_desc, datagram);
+}
+
 size_t quicly_send_stateless_reset(quicly_context_t *ctx, const void *src_cid, void *payload)
 {
     uint8_t *base = payload;
@@ -5979,6 +6658,153 @@ size_t quicly_send_stateless_reset(quicly_context_t *ctx, const void *src_cid, v
     return QUICLY_STATELESS_RESET_PACKET_MIN_LEN;
 }
 
+static uint64_t stateless_ratelimit_hash(quicly_stateless_ratelimit_t *limiter, struct sockaddr *addr)
+{
+    const uint8_t *prefix = NULL;
+    size_t prefix_len = 0;
+    uint64_t h = limiter->key;
+
+    switch (addr->sa_family) {
+    case AF_INET:
+        prefix = (const uint8_t *)&((struct sockaddr_in *)addr)->sin_addr;
+        prefix_len = 3;
+        break;
+    case AF_INET6:
+        prefix = (const uint8_t *)&((struct sockaddr_in6 *)addr)->sin6_addr;
+        prefix_len = 6;
+        break;
+    default:
+        break;
+    }
+
+    /* FNV-1a using the key as the offset basis, followed by a finalizer that mixes the upper bits into the lower ones */
+    for (size_t i = 0; i < prefix_len; ++i)
+        h = (h ^ prefix[i]) * 0x100000001b3;
+    h ^= h >> 32;
+    h *= 0xbf58476d1ce4e5b9;
+    h ^= h >> 29;
+
+    return h;
+}
+
+void quicly_stateless_ratelimit_init(quicly_stateless_ratelimit_t *limiter, uint32_t rate, uint32_t burst, ptls_context_t *tls)
+{
+    memset(limiter, 0, sizeof(*limiter));
+    limiter->rate = rate;
+    limiter->burst = burst;
+    tls->random_bytes(&limiter->key, sizeof(limiter->key));
+}
+
+int quicly_stateless_ratelimit_consume(quicly_stateless_ratelimit_t *limiter, struct sockaddr *addr, int64_t now)
+{
+    struct st_quicly_stateless_ratelimit_bucket_t *bucket =
+        limiter->buckets + stateless_ratelimit_hash(limiter, addr) % QUICLY_STATELESS_RATELIMIT_NUM_BUCKETS;
+    uint64_t capacity = (uint64_t)limiter->burst * 1000;
+
+    /* refill; `rate` per second is `rate` thousandths per millisecond */
+    if (bucket->updated_at == 0) {
+        bucket->tokens = capacity;
+    } else if (now > bucket->updated_at) {
+        bucket->tokens += (uint64_t)(now - bucket->updated_at) * limiter->rate;
+        if (bucket->tokens > capacity)
+            bucket->tokens = capacity;
+    }
+    bucket->updated_at = now;
+
+    if (bucket->tokens < 1000) {
+        ++limiter->num_limited;
+        return 0;
+    }
+    bucket->tokens -= 1000;
+    return 1;
+}
+
+static int generate_stateless_reset_tokens(quicly_cid_encryptor_t *encryptor, void *const *tokens, const void *const *cids,
+                                           size_t count)
+{
+    if (encryptor->generate_stateless_reset_token_batch != NULL)
+        return encryptor->generate_stateless_reset_token_batch(encryptor, tokens, cids, count);
+
+    for (size_t i = 0; i < count; ++i)
+        if (!encryptor->generate_stateless_reset_token(encryptor, tokens[i], cids[i]))
+            return 0;
+    return 1;
+}
+
+size_t quicly_send_stateless_reset_batch(quicly_context_t *ctx, quicly_stateless_ratelimit_t *limiter, int64_t now,
+                                         const quicly_stateless_request_t *requests, size_t count, struct iovec *datagrams,
+                                         void *buf, size_t bufsize)
+{
+    uint8_t *dst = buf, *const end = dst + bufsize;
+    size_t num_built = 0;
+
+    for (size_t off = 0; off < count; off += QUICLY_STATELESS_RESET_BATCH_SIZE) {
+        size_t batch_end = count - off < QUICLY_STATELESS_RESET_BATCH_SIZE ? count : off + QUICLY_STATELESS_RESET_BATCH_SIZE,
+               num_tokens = 0;
+        void *tokens[QUICLY_STATELESS_RESET_BATCH_SIZE];
+        const void *cids[QUICLY_STATELESS_RESET_BATCH_SIZE];
+        uint8_t *batch_start = dst;
+
+        /* determine the packets to respond to, assigning space to each */
+        for (size_t i = off; i < batch_end; ++i) {
+            quicly_decoded_packet_t *packet = requests[i].packet;
+            datagrams[i] = (struct iovec){NULL};
+            if (QUICLY_PACKET_IS_LONG_HEADER(packet->octets.base[0]) ||
+                packet->datagram_size <= QUICLY_STATELESS_RESET_PACKET_MIN_LEN || end - dst < QUICLY_STATELESS_RESET_PACKET_MIN_LEN)
+                continue;
+            if (limiter != NULL && !quicly_stateless_ratelimit_consume(limiter, requests[i].addr, now))
+                continue;
+            datagrams[i] = (struct iovec){.iov_base = dst, .iov_len = QUICLY_STATELESS_RESET_PACKET_MIN_LEN};
+            tokens[num_tokens] = dst + QUICLY_STATELESS_RESET_PACKET_MIN_LEN - QUICLY_STATELESS_RESET_TOKEN_LEN;
+            cids[num_tokens] = packet->cid.dest.encrypted.base;
+            ++num_tokens;
+            dst += QUICLY_STATELESS_RESET_PACKET_MIN_LEN;
+        }
+        if (num_tokens == 0)
+            continue;
+
+        /* build the packets, generating the random bytes and the tokens at once */
+        ctx->tls->random_bytes(batch_start, dst - batch_start);
+        for (uint8_t *p = batch_start; p != dst; p += QUICLY_STATELESS_RESET_PACKET_MIN_LEN)
+            *p = (*p & ~QUICLY_LONG_HEADER_BIT) | QUICLY_QUIC_BIT;
+        if (!generate_stateless_reset_tokens(ctx->cid_encryptor, tokens, cids, num_tokens))
+            return SIZE_MAX;
+        num_built += num_tokens;
+    }
+
+    return num_built;
+}
+
+size_t quicly_send_version_negotiation_batch(quicly_context_t *ctx, quicly_stateless_ratelimit_t *limiter, int64_t now,
+                                             const quicly_stateless_request_t *requests, size_t count, const uint32_t *versions,
+                                             struct iovec *datagrams, void *buf, size_t bufsize)
+{
+    uint8_t *dst = buf, *const end = dst + bufsize;
+    size_t num_versions = 0, num_built = 0;
+
+    for (const uint32_t *v = versions; *v != 0; ++v)
+        ++num_versions;
+
+    for (size_t i = 0; i < count; ++i) {
+        quicly_decoded_packet_t *packet = requests[i].packet;
+        /* type_flags, version, CIDs, and the supported versions including the greasing one */
+        size_t len = 1 + 4 + 1 + packet->cid.src.len + 1 + packet->cid.dest.encrypted.len + (num_versions + 1) * 4;
+        datagrams[i] = (struct iovec){NULL};
+        if (!QUICLY_PACKET_IS_LONG_HEADER(packet->octets.base[0]) || packet->version == 0 ||
+            packet->datagram_size < QUICLY_MIN_CLIENT_INITIAL_SIZE || (size_t)(end - dst) < len)
+            continue;
+        if (limiter != NULL && !quicly_stateless_ratelimit_consume(limiter, requests[i].addr, now))
+            continue;
+        size_t built = quicly_send_version_negotiation(ctx, packet->cid.src, packet->cid.dest.encrypted, versions, dst);
+        assert(built == len);
+        datagrams[i] = (struct iovec){.iov_base = dst, .iov_len = built};
+        dst += built;
+        ++num_built;
+    }
+
+    return num_built;
+}
+
 quicly_error_t quicly_send_resumption_token(quicly_conn_t *conn)
 {
     assert(!quicly_is_client(conn));
@@ -6133,8 +6959,11 @@ static quicly_error_t handle_crypto_frame(quicly_conn_t *conn, struct st_quicly_
 
     if ((ret = quicly_decode_crypto_frame(&state->src, state->end, &frame)) != 0)
         return ret;
-    stream = quicly_get_stream(conn, -(quicly_stream_id_t)(1 + state->epoch));
-    assert(stream != NULL);
+    /* post-handshake messages (i.e., NewSessionTicket) are ignored once `quicly_hibernate` releases the TLS object */
+    if ((stream = quicly_get_stream(conn, -(quicly_stream_id_t)(1 + state->epoch))) == NULL) {
+        assert(conn->crypto.tls == NULL && state->epoch == QUICLY_EPOCH_1RTT);
+        return 0;
+    }
     return apply_stream_frame(stream, &frame);
 }
 
@@ -6203,6 +7032,7 @@ static quicly_error_t handle_ack_frame(quicly_conn_t *conn, struct st_quicly_han
         int64_t sent_at;
     } largest_newly_acked = {UINT64_MAX, INT64_MAX};
     size_t bytes_acked = 0;
+    quicly_delivery_rate_sample_t rate_sample;
     int includes_ack_eliciting = 0, includes_late_ack = 0;
     quicly_error_t ret;
 
@@ -6234,6 +7064,7 @@ static quicly_error_t handle_ack_frame(quicly_conn_t *conn, struct st_quicly_han
 
     if ((ret = init_acks_iter(conn, &iter)) != 0)
         return ret;
+    quicly_sentmap_init_rate_sample(&rate_sample);
 
     /* TODO log PNs being ACKed too late */
 
@@ -6292,6 +7123,7 @@ static quicly_error_t handle_ack_frame(quicly_conn_t *conn, struct st_quicly_han
                     bytes_acked += sent->cc_bytes_in_flight;
                     if (sent->cc_limited)
                         cc_limited = 1;
+                    quicly_sentmap_update_rate_sample(&conn->egress.loss.sentmap, &rate_sample, sent, conn->stash.now);
                 }
                 conn->super.stats.num_bytes.ack_received += sent->cc_bytes_in_flight;
             }
@@ -6335,9 +7167,16 @@ static quicly_error_t handle_ack_frame(quicly_conn_t *conn, struct st_quicly_han
 
     /* OnPacketAcked and OnPacketAckedCC */
     if (bytes_acked > 0) {
+        quicly_sentmap_generate_rate_sample(&conn->egress.loss.sentmap, &rate_sample, conn->egress.loss.rtt.minimum);
+        if (rate_sample.rate != 0) {
+            conn->egress.delivery_rate_sample.latest = rate_sample.rate;
+            if (!rate_sample.is_app_limited && conn->egress.delivery_rate_sample.max < rate_sample.rate)
+                conn->egress.delivery_rate_sample.max = rate_sample.rate;
+        }
         conn->egress.cc.type->cc_on_acked(&conn->egress.cc, &conn->egress.loss, (uint32_t)bytes_acked, frame.largest_acknowledged,
                                           (uint32_t)(conn->egress.loss.sentmap.bytes_in_flight + bytes_acked), cc_limited,
-                                          conn->egress.packet_number, conn->stash.now, conn->egress.max_udp_payload_size);
+                                          &rate_sample, conn->egress.packet_number, conn->stash.now,
+                                          conn->egress.max_udp_payload_size);
         QUICLY_PROBE(QUICTRACE_CC_ACK, conn, conn->stash.now, &conn->egress.loss.rtt, conn->egress.cc.cwnd,
                      conn->egress.loss.sentmap.bytes_in_flight);
     }
@@ -6358,18 +7197,22 @@ static quicly_error_t handle_ack_frame(quicly_conn_t *conn, struct st_quicly_han
 
     /* ECN */
     if (conn->egress.ecn.state != QUICLY_ECN_OFF && largest_newly_acked.pn != UINT64_MAX) {
-        /* if things look suspicious (ECT(1) count becoming non-zero), turn ECN off */
-        if (frame.ecn_counts[1] != 0)
+        /* index of the ECT codepoint being sent (see `quicly_send_get_ecn_bits`) within `ecn_counts` */
+        size_t ect_index = conn->egress.cc.type->cc_on_ecn_ce != NULL ? 1 : 0;
+
+        /* if things look suspicious (count of the ECT codepoint not being sent becoming non-zero), turn ECN off */
+        if (frame.ecn_counts[ect_index ^ 1] != 0)
             update_ecn_state(conn, QUICLY_ECN_OFF);
         /* TODO: maybe compare num_packets.acked vs. sum(ecn_counts) to see if any packet has been received as NON-ECT? */
 
         /* ECN validation succeeds if at least one packet is acked using one of the expected marks during the probing period */
-        if (conn->egress.ecn.state == QUICLY_ECN_PROBING && frame.ecn_counts[0] + frame.ecn_counts[2] > 0)
+        if (conn->egress.ecn.state == QUICLY_ECN_PROBING && frame.ecn_counts[ect_index] + frame.ecn_counts[2] > 0)
             update_ecn_state(conn, QUICLY_ECN_ON);
 
         /* check if congestion should be reported */
-        int report_congestion =
-            conn->egress.ecn.state != QUICLY_ECN_OFF && frame.ecn_counts[2] > conn->egress.ecn.counts[state->epoch][2];
+        uint64_t num_newly_ce = 0;
+        if (conn->egress.ecn.state != QUICLY_ECN_OFF && frame.ecn_counts[2] > conn->egress.ecn.counts[state->epoch][2])
+            num_newly_ce = frame.ecn_counts[2] - conn->egress.ecn.counts[state->epoch][2];
 
         /* update counters */
         for (size_t i = 0; i < PTLS_ELEMENTSOF(frame.ecn_counts); ++i) {
@@ -6379,12 +7222,20 @@ static quicly_error_t handle_ack_frame(quicly_conn_t *conn, struct st_quicly_han
             }
         }
 
-        /* report congestion */
-        if (report_congestion) {
+        /* report congestion; scalable CCs are notified of the number of marks, others treat them as a loss event */
+        if (num_newly_ce != 0) {
             QUICLY_PROBE(ECN_CONGESTION, conn, conn->stash.now, conn->super.stats.num_packets.acked_ecn_counts[2]);
             QUICLY_LOG_CONN(ecn_congestion, conn,
                             { PTLS_LOG_ELEMENT_UNSIGNED(ce_count, conn->super.stats.num_packets.acked_ecn_counts[2]); });
-            notify_congestion_to_cc(conn, 0, largest_newly_acked.pn);
+            if (conn->egress.cc.type->cc_on_ecn_ce != NULL) {
+                if (conn->egress.pn_path_start <= largest_newly_acked.pn)
+                    conn->egress.cc.type->cc_on_ecn_ce(&conn->egress.cc, &conn->egress.loss,
+                                                       num_newly_ce <= UINT32_MAX ? (uint32_t)num_newly_ce : UINT32_MAX,
+                                                       largest_newly_acked.pn, conn->egress.packet_number, conn->stash.now,
+                                                       conn->egress.max_udp_payload_size);
+            } else {
+                notify_congestion_to_cc(conn, 0, largest_newly_acked.pn);
+            }
         }
     }
 
@@ -6436,6 +7287,8 @@ static quicly_error_t handle_data_blocked_frame(quicly_conn_t *conn, struct st_q
     QUICLY_PROBE(DATA_BLOCKED_RECEIVE, conn, conn->stash.now, frame.offset);
     QUICLY_LOG_CONN(data_blocked_receive, conn, { PTLS_LOG_ELEMENT_UNSIGNED(off, frame.offset); });
 
+    /* the peer is being blocked; the window is too small for the current pace of transfer */
+    grow_max_data_window(conn, conn->ingress.max_data.window * 2);
     quicly_maxsender_request_transmit(&conn->ingress.max_data.sender);
     if (should_send_max_data(conn))
         conn->egress.pending_flows |= QUICLY_PENDING_FLOW_OTHERS_BIT;
@@ -6562,6 +7415,11 @@ static quicly_error_t handle_path_response_frame(quicly_conn_t *conn, struct st_
     if (ptls_mem_equal(path->path_challenge.data, frame.data, QUICLY_PATH_CHALLENGE_DATA_LEN)) {
         /* Path validation succeeded, stop sending PATH_CHALLENGEs. Active path might become changed in `quicly_receive`. */
         path->path_challenge.send_at = INT64_MAX;
+        /* Take an RTT sample, unless the response might be for a PATH_CHALLENGE other than the last one (cf. Karn's algorithm). */
+        if (path->path_challenge.num_sent == 1) {
+            int64_t rtt = conn->stash.now - path->path_challenge.last_sent_at;
+            path->rtt = rtt > 0 ? (rtt < UINT32_MAX ? (uint32_t)rtt : UINT32_MAX - 1) : 1;
+        }
         recalc_send_probe_at(conn);
         conn->super.stats.num_paths.validated += 1;
     }
@@ -7137,10 +7995,24 @@ static quicly_error_t handle_payload(quicly_conn_t *conn, size_t epoch, size_t p
             ++num_frames_ack_eliciting;
         if (!frame_handler->probing)
             ++num_frames_non_probing;
+        /* deliver batched stream data before handling a frame that might refer to the stream state, or before handling a STREAM
+         * frame when the batch is full; flushing at this point ensures that no stream being referred to is destroyed */
+        if (conn->stash.recv_batch.count != 0 &&
+            ((state.frame_type & ~(uint64_t)QUICLY_FRAME_TYPE_STREAM_BITS) != QUICLY_FRAME_TYPE_STREAM_BASE ||
+             conn->stash.recv_batch.count == PTLS_ELEMENTSOF(conn->stash.recv_batch.entries)) &&
+            (ret = flush_recv_batch(conn)) != 0)
+            break;
         if ((ret = frame_handler->cb(conn, &state)) != 0)
             break;
     } while (state.src != state.end);
 
+    if (ret == 0) {
+        if (conn->stash.recv_batch.count != 0)
+            ret = flush_recv_batch(conn);
+    } else {
+        conn->stash.recv_batch.count = 0;
+    }
+
     *is_ack_only = num_frames_ack_eliciting == 0;
     *is_probe_only = num_frames_non_probing == 0;
     if (ret != 0)
@@ -7177,12 +8049,15 @@ quicly_error_t quicly_accept(quicly_conn_t **conn, quicly_context_t *ctx, struct
         int alive;
     } cipher = {};
     ptls_iovec_t payload;
-    uint64_t next_expected_pn, pn, offending_frame_type = QUICLY_FRAME_TYPE_PADDING;
+    uint64_t next_expected_pn, pn, offending_frame_type = QUICLY_FRAME_TYPE_PADDING, admission_cpu_at = 0;
     int is_ack_only, is_probe_only;
     quicly_error_t ret;
 
     *conn = NULL;
 
+    if (ctx->admission != NULL)
+        admission_cpu_at = admission_get_cpu_usec();
+
     /* process initials only */
     if ((packet->octets.base[0] & QUICLY_PACKET_TYPE_BITMASK) != QUICLY_PACKET_TYPE_INITIAL) {
         ret = QUICLY_ERROR_PACKET_IGNORED;
@@ -7200,6 +8075,22 @@ quicly_error_t quicly_accept(quicly_conn_t **conn, quicly_context_t *ctx, struct
         ret = QUICLY_TRANSPORT_ERROR_PROTOCOL_VIOLATION;
         goto Exit;
     }
+    if (ctx->admission != NULL && ctx->admission->enforce) {
+        switch (quicly_admission_decide(ctx->admission, ctx->now->cb(ctx->now),
+                                        address_token != NULL && !address_token->address_mismatch)) {
+        case QUICLY_ADMISSION_ACCEPT:
+            break;
+        case QUICLY_ADMISSION_RETRY:
+            ret = QUICLY_ERROR_RETRY_REQUIRED;
+            goto Exit;
+        case QUICLY_ADMISSION_REFUSE:
+            ret = QUICLY_TRANSPORT_ERROR_CONNECTION_REFUSED;
+            goto Exit;
+        default:
+            ret = QUICLY_ERROR_PACKET_IGNORED;
+            goto Exit;
+        }
+    }
     if ((ret = setup_initial_encryption(get_aes128gcmsha256(ctx), &cipher.ingress, &cipher.egress, packet->cid.dest.encrypted, 0,
                                         ptls_iovec_init(salt->initial, sizeof(salt->initial)), NULL)) != 0)
         goto Exit;
@@ -7219,6 +8110,10 @@ quicly_error_t quicly_accept(quicly_conn_t **conn, quicly_context_t *ctx, struct
         goto Exit;
     }
     (*conn)->super.state = QUICLY_STATE_ACCEPTING;
+    if (ctx->admission != NULL) {
+        ++ctx->admission->num_handshakes;
+        (*conn)->admission_in_handshake = 1;
+    }
     quicly_set_cid(&(*conn)->super.original_dcid, packet->cid.dest.encrypted);
     if (address_token != NULL) {
         (*conn)->super.remote.address_validation.validated = !address_token->address_mismatch;
@@ -7242,6 +8137,9 @@ quicly_error_t quicly_accept(quicly_conn_t **conn, quicly_context_t *ctx, struct
             break;
         }
     }
+    /* when the client did not provide the properties of the path, use those observed by previous connections from the network */
+    if ((*conn)->super.stats.jumpstart.prev_rate == 0 && ctx->path_profile_cache != NULL)
+        apply_path_profile(*conn);
     if ((ret = setup_handshake_space_and_flow(*conn, QUICLY_EPOCH_INITIAL)) != 0)
         goto Exit;
     (*conn)->initial->super.next_expected_packet_number = next_expected_pn;
@@ -7309,6 +8207,8 @@ Exit:
         dispose_cipher(&cipher.ingress);
         dispose_cipher(&cipher.egress);
     }
+    if (ctx->admission != NULL)
+        admission_add_cpu_time(ctx->admission, ctx->now->cb(ctx->now), admission_get_cpu_usec() - admission_cpu_at);
     return ret;
 }
 
@@ -7440,8 +8340,9 @@ static quicly_error_t do_receive(quicly_conn_t *conn, struct sockaddr *dest_addr
                 goto Exit;
             }
             /* store token and ODCID */
-            free(conn->token.base);
-            if ((conn->token.base = malloc(packet->token.len)) == NULL) {
+            quicly_dealloc(conn->super.ctx->allocator, conn->token.base, conn->token.len, QUICLY_ALLOC_TAG_TOKEN);
+            conn->token = ptls_iovec_init(NULL, 0);
+            if ((conn->token.base = quicly_alloc(conn->super.ctx->allocator, packet->token.len, QUICLY_ALLOC_TAG_TOKEN)) == NULL) {
                 ret = PTLS_ERROR_NO_MEMORY;
                 goto Exit;
             }
@@ -7678,6 +8579,10 @@ quicly_error_t quicly_receive(quicly_conn_t *conn, struct sockaddr *dest_addr, s
 {
     lock_now(conn, 0);
 
+    /* measure the CPU time spent for handshakes, if necessary */
+    quicly_admission_t *admission = conn->admission_in_handshake ? conn->super.ctx->admission : NULL;
+    uint64_t admission_cpu_at = admission != NULL ? admission_get_cpu_usec() : 0;
+
     int might_be_reorder;
     quicly_error_t ret = do_receive(conn, dest_addr, src_addr, packet, -1, &might_be_reorder);
 
@@ -7687,7 +8592,8 @@ quicly_error_t quicly_receive(quicly_conn_t *conn, struct sockaddr *dest_addr, s
             compare_socket_address(&conn->paths[0]->address.remote.sa, src_addr) == 0) {
             /* instantiate the delayed packet */
             struct st_quicly_delayed_packet_t *delayed;
-            if ((delayed = malloc(offsetof(struct st_quicly_delayed_packet_t, bytes) + packet->octets.len)) == NULL) {
+            if ((delayed = quicly_alloc(conn->super.ctx->allocator, DELAYED_PACKET_SIZE(packet->octets.len),
+                                        QUICLY_ALLOC_TAG_DELAYED_PACKET)) == NULL) {
                 ret = PTLS_ERROR_NO_MEMORY;
                 goto Exit;
             }
@@ -7731,7 +8637,8 @@ quicly_error_t quicly_receive(quicly_conn_t *conn, struct sockaddr *dest_addr, s
                 int might_be_reorder;
                 ret = do_receive(conn, NULL, &conn->paths[0]->address.remote.sa, &delayed->packet, conn->stash.now - delayed->at,
                                  &might_be_reorder);
-                free(delayed);
+                quicly_dealloc(conn->super.ctx->allocator, delayed, DELAYED_PACKET_SIZE(delayed->packet.octets.len),
+                               QUICLY_ALLOC_TAG_DELAYED_PACKET);
                 switch (ret) {
                 case 0:
                     conn->super.stats.num_packets.delayed_used += 1;
@@ -7747,6 +8654,8 @@ quicly_error_t quicly_receive(quicly_conn_t *conn, struct sockaddr *dest_addr, s
     }
 
 Exit:
+    if (admission != NULL)
+        admission_add_cpu_time(admission, conn->stash.now, admission_get_cpu_usec() - admission_cpu_at);
     unlock_now(conn);
     return ret;
 }
@@ -8188,8 +9097,7 @@ void quicly__debug_printf(quicly_conn_t *conn, const char *function, int line, c
     PTLS_LOG_DEFINE_POINT(quicly, debug_message, debug_message_logpoint);
     if (QUICLY_PROBE_ENABLED(DEBUG_MESSAGE) ||
         (ptls_log_point_maybe_active(&debug_message_logpoint) &
-         ptls_log_conn_maybe_active(ptls_get_log_state(conn->crypto.tls), (const char *(*)(void *))ptls_get_server_name,
-                                    conn->crypto.tls)) != 0) {
+         ptls_log_conn_maybe_active(quicly_get_log_state(conn), (const char *(*)(void *))quicly_get_server_name, conn)) != 0) {
         char buf[1024];
         va_list args;
 
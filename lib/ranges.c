@@ -43,13 +43,13 @@ static int insert_at(quicly_ranges_t *ranges, uint64_t start, uint64_t end, size
 {
     if (ranges->num_ranges == ranges->capacity) {
         size_t new_capacity = ranges->capacity < 4 ? 4 : ranges->capacity * 2;
-        quicly_range_t *new_ranges = malloc(new_capacity * sizeof(*new_ranges));
+        quicly_range_t *new_ranges = quicly_alloc(ranges->allocator, new_capacity * sizeof(*new_ranges), QUICLY_ALLOC_TAG_RANGES);
         if (new_ranges == NULL)
             return PTLS_ERROR_NO_MEMORY;
         COPY(new_ranges, ranges->ranges, slot);
         COPY(new_ranges + slot + 1, ranges->ranges + slot, ranges->num_ranges - slot);
         if (ranges->ranges != &ranges->_initial)
-            free(ranges->ranges);
+            quicly_dealloc(ranges->allocator, ranges->ranges, ranges->capacity * sizeof(*new_ranges), QUICLY_ALLOC_TAG_RANGES);
         ranges->ranges = new_ranges;
         ranges->capacity = new_capacity;
     } else {
@@ -68,7 +68,8 @@ void quicly_ranges_drop_by_range_indices(quicly_ranges_t *ranges, size_t begin_r
     ranges->num_ranges -= end_range_index - begin_range_index;
     if (ranges->capacity > 4 && ranges->num_ranges * 3 <= ranges->capacity) {
         size_t new_capacity = ranges->capacity / 2;
-        quicly_range_t *new_ranges = realloc(ranges->ranges, new_capacity * sizeof(*new_ranges));
+        quicly_range_t *new_ranges = quicly_realloc(ranges->allocator, ranges->ranges, ranges->capacity * sizeof(*new_ranges),
+                                                    new_capacity * sizeof(*new_ranges), QUICLY_ALLOC_TAG_RANGES);
         if (new_ranges != NULL) {
             ranges->ranges = new_ranges;
             ranges->capacity = new_capacity;
@@ -76,6 +77,27 @@ void quicly_ranges_drop_by_range_indices(quicly_ranges_t *ranges, size_t begin_r
     }
 }
 
+void quicly_ranges_shrink(quicly_ranges_t *ranges)
+{
+    if (ranges->ranges == &ranges->_initial || ranges->num_ranges == ranges->capacity)
+        return;
+
+    if (ranges->num_ranges <= 1) {
+        if (ranges->num_ranges != 0)
+            ranges->_initial = ranges->ranges[0];
+        quicly_dealloc(ranges->allocator, ranges->ranges, ranges->capacity * sizeof(*ranges->ranges), QUICLY_ALLOC_TAG_RANGES);
+        ranges->ranges = &ranges->_initial;
+        ranges->capacity = 1;
+    } else {
+        quicly_range_t *new_ranges = quicly_realloc(ranges->allocator, ranges->ranges, ranges->capacity * sizeof(*new_ranges),
+                                                    ranges->num_ranges * sizeof(*new_ranges), QUICLY_ALLOC_TAG_RANGES);
+        if (new_ranges != NULL) {
+            ranges->ranges = new_ranges;
+            ranges->capacity = ranges->num_ranges;
+        }
+    }
+}
+
 static inline int merge_update(quicly_ranges_t *ranges, uint64_t start, uint64_t end, size_t slot, size_t end_slot)
 {
     if (start < ranges->ranges[slot].start)
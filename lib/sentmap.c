@@ -64,7 +64,7 @@ static struct st_quicly_sent_block_t **free_block(quicly_sentmap_t *map, struct
         ref = (struct st_quicly_sent_block_t **)&dummy_ref;
     }
 
-    free(block);
+    quicly_dealloc(map->allocator, block, sizeof(*block), QUICLY_ALLOC_TAG_SENTMAP);
     return ref;
 }
 
@@ -88,14 +88,63 @@ void quicly_sentmap_dispose(quicly_sentmap_t *map)
 
     while ((block = map->head) != NULL) {
         map->head = block->next;
-        free(block);
+        quicly_dealloc(map->allocator, block, sizeof(*block), QUICLY_ALLOC_TAG_SENTMAP);
     }
+    quicly_dealloc(map->allocator, map->rate.packets, map->rate.capacity * sizeof(*map->rate.packets), QUICLY_ALLOC_TAG_SENTMAP);
+}
+
+void quicly_sentmap_shrink(quicly_sentmap_t *map)
+{
+    if (map->head != NULL)
+        return;
+    quicly_dealloc(map->allocator, map->rate.packets, map->rate.capacity * sizeof(*map->rate.packets), QUICLY_ALLOC_TAG_SENTMAP);
+    map->rate.packets = NULL;
+    map->rate.capacity = 0;
+}
+
+/**
+ * Grows `rate.packets` so that the slot for `packet_number` does not collide with those of the packets retained by the map.
+ */
+static quicly_error_t reserve_rate(quicly_sentmap_t *map, uint64_t packet_number)
+{
+    quicly_sentmap_iter_t iter;
+    uint64_t oldest;
+
+    quicly_sentmap_init_iter(map, &iter);
+    oldest = quicly_sentmap_get(&iter)->packet_number;
+    if (oldest > packet_number)
+        oldest = packet_number;
+    if (packet_number - oldest < map->rate.capacity)
+        return 0;
+
+    size_t new_capacity = map->rate.capacity != 0 ? map->rate.capacity * 2 : 16;
+    while (new_capacity <= packet_number - oldest)
+        new_capacity *= 2;
+    quicly_sent_rate_t *new_packets;
+    if ((new_packets = quicly_alloc(map->allocator, new_capacity * sizeof(*new_packets), QUICLY_ALLOC_TAG_SENTMAP)) == NULL)
+        return PTLS_ERROR_NO_MEMORY;
+
+    /* move the state of the packets being inflight */
+    for (; iter.p != &quicly_sentmap__end_iter; quicly_sentmap_skip(&iter)) {
+        const quicly_sent_packet_t *packet = quicly_sentmap_get(&iter);
+        if (packet->cc_bytes_in_flight != 0)
+            new_packets[packet->packet_number & (new_capacity - 1)] = *quicly_sentmap__get_rate(map, packet);
+    }
+
+    quicly_dealloc(map->allocator, map->rate.packets, map->rate.capacity * sizeof(*map->rate.packets), QUICLY_ALLOC_TAG_SENTMAP);
+    map->rate.packets = new_packets;
+    map->rate.capacity = new_capacity;
+    return 0;
 }
 
 quicly_error_t quicly_sentmap_prepare(quicly_sentmap_t *map, uint64_t packet_number, int64_t now, uint8_t ack_epoch)
 {
+    quicly_error_t ret;
+
     assert(map->_pending_packet == NULL);
 
+    if ((ret = reserve_rate(map, packet_number)) != 0)
+        return ret;
     if ((map->_pending_packet = quicly_sentmap_allocate(map, quicly_sentmap__type_packet)) == NULL)
         return PTLS_ERROR_NO_MEMORY;
     map->_pending_packet->data.packet = (quicly_sent_packet_t){packet_number, now, ack_epoch};
@@ -106,7 +155,7 @@ struct st_quicly_sent_block_t *quicly_sentmap__new_block(quicly_sentmap_t *map)
 {
     struct st_quicly_sent_block_t *block;
 
-    if ((block = malloc(sizeof(*block))) == NULL)
+    if ((block = quicly_alloc(map->allocator, sizeof(*block), QUICLY_ALLOC_TAG_SENTMAP)) == NULL)
         return NULL;
 
     block->next = NULL;
@@ -168,6 +217,52 @@ quicly_error_t quicly_sentmap_update(quicly_sentmap_t *map, quicly_sentmap_iter_
     return ret;
 }
 
+void quicly_sentmap_update_rate_sample(quicly_sentmap_t *map, quicly_delivery_rate_sample_t *rs, const quicly_sent_packet_t *packet,
+                                       int64_t now)
+{
+    /* skip packets that do not carry delivery state (i.e., not ack-eliciting, or already deemed lost) */
+    if (packet->cc_bytes_in_flight == 0)
+        return;
+
+    const quicly_sent_rate_t *rate = quicly_sentmap__get_rate(map, packet);
+
+    /* reconstruct the 64-bit value of `delivered` at the moment the packet was sent, then update the connection-level state */
+    uint64_t packet_delivered = map->rate.delivered - (uint32_t)((uint32_t)map->rate.delivered - rate->delivered);
+    map->rate.delivered += packet->cc_bytes_in_flight;
+    map->rate.delivered_time = now;
+
+    /* use the most recently sent packet for building the sample */
+    if (rs->_prior_time == INT64_MIN || packet_delivered >= rs->_prior_delivered) {
+        rs->_prior_delivered = packet_delivered;
+        rs->_prior_time = packet->sent_at - rate->delivered_time_delta;
+        rs->is_app_limited = packet->app_limited;
+        rs->_send_elapsed = rate->first_sent_time_delta;
+        rs->_ack_elapsed = quicly_sentmap__time_delta(now, rs->_prior_time);
+        map->rate.first_sent_time = packet->sent_at;
+    }
+}
+
+void quicly_sentmap_generate_rate_sample(quicly_sentmap_t *map, quicly_delivery_rate_sample_t *rs, uint32_t min_rtt)
+{
+    /* clear the app-limited marker once the bubble has been acknowledged */
+    if (map->rate.app_limited != 0 && map->rate.delivered > map->rate.app_limited)
+        map->rate.app_limited = 0;
+
+    rs->rate = 0;
+    rs->delivered = 0;
+    rs->interval = 0;
+    if (rs->_prior_time == INT64_MIN)
+        return;
+
+    /* Use the longer of the send and ack intervals so that ACK compression would not lead to overestimation. Intervals shorter
+     * than min RTT are ignored, as they are likely to be caused by spurious retransmissions or by ACK decimation. */
+    rs->interval = rs->_send_elapsed > rs->_ack_elapsed ? rs->_send_elapsed : rs->_ack_elapsed;
+    rs->delivered = map->rate.delivered - rs->_prior_delivered;
+    if (rs->interval == 0 || rs->interval < min_rtt)
+        return;
+    rs->rate = rs->delivered * 1000 / rs->interval;
+}
+
 quicly_error_t quicly_sentmap__type_packet(quicly_sentmap_t *map, const quicly_sent_packet_t *packet, int acked,
                                            quicly_sent_t *sent)
 {
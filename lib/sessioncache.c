@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2026 Fastly
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "quicly/linklist.h"
+#include "quicly/sessioncache.h"
+
+#define QUICLY_REPLAY_FILTER_BITS_PER_ENTRY 16
+#define QUICLY_REPLAY_FILTER_NUM_HASHES 7
+
+struct st_quicly_ticket_store_entry_t {
+    quicly_linklist_t link;
+    uint32_t hash;
+    int64_t expires_at;
+    ptls_iovec_t ticket;
+    size_t key_len;
+    uint8_t key[1];
+};
+
+struct st_quicly_ticket_store_t {
+    size_t capacity_per_shard;
+    size_t num_shards;
+    struct st_quicly_ticket_store_shard_t {
+        pthread_mutex_t mutex;
+        /**
+         * list of entries, the oldest first
+         */
+        quicly_linklist_t entries;
+        size_t num_entries;
+    } shards[1];
+};
+
+struct st_quicly_replay_filter_t {
+    uint64_t key[2];
+    int64_t window;
+    size_t num_shards;
+    size_t bits_per_shard;
+    /**
+     * memory being allocated for the Bloom filters of all the shards
+     */
+    uint64_t *bits;
+    struct st_quicly_replay_filter_shard_t {
+        pthread_mutex_t mutex;
+        /**
+         * when the current Bloom filter started recording
+         */
+        int64_t window_start;
+        uint64_t *current;
+        uint64_t *previous;
+    } shards[1];
+};
+
+static uint32_t hash_key(ptls_iovec_t key)
+{
+    /* FNV-1a */
+    uint32_t hash = 2166136261;
+    for (size_t i = 0; i < key.len; ++i)
+        hash = (hash ^ key.base[i]) * 16777619;
+    return hash;
+}
+
+static struct st_quicly_ticket_store_entry_t *ticket_store_entry_from_link(quicly_linklist_t *link)
+{
+    return (void *)((char *)link - offsetof(struct st_quicly_ticket_store_entry_t, link));
+}
+
+static void free_ticket_store_entry(struct st_quicly_ticket_store_shard_t *shard, struct st_quicly_ticket_store_entry_t *entry)
+{
+    quicly_linklist_unlink(&entry->link);
+    --shard->num_entries;
+    free(entry->ticket.base);
+    free(entry);
+}
+
+quicly_ticket_store_t *quicly_new_ticket_store(size_t capacity, size_t num_shards)
+{
+    quicly_ticket_store_t *store;
+
+    if (num_shards == 0)
+        num_shards = 1;
+
+    if ((store = malloc(offsetof(quicly_ticket_store_t, shards) + sizeof(store->shards[0]) * num_shards)) == NULL)
+        return NULL;
+    store->capacity_per_shard = (capacity + num_shards - 1) / num_shards;
+    if (store->capacity_per_shard == 0)
+        store->capacity_per_shard = 1;
+    store->num_shards = num_shards;
+    for (size_t i = 0; i < num_shards; ++i) {
+        pthread_mutex_init(&store->shards[i].mutex, NULL);
+        quicly_linklist_init(&store->shards[i].entries);
+        store->shards[i].num_entries = 0;
+    }
+
+    return store;
+}
+
+void quicly_free_ticket_store(quicly_ticket_store_t *store)
+{
+    for (size_t i = 0; i < store->num_shards; ++i) {
+        struct st_quicly_ticket_store_shard_t *shard = store->shards + i;
+        while (quicly_linklist_is_linked(&shard->entries))
+            free_ticket_store_entry(shard, ticket_store_entry_from_link(shard->entries.next));
+        pthread_mutex_destroy(&shard->mutex);
+    }
+    free(store);
+}
+
+int quicly_ticket_store_save(quicly_ticket_store_t *store, ptls_iovec_t key, ptls_iovec_t ticket, int64_t expires_at)
+{
+    struct st_quicly_ticket_store_entry_t *entry;
+
+    /* build the entry outside the lock */
+    if ((entry = malloc(offsetof(struct st_quicly_ticket_store_entry_t, key) + key.len)) == NULL)
+        return PTLS_ERROR_NO_MEMORY;
+    if ((entry->ticket.base = malloc(ticket.len != 0 ? ticket.len : 1)) == NULL) {
+        free(entry);
+        return PTLS_ERROR_NO_MEMORY;
+    }
+    memcpy(entry->ticket.base, ticket.base, ticket.len);
+    entry->ticket.len = ticket.len;
+    quicly_linklist_init(&entry->link);
+    entry->hash = hash_key(key);
+    entry->expires_at = expires_at;
+    entry->key_len = key.len;
+    memcpy(entry->key, key.base, key.len);
+
+    struct st_quicly_ticket_store_shard_t *shard = store->shards + entry->hash % store->num_shards;
+
+    pthread_mutex_lock(&shard->mutex);
+
+    if (shard->num_entries >= store->capacity_per_shard)
+        free_ticket_store_entry(shard, ticket_store_entry_from_link(shard->entries.next));
+    quicly_linklist_insert(shard->entries.prev, &entry->link);
+    ++shard->num_entries;
+
+    pthread_mutex_unlock(&shard->mutex);
+
+    return 0;
+}
+
+ptls_iovec_t quicly_ticket_store_take(quicly_ticket_store_t *store, ptls_iovec_t key, int64_t now)
+{
+    uint32_t hash = hash_key(key);
+    struct st_quicly_ticket_store_shard_t *shard = store->shards + hash % store->num_shards;
+    ptls_iovec_t ticket = {NULL};
+
+    pthread_mutex_lock(&shard->mutex);
+
+    /* scan from the newest, discarding the expired entries being found */
+    for (quicly_linklist_t *link = shard->entries.prev, *prev; link != &shard->entries; link = prev) {
+        struct st_quicly_ticket_store_entry_t *entry = ticket_store_entry_from_link(link);
+        prev = link->prev;
+        if (entry->expires_at <= now) {
+            free_ticket_store_entry(shard, entry);
+            continue;
+        }
+        if (entry->hash == hash && entry->key_len == key.len && memcmp(entry->key, key.base, key.len) == 0) {
+            ticket = entry->ticket;
+            entry->ticket = ptls_iovec_init(NULL, 0);
+            free_ticket_store_entry(shard, entry);
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&shard->mutex);
+
+    return ticket;
+}
+
+quicly_replay_filter_t *quicly_new_replay_filter(size_t capacity, int64_t window, size_t num_shards,
+                                                 void (*random_bytes)(void *, size_t))
+{
+    quicly_replay_filter_t *filter;
+
+    assert(window > 0);
+
+    if (num_shards == 0)
+        num_shards = 1;
+    /* number of bits per shard, rounded up to a multiple of 64 */
+    size_t bits_per_shard = ((capacity + num_shards - 1) / num_shards * QUICLY_REPLAY_FILTER_BITS_PER_ENTRY + 63) / 64 * 64;
+    if (bits_per_shard == 0)
+        bits_per_shard = 64;
+
+    if ((filter = malloc(offsetof(quicly_replay_filter_t, shards) + sizeof(filter->shards[0]) * num_shards)) == NULL)
+        return NULL;
+    if ((filter->bits = calloc(num_shards * 2, bits_per_shard / 8)) == NULL) {
+        free(filter);
+        return NULL;
+    }
+    random_bytes(filter->key, sizeof(filter->key));
+    filter->window = window;
+    filter->num_shards = num_shards;
+    filter->bits_per_shard = bits_per_shard;
+    for (size_t i = 0; i < num_shards; ++i) {
+        struct st_quicly_replay_filter_shard_t *shard = filter->shards + i;
+        pthread_mutex_init(&shard->mutex, NULL);
+        shard->window_start = 0;
+        shard->current = filter->bits + bits_per_shard / 64 * i * 2;
+        shard->previous = shard->current + bits_per_shard / 64;
+    }
+
+    return filter;
+}
+
+void quicly_free_replay_filter(quicly_replay_filter_t *filter)
+{
+    for (size_t i = 0; i < filter->num_shards; ++i)
+        pthread_mutex_destroy(&filter->shards[i].mutex);
+    free(filter->bits);
+    free(filter);
+}
+
+static uint64_t replay_filter_mix(uint64_t x)
+{
+    /* finalizer of splitmix64 */
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+    return x ^ (x >> 31);
+}
+
+static int replay_filter_test_bits(const uint64_t *bits, const size_t *indices)
+{
+    for (size_t i = 0; i < QUICLY_REPLAY_FILTER_NUM_HASHES; ++i)
+        if ((bits[indices[i] / 64] & ((uint64_t)1 << (indices[i] % 64))) == 0)
+            return 0;
+    return 1;
+}
+
+int quicly_replay_filter_test_and_set(quicly_replay_filter_t *filter, ptls_iovec_t id, int64_t now)
+{
+    size_t indices[QUICLY_REPLAY_FILTER_NUM_HASHES];
+    uint64_t h1, h2;
+    int found;
+
+    { /* calculate the hashes outside the lock; FNV-1a keyed by the random key, then mixed for use with double hashing */
+        uint64_t hash = 14695981039346656037u ^ filter->key[0];
+        for (size_t i = 0; i < id.len; ++i)
+            hash = (hash ^ id.base[i]) * 1099511628211;
+        h1 = replay_filter_mix(hash);
+        h2 = replay_filter_mix(h1 ^ filter->key[1]) | 1;
+    }
+    struct st_quicly_replay_filter_shard_t *shard = filter->shards + (h1 >> 32) % filter->num_shards;
+    for (size_t i = 0; i < QUICLY_REPLAY_FILTER_NUM_HASHES; ++i)
+        indices[i] = (h1 + i * h2) % filter->bits_per_shard;
+
+    pthread_mutex_lock(&shard->mutex);
+
+    /* rotate the filters when the current window ends; both are cleared if the previous window has ended as well */
+    if (now - shard->window_start >= filter->window) {
+        uint64_t *tmp = shard->previous;
+        shard->previous = shard->current;
+        shard->current = tmp;
+        memset(shard->current, 0, filter->bits_per_shard / 8);
+        if (now - shard->window_start >= filter->window * 2)
+            memset(shard->previous, 0, filter->bits_per_shard / 8);
+        shard->window_start = now;
+    }
+
+    found = replay_filter_test_bits(shard->current, indices) || replay_filter_test_bits(shard->previous, indices);
+    for (size_t i = 0; i < QUICLY_REPLAY_FILTER_NUM_HASHES; ++i)
+        shard->current[indices[i] / 64] |= (uint64_t)1 << (indices[i] % 64);
+
+    pthread_mutex_unlock(&shard->mutex);
+
+    return found;
+}
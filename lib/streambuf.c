@@ -22,8 +22,46 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include "quicly/streambuf.h"
 
+/**
+ * payload of the vector used by `quicly_sendbuf_write`, holding a copy of the data being written
+ */
+struct st_quicly_sendbuf_raw_vec_t {
+    quicly_allocator_t *allocator;
+    uint8_t bytes[1];
+};
+
+struct st_quicly_sendbuf_file_vec_t {
+    quicly_allocator_t *allocator;
+    int fd;
+    /**
+     * offset within the file that corresponds to the beginning of the vector
+     */
+    uint64_t file_off;
+    /**
+     * the region being mapped; `base` is NULL if nothing is mapped
+     */
+    struct {
+        uint8_t *base;
+        /**
+         * offset within the file that corresponds to `base` (always page-aligned)
+         */
+        uint64_t file_off;
+        size_t len;
+    } map;
+    /**
+     * offset within the file up to which the kernel has been advised to read ahead
+     */
+    uint64_t advised_until;
+    /**
+     * number of bytes at the front of the vector that have been retired
+     */
+    uint64_t retired;
+};
+
 static void convert_error(quicly_stream_t *stream, quicly_error_t err)
 {
     assert(err != 0);
@@ -47,7 +85,7 @@ void quicly_sendbuf_dispose(quicly_sendbuf_t *sb)
         if (vec->cb->discard_vec != NULL)
             vec->cb->discard_vec(vec);
     }
-    free(sb->vecs.entries);
+    quicly_dealloc(sb->allocator, sb->vecs.entries, sb->vecs.capacity * sizeof(*sb->vecs.entries), QUICLY_ALLOC_TAG_STREAMBUF);
 }
 
 void quicly_sendbuf_shift(quicly_stream_t *stream, quicly_sendbuf_t *sb, size_t delta)
@@ -60,6 +98,8 @@ void quicly_sendbuf_shift(quicly_stream_t *stream, quicly_sendbuf_t *sb, size_t
         size_t bytes_in_first_vec = first_vec->len - sb->off_in_first_vec;
         if (delta < bytes_in_first_vec) {
             sb->off_in_first_vec += delta;
+            if (first_vec->cb->shift_vec != NULL)
+                first_vec->cb->shift_vec(first_vec, sb->off_in_first_vec);
             break;
         }
         delta -= bytes_in_first_vec;
@@ -72,7 +112,8 @@ void quicly_sendbuf_shift(quicly_stream_t *stream, quicly_sendbuf_t *sb, size_t
             memmove(sb->vecs.entries, sb->vecs.entries + i, (sb->vecs.size - i) * sizeof(*sb->vecs.entries));
             sb->vecs.size -= i;
         } else {
-            free(sb->vecs.entries);
+            quicly_dealloc(sb->allocator, sb->vecs.entries, sb->vecs.capacity * sizeof(*sb->vecs.entries),
+                           QUICLY_ALLOC_TAG_STREAMBUF);
             sb->vecs.entries = NULL;
             sb->vecs.size = 0;
             sb->vecs.capacity = 0;
@@ -118,39 +159,191 @@ void quicly_sendbuf_emit(quicly_stream_t *stream, quicly_sendbuf_t *sb, size_t o
     }
 }
 
+static size_t raw_vec_size(size_t len)
+{
+    return offsetof(struct st_quicly_sendbuf_raw_vec_t, bytes) + len;
+}
+
 static quicly_error_t flatten_raw(quicly_sendbuf_vec_t *vec, void *dst, size_t off, size_t len)
 {
-    memcpy(dst, (uint8_t *)vec->cbdata + off, len);
+    struct st_quicly_sendbuf_raw_vec_t *rv = vec->cbdata;
+
+    memcpy(dst, rv->bytes + off, len);
     return 0;
 }
 
 static void discard_raw(quicly_sendbuf_vec_t *vec)
 {
-    free(vec->cbdata);
+    struct st_quicly_sendbuf_raw_vec_t *rv = vec->cbdata;
+
+    quicly_dealloc(rv->allocator, rv, raw_vec_size(vec->len), QUICLY_ALLOC_TAG_STREAMBUF);
 }
 
 int quicly_sendbuf_write(quicly_stream_t *stream, quicly_sendbuf_t *sb, const void *src, size_t len)
 {
     static const quicly_streambuf_sendvec_callbacks_t raw_callbacks = {flatten_raw, discard_raw};
-    quicly_sendbuf_vec_t vec = {&raw_callbacks, len, NULL};
+    struct st_quicly_sendbuf_raw_vec_t *rv;
     int ret;
 
     assert(quicly_sendstate_is_open(&stream->sendstate));
 
-    if ((vec.cbdata = malloc(len)) == NULL) {
-        ret = PTLS_ERROR_NO_MEMORY;
-        goto Error;
-    }
-    memcpy(vec.cbdata, src, len);
+    if ((rv = quicly_alloc(sb->allocator, raw_vec_size(len), QUICLY_ALLOC_TAG_STREAMBUF)) == NULL)
+        return PTLS_ERROR_NO_MEMORY;
+    rv->allocator = sb->allocator;
+    memcpy(rv->bytes, src, len);
+    quicly_sendbuf_vec_t vec = {&raw_callbacks, len, rv};
     if ((ret = quicly_sendbuf_write_vec(stream, sb, &vec)) != 0)
         goto Error;
     return 0;
 
 Error:
-    free(vec.cbdata);
+    quicly_dealloc(sb->allocator, rv, raw_vec_size(len), QUICLY_ALLOC_TAG_STREAMBUF);
     return ret;
 }
 
+static size_t get_page_size(void)
+{
+    static size_t page_size;
+
+    if (page_size == 0)
+        page_size = (size_t)sysconf(_SC_PAGESIZE);
+    return page_size;
+}
+
+static void file_vec_unmap(struct st_quicly_sendbuf_file_vec_t *fv)
+{
+    if (fv->map.base != NULL) {
+        munmap(fv->map.base, fv->map.len);
+        fv->map.base = NULL;
+    }
+}
+
+/**
+ * Maps a window that covers the region being requested. The window starts from the oldest byte that has not been retired so that
+ * retransmissions can be served from the same window, unless doing so would prevent the window from covering the requested region.
+ */
+static quicly_error_t file_vec_map(struct st_quicly_sendbuf_file_vec_t *fv, size_t vec_len, size_t off, size_t len)
+{
+    uint64_t start = fv->retired, end;
+    void *base;
+
+    if (off < start || off + len - start > QUICLY_SENDBUF_FILE_WINDOW_SIZE)
+        start = off;
+    end = start + QUICLY_SENDBUF_FILE_WINDOW_SIZE;
+    if (end < off + len)
+        end = off + len;
+    if (end > vec_len)
+        end = vec_len;
+
+    file_vec_unmap(fv);
+
+    uint64_t file_start = (fv->file_off + start) & ~(uint64_t)(get_page_size() - 1);
+    size_t map_len = fv->file_off + end - file_start;
+    if ((base = mmap(NULL, map_len, PROT_READ, MAP_SHARED, fv->fd, (off_t)file_start)) == MAP_FAILED)
+        return QUICLY_TRANSPORT_ERROR_INTERNAL;
+    posix_madvise(base, map_len, POSIX_MADV_SEQUENTIAL);
+
+    fv->map.base = base;
+    fv->map.file_off = file_start;
+    fv->map.len = map_len;
+    fv->advised_until = file_start;
+
+    return 0;
+}
+
+static quicly_error_t flatten_file(quicly_sendbuf_vec_t *vec, void *dst, size_t off, size_t len)
+{
+    struct st_quicly_sendbuf_file_vec_t *fv = vec->cbdata;
+    uint64_t file_pos = fv->file_off + off;
+    quicly_error_t ret;
+
+    /* map a new window unless the requested region is covered by the current one */
+    if (fv->map.base == NULL || file_pos < fv->map.file_off || fv->map.file_off + fv->map.len < file_pos + len) {
+        if ((ret = file_vec_map(fv, vec->len, off, len)) != 0)
+            return ret;
+    }
+
+    /* when the send cursor is approaching the end of the region being read ahead, ask the kernel to read the next chunk */
+    if (fv->advised_until < file_pos + len + QUICLY_SENDBUF_FILE_READAHEAD_SIZE / 2) {
+        uint64_t advise_from = fv->advised_until > file_pos ? fv->advised_until : file_pos,
+                 advise_to = file_pos + len + QUICLY_SENDBUF_FILE_READAHEAD_SIZE;
+        advise_from &= ~(uint64_t)(get_page_size() - 1);
+        if (advise_to > fv->map.file_off + fv->map.len)
+            advise_to = fv->map.file_off + fv->map.len;
+        if (advise_from < advise_to)
+            posix_madvise(fv->map.base + (advise_from - fv->map.file_off), advise_to - advise_from, POSIX_MADV_WILLNEED);
+        fv->advised_until = advise_to;
+    }
+
+    memcpy(dst, fv->map.base + (file_pos - fv->map.file_off), len);
+    return 0;
+}
+
+static void discard_file(quicly_sendbuf_vec_t *vec)
+{
+    struct st_quicly_sendbuf_file_vec_t *fv = vec->cbdata;
+
+    file_vec_unmap(fv);
+    close(fv->fd);
+    quicly_dealloc(fv->allocator, fv, sizeof(*fv), QUICLY_ALLOC_TAG_STREAMBUF);
+}
+
+static void shift_file(quicly_sendbuf_vec_t *vec, size_t off)
+{
+    struct st_quicly_sendbuf_file_vec_t *fv = vec->cbdata;
+
+    fv->retired = off;
+
+    /* unmap the pages that have been retired */
+    if (fv->map.base != NULL) {
+        uint64_t retired_until = (fv->file_off + off) & ~(uint64_t)(get_page_size() - 1);
+        if (fv->map.file_off < retired_until) {
+            size_t delta = retired_until - fv->map.file_off;
+            if (delta >= fv->map.len) {
+                file_vec_unmap(fv);
+            } else {
+                munmap(fv->map.base, delta);
+                fv->map.base += delta;
+                fv->map.file_off += delta;
+                fv->map.len -= delta;
+            }
+        }
+    }
+}
+
+const quicly_streambuf_sendvec_callbacks_t quicly_sendbuf_file_vec_callbacks = {flatten_file, discard_file, shift_file};
+
+int quicly_sendbuf_init_file_vec(quicly_sendbuf_vec_t *vec, quicly_allocator_t *allocator, int fd, uint64_t off, size_t len)
+{
+    struct st_quicly_sendbuf_file_vec_t *fv;
+
+    if ((fv = quicly_alloc(allocator, sizeof(*fv), QUICLY_ALLOC_TAG_STREAMBUF)) == NULL)
+        return PTLS_ERROR_NO_MEMORY;
+    *fv = (struct st_quicly_sendbuf_file_vec_t){.allocator = allocator, .fd = fd, .file_off = off};
+
+    *vec = (quicly_sendbuf_vec_t){&quicly_sendbuf_file_vec_callbacks, len, fv};
+    return 0;
+}
+
+int quicly_sendbuf_write_file(quicly_stream_t *stream, quicly_sendbuf_t *sb, int fd, uint64_t off, size_t len)
+{
+    quicly_sendbuf_vec_t vec;
+    size_t num_vecs = sb->vecs.size;
+    int ret;
+
+    if ((ret = quicly_sendbuf_init_file_vec(&vec, sb->allocator, fd, off, len)) != 0) {
+        close(fd);
+        return ret;
+    }
+    if ((ret = quicly_sendbuf_write_vec(stream, sb, &vec)) != 0) {
+        /* once appended, the vector is discarded along with the send buffer */
+        if (sb->vecs.size == num_vecs)
+            discard_file(&vec);
+        return ret;
+    }
+    return 0;
+}
+
 int quicly_sendbuf_write_vec(quicly_stream_t *stream, quicly_sendbuf_t *sb, quicly_sendbuf_vec_t *vec)
 {
     assert(sb->vecs.size <= sb->vecs.capacity);
@@ -158,7 +351,8 @@ int quicly_sendbuf_write_vec(quicly_stream_t *stream, quicly_sendbuf_t *sb, quic
     if (sb->vecs.size == sb->vecs.capacity) {
         quicly_sendbuf_vec_t *new_entries;
         size_t new_capacity = sb->vecs.capacity == 0 ? 4 : sb->vecs.capacity * 2;
-        if ((new_entries = realloc(sb->vecs.entries, new_capacity * sizeof(*sb->vecs.entries))) == NULL)
+        if ((new_entries = quicly_realloc(sb->allocator, sb->vecs.entries, sb->vecs.capacity * sizeof(*sb->vecs.entries),
+                                          new_capacity * sizeof(*sb->vecs.entries), QUICLY_ALLOC_TAG_STREAMBUF)) == NULL)
             return PTLS_ERROR_NO_MEMORY;
         sb->vecs.entries = new_entries;
         sb->vecs.capacity = new_capacity;
@@ -208,6 +402,27 @@ int quicly_recvbuf_receive(quicly_stream_t *stream, ptls_buffer_t *rb, size_t of
     return 0;
 }
 
+int quicly_recvbuf_receive_batch(quicly_stream_t *stream, ptls_buffer_t *rb, const quicly_stream_recv_vec_t *vecs,
+                                 size_t num_vecs)
+{
+    size_t end = rb->off, i;
+    int ret;
+
+    for (i = 0; i != num_vecs; ++i)
+        if (vecs[i].len != 0 && end < vecs[i].off + vecs[i].len)
+            end = vecs[i].off + vecs[i].len;
+    if ((ret = ptls_buffer_reserve(rb, end - rb->off)) != 0) {
+        convert_error(stream, ret);
+        return -1;
+    }
+    for (i = 0; i != num_vecs; ++i)
+        if (vecs[i].len != 0)
+            memcpy(rb->base + vecs[i].off, vecs[i].src, vecs[i].len);
+    rb->off = end;
+
+    return 0;
+}
+
 int quicly_streambuf_create(quicly_stream_t *stream, size_t sz)
 {
     quicly_streambuf_t *sbuf;
@@ -215,9 +430,12 @@ int quicly_streambuf_create(quicly_stream_t *stream, size_t sz)
     assert(sz >= sizeof(*sbuf));
     assert(stream->data == NULL);
 
-    if ((sbuf = malloc(sz)) == NULL)
+    quicly_allocator_t *allocator = quicly_get_context(stream->conn)->allocator;
+    if ((sbuf = quicly_alloc(allocator, sz, QUICLY_ALLOC_TAG_STREAMBUF)) == NULL)
         return PTLS_ERROR_NO_MEMORY;
     quicly_sendbuf_init(&sbuf->egress);
+    sbuf->egress.allocator = allocator;
+    sbuf->size = sz;
     ptls_buffer_init(&sbuf->ingress, "", 0);
     if (sz != sizeof(*sbuf))
         memset((char *)sbuf + sizeof(*sbuf), 0, sz - sizeof(*sbuf));
@@ -232,10 +450,26 @@ void quicly_streambuf_destroy(quicly_stream_t *stream, quicly_error_t err)
 
     quicly_sendbuf_dispose(&sbuf->egress);
     ptls_buffer_dispose(&sbuf->ingress);
-    free(sbuf);
+    quicly_dealloc(sbuf->egress.allocator, sbuf, sbuf->size, QUICLY_ALLOC_TAG_STREAMBUF);
     stream->data = NULL;
 }
 
+void quicly_streambuf_shrink(quicly_stream_t *stream)
+{
+    quicly_streambuf_t *sbuf = stream->data;
+
+    if (sbuf->egress.vecs.size == 0 && sbuf->egress.vecs.entries != NULL) {
+        quicly_dealloc(sbuf->egress.allocator, sbuf->egress.vecs.entries,
+                       sbuf->egress.vecs.capacity * sizeof(*sbuf->egress.vecs.entries), QUICLY_ALLOC_TAG_STREAMBUF);
+        sbuf->egress.vecs.entries = NULL;
+        sbuf->egress.vecs.capacity = 0;
+    }
+    if (sbuf->ingress.off == 0) {
+        ptls_buffer_dispose(&sbuf->ingress);
+        ptls_buffer_init(&sbuf->ingress, "", 0);
+    }
+}
+
 void quicly_streambuf_egress_emit(quicly_stream_t *stream, size_t off, void *dst, size_t *len, int *wrote_all)
 {
     quicly_streambuf_t *sbuf = stream->data;
@@ -254,3 +488,9 @@ int quicly_streambuf_ingress_receive(quicly_stream_t *stream, size_t off, const
     quicly_streambuf_t *sbuf = stream->data;
     return quicly_recvbuf_receive(stream, &sbuf->ingress, off, src, len);
 }
+
+int quicly_streambuf_ingress_receive_batch(quicly_stream_t *stream, const quicly_stream_recv_vec_t *vecs, size_t num_vecs)
+{
+    quicly_streambuf_t *sbuf = stream->data;
+    return quicly_recvbuf_receive_batch(stream, &sbuf->ingress, vecs, num_vecs);
+}
@@ -223,27 +223,8 @@ static void send_header(quicly_stream_t *stream, int is_http1, int status, const
     send_str(stream, buf);
 }
 
-static quicly_error_t flatten_file_vec(quicly_sendbuf_vec_t *vec, void *dst, size_t off, size_t len)
-{
-    int fd = (intptr_t)vec->cbdata;
-    ssize_t rret;
-
-    /* FIXME handle partial read */
-    while ((rret = pread(fd, dst, len, off)) == -1 && errno == EINTR)
-        ;
-
-    return rret == len ? 0 : QUICLY_TRANSPORT_ERROR_INTERNAL; /* should return application-level error */
-}
-
-static void discard_file_vec(quicly_sendbuf_vec_t *vec)
-{
-    int fd = (intptr_t)vec->cbdata;
-    close(fd);
-}
-
 static int send_file(quicly_stream_t *stream, int is_http1, const char *fn, const char *mime_type)
 {
-    static const quicly_streambuf_sendvec_callbacks_t send_file_callbacks = {flatten_file_vec, discard_file_vec};
     int fd;
     struct stat st;
 
@@ -255,8 +236,7 @@ static int send_file(quicly_stream_t *stream, int is_http1, const char *fn, cons
     }
 
     send_header(stream, is_http1, 200, mime_type);
-    quicly_sendbuf_vec_t vec = {&send_file_callbacks, (size_t)st.st_size, (void *)(intptr_t)fd};
-    quicly_streambuf_egress_write_vec(stream, &vec);
+    quicly_streambuf_egress_write_file(stream, fd, 0, (size_t)st.st_size);
     return 1;
 }
 
@@ -1210,9 +1190,12 @@ static void usage(const char *cmd)
            "  -k key-file               specifies the credentials to be used for running the\n"
            "                            server. If omitted, the command runs as a client.\n"
            "  -C <algo>[:<iw>[:<p>]]    specifies the congestion control algorithm (\"reno\"\n"
-           "                            (default), \"cubic\", or \"pico\"), as well as\n"
-           "                            initial congestion window size (in packets, default:\n"
-           "                            10) and use of pacing.\n"
+           "                            (default), \"cubic\", \"pico\", \"bbr\", \"prague\", or\n"
+           "                            \"ledbat\"), as well as initial congestion window size\n"
+           "                            (in packets, default: 10) and use of pacing.\n"
+           "                            \"prague\" is an L4S CC that should be used with ECN\n"
+           "                            and pacing. \"ledbat\" is a less-than-best-effort CC\n"
+           "                            for background transfers.\n"
            "  -d draft-number           specifies the draft version number to be used (e.g.,\n"
            "                            29)\n"
            "  --disable-ecn             turns off ECN support (default is on)\n"
@@ -1230,6 +1213,7 @@ static void usage(const char *cmd)
            "  -f fraction               increases the induced ack frequency to specified\n"
            "                            fraction of CWND (default: 0)\n"
            "  -G                        enable UDP generic segmentation offload\n"
+           "  --hystart                 turns on HyStart++ (reno and cubic only)\n"
            "  -i interval               interval to reissue requests (in milliseconds)\n"
            "  --jumpstart-default <wnd> jumpstart CWND size for new connections, in packets\n"
            "  --jumpstart-max <wnd>     maximum jumpstart CWND size for resuming connections\n"
@@ -1238,10 +1222,20 @@ static void usage(const char *cmd)
            "  -l log-file               file to log traffic secrets\n"
            "  -M <bytes>                max stream data (in bytes; default: 1MB)\n"
            "  -m <bytes>                max data (in bytes; default: 16MB)\n"
+           "  --max-connection-window <bytes>\n"
+           "                            enables receive window autotuning, growing the\n"
+           "                            connection-level window up to the specified size\n"
+           "  --max-stream-window <bytes>\n"
+           "                            enables receive window autotuning, growing the\n"
+           "                            stream-level window up to the specified size\n"
            "  -N                        enforce HelloRetryRequest (client-only)\n"
            "  -n                        enforce version negotiation (client-only)\n"
            "  -O                        suppress output\n"
            "  -p path                   path to request (can be set multiple times)\n"
+           "  --path-profile-cache <entries>\n"
+           "                            remembers the delivery rate and RTT observed for\n"
+           "                            each client subnet, using them for seeding\n"
+           "                            jumpstart and initial RTT (server only)\n"
            "  -P path                   path to request, store response to file (can be set\n"
            "                            multiple times)\n"
            "  -R                        require Retry (server only)\n"
@@ -1495,7 +1489,7 @@ int main(int argc, char **argv)
     struct sockaddr_storage sa;
     socklen_t salen;
     unsigned udpbufsize = 0;
-    int ch, opt_index, fd = -1;
+    int ch, opt_index, fd = -1, use_hystart = 0;
 
     ERR_load_crypto_strings();
     OpenSSL_add_all_algorithms();
@@ -1526,8 +1520,12 @@ int main(int argc, char **argv)
                                              {"ech-configs", required_argument, NULL, 0},
                                              {"disable-ecn", no_argument, NULL, 0},
                                              {"disregard-app-limited", no_argument, NULL, 0},
+                                             {"hystart", no_argument, NULL, 0},
                                              {"jumpstart-default", required_argument, NULL, 0},
                                              {"jumpstart-max", required_argument, NULL, 0},
+                                             {"max-connection-window", required_argument, NULL, 0},
+                                             {"max-stream-window", required_argument, NULL, 0},
+                                             {"path-profile-cache", required_argument, NULL, 0},
                                              {"rapid-start", no_argument, NULL, 0},
                                              {"sockfd", required_argument, NULL, 0},
                                              {"exit-after-handshake", no_argument, NULL, 0},
@@ -1547,6 +1545,8 @@ int main(int argc, char **argv)
                 ctx.enable_ratio.ecn = 0;
             } else if (strcmp(longopts[opt_index].name, "disregard-app-limited") == 0) {
                 ctx.enable_ratio.respect_app_limited = 0;
+            } else if (strcmp(longopts[opt_index].name, "hystart") == 0) {
+                use_hystart = 1;
             } else if (strcmp(longopts[opt_index].name, "jumpstart-default") == 0) {
                 if (sscanf(optarg, "%" SCNu32, &ctx.default_jumpstart_cwnd_packets) != 1) {
                     fprintf(stderr, "failed to parse default jumpstart size: %s\n", optarg);
@@ -1557,6 +1557,23 @@ int main(int argc, char **argv)
                     fprintf(stderr, "failed to parse max jumpstart size: %s\n", optarg);
                     exit(1);
                 }
+            } else if (strcmp(longopts[opt_index].name, "max-connection-window") == 0) {
+                if (sscanf(optarg, "%" SCNu64, &ctx.recv_window_autotune.max_window) != 1) {
+                    fprintf(stderr, "failed to parse max connection window: %s\n", optarg);
+                    exit(1);
+                }
+            } else if (strcmp(longopts[opt_index].name, "max-stream-window") == 0) {
+                if (sscanf(optarg, "%" SCNu32, &ctx.recv_window_autotune.max_stream_window) != 1) {
+                    fprintf(stderr, "failed to parse max stream window: %s\n", optarg);
+                    exit(1);
+                }
+            } else if (strcmp(longopts[opt_index].name, "path-profile-cache") == 0) {
+                size_t capacity;
+                if (sscanf(optarg, "%zu", &capacity) != 1 ||
+                    (ctx.path_profile_cache = quicly_new_default_path_profile_cache(capacity, 24, 48, 3600 * 1000)) == NULL) {
+                    fprintf(stderr, "failed to setup path profile cache: %s\n", optarg);
+                    exit(1);
+                }
             } else if (strcmp(longopts[opt_index].name, "rapid-start") == 0) {
                 ctx.enable_ratio.rapid_start = 255;
             } else if (strcmp(longopts[opt_index].name, "sockfd") == 0) {
@@ -1627,6 +1644,7 @@ int main(int argc, char **argv)
         case 'G':
 #ifdef __linux__
             send_packets = send_packets_gso;
+            ctx.max_gso_segments = MAX_BURST_PACKETS;
 #else
             fprintf(stderr, "UDP GSO only supported on linux\n");
             exit(1);
@@ -1807,6 +1825,17 @@ int main(int argc, char **argv)
     argc -= optind;
     argv += optind;
 
+    if (use_hystart) {
+        if (ctx.init_cc == &quicly_cc_reno_init) {
+            ctx.init_cc = &quicly_cc_reno_hystart_init;
+        } else if (ctx.init_cc == &quicly_cc_cubic_init) {
+            ctx.init_cc = &quicly_cc_cubic_hystart_init;
+        } else {
+            fprintf(stderr, "--hystart can only be used with reno or cubic\n");
+            exit(1);
+        }
+    }
+
     if (exit_after_handshake) {
         if (reqs[0].path != NULL) {
             fprintf(stderr, "-p and --exit-after-handshake cannot be used together\n");
@@ -19,6 +19,7 @@
  * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
  * IN THE SOFTWARE.
  */
+#include <math.h>
 #include "quicly/cc.h"
 #include "test.h"
 
@@ -55,7 +56,632 @@ static void test_rapid_start(void)
     ok(!quicly_cc_rapid_start_use_3x(&rs, &rtt));
 }
 
+/**
+ * acks a round of `num_packets` packets starting from `pn`, each carrying the given RTT sample
+ */
+static uint64_t hystart_ack_round(quicly_cc_t *cc, quicly_loss_t *loss, uint64_t pn, uint64_t num_packets, uint32_t rtt,
+                                  int64_t now)
+{
+    quicly_delivery_rate_sample_t rs;
+    quicly_sentmap_init_rate_sample(&rs);
+
+    loss->rtt.latest = rtt;
+    for (uint64_t i = 0; i < num_packets; ++i)
+        cc->type->cc_on_acked(cc, loss, 1200, pn + i, cc->cwnd + 1200, 1, &rs, pn + num_packets, now, 1200);
+    return pn + num_packets;
+}
+
+static void do_test_hystart(quicly_init_cc_t *init)
+{
+    quicly_loss_t loss = {.rtt = {.minimum = 100, .smoothed = 100, .latest = 100}};
+    quicly_cc_t cc;
+    uint64_t pn = 0;
+    int64_t now = 1000;
+    uint32_t cwnd;
+    quicly_delivery_rate_sample_t rs;
+
+    quicly_sentmap_init_rate_sample(&rs);
+    init->cb(init, &cc, 10 * 1200, now);
+    ok(cc.hystart.phase == QUICLY_CC_HYSTART_SLOW_START);
+
+    /* first two rounds establish the baseline; slow start doubles CWND every round */
+    pn = hystart_ack_round(&cc, &loss, pn, 10, 100, now += 100);
+    pn = hystart_ack_round(&cc, &loss, pn, 10, 100, now += 100);
+    ok(cc.hystart.phase == QUICLY_CC_HYSTART_SLOW_START);
+    ok(cc.cwnd == 30 * 1200);
+
+    /* increase below the threshold (i.e., max(4, min(16, 100 / 8)) = 12) does not trigger CSS */
+    pn = hystart_ack_round(&cc, &loss, pn, 10, 111, now += 100);
+    ok(cc.hystart.phase == QUICLY_CC_HYSTART_SLOW_START);
+
+    /* RTT increase is detected after N_RTT_SAMPLE samples; remaining acks of the round grow CWND by 1/4 */
+    cwnd = cc.cwnd;
+    pn = hystart_ack_round(&cc, &loss, pn, 10, 125, now += 100);
+    ok(cc.hystart.phase == QUICLY_CC_HYSTART_CSS);
+    ok(cc.cwnd == cwnd + 7 * 1200 + 3 * 300);
+
+    /* RTT going down in CSS means the exit was spurious */
+    pn = hystart_ack_round(&cc, &loss, pn, 10, 100, now += 100);
+    ok(cc.hystart.phase == QUICLY_CC_HYSTART_SLOW_START);
+    ok(cc.ssthresh == UINT32_MAX);
+
+    /* enter CSS again, then stay there until CSS_ROUNDS pass */
+    pn = hystart_ack_round(&cc, &loss, pn, 10, 100, now += 100);
+    pn = hystart_ack_round(&cc, &loss, pn, 10, 130, now += 100);
+    ok(cc.hystart.phase == QUICLY_CC_HYSTART_CSS);
+    cwnd = cc.cwnd;
+    pn = hystart_ack_round(&cc, &loss, pn, 10, 130, now += 100);
+    ok(cc.hystart.phase == QUICLY_CC_HYSTART_CSS);
+    ok(cc.cwnd == cwnd + 10 * 300);
+    for (size_t i = 0; i < QUICLY_HYSTART_CSS_ROUNDS - 2; ++i)
+        pn = hystart_ack_round(&cc, &loss, pn, 10, 130, now += 100);
+    ok(cc.hystart.phase == QUICLY_CC_HYSTART_CSS);
+    cwnd = cc.cwnd;
+    cc.type->cc_on_acked(&cc, &loss, 1200, pn, cc.cwnd + 1200, 1, &rs, pn + 10, now += 100, 1200);
+    ok(cc.hystart.phase == QUICLY_CC_HYSTART_DONE);
+    ok(cc.ssthresh == cwnd);
+    ok(cc.cwnd_exiting_slow_start == cwnd);
+    ok(cc.exit_slow_start_at == now);
+    if (cc.type == &quicly_cc_type_cubic) {
+        ok(cc.state.cubic.w_max == cwnd);
+        ok(cc.state.cubic.k == 0);
+    }
+
+    /* loss observed in CSS reduces CWND by beta rather than by half */
+    init->cb(init, &cc, 10 * 1200, now);
+    pn = hystart_ack_round(&cc, &loss, pn, 10, 100, now += 100);
+    pn = hystart_ack_round(&cc, &loss, pn, 10, 100, now += 100);
+    pn = hystart_ack_round(&cc, &loss, pn, 10, 130, now += 100);
+    ok(cc.hystart.phase == QUICLY_CC_HYSTART_CSS);
+    cwnd = cc.cwnd;
+    cc.type->cc_on_lost(&cc, &loss, 1200, pn - 1, pn + 10, now, 1200);
+    ok(cc.hystart.phase == QUICLY_CC_HYSTART_DONE);
+    if (cc.type == &quicly_cc_type_cubic) {
+        ok(cc.cwnd == (uint64_t)cwnd * 7 / 10); /* CUBIC uses integer arithmetic */
+    } else {
+        ok(cc.cwnd == (uint32_t)(cwnd * QUICLY_RENO_BETA));
+    }
+}
+
+static void test_hystart(void)
+{
+    quicly_cc_t cc;
+
+    /* off by default */
+    quicly_cc_reno_init.cb(&quicly_cc_reno_init, &cc, 10 * 1200, 0);
+    ok(!quicly_cc_hystart_is_enabled(&cc.hystart));
+    quicly_cc_cubic_init.cb(&quicly_cc_cubic_init, &cc, 10 * 1200, 0);
+    ok(!quicly_cc_hystart_is_enabled(&cc.hystart));
+
+    subtest("reno", do_test_hystart, &quicly_cc_reno_hystart_init);
+    subtest("cubic", do_test_hystart, &quicly_cc_cubic_hystart_init);
+}
+
+/**
+ * acks `num_packets` packets one by one, reporting `inflight_packets` packets being inflight for each ACK
+ */
+static void ack_packets_one_by_one(quicly_cc_t *cc, quicly_loss_t *loss, uint64_t *pn, size_t num_packets,
+                                   uint32_t inflight_packets, int cc_limited, int64_t now)
+{
+    quicly_delivery_rate_sample_t rs;
+    quicly_sentmap_init_rate_sample(&rs);
+
+    for (size_t i = 0; i < num_packets; ++i) {
+        cc->type->cc_on_acked(cc, loss, 1200, *pn, inflight_packets * 1200, cc_limited, &rs, *pn + inflight_packets, now, 1200);
+        ++*pn;
+    }
+}
+
+static void do_test_app_limited(quicly_init_cc_t *init)
+{
+    quicly_loss_t loss = {.rtt = {.minimum = 100, .smoothed = 100, .latest = 100}};
+    quicly_cc_t cc;
+    uint64_t pn = 0;
+    int64_t now = 1000, avoidance_start = 0;
+    uint32_t cwnd;
+
+    init->cb(init, &cc, 10 * 1200, now);
+
+    /* slow start grows CWND only while being CC-limited */
+    ack_packets_one_by_one(&cc, &loss, &pn, 10, 10, 1, now += 100);
+    ok(cc.cwnd == 20 * 1200);
+    ack_packets_one_by_one(&cc, &loss, &pn, 10, 5, 0, now += 100);
+    ok(cc.cwnd == 20 * 1200);
+    ok(quicly_cc_cwv_is_app_limited(&cc));
+    ack_packets_one_by_one(&cc, &loss, &pn, 60, 20, 1, now += 100);
+    ok(cc.cwnd == 80 * 1200);
+    ok(!quicly_cc_cwv_is_app_limited(&cc));
+
+    /* exit slow start, then leave the recovery period */
+    cc.type->cc_on_lost(&cc, &loss, 1200, pn, pn + 80, now, 1200);
+    ok(cc.cwnd == 40 * 1200);
+    pn += 80;
+
+    /* congestion avoidance grows CWND only while being CC-limited */
+    ack_packets_one_by_one(&cc, &loss, &pn, 60, 40, 1, now += 100);
+    cwnd = cc.cwnd;
+    ok(cwnd > 40 * 1200);
+    for (int i = 0; i < 100; ++i)
+        ack_packets_one_by_one(&cc, &loss, &pn, 5, 5, 0, now += 100);
+    ok(cc.cwnd == cwnd);
+    if (cc.type == &quicly_cc_type_cubic)
+        avoidance_start = cc.state.cubic.avoidance_start;
+    ack_packets_one_by_one(&cc, &loss, &pn, 1, 40, 1, now += 100);
+    ok(cc.cwnd >= cwnd);
+    if (cc.type == &quicly_cc_type_cubic) /* app-limited period (i.e., 10 seconds) is excluded from the cubic epoch */
+        ok(cc.state.cubic.avoidance_start == avoidance_start + 10000);
+    ack_packets_one_by_one(&cc, &loss, &pn, 60, 40, 1, now += 100);
+    ok(cc.cwnd > cwnd);
+
+    /* staying app-limited longer than the Non-Validated Period halves CWND */
+    cwnd = cc.cwnd;
+    for (int64_t i = 0; i <= QUICLY_CC_CWV_NVP_DURATION / 1000; ++i)
+        ack_packets_one_by_one(&cc, &loss, &pn, 1, 5, 0, now += 1000);
+    ok(cc.cwnd == cwnd / 2);
+    ok(cc.ssthresh >= cwnd / 4 * 3);
+    ok(cc.cwnd_minimum == cc.cwnd);
+
+    /* loss while being app-limited reduces from the validated portion of CWND (i.e., pipeACK) */
+    ack_packets_one_by_one(&cc, &loss, &pn, 1, 12, 0, now += 100);
+    ok(cc.cwnd > 12 * 1200);
+    cc.type->cc_on_lost(&cc, &loss, 1200, pn, pn + 12, now, 1200);
+    ok(cc.cwnd == (uint32_t)(12 * 1200 * QUICLY_RENO_BETA));
+}
+
+static void test_app_limited(void)
+{
+    subtest("reno", do_test_app_limited, &quicly_cc_reno_init);
+    subtest("cubic", do_test_app_limited, &quicly_cc_cubic_init);
+    subtest("pico", do_test_app_limited, &quicly_cc_pico_init);
+}
+
+/**
+ * Floating-point implementation of CUBIC (RFC 8312) congestion avoidance, against which the fixed-point implementation is compared.
+ */
+struct cubic_ref_t {
+    double k;
+    uint32_t w_max, w_last_max, cwnd;
+    int64_t avoidance_start;
+};
+
+static void cubic_ref_on_lost(struct cubic_ref_t *ref, int64_t now, uint32_t mtu)
+{
+    ref->avoidance_start = now;
+    ref->w_max = ref->cwnd;
+    if (ref->w_max < ref->w_last_max) {
+        ref->w_last_max = ref->w_max;
+        ref->w_max *= (1.0 + 0.7) / 2.0;
+    } else {
+        ref->w_last_max = ref->w_max;
+    }
+    ref->k = cbrt(ref->w_max / (double)mtu * ((1 - 0.7) / 0.4));
+    ref->cwnd *= 0.7;
+}
+
+static void cubic_ref_on_acked(struct cubic_ref_t *ref, uint32_t rtt, int64_t now, uint32_t mtu)
+{
+    double t = (now - ref->avoidance_start) / 1000., rtt_sec = rtt / 1000., tk = t - ref->k, tk_next = t + rtt_sec - ref->k;
+    uint32_t w_cubic = 0.4 * tk * tk * tk * mtu + ref->w_max;
+    uint32_t w_est = ref->w_max * 0.7 + 3 * (1 - 0.7) / (1 + 0.7) * (t / rtt_sec) * mtu;
+    if (w_cubic < w_est) {
+        if (w_est > ref->cwnd)
+            ref->cwnd = w_est;
+    } else {
+        double w_cubic_target = 0.4 * tk_next * tk_next * tk_next * mtu + ref->w_max;
+        if (w_cubic_target > ref->cwnd)
+            ref->cwnd += (uint32_t)((w_cubic_target / ref->cwnd - 1) * mtu);
+    }
+}
+
+/**
+ * Runs the fixed-point implementation and the reference side by side, for `duration` milliseconds, acking CWND every RTT. Returns
+ * the maximum relative difference of CWND observed.
+ */
+static double run_cubic_ref(quicly_cc_t *cc, struct cubic_ref_t *ref, quicly_loss_t *loss, uint64_t *pn, int64_t *now,
+                            int64_t duration)
+{
+    quicly_delivery_rate_sample_t rs;
+    int64_t end_at = *now + duration;
+    double max_diff = 0;
+
+    quicly_sentmap_init_rate_sample(&rs);
+    while (*now < end_at) {
+        uint32_t num_packets = cc->cwnd / 1200;
+        for (uint32_t i = 0; i < num_packets; ++i) {
+            int64_t at = *now + loss->rtt.smoothed * i / num_packets;
+            cc->type->cc_on_acked(cc, loss, 1200, *pn, cc->cwnd, 1, &rs, *pn + 1 + num_packets, at, 1200);
+            ++*pn;
+            cubic_ref_on_acked(ref, loss->rtt.smoothed, at, 1200);
+        }
+        double diff = fabs((double)cc->cwnd - ref->cwnd) / ref->cwnd;
+        if (max_diff < diff)
+            max_diff = diff;
+        *now += loss->rtt.smoothed;
+    }
+
+    return max_diff;
+}
+
+static void do_test_cubic_trajectory(uint32_t initial_w_max, uint32_t rtt)
+{
+    quicly_loss_t loss = {.rtt = {.minimum = rtt, .smoothed = rtt, .latest = rtt}};
+    quicly_cc_t cc;
+    struct cubic_ref_t ref = {};
+    uint64_t pn = 0;
+    int64_t now = 1000;
+
+    quicly_cc_cubic_init.cb(&quicly_cc_cubic_init, &cc, initial_w_max, now);
+    cc.ssthresh = cc.cwnd; /* in congestion avoidance */
+    ref.cwnd = cc.cwnd;
+
+    /* loss, then the second loss before reaching W_max, which triggers fast convergence */
+    cc.type->cc_on_lost(&cc, &loss, 1200, pn, pn + 1, now, 1200);
+    cubic_ref_on_lost(&ref, now, 1200);
+    ok(cc.cwnd == ref.cwnd);
+    ok(fabs(cc.state.cubic.k - ref.k * 1000) <= 1);
+    ++pn;
+    ok(run_cubic_ref(&cc, &ref, &loss, &pn, &now, 1000) < 0.005);
+    ref.cwnd = cc.cwnd;
+    cc.type->cc_on_lost(&cc, &loss, 1200, pn, pn + 1, now, 1200);
+    cubic_ref_on_lost(&ref, now, 1200);
+    ok(cc.state.cubic.w_max == ref.w_max);
+    ok(fabs(cc.state.cubic.k - ref.k * 1000) <= 1);
+    ++pn;
+
+    /* concave and convex regions (and TCP-friendly region, depending on the parameters) */
+    ok(run_cubic_ref(&cc, &ref, &loss, &pn, &now, 30000) < 0.005);
+    ok(cc.cwnd > initial_w_max);
+}
+
+static void test_cubic(void)
+{
+    /* K matches the floating-point cube root for the entire range of W_max */
+    for (uint64_t w_max = 2 * 1200; w_max <= UINT32_MAX; w_max = w_max * 5 / 4 + 1) {
+        quicly_cc_t cc;
+        quicly_loss_t loss = {};
+        quicly_cc_cubic_init.cb(&quicly_cc_cubic_init, &cc, (uint32_t)w_max, 0);
+        cc.ssthresh = cc.cwnd;
+        cc.type->cc_on_lost(&cc, &loss, 1200, 0, 1, 0, 1200);
+        double k = cbrt(w_max / 1200. * ((1 - 0.7) / 0.4)) * 1000;
+        if (!(fabs(cc.state.cubic.k - k) <= 1)) {
+            ok(0);
+            return;
+        }
+    }
+    ok(1);
+
+    subtest("100ms", do_test_cubic_trajectory, 100 * 1200, 100);
+    subtest("10ms", do_test_cubic_trajectory, 1000 * 1200, 10);
+    subtest("tcp-friendly", do_test_cubic_trajectory, 20 * 1200, 300);
+}
+
+struct bbr_sim_t {
+    quicly_cc_t cc;
+    quicly_loss_t loss;
+    int64_t now;
+    uint64_t next_pn;
+    int64_t link_free_at;
+    uint64_t pacer_credit;
+    int64_t acked_at[4096];
+    size_t num_inflight;
+    /**
+     * if set, every ACK reports a new CE mark
+     */
+    int mark_ce;
+};
+
+/**
+ * Runs a BBR sender that always has data to send over a bottleneck link of `bytes_per_msec` with the base RTT of `rtt`
+ * milliseconds, for `duration` milliseconds. Packets are acked individually. Returns if PROBE_RTT has been entered.
+ */
+static int run_bbr(struct bbr_sim_t *sim, uint32_t bytes_per_msec, uint32_t rtt, int64_t duration)
+{
+    static const uint32_t mtu = 1200;
+    int64_t end_at = sim->now + duration;
+    int probe_rtt_seen = 0;
+
+    for (; sim->now < end_at; ++sim->now) {
+        /* process acks */
+        while (sim->num_inflight != 0 && sim->acked_at[0] <= sim->now) {
+            quicly_sentmap_iter_t iter;
+            quicly_delivery_rate_sample_t rs;
+            quicly_sentmap_init_iter(&sim->loss.sentmap, &iter);
+            const quicly_sent_packet_t *sent = quicly_sentmap_get(&iter);
+            uint64_t pn = sent->packet_number;
+            sim->loss.rtt.latest = (uint32_t)(sim->now - sent->sent_at);
+            if (sim->loss.rtt.minimum > sim->loss.rtt.latest)
+                sim->loss.rtt.minimum = sim->loss.rtt.latest;
+            quicly_sentmap_init_rate_sample(&rs);
+            quicly_sentmap_update_rate_sample(&sim->loss.sentmap, &rs, sent, sim->now);
+            quicly_sentmap_update(&sim->loss.sentmap, &iter, QUICLY_SENTMAP_EVENT_ACKED);
+            quicly_sentmap_generate_rate_sample(&sim->loss.sentmap, &rs, sim->loss.rtt.minimum);
+            sim->cc.type->cc_on_acked(&sim->cc, &sim->loss, mtu, pn, (uint32_t)sim->loss.sentmap.bytes_in_flight + mtu, 1, &rs,
+                                      sim->next_pn, sim->now, mtu);
+            if (sim->mark_ce)
+                sim->cc.type->cc_on_lost(&sim->cc, &sim->loss, 0, pn, sim->next_pn, sim->now, mtu);
+            memmove(sim->acked_at, sim->acked_at + 1, --sim->num_inflight * sizeof(sim->acked_at[0]));
+        }
+        if (sim->cc.state.bbr.mode == 6 /* PROBE_RTT */)
+            probe_rtt_seen = 1;
+        /* send packets, as permitted by the pacer and CWND */
+        sim->pacer_credit += sim->cc.type->cc_pacing_rate(&sim->cc, &sim->loss);
+        if (sim->pacer_credit > 10 * mtu)
+            sim->pacer_credit = 10 * mtu;
+        while (sim->pacer_credit >= mtu && sim->loss.sentmap.bytes_in_flight + mtu <= sim->cc.cwnd &&
+               sim->num_inflight < PTLS_ELEMENTSOF(sim->acked_at)) {
+            /* the packet leaves the bottleneck after being queued; the ack arrives after the base RTT */
+            int64_t departs_at = sim->link_free_at > sim->now ? sim->link_free_at : sim->now;
+            departs_at += (mtu + bytes_per_msec - 1) / bytes_per_msec;
+            sim->link_free_at = departs_at;
+            quicly_sentmap_prepare(&sim->loss.sentmap, sim->next_pn++, sim->now, QUICLY_EPOCH_1RTT);
+            quicly_sentmap_commit(&sim->loss.sentmap, mtu, 1, 0);
+            sim->acked_at[sim->num_inflight++] = departs_at + rtt;
+            sim->cc.type->cc_on_sent(&sim->cc, &sim->loss, mtu, sim->now);
+            sim->pacer_credit -= mtu;
+        }
+    }
+
+    return probe_rtt_seen;
+}
+
+static void test_bbr(void)
+{
+    static struct bbr_sim_t sim;
+    quicly_cc_t *cc = &sim.cc;
+
+    sim.now = 1;
+    quicly_sentmap_init(&sim.loss.sentmap);
+    quicly_cc_bbr_init.cb(&quicly_cc_bbr_init, cc, 10 * 1200, sim.now);
+    ok(cc->type == &quicly_cc_type_bbr);
+    ok(cc->state.bbr.mode == 0 /* STARTUP */);
+    sim.loss.rtt.smoothed = sim.loss.rtt.latest = 100;
+    sim.loss.rtt.minimum = UINT32_MAX;
+
+    /* before any sample is taken, the initial window is paced at the STARTUP gain */
+    ok(cc->type->cc_pacing_rate(cc, &sim.loss) == (uint32_t)(10 * 1200 * 2.77 / 100));
+
+    /* 9.6 Mbps, 40ms; leave STARTUP and converge to the link capacity */
+    ok(!run_bbr(&sim, 1200, 40, 3000));
+    ok(cc->state.bbr.full_bw_reached);
+    ok(cc->cwnd_exiting_slow_start != 0);
+    ok(2 <= cc->state.bbr.mode && cc->state.bbr.mode <= 5 /* PROBE_BW */);
+    ok(cc->state.bbr.min_rtt == 41);
+    uint64_t max_bw = cc->state.bbr.max_bw_filter[0] > cc->state.bbr.max_bw_filter[1] ? cc->state.bbr.max_bw_filter[0]
+                                                                                       : cc->state.bbr.max_bw_filter[1];
+    ok(max_bw >= 1200 * 1000 * 0.9);
+    ok(max_bw <= 1200 * 1000 * 1.1);
+    uint32_t pacing_rate = cc->type->cc_pacing_rate(cc, &sim.loss);
+    ok(pacing_rate >= 1200 * 0.8);
+    ok(pacing_rate <= 1200 * 1.3);
+    /* CWND is bounded by cwnd_gain * BDP plus the allowance for bursts */
+    ok(cc->cwnd <= 2.25 * 1200 * 41 + 5 * 2 * 1200);
+    ok(cc->num_loss_episodes == 0);
+
+    /* without any loss or RTT reduction, PROBE_RTT is entered once 5 seconds elapse, and then is exitted */
+    ok(run_bbr(&sim, 1200, 40, 4000));
+    ok(cc->state.bbr.mode != 6);
+
+    /* heavy loss in a round establishes inflight_hi */
+    ok(cc->state.bbr.inflight_hi == UINT32_MAX);
+    for (uint64_t pn = sim.next_pn; pn < sim.next_pn + 10; ++pn)
+        cc->type->cc_on_lost(cc, &sim.loss, 1200, pn, sim.next_pn + 100, sim.now, 1200);
+    ok(cc->num_loss_episodes == 1);
+    ok(cc->state.bbr.inflight_hi != UINT32_MAX);
+    ok(cc->cwnd <= cc->state.bbr.inflight_hi);
+
+    /* persistent congestion collapses CWND until recovery is exitted, at which point CWND is restored */
+    uint32_t cwnd = cc->cwnd;
+    quicly_delivery_rate_sample_t rs;
+    quicly_sentmap_init_rate_sample(&rs);
+    cc->type->cc_on_persistent_congestion(cc, &sim.loss, sim.now);
+    ok(cc->cwnd == 4 * 1200);
+    cc->type->cc_on_acked(cc, &sim.loss, 1200, cc->recovery_end - 1, 2 * 1200, 1, &rs, cc->recovery_end + 1, sim.now, 1200);
+    ok(cc->cwnd < cwnd);
+    cc->type->cc_on_acked(cc, &sim.loss, 1200, cc->recovery_end, 1200, 1, &rs, cc->recovery_end + 1, sim.now, 1200);
+    ok(cc->cwnd >= cwnd);
+
+    quicly_sentmap_dispose(&sim.loss.sentmap);
+}
+
+static void test_bbr_ecn(void)
+{
+    static struct bbr_sim_t sim;
+    quicly_cc_t *cc = &sim.cc;
+
+    sim.now = 1;
+    quicly_sentmap_init(&sim.loss.sentmap);
+    quicly_cc_bbr_init.cb(&quicly_cc_bbr_init, cc, 10 * 1200, sim.now);
+    sim.loss.rtt.smoothed = sim.loss.rtt.latest = 100;
+    sim.loss.rtt.minimum = UINT32_MAX;
+
+    /* CE marks in consecutive rounds end STARTUP */
+    sim.mark_ce = 1;
+    run_bbr(&sim, 1200, 40, 200);
+    ok(cc->state.bbr.full_bw_reached);
+    ok(cc->state.bbr.inflight_hi != UINT32_MAX);
+    ok(cc->state.bbr.ecn_alpha > 0);
+
+    /* converge without marks */
+    sim.mark_ce = 0;
+    run_bbr(&sim, 1200, 40, 3000);
+    ok(cc->state.bbr.ecn_alpha < 0.1);
+    uint32_t cwnd_unmarked = cc->cwnd;
+
+    /* persistent marks bound inflight_hi and inflight_lo, the latter shrinking in proportion to ecn_alpha */
+    sim.mark_ce = 1;
+    run_bbr(&sim, 1200, 40, 1000);
+    ok(cc->state.bbr.ecn_alpha > 0.5);
+    ok(cc->cwnd <= cc->state.bbr.inflight_hi);
+    ok(cc->state.bbr.inflight_lo != UINT32_MAX);
+    ok(cc->cwnd < cwnd_unmarked);
+    ok(cc->num_loss_episodes != 0);
+
+    quicly_sentmap_dispose(&sim.loss.sentmap);
+}
+
+static void test_prague(void)
+{
+    quicly_loss_t loss = {.rtt = {.minimum = 25, .smoothed = 25, .latest = 25}};
+    quicly_cc_t cc;
+    uint64_t pn = 0;
+    int64_t now = 1000;
+    uint32_t cwnd;
+
+    quicly_cc_prague_init.cb(&quicly_cc_prague_init, &cc, 10 * 1200, now);
+    ok(cc.type == &quicly_cc_type_prague);
+    ok(cc.state.prague.alpha == 1);
+    ok(cc.type->cc_pacing_rate(&cc, &loss) == 10 * 1200 * 2 / 25);
+
+    /* alpha decays by the EWMA gain when a round passes without CE marks */
+    ack_packets_one_by_one(&cc, &loss, &pn, 10, 10, 1, now += 25);
+    ok(cc.cwnd == 20 * 1200);
+    ack_packets_one_by_one(&cc, &loss, &pn, 20, 20, 1, now += 25);
+    ok(cc.cwnd == 40 * 1200);
+    ok(cc.state.prague.alpha == 1 - QUICLY_PRAGUE_ALPHA_GAIN);
+
+    /* CE mark reduces CWND by alpha / 2 and exits slow start, but only once per round */
+    cc.type->cc_on_ecn_ce(&cc, &loss, 1, pn - 1, pn + 40, now, 1200);
+    cwnd = 40 * 1200 - (uint32_t)(40 * 1200 * (1 - QUICLY_PRAGUE_ALPHA_GAIN) / 2);
+    ok(cc.cwnd == cwnd);
+    ok(cc.ssthresh == cwnd);
+    ok(cc.num_loss_episodes == 1);
+    ok(cc.num_ecn_loss_episodes == 1);
+    cc.type->cc_on_ecn_ce(&cc, &loss, 1, pn - 1, pn + 40, now, 1200);
+    ok(cc.cwnd == cwnd);
+    ok(cc.num_loss_episodes == 1);
+
+    /* alpha converges to the fraction of packets being marked */
+    for (int i = 0; i < 200; ++i) {
+        ack_packets_one_by_one(&cc, &loss, &pn, 20, 20, 0, now += 25);
+        cc.type->cc_on_ecn_ce(&cc, &loss, 2, pn - 1, pn + 20, now, 1200);
+    }
+    ok(0.09 < cc.state.prague.alpha && cc.state.prague.alpha < 0.11);
+
+    /* the reduction is proportional to alpha, whereas loss halves CWND */
+    cc.cwnd = 100 * 1200;
+    cc.type->cc_on_ecn_ce(&cc, &loss, 1, pn + 100, pn + 200, now, 1200);
+    cwnd = 100 * 1200 - (uint32_t)(100 * 1200 * cc.state.prague.alpha / 2);
+    ok(cc.cwnd == cwnd);
+    ok(cc.cwnd > 100 * 1200 * 0.94);
+    cc.type->cc_on_lost(&cc, &loss, 1200, pn + 200, pn + 300, now, 1200);
+    ok(cc.cwnd == cwnd / 2);
+    ok(cc.num_ecn_loss_episodes == cc.num_loss_episodes - 1);
+
+    /* persistent congestion collapses CWND to the minimum and resets alpha */
+    cc.type->cc_on_persistent_congestion(&cc, &loss, now);
+    ok(cc.cwnd == QUICLY_MIN_CWND * 1200);
+    ok(cc.cwnd_minimum == cc.cwnd);
+    ok(cc.state.prague.alpha == 1);
+
+    /* in congestion avoidance, CWND grows by 1 MTU per CWND acked at the reference RTT, and is paced at 1.25x */
+    quicly_cc_prague_init.cb(&quicly_cc_prague_init, &cc, 100 * 1200, now);
+    cc.ssthresh = cc.cwnd;
+    pn = 0;
+    ack_packets_one_by_one(&cc, &loss, &pn, 99, 100, 1, now += 25);
+    ok(cc.cwnd == 100 * 1200);
+    ack_packets_one_by_one(&cc, &loss, &pn, 1, 100, 1, now);
+    ok(cc.cwnd == 101 * 1200);
+    ok(cc.type->cc_pacing_rate(&cc, &loss) == 101 * 1200 * 5 / 4 / 25);
+
+    /* below the reference RTT, the increase is scaled by (RTT / RTT_ref)^2, making the rate of increase RTT-independent */
+    loss.rtt.smoothed = 5;
+    quicly_cc_prague_init.cb(&quicly_cc_prague_init, &cc, 100 * 1200, now);
+    cc.ssthresh = cc.cwnd;
+    pn = 0;
+    ack_packets_one_by_one(&cc, &loss, &pn, 2499, 100, 1, now += 5);
+    ok(cc.cwnd == 100 * 1200);
+    ack_packets_one_by_one(&cc, &loss, &pn, 1, 100, 1, now);
+    ok(cc.cwnd == 101 * 1200);
+}
+
+static void test_ledbat(void)
+{
+    quicly_loss_t loss = {.rtt = {.minimum = 40, .smoothed = 40, .latest = 40}};
+    quicly_cc_t cc;
+    uint64_t pn = 0;
+    int64_t now = 1000;
+    uint32_t cwnd;
+
+    /* slow start is slowed down by GAIN, which is 1/16 when base delay is small */
+    loss.rtt.minimum = 5;
+    quicly_cc_ledbat_init.cb(&quicly_cc_ledbat_init, &cc, 10 * 1200, now);
+    ack_packets_one_by_one(&cc, &loss, &pn, 10, 10, 1, now);
+    ok(cc.cwnd == 10 * 1200 + 10 * 1200 / QUICLY_LEDBAT_MAX_GAIN_DIVISOR);
+
+    /* GAIN is 1 / ceil(2 * TARGET / base_delay) (i.e., 1/3) when base delay is 40ms */
+    loss.rtt.minimum = 40;
+    quicly_cc_ledbat_init.cb(&quicly_cc_ledbat_init, &cc, 10 * 1200, now);
+    ack_packets_one_by_one(&cc, &loss, &pn, 10, 10, 1, now);
+    ok(cc.cwnd == 16000);
+
+    /* slow start is exitted once the minimum of the latest samples exceeds 3/4 of the target */
+    loss.rtt.latest = 40 + QUICLY_LEDBAT_TARGET * 3 / 4 + 5;
+    ack_packets_one_by_one(&cc, &loss, &pn, QUICLY_LEDBAT_DELAY_FILTER - 1, 10, 1, now += 100);
+    ok(cc.cwnd == 17200);
+    ok(cc.cwnd_exiting_slow_start == 0);
+    ack_packets_one_by_one(&cc, &loss, &pn, 1, 10, 1, now);
+    ok(cc.cwnd == 17200);
+    ok(cc.ssthresh == 17200);
+    ok(cc.cwnd_exiting_slow_start == 17200);
+    ok(cc.state.ledbat.slowdown_at == now + 2 * 40);
+
+    /* below the target, CWND grows by GAIN MTUs per CWND acked */
+    loss.rtt.latest = 40;
+    ack_packets_one_by_one(&cc, &loss, &pn, 17200 * 3 / 1200 - 1, 15, 1, now += 50);
+    ok(cc.cwnd == 17200);
+    ack_packets_one_by_one(&cc, &loss, &pn, 1, 15, 1, now);
+    ok(cc.cwnd == 18400);
+
+    /* above the target, CWND is reduced in proportion to the excess (i.e., 25% of the bytes being acked, minus GAIN) */
+    loss.rtt.latest = 40 + QUICLY_LEDBAT_TARGET * 5 / 4;
+    ack_packets_one_by_one(&cc, &loss, &pn, QUICLY_LEDBAT_DELAY_FILTER - 1, 15, 1, now);
+    ok(cc.cwnd == 18400);
+    ack_packets_one_by_one(&cc, &loss, &pn, 1, 15, 1, now);
+    ok(cc.cwnd == 18400 - (1200 / 4 - 1200 * 1200 / (18400 * 3)));
+
+    /* ... but by no more than half of the bytes being acked */
+    loss.rtt.latest = 40 + QUICLY_LEDBAT_TARGET * 4;
+    ack_packets_one_by_one(&cc, &loss, &pn, QUICLY_LEDBAT_DELAY_FILTER, 15, 1, now);
+    cwnd = cc.cwnd;
+    ack_packets_one_by_one(&cc, &loss, &pn, 1, 15, 1, now);
+    ok(cc.cwnd == cwnd - 1200 / 2);
+    ok(cc.num_loss_episodes == 0);
+
+    /* periodic slowdown drops CWND to the minimum for 2 RTTs, then regains the previous CWND using slow start */
+    loss.rtt.latest = 40;
+    cwnd = cc.cwnd;
+    now = cc.state.ledbat.slowdown_at;
+    ack_packets_one_by_one(&cc, &loss, &pn, 1, 15, 1, now);
+    ok(cc.cwnd == QUICLY_MIN_CWND * 1200);
+    ok(cc.ssthresh == cwnd);
+    ack_packets_one_by_one(&cc, &loss, &pn, 10, 2, 1, now + 2 * 40 - 1);
+    ok(cc.cwnd == QUICLY_MIN_CWND * 1200);
+    for (int i = 0; i < 1000 && cc.state.ledbat.slowdown_started_at != INT64_MAX; ++i)
+        ack_packets_one_by_one(&cc, &loss, &pn, 1, 10, 1, now + 100);
+    ok(cc.cwnd == cwnd);
+    ok(cc.state.ledbat.slowdown_at == now + 100 + 100 * QUICLY_LEDBAT_SLOWDOWN_INTERVAL_RATIO);
+
+    /* loss halves CWND */
+    cc.type->cc_on_lost(&cc, &loss, 1200, pn, pn + 15, now + 100, 1200);
+    ok(cc.cwnd == cwnd / 2);
+    ok(cc.num_loss_episodes == 1);
+
+    /* persistent congestion collapses CWND to the minimum, deferring the next slowdown until slow start is exitted again */
+    cc.type->cc_on_persistent_congestion(&cc, &loss, now + 100);
+    ok(cc.cwnd == QUICLY_MIN_CWND * 1200);
+    ok(cc.cwnd < cc.ssthresh);
+    ok(cc.state.ledbat.slowdown_at == INT64_MAX);
+    ok(cc.state.ledbat.slowdown_started_at == INT64_MAX);
+}
+
 void test_cc(void)
 {
     subtest("rapid-start", test_rapid_start);
+    subtest("hystart", test_hystart);
+    subtest("app-limited", test_app_limited);
+    subtest("cubic", test_cubic);
+    subtest("bbr", test_bbr);
+    subtest("bbr-ecn", test_bbr_ecn);
+    subtest("prague", test_prague);
+    subtest("ledbat", test_ledbat);
 }
@@ -32,12 +32,14 @@ static void test_jumpstart_pattern(quicly_init_cc_t *init, const struct test_jum
     static const uint32_t mtu = 1200;
     quicly_loss_t loss = {.rtt = {.latest = 100, .smoothed = 100, .minimum = 100, .variance = 0}};
     quicly_cc_t cc;
+    quicly_delivery_rate_sample_t rs;
     int64_t now = 1;
     uint64_t next_pn = 0;
     uint32_t packets_acked = 0, packets_inflight = 0;
     size_t ackcnt = 0;
 
     init->cb(init, &cc, 10 * mtu, now);
+    quicly_sentmap_init_rate_sample(&rs); /* no delivery rate sample is provided */
     ok(cc.cwnd == 10 * mtu);
     ok(cc.num_loss_episodes == 0);
 
@@ -50,7 +52,7 @@ static void test_jumpstart_pattern(quicly_init_cc_t *init, const struct test_jum
             break;
         case TEST_JUMPSTART_ACTION_ACKED:
             cc.type->cc_on_acked(&cc, &loss, action->packets * mtu, packets_acked + action->packets - 1, packets_inflight * mtu, 1,
-                                 next_pn, action->now, mtu);
+                                 &rs, next_pn, action->now, mtu);
             packets_inflight -= action->packets;
             packets_acked += action->packets;
             ++ackcnt;
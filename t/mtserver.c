@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2026 Fastly
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include "picotls/openssl.h"
+#include "quicly/defaults.h"
+#include "quicly/mtserver.h"
+#include "test.h"
+
+static quicly_decoded_packet_t build_packet(uint8_t *cid, size_t cidlen, uint64_t node_id, uint32_t thread_id)
+{
+    quicly_decoded_packet_t packet = {.cid.dest = {.encrypted = ptls_iovec_init(cid, cidlen),
+                                                   .plaintext = {.node_id = node_id, .thread_id = thread_id}}};
+    return packet;
+}
+
+static void test_route(void)
+{
+    uint8_t cid[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    quicly_decoded_packet_t packet;
+
+    /* CIDs issued by this node are routed by thread_id */
+    packet = build_packet(cid, sizeof(cid), 1234, 3);
+    ok(quicly_mtserver_route(&packet, 1234, 4) == 3);
+    packet = build_packet(cid, sizeof(cid), 1234, 0);
+    ok(quicly_mtserver_route(&packet, 1234, 4) == 0);
+
+    /* others are routed by the hash of the CID, regardless of the socket they arrive at */
+    size_t hashed = quicly_mtserver_route(&packet, 5678, 4);
+    ok(hashed < 4);
+    packet = build_packet(cid, sizeof(cid), 1234, 4); /* thread_id out of range */
+    ok(quicly_mtserver_route(&packet, 1234, 4) == hashed);
+    packet = build_packet(cid, sizeof(cid), quicly_cid_plaintext_invalid.node_id, quicly_cid_plaintext_invalid.thread_id);
+    ok(quicly_mtserver_route(&packet, 1234, 4) == hashed);
+
+    /* client-generated CIDs are spread among the workers */
+    size_t counts[4] = {0};
+    for (size_t i = 0; i < 1000; ++i) {
+        memcpy(cid, &i, sizeof(i));
+        packet = build_packet(cid, sizeof(cid), quicly_cid_plaintext_invalid.node_id, quicly_cid_plaintext_invalid.thread_id);
+        ++counts[quicly_mtserver_route(&packet, 1234, 4)];
+    }
+    for (size_t i = 0; i < 4; ++i)
+        ok(counts[i] > 150);
+}
+
+static size_t num_init_context_calls, num_dispose_context_calls;
+
+static int init_context(quicly_mtserver_t *server, size_t thread_id, quicly_context_t *ctx)
+{
+    ok(quicly_mtserver_get_data(server) == &num_init_context_calls);
+    ok(ctx != &quic_ctx);
+    ++num_init_context_calls;
+    return 0;
+}
+
+static void dispose_context(quicly_mtserver_t *server, size_t thread_id, quicly_context_t *ctx)
+{
+    ok(ctx != &quic_ctx);
+    ++num_dispose_context_calls;
+}
+
+static void test_lifecycle(void)
+{
+    quicly_mtserver_callbacks_t callbacks = {.init_context = init_context, .dispose_context = dispose_context};
+    quicly_address_t addr = {.sin = {.sin_family = AF_INET}};
+    quicly_mtserver_t *server;
+
+    addr.sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    /* all the workers share the ephemeral port chosen for the first socket */
+    server = quicly_mtserver_create(&quic_ctx, &addr.sa, 3, 0, &callbacks, &num_init_context_calls);
+    ok(server != NULL);
+    struct sockaddr_in *sockname = (struct sockaddr_in *)quicly_mtserver_get_sockname(server);
+    ok(sockname->sin_family == AF_INET);
+    ok(sockname->sin_port != 0);
+
+    ok(quicly_mtserver_start(server) == 0);
+    ok(num_init_context_calls == 3);
+    quicly_mtserver_stop(server);
+
+    /* contexts are set up only once, and are disposed when the server is freed */
+    ok(quicly_mtserver_start(server) == 0);
+    ok(num_init_context_calls == 3);
+    quicly_mtserver_stop(server);
+    ok(num_dispose_context_calls == 0);
+    quicly_mtserver_free(server);
+    ok(num_dispose_context_calls == 3);
+}
+
+static void test_handoff(void)
+{
+    quicly_mtserver_callbacks_t callbacks = {NULL};
+    quicly_address_t addr = {.sin = {.sin_family = AF_INET}};
+    quicly_mtserver_t *server;
+    int fds[16];
+
+    addr.sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    server = quicly_mtserver_create(&quic_ctx, &addr.sa, 4, 0, &callbacks, NULL);
+    ok(server != NULL);
+    ok(quicly_mtserver_start(server) == 0);
+
+    /* Send packets of an unknown version from multiple sockets. SO_REUSEPORT distributes them by the 4-tuple, whereas the owner is
+     * determined by the CID, therefore some of them are handed off. Each of them should be answered with a VN packet. */
+    for (size_t i = 0; i < PTLS_ELEMENTSOF(fds); ++i) {
+        uint8_t datagram[1200] = {0xc0, 0x1a, 0x1a, 0x1a, 0x1a, 8, 'd', 'c', 'i', 'd', 0, 0, 0, (uint8_t)i, 0};
+        fds[i] = socket(AF_INET, SOCK_DGRAM, 0);
+        assert(fds[i] != -1);
+        ok(sendto(fds[i], datagram, sizeof(datagram), 0, quicly_mtserver_get_sockname(server), sizeof(struct sockaddr_in)) ==
+           sizeof(datagram));
+    }
+    size_t num_vn = 0;
+    for (size_t i = 0; i < PTLS_ELEMENTSOF(fds); ++i) {
+        struct pollfd pfd = {.fd = fds[i], .events = POLLIN};
+        uint8_t buf[1500];
+        ssize_t rret;
+        if (poll(&pfd, 1, 1000) == 1 && (rret = recv(fds[i], buf, sizeof(buf), 0)) >= 5 && buf[1] == 0 && buf[2] == 0 &&
+            buf[3] == 0 && buf[4] == 0)
+            ++num_vn;
+        close(fds[i]);
+    }
+    ok(num_vn == PTLS_ELEMENTSOF(fds));
+
+    quicly_mtserver_stop(server);
+    quicly_mtserver_free(server);
+}
+
+static size_t num_accepted, num_closed;
+
+static int init_handshake_context(quicly_mtserver_t *server, size_t thread_id, quicly_context_t *ctx)
+{
+    /* workers use the real clock, as they run concurrently with the test */
+    ctx->now = &quicly_default_now;
+    if ((ctx->cid_encryptor = quicly_new_default_cid_encryptor(&ptls_openssl_aes128ecb, &ptls_openssl_aes128ecb,
+                                                               &ptls_openssl_sha256, ptls_iovec_init("abc", 3))) == NULL)
+        return -1;
+    return 0;
+}
+
+static void dispose_handshake_context(quicly_mtserver_t *server, size_t thread_id, quicly_context_t *ctx)
+{
+    quicly_free_default_cid_encryptor(ctx->cid_encryptor);
+}
+
+static void on_accept(quicly_mtserver_worker_t *worker, quicly_conn_t *conn)
+{
+    __atomic_add_fetch(&num_accepted, 1, __ATOMIC_RELAXED);
+}
+
+static void on_close(quicly_mtserver_worker_t *worker, quicly_conn_t *conn)
+{
+    __atomic_add_fetch(&num_closed, 1, __ATOMIC_RELAXED);
+}
+
+static void test_handshake(void)
+{
+    quicly_mtserver_callbacks_t callbacks = {.init_context = init_handshake_context,
+                                             .dispose_context = dispose_handshake_context,
+                                             .on_accept = on_accept,
+                                             .on_close = on_close};
+    quicly_address_t addr = {.sin = {.sin_family = AF_INET}};
+    quicly_mtserver_t *server;
+    quicly_conn_t *client;
+    quicly_stats_t stats;
+    quicly_error_t ret;
+    int fd;
+
+    addr.sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    server = quicly_mtserver_create(&quic_ctx, &addr.sa, 4, 0, &callbacks, NULL);
+    ok(server != NULL);
+    ok(quicly_mtserver_start(server) == 0);
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    assert(fd != -1);
+
+    ret = quicly_connect(&client, &quic_ctx, "example.com", quicly_mtserver_get_sockname(server), NULL, new_master_id(),
+                         ptls_iovec_init(NULL, 0), NULL, NULL, NULL);
+    ok(ret == 0);
+
+    /* Run the handshake until it is confirmed. Initial packets carry the CID chosen by the client, whereas the others carry the
+     * CID issued by the worker that accepted the connection, each of them being looked up using a different index. */
+    for (size_t i = 0; i < 100; ++i) {
+        quicly_address_t dest, src;
+        struct iovec datagrams[10];
+        uint8_t buf[PTLS_ELEMENTSOF(datagrams) * quic_ctx.transport_params.max_udp_payload_size];
+        size_t num_datagrams = PTLS_ELEMENTSOF(datagrams);
+        if ((ret = quicly_send(client, &dest, &src, datagrams, &num_datagrams, buf, sizeof(buf))) != 0)
+            break;
+        for (size_t j = 0; j < num_datagrams; ++j)
+            sendto(fd, datagrams[j].iov_base, datagrams[j].iov_len, 0, &dest.sa, quicly_get_socklen(&dest.sa));
+        struct pollfd pfd = {.fd = fd, .events = POLLIN};
+        while (poll(&pfd, 1, 100) == 1) {
+            quicly_address_t from;
+            socklen_t fromlen = sizeof(from);
+            ssize_t rret;
+            if ((rret = recvfrom(fd, buf, sizeof(buf), 0, &from.sa, &fromlen)) <= 0)
+                break;
+            size_t off = 0;
+            while (off < (size_t)rret) {
+                quicly_decoded_packet_t packet;
+                if (quicly_decode_packet(&quic_ctx, &packet, buf, rret, &off) == SIZE_MAX)
+                    break;
+                quicly_receive(client, NULL, &from.sa, &packet);
+            }
+        }
+        quicly_get_stats(client, &stats);
+        if (stats.handshake_confirmed_msec != UINT64_MAX)
+            break;
+    }
+    ok(ret == 0);
+    quicly_get_stats(client, &stats);
+    ok(stats.handshake_confirmed_msec != UINT64_MAX);
+    ok(__atomic_load_n(&num_accepted, __ATOMIC_RELAXED) == 1);
+
+    quicly_free(client);
+    close(fd);
+    quicly_mtserver_stop(server);
+    ok(num_closed == 1);
+    quicly_mtserver_free(server);
+}
+
+void test_mtserver(void)
+{
+    subtest("route", test_route);
+    subtest("lifecycle", test_lifecycle);
+    subtest("handoff", test_handoff);
+    subtest("handshake", test_handshake);
+}
@@ -52,17 +52,18 @@ struct pattern {
     size_t consume;
 };
 
-static int64_t test_pattern(quicly_pacer_t *pacer, int64_t now, const uint32_t bytes_per_msec, const struct pattern *expected)
+static int64_t test_pattern(quicly_pacer_t *pacer, int64_t now, const uint32_t bytes_per_msec, uint32_t burst,
+                            const struct pattern *expected)
 {
     for (; expected->at != 0; ++expected) {
-        int64_t send_at = quicly_pacer_can_send_at(pacer, bytes_per_msec, mtu);
+        int64_t send_at = quicly_pacer_can_send_at(pacer, bytes_per_msec, mtu, burst);
         if (now == expected->at) {
             ok(send_at <= now);
         } else {
             ok(send_at == expected->at);
             now = send_at;
         }
-        size_t window = quicly_pacer_get_window(pacer, now, bytes_per_msec, mtu);
+        size_t window = quicly_pacer_get_window(pacer, now, bytes_per_msec, mtu, burst);
         ok((window + mtu - 1) / mtu * mtu == expected->avail);
         quicly_pacer_consume_window(pacer, expected->consume);
     }
@@ -79,7 +80,7 @@ static void test_medium(void)
     quicly_pacer_reset(&pacer);
 
     /* 3x pacer-restricted, then non-pacer-restricted */
-    now = test_pattern(&pacer, now, bytes_per_msec,
+    now = test_pattern(&pacer, now, bytes_per_msec, QUICLY_PACER_BURST_LOW,
                        (const struct pattern[]){
                            {1, 10 * mtu, 10 * mtu},
                            {2, 4 * mtu, 4 * mtu},
@@ -91,7 +92,7 @@ static void test_medium(void)
 
     /* in the next millisecond, we have new data to send, and we borrow 3mtu from the previous millisec */
     now = 5;
-    now = test_pattern(&pacer, now, bytes_per_msec,
+    now = test_pattern(&pacer, now, bytes_per_msec, QUICLY_PACER_BURST_LOW,
                        (const struct pattern[]){
                            {5, 7 * mtu, 7 * mtu},
                            {6, 4 * mtu, 1 * mtu},
@@ -101,7 +102,7 @@ static void test_medium(void)
 
     /* skip 2ms, and we can send a burst */
     now = 8;
-    now = test_pattern(&pacer, now, bytes_per_msec,
+    now = test_pattern(&pacer, now, bytes_per_msec, QUICLY_PACER_BURST_LOW,
                        (const struct pattern[]){
                            {8, 10 * mtu, 10 * mtu},
                            {9, 4 * mtu, 1 * mtu},
@@ -118,7 +119,7 @@ static void test_slow(void)
 
     quicly_pacer_reset(&pacer);
 
-    now = test_pattern(&pacer, now, bytes_per_msec,
+    now = test_pattern(&pacer, now, bytes_per_msec, QUICLY_PACER_BURST_LOW,
                        (const struct pattern[]){
                            {1, 10 * mtu, 10 * mtu}, /* borrow 12000 bytes */
                            {5, 2 * mtu, 2 * mtu},   /* borrowing 11600 bytes after 4ms */
@@ -141,7 +142,7 @@ static void test_fast(void)
 
     quicly_pacer_reset(&pacer);
 
-    now = test_pattern(&pacer, now, bytes_per_msec,
+    now = test_pattern(&pacer, now, bytes_per_msec, QUICLY_PACER_BURST_LOW,
                        (const struct pattern[]){
                            {1, 84 * mtu, 84 * mtu}, /* borrow 800 bytes */
                            {2, 83 * mtu, 83 * mtu}, /* borrowing 400 bytes */
@@ -151,10 +152,77 @@ static void test_fast(void)
                        });
 }
 
+static void test_calc_burst(void)
+{
+    /* without GSO, the default is used unless CWND is small */
+    ok(quicly_pacer_calc_burst(4 * mtu, 0, mtu, 0) == QUICLY_PACER_BURST_LOW);
+    ok(quicly_pacer_calc_burst(100000, 1000000, mtu, 0) == QUICLY_PACER_BURST_LOW);
+    ok(quicly_pacer_calc_burst(100000, 1000000, mtu, 1) == QUICLY_PACER_BURST_LOW);
+
+    /* with GSO, the burst grows up to 1ms of data ... */
+    ok(quicly_pacer_calc_burst(4 * mtu, 40 * mtu, mtu, 64) == QUICLY_PACER_BURST_LOW);
+    ok(quicly_pacer_calc_burst(30 * mtu, 300 * mtu, mtu, 64) == 30);
+    /* ... or to the GSO batch size (10Gbps, 1ms RTT) */
+    ok(quicly_pacer_calc_burst(1250000, 1250000, mtu, 64) == 64);
+    ok(quicly_pacer_calc_burst(100000, 1000000, mtu, 64) == 64);
+
+    /* sub-ms RTT (rounded up to 1ms) with a moderate rate; burst is capped to 1/4 of CWND */
+    ok(quicly_pacer_calc_burst(40 * mtu, 40 * mtu, mtu, 64) == 10);
+    /* the cap does not scale with the pacing multiplier being used during slow start */
+    ok(quicly_pacer_calc_burst(quicly_pacer_calc_send_rate(2, 40 * mtu, 1), 40 * mtu, mtu, 64) == 10);
+    ok(quicly_pacer_calc_burst(quicly_pacer_calc_send_rate(3, 40 * mtu, 1), 40 * mtu, mtu, 64) == 10);
+
+    /* slow paths */
+    ok(quicly_pacer_calc_burst(700, 70000, mtu, 64) == QUICLY_PACER_BURST_LOW);
+    ok(quicly_pacer_calc_burst(700, 14000, mtu, 64) == 2);
+    ok(quicly_pacer_calc_burst(700, 3500, mtu, 64) == QUICLY_PACER_BURST_MIN);
+}
+
+static void test_slow_small_cwnd(void)
+{
+    const uint32_t bytes_per_msec = 700;
+    quicly_pacer_t pacer;
+    int64_t now = 1;
+
+    quicly_pacer_reset(&pacer);
+
+    /* same rate as test_slow, but the burst is capped to a quarter of CWND, which is small */
+    now = test_pattern(&pacer, now, bytes_per_msec, quicly_pacer_calc_burst(bytes_per_msec, bytes_per_msec * 20, mtu, 0),
+                       (const struct pattern[]){
+                           {1, 4 * mtu, 4 * mtu},  /* borrow 4800 bytes */
+                           {5, 2 * mtu, 2 * mtu},  /* borrowing 4400 bytes after 4ms */
+                           {8, 2 * mtu, 2 * mtu},  /* borrowing 4700 bytes after 3ms */
+                           {12, 2 * mtu, 2 * mtu}, /* borrowing 4300 bytes after 4ms */
+                           {0},
+                       });
+}
+
+static void test_gso(void)
+{
+    const uint32_t bytes_per_msec = 30 * mtu;
+    quicly_pacer_t pacer;
+    int64_t now = 1;
+
+    quicly_pacer_reset(&pacer);
+
+    /* 1ms worth of data is sent every millisecond, in addition to the initial burst of 2 packets */
+    now = test_pattern(&pacer, now, bytes_per_msec, quicly_pacer_calc_burst(bytes_per_msec, bytes_per_msec * 10, mtu, 64),
+                       (const struct pattern[]){
+                           {1, 32 * mtu, 32 * mtu},
+                           {2, 30 * mtu, 30 * mtu},
+                           {3, 30 * mtu, 30 * mtu},
+                           {0},
+                       });
+    ok(now == 3);
+}
+
 void test_pacer(void)
 {
     subtest("calc-rate", test_calc_rate);
+    subtest("calc-burst", test_calc_burst);
     subtest("medium", test_medium);
     subtest("slow", test_slow);
     subtest("fast", test_fast);
+    subtest("slow-small-cwnd", test_slow_small_cwnd);
+    subtest("gso", test_gso);
 }
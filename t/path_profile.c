@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2017-2024 Fastly, Kazuho Oku
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <arpa/inet.h>
+#include "quicly/defaults.h"
+#include "test.h"
+
+static struct sockaddr *build_address(quicly_address_t *addr, const char *str)
+{
+    memset(addr, 0, sizeof(*addr));
+    if (inet_pton(AF_INET, str, &addr->sin.sin_addr) == 1) {
+        addr->sin.sin_family = AF_INET;
+    } else {
+        int ret = inet_pton(AF_INET6, str, &addr->sin6.sin6_addr);
+        assert(ret == 1);
+        addr->sin6.sin6_family = AF_INET6;
+    }
+    return &addr->sa;
+}
+
+static int lookup(quicly_path_profile_cache_t *cache, const char *str, int64_t now, quicly_path_profile_t *profile)
+{
+    quicly_address_t addr;
+    return cache->lookup(cache, NULL, build_address(&addr, str), now, profile);
+}
+
+static void store(quicly_path_profile_cache_t *cache, const char *str, int64_t now, uint64_t delivery_rate)
+{
+    quicly_address_t addr;
+    quicly_path_profile_t profile = {.delivery_rate = delivery_rate, .min_rtt = 10, .loss_permille = 1};
+    cache->store(cache, NULL, build_address(&addr, str), now, &profile);
+}
+
+static void test_default_cache(void)
+{
+    quicly_path_profile_cache_t *cache = quicly_new_default_path_profile_cache(8, 24, 48, 1000);
+    quicly_path_profile_t profile;
+
+    ok(!lookup(cache, "192.0.2.1", 0, &profile));
+    store(cache, "192.0.2.1", 0, 1000);
+
+    /* hosts in the same subnet share the entry */
+    ok(lookup(cache, "192.0.2.200", 10, &profile));
+    ok(profile.delivery_rate == 1000);
+    ok(profile.min_rtt == 10);
+    ok(profile.loss_permille == 1);
+    ok(lookup(cache, "::ffff:192.0.2.5", 10, &profile));
+    ok(!lookup(cache, "198.51.100.1", 10, &profile));
+    ok(!lookup(cache, "192.0.3.1", 10, &profile));
+
+    /* IPv6 */
+    store(cache, "2001:db8:1::1", 0, 2000);
+    ok(lookup(cache, "2001:db8:1:ffff::1", 10, &profile));
+    ok(profile.delivery_rate == 2000);
+    ok(!lookup(cache, "2001:db8:2::1", 10, &profile));
+
+    /* the last observation wins */
+    store(cache, "192.0.2.2", 500, 3000);
+    ok(lookup(cache, "192.0.2.1", 510, &profile));
+    ok(profile.delivery_rate == 3000);
+
+    /* entries expire */
+    ok(!lookup(cache, "2001:db8:1::1", 1000, &profile));
+    ok(lookup(cache, "192.0.2.1", 1499, &profile));
+    ok(!lookup(cache, "192.0.2.1", 1500, &profile));
+
+    /* the number of entries is bounded */
+    char str[sizeof("10.0.255.1")];
+    size_t num_found = 0;
+    for (int i = 0; i < 256; ++i) {
+        sprintf(str, "10.0.%d.1", i);
+        store(cache, str, 2000, 1000);
+    }
+    for (int i = 0; i < 256; ++i) {
+        sprintf(str, "10.0.%d.1", i);
+        if (lookup(cache, str, 2000, &profile))
+            ++num_found;
+    }
+    ok(0 < num_found && num_found <= 8);
+
+    quicly_free_default_path_profile_cache(cache);
+}
+
+void test_path_profile(void)
+{
+    subtest("default-cache", test_default_cache);
+}
@@ -241,9 +241,43 @@ static void test_next_missing(void)
     }
 }
 
+static void test_shrink(void)
+{
+    quicly_ranges_t ranges;
+
+    quicly_ranges_init(&ranges);
+    for (uint64_t i = 0; i < 10; ++i)
+        quicly_ranges_add(&ranges, i * 10, i * 10 + 5);
+    ok(ranges.capacity == 16);
+
+    quicly_ranges_add(&ranges, 0, 47);
+    CHECK({0, 47}, {50, 55}, {60, 65}, {70, 75}, {80, 85}, {90, 95});
+    ok(ranges.capacity == 16);
+    quicly_ranges_shrink(&ranges);
+    ok(ranges.capacity == 6);
+    CHECK({0, 47}, {50, 55}, {60, 65}, {70, 75}, {80, 85}, {90, 95});
+
+    /* can grow after being shrunk */
+    quicly_ranges_add(&ranges, 100, 105);
+    CHECK({0, 47}, {50, 55}, {60, 65}, {70, 75}, {80, 85}, {90, 95}, {100, 105});
+
+    /* the heap allocation is released when up to one range is stored */
+    quicly_ranges_add(&ranges, 0, 105);
+    CHECK({0, 105});
+    quicly_ranges_shrink(&ranges);
+    ok(ranges.ranges == &ranges._initial);
+    ok(ranges.capacity == 1);
+    CHECK({0, 105});
+
+    quicly_ranges_add(&ranges, 200, 201);
+    CHECK({0, 105}, {200, 201});
+    quicly_ranges_clear(&ranges);
+}
+
 void test_ranges(void)
 {
     subtest("add", test_add);
     subtest("subtract", test_subtract);
     subtest("next_missing", test_next_missing);
+    subtest("shrink", test_shrink);
 }
@@ -189,9 +189,87 @@ static void test_pto(void)
     quicly_sentmap_dispose(&map);
 }
 
+static void ack_packets(quicly_sentmap_t *map, quicly_delivery_rate_sample_t *rs, size_t num_packets, int64_t now)
+{
+    quicly_sentmap_iter_t iter;
+
+    quicly_sentmap_init_rate_sample(rs);
+    quicly_sentmap_init_iter(map, &iter);
+    for (size_t i = 0; i < num_packets; ++i) {
+        quicly_sentmap_update_rate_sample(map, rs, quicly_sentmap_get(&iter), now);
+        quicly_sentmap_update(map, &iter, QUICLY_SENTMAP_EVENT_ACKED);
+    }
+}
+
+static void test_rate_sample(void)
+{
+    quicly_sentmap_t map;
+    quicly_sentmap_iter_t iter;
+    quicly_delivery_rate_sample_t rs;
+    uint64_t pn;
+
+    quicly_sentmap_init(&map);
+
+    /* send 10 packets at t=0, ack them at t=50 */
+    for (pn = 0; pn < 10; ++pn) {
+        quicly_sentmap_prepare(&map, pn, 0, QUICLY_EPOCH_1RTT);
+        quicly_sentmap_commit(&map, 1000, 1, 0);
+    }
+    ack_packets(&map, &rs, 10, 50);
+    quicly_sentmap_generate_rate_sample(&map, &rs, 50);
+    ok(rs.delivered == 10000);
+    ok(rs.interval == 50);
+    ok(rs.rate == 200000);
+    ok(!rs.is_app_limited);
+    ok(map.rate.delivered == 10000);
+
+    /* sender becomes app-limited, sending 5 packets at t=50 */
+    quicly_sentmap_on_app_limited(&map);
+    ok(map.rate.app_limited == 10000);
+    for (; pn < 15; ++pn) {
+        quicly_sentmap_prepare(&map, pn, 50, QUICLY_EPOCH_1RTT);
+        quicly_sentmap_commit(&map, 1000, 0, 0);
+    }
+    quicly_sentmap_init_iter(&map, &iter);
+    ok(quicly_sentmap_get(&iter)->app_limited);
+    ok(quicly_sentmap__get_rate(&map, quicly_sentmap_get(&iter))->delivered == 10000);
+    ok(quicly_sentmap__get_rate(&map, quicly_sentmap_get(&iter))->delivered_time_delta == 0);
+
+    /* samples shorter than min RTT are invalid; the marker is cleared once packets sent after the bubble are acked */
+    ack_packets(&map, &rs, 2, 90);
+    quicly_sentmap_generate_rate_sample(&map, &rs, 50);
+    ok(rs.rate == 0);
+    ok(map.rate.app_limited == 0);
+
+    /* the sample is flagged as app-limited, as the packet was sent while being app-limited */
+    ack_packets(&map, &rs, 3, 100);
+    quicly_sentmap_generate_rate_sample(&map, &rs, 50);
+    ok(rs.delivered == 5000);
+    ok(rs.interval == 50);
+    ok(rs.rate == 100000);
+    ok(rs.is_app_limited);
+
+    /* the per-packet state is retained while the table is grown, and is released by shrink once all packets are acked */
+    for (; pn < 115; ++pn) {
+        quicly_sentmap_prepare(&map, pn, 100, QUICLY_EPOCH_1RTT);
+        quicly_sentmap_commit(&map, 1000, 1, 0);
+    }
+    ok(map.rate.capacity == 128);
+    ack_packets(&map, &rs, 100, 150);
+    quicly_sentmap_generate_rate_sample(&map, &rs, 50);
+    ok(rs.delivered == 100000);
+    ok(rs.interval == 50);
+    ok(!rs.is_app_limited);
+    quicly_sentmap_shrink(&map);
+    ok(map.rate.packets == NULL);
+
+    quicly_sentmap_dispose(&map);
+}
+
 void test_sentmap(void)
 {
     subtest("basic", test_basic);
     subtest("late-ack", test_late_ack);
     subtest("pto", test_pto);
+    subtest("rate-sample", test_rate_sample);
 }
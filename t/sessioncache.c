@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2026 Fastly
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <pthread.h>
+#include "quicly/sessioncache.h"
+#include "test.h"
+
+static int take(quicly_ticket_store_t *store, const char *server_name, int64_t now, const char *expected)
+{
+    ptls_iovec_t ticket = quicly_ticket_store_take(store, ptls_iovec_init(server_name, strlen(server_name)), now);
+    int ret;
+
+    if (ticket.base == NULL)
+        return expected == NULL;
+    ret = expected != NULL && ticket.len == strlen(expected) && memcmp(ticket.base, expected, ticket.len) == 0;
+    free(ticket.base);
+    return ret;
+}
+
+static void save(quicly_ticket_store_t *store, const char *server_name, const char *ticket, int64_t expires_at)
+{
+    int ret = quicly_ticket_store_save(store, ptls_iovec_init(server_name, strlen(server_name)),
+                                       ptls_iovec_init(ticket, strlen(ticket)), expires_at);
+    ok(ret == 0);
+}
+
+static void test_ticket_store(void)
+{
+    quicly_ticket_store_t *store = quicly_new_ticket_store(4, 1);
+
+    ok(take(store, "example.com", 0, NULL));
+
+    /* tickets are handed out once, newest first */
+    save(store, "example.com", "ticket1", 1000);
+    save(store, "example.com", "ticket2", 1000);
+    save(store, "example.org", "ticket3", 1000);
+    ok(take(store, "example.com", 0, "ticket2"));
+    ok(take(store, "example.com", 0, "ticket1"));
+    ok(take(store, "example.com", 0, NULL));
+    ok(take(store, "example.net", 0, NULL));
+
+    /* expired tickets are discarded */
+    save(store, "example.com", "ticket4", 500);
+    ok(take(store, "example.com", 500, NULL));
+    ok(take(store, "example.org", 999, "ticket3"));
+
+    /* the number of tickets is bounded, the oldest being evicted */
+    save(store, "a.example", "ticket5", 1000);
+    save(store, "b.example", "ticket6", 1000);
+    save(store, "c.example", "ticket7", 1000);
+    save(store, "d.example", "ticket8", 1000);
+    save(store, "e.example", "ticket9", 1000);
+    ok(take(store, "a.example", 0, NULL));
+    ok(take(store, "b.example", 0, "ticket6"));
+    ok(take(store, "e.example", 0, "ticket9"));
+
+    /* tickets being left are freed along with the store */
+    quicly_free_ticket_store(store);
+
+    /* sharded */
+    store = quicly_new_ticket_store(64, 4);
+    save(store, "example.com", "ticket1", 1000);
+    save(store, "example.org", "ticket2", 1000);
+    ok(take(store, "example.org", 0, "ticket2"));
+    ok(take(store, "example.com", 0, "ticket1"));
+    quicly_free_ticket_store(store);
+}
+
+static void test_replay_filter_window(void)
+{
+    quicly_replay_filter_t *filter = quicly_new_replay_filter(1000, 10000, 4, quic_ctx.tls->random_bytes);
+
+    ok(!quicly_replay_filter_test_and_set(filter, ptls_iovec_init("ticket1", 7), 100000));
+    ok(quicly_replay_filter_test_and_set(filter, ptls_iovec_init("ticket1", 7), 100000));
+    ok(!quicly_replay_filter_test_and_set(filter, ptls_iovec_init("ticket2", 7), 100000));
+    ok(!quicly_replay_filter_test_and_set(filter, ptls_iovec_init("ticket", 6), 100000));
+
+    /* identifiers are remembered for at least one window, and forgotten after two */
+    ok(quicly_replay_filter_test_and_set(filter, ptls_iovec_init("ticket1", 7), 109999));
+    ok(quicly_replay_filter_test_and_set(filter, ptls_iovec_init("ticket2", 7), 110000));
+    ok(!quicly_replay_filter_test_and_set(filter, ptls_iovec_init("ticket1", 7), 130000));
+
+    quicly_free_replay_filter(filter);
+}
+
+#define REPLAY_FILTER_NUM_THREADS 4
+#define REPLAY_FILTER_NUM_IDS 1000
+
+static void *replay_filter_thread_main(void *_filter)
+{
+    quicly_replay_filter_t *filter = _filter;
+    size_t num_fresh = 0;
+
+    for (uint32_t i = 0; i < REPLAY_FILTER_NUM_IDS; ++i)
+        if (!quicly_replay_filter_test_and_set(filter, ptls_iovec_init(&i, sizeof(i)), 0))
+            ++num_fresh;
+
+    return (void *)num_fresh;
+}
+
+static void test_replay_filter_threads(void)
+{
+    quicly_replay_filter_t *filter = quicly_new_replay_filter(REPLAY_FILTER_NUM_IDS * 10, 10000, 4, quic_ctx.tls->random_bytes);
+    pthread_t tids[REPLAY_FILTER_NUM_THREADS];
+    size_t num_fresh = 0;
+
+    /* each identifier is seen for the first time by exactly one thread */
+    for (size_t i = 0; i < REPLAY_FILTER_NUM_THREADS; ++i)
+        pthread_create(tids + i, NULL, replay_filter_thread_main, filter);
+    for (size_t i = 0; i < REPLAY_FILTER_NUM_THREADS; ++i) {
+        void *ret;
+        pthread_join(tids[i], &ret);
+        num_fresh += (size_t)ret;
+    }
+    ok(num_fresh == REPLAY_FILTER_NUM_IDS);
+
+    quicly_free_replay_filter(filter);
+}
+
+void test_sessioncache(void)
+{
+    subtest("ticket-store", test_ticket_store);
+    subtest("replay-filter-window", test_replay_filter_window);
+    subtest("replay-filter-threads", test_replay_filter_threads);
+}
@@ -20,6 +20,7 @@
  * IN THE SOFTWARE.
  */
 #include <string.h>
+#include "quicly/defaults.h"
 #include "quicly/streambuf.h"
 #include "test.h"
 
@@ -372,6 +373,178 @@ static void tiny_stream_window(void)
     quic_ctx.transport_params.max_stream_data = max_stream_data_orig;
 }
 
+static void stream_window_autotune(void)
+{
+    quicly_max_stream_data_t max_stream_data_orig = quic_ctx.transport_params.max_stream_data;
+    quicly_stream_t *client_stream, *server_stream;
+    test_streambuf_t *server_streambuf;
+    size_t i;
+    quicly_error_t ret;
+    char testdata[1025];
+
+    quic_ctx.transport_params.max_stream_data = (quicly_max_stream_data_t){4096, 4096, 4096};
+    quic_ctx.recv_window_autotune.max_stream_window = 32768;
+    for (i = 0; i < 1024 / 16; ++i)
+        strcpy(testdata + i * 16, "0123456789abcdef");
+    testdata[1024] = '\0';
+
+    ret = quicly_open_stream(client, &client_stream, 0);
+    ok(ret == 0);
+    client_stream->_send_aux.max_stream_data = 4096;
+    for (i = 0; i < 128; ++i)
+        quicly_streambuf_egress_write(client_stream, testdata, strlen(testdata));
+
+    transmit(client, server);
+    server_stream = quicly_get_stream(server, client_stream->stream_id);
+    ok(server_stream != NULL);
+    server_streambuf = server_stream->data;
+    ok(quicly_stream_get_receive_window(server_stream) == 4096);
+
+    /* application drains slowly; the window is not expanded */
+    quic_now += 1000;
+    ok(server_streambuf->super.ingress.off == 4096);
+    quicly_streambuf_ingress_shift(server_stream, server_streambuf->super.ingress.off);
+    transmit(server, client);
+    ok(quicly_stream_get_receive_window(server_stream) == 4096);
+    transmit(client, server);
+    ok(server_streambuf->super.ingress.off == 4096);
+
+    /* application drains as soon as data arrives; the window is doubled upto the ceiling */
+    quicly_streambuf_ingress_shift(server_stream, server_streambuf->super.ingress.off);
+    transmit(server, client);
+    ok(quicly_stream_get_receive_window(server_stream) == 8192);
+
+    /* the window is doubled again, but the packet carrying MAX_STREAM_DATA is lost */
+    transmit(client, server);
+    quicly_streambuf_ingress_shift(server_stream, server_streambuf->super.ingress.off);
+    {
+        quicly_address_t dest, src;
+        struct iovec packet;
+        uint8_t packet_buf[quic_ctx.transport_params.max_udp_payload_size];
+        size_t cnt = 1;
+        ret = quicly_send(server, &dest, &src, &packet, &cnt, packet_buf, sizeof(packet_buf));
+        ok(ret == 0);
+        ok(cnt == 1);
+    }
+    ok(quicly_stream_get_receive_window(server_stream) == 16384);
+
+    /* the loss is detected by the packet threshold upon receiving ACK for the packets that follow; the retransmission happens
+     * right away, but does not grow the window as no data has been consumed since the previous update */
+    for (i = 0; i < 4; ++i)
+        quicly_streambuf_egress_write(server_stream, testdata, strlen(testdata));
+    ok(transmit(server, client) >= 3);
+    transmit(client, server);
+    transmit(server, client);
+    ok(quicly_stream_get_receive_window(server_stream) == 16384);
+
+    for (i = 0; i < 64 && server_stream->recvstate.data_off < 128 * 1024; ++i) {
+        transmit(client, server);
+        quicly_streambuf_ingress_shift(server_stream, server_streambuf->super.ingress.off);
+        transmit(server, client);
+    }
+    ok(server_stream->recvstate.data_off == 128 * 1024);
+    ok(quicly_stream_get_receive_window(server_stream) == 32768);
+
+    quicly_reset_stream(client_stream, QUICLY_ERROR_FROM_APPLICATION_ERROR_CODE(12345));
+    quicly_request_stop(client_stream, QUICLY_ERROR_FROM_APPLICATION_ERROR_CODE(12345));
+    transmit(client, server);
+    transmit(server, client);
+    quic_now += QUICLY_DELAYED_ACK_TIMEOUT;
+    transmit(client, server);
+    transmit(server, client);
+    ok(quicly_num_streams(client) == 0);
+    ok(quicly_num_streams(server) == 0);
+
+    quic_ctx.recv_window_autotune.max_stream_window = 0;
+    quic_ctx.transport_params.max_stream_data = max_stream_data_orig;
+}
+
+static size_t receive_batch_calls, receive_batch_vecs;
+
+static void on_receive_batch(quicly_stream_t *stream, const quicly_stream_recv_vec_t *vecs, size_t num_vecs)
+{
+    ++receive_batch_calls;
+    receive_batch_vecs += num_vecs;
+    quicly_streambuf_ingress_receive_batch(stream, vecs, num_vecs);
+}
+
+static void receive_batch(void)
+{
+    static const char *msgs[] = {"alpha", "beta", "gamma"};
+    quicly_stream_t *client_streams[PTLS_ELEMENTSOF(msgs)], *server_stream;
+    size_t i;
+    quicly_error_t ret;
+
+    stream_callbacks.on_receive_batch = on_receive_batch;
+    receive_batch_calls = 0;
+    receive_batch_vecs = 0;
+
+    for (i = 0; i != PTLS_ELEMENTSOF(msgs); ++i) {
+        ret = quicly_open_stream(client, client_streams + i, 0);
+        ok(ret == 0);
+        quicly_streambuf_egress_write(client_streams[i], msgs[i], strlen(msgs[i]));
+        quicly_streambuf_egress_shutdown(client_streams[i]);
+    }
+
+    /* all the streams fit into one packet; each of them is notified once */
+    ok(transmit(client, server) == 1);
+    ok(receive_batch_calls == PTLS_ELEMENTSOF(msgs));
+    ok(receive_batch_vecs == PTLS_ELEMENTSOF(msgs));
+    for (i = 0; i != PTLS_ELEMENTSOF(msgs); ++i) {
+        server_stream = quicly_get_stream(server, client_streams[i]->stream_id);
+        ok(server_stream != NULL);
+        ok(quicly_recvstate_transfer_complete(&server_stream->recvstate));
+        ok(buffer_is(&((test_streambuf_t *)server_stream->data)->super.ingress, msgs[i]));
+        quicly_streambuf_egress_shutdown(server_stream);
+    }
+
+    quic_now += QUICLY_DELAYED_ACK_TIMEOUT;
+    transmit(server, client);
+    ok(quicly_num_streams(client) == 0);
+    quic_now += QUICLY_DELAYED_ACK_TIMEOUT;
+    transmit(client, server);
+    ok(quicly_num_streams(server) == 0);
+
+    stream_callbacks.on_receive_batch = NULL;
+}
+
+static void emit_one_byte(quicly_stream_t *stream, size_t off, void *dst, size_t *len, int *wrote_all)
+{
+    if (*len > 1)
+        *len = 1;
+    quicly_streambuf_egress_emit(stream, off, dst, len, wrote_all);
+}
+
+static void receive_batch_overflow(void)
+{
+    static const char msg[] = "abcdefghijklmnopq"; /* 17 bytes, sent as one STREAM frame each, FIN riding on the last one */
+    quicly_stream_t *client_stream;
+    quicly_error_t ret;
+
+    stream_callbacks.on_receive_batch = on_receive_batch;
+    stream_callbacks.on_send_emit = emit_one_byte;
+    receive_batch_calls = 0;
+    receive_batch_vecs = 0;
+
+    ret = quicly_open_stream(client, &client_stream, 1);
+    ok(ret == 0);
+    quicly_streambuf_egress_write(client_stream, msg, strlen(msg));
+    quicly_streambuf_egress_shutdown(client_stream);
+
+    /* the batch is flushed before the 17th frame is applied, and the stream is destroyed after the rest is delivered */
+    ok(transmit(client, server) == 1);
+    ok(receive_batch_calls == 2);
+    ok(receive_batch_vecs == strlen(msg));
+    ok(quicly_num_streams(server) == 0);
+
+    stream_callbacks.on_send_emit = quicly_streambuf_egress_emit;
+    stream_callbacks.on_receive_batch = NULL;
+
+    quic_now += QUICLY_DELAYED_ACK_TIMEOUT;
+    transmit(server, client);
+    ok(quicly_num_streams(client) == 0);
+}
+
 static void test_reset_during_loss(void)
 {
     quicly_max_stream_data_t max_stream_data_orig = quic_ctx.transport_params.max_stream_data;
@@ -595,6 +768,209 @@ static void tiny_connection_window(void)
     quic_ctx.transport_params.max_data = max_data_orig;
 }
 
+static void connection_window_autotune(void)
+{
+    uint64_t max_data_orig = quic_ctx.transport_params.max_data;
+    quicly_stream_t *client_stream, *server_stream;
+    test_streambuf_t *server_streambuf;
+    uint64_t permitted, consumed;
+    size_t i;
+    quicly_error_t ret;
+    char testdata[1025];
+
+    quic_ctx.transport_params.max_data = 16384;
+    quic_ctx.recv_window_autotune.max_window = 131072;
+    for (i = 0; i < 1024 / 16; ++i)
+        strcpy(testdata + i * 16, "0123456789abcdef");
+    testdata[1024] = '\0';
+
+    { /* create connection */
+        quicly_address_t dest, src;
+        struct iovec raw;
+        uint8_t rawbuf[quic_ctx.transport_params.max_udp_payload_size];
+        size_t num_packets;
+        quicly_decoded_packet_t decoded;
+
+        ret = quicly_connect(&client, &quic_ctx, "example.com", &fake_address.sa, NULL, new_master_id(), ptls_iovec_init(NULL, 0),
+                             NULL, NULL, NULL);
+        ok(ret == 0);
+        num_packets = 1;
+        ret = quicly_send(client, &dest, &src, &raw, &num_packets, rawbuf, sizeof(rawbuf));
+        ok(ret == 0);
+        ok(num_packets == 1);
+        decode_packets(&decoded, &raw, 1);
+        ret = quicly_accept(&server, &quic_ctx, NULL, &fake_address.sa, &decoded, NULL, new_master_id(), NULL, NULL);
+        ok(ret == 0);
+    }
+
+    transmit(server, client);
+    ok(quicly_get_state(client) == QUICLY_STATE_CONNECTED);
+
+    /* write 512KB */
+    ret = quicly_open_stream(client, &client_stream, 0);
+    ok(ret == 0);
+    for (i = 0; i < 512; ++i)
+        quicly_streambuf_egress_write(client_stream, testdata, strlen(testdata));
+
+    transmit(client, server);
+    server_stream = quicly_get_stream(server, client_stream->stream_id);
+    ok(server_stream != NULL);
+    server_streambuf = server_stream->data;
+
+    /* data is being received as fast as possible; the connection-level window grows upto the ceiling */
+    for (i = 0; i < 64 && server_stream->recvstate.data_off < 512 * 1024; ++i) {
+        quicly_streambuf_ingress_shift(server_stream, server_streambuf->super.ingress.off);
+        transmit(server, client);
+        transmit(client, server);
+    }
+    quicly_streambuf_ingress_shift(server_stream, server_streambuf->super.ingress.off);
+    ok(server_stream->recvstate.data_off == 512 * 1024);
+
+    transmit(server, client);
+    quicly_get_max_data(client, &permitted, NULL, NULL);
+    quicly_get_max_data(server, NULL, NULL, &consumed);
+    ok(permitted - consumed > 16384);
+    ok(permitted - consumed <= 131072);
+
+    quicly_free(client);
+    quicly_free(server);
+    client = NULL;
+    server = NULL;
+
+    quic_ctx.recv_window_autotune.max_window = 0;
+    quic_ctx.transport_params.max_data = max_data_orig;
+}
+
+static void recvbuf_budget(void)
+{
+    uint64_t max_data_orig = quic_ctx.transport_params.max_data;
+    quicly_recvbuf_budget_t budget = {.capacity = 65536};
+    quicly_stream_t *client_stream, *server_stream;
+    test_streambuf_t *server_streambuf;
+    quicly_stats_t stats;
+    size_t i;
+    quicly_error_t ret;
+    char testdata[1025];
+
+    quic_ctx.transport_params.max_data = 49152;
+    quic_ctx.recvbuf_budget = &budget;
+    for (i = 0; i < 1024 / 16; ++i)
+        strcpy(testdata + i * 16, "0123456789abcdef");
+    testdata[1024] = '\0';
+
+    { /* create connection; both endpoints commit their initial window, the server's being capped by what is left in the budget */
+        quicly_address_t dest, src;
+        struct iovec raw;
+        uint8_t rawbuf[quic_ctx.transport_params.max_udp_payload_size];
+        size_t num_packets;
+        quicly_decoded_packet_t decoded;
+
+        ret = quicly_connect(&client, &quic_ctx, "example.com", &fake_address.sa, NULL, new_master_id(), ptls_iovec_init(NULL, 0),
+                             NULL, NULL, NULL);
+        ok(ret == 0);
+        ok(budget.committed == 49152);
+        num_packets = 1;
+        ret = quicly_send(client, &dest, &src, &raw, &num_packets, rawbuf, sizeof(rawbuf));
+        ok(ret == 0);
+        ok(num_packets == 1);
+        decode_packets(&decoded, &raw, 1);
+        ret = quicly_accept(&server, &quic_ctx, NULL, &fake_address.sa, &decoded, NULL, new_master_id(), NULL, NULL);
+        ok(ret == 0);
+        ok(budget.committed == 65536);
+    }
+
+    transmit(server, client);
+    ok(quicly_get_state(client) == QUICLY_STATE_CONNECTED);
+    ok(quicly_get_remote_transport_parameters(client)->max_data == 65536 - 49152);
+    ok(quicly_get_remote_transport_parameters(server)->max_data == 49152);
+
+    /* write 256KB; the transfer completes even though the budget has been exhausted */
+    ret = quicly_open_stream(client, &client_stream, 0);
+    ok(ret == 0);
+    for (i = 0; i < 256; ++i)
+        quicly_streambuf_egress_write(client_stream, testdata, strlen(testdata));
+
+    transmit(client, server);
+    server_stream = quicly_get_stream(server, client_stream->stream_id);
+    ok(server_stream != NULL);
+    server_streambuf = server_stream->data;
+    for (i = 0; i < 256 && server_stream->recvstate.data_off < 256 * 1024; ++i) {
+        quicly_streambuf_ingress_shift(server_stream, server_streambuf->super.ingress.off);
+        transmit(server, client);
+        transmit(client, server);
+    }
+    quicly_streambuf_ingress_shift(server_stream, server_streambuf->super.ingress.off);
+    ok(server_stream->recvstate.data_off == 256 * 1024);
+
+    /* server's window has stayed within the budget */
+    quicly_get_stats(server, &stats);
+    ok(stats.num_recv_window_throttled == 0);
+    ok(stats.recv_window_committed == 65536 - 49152);
+    ok(budget.committed == 65536);
+
+    quicly_free(client);
+    ok(budget.committed == 65536 - 49152);
+    quicly_free(server);
+    ok(budget.committed == 0);
+    client = NULL;
+    server = NULL;
+
+    quic_ctx.recvbuf_budget = NULL;
+    quic_ctx.transport_params.max_data = max_data_orig;
+}
+
+static void path_profile_cache(void)
+{
+    quicly_stats_t stats;
+    uint32_t min_rtt;
+    quicly_error_t ret;
+
+    quic_ctx.path_profile_cache = quicly_new_default_path_profile_cache(16, 24, 48, 60 * 1000);
+
+    /* first connection from the network is not seeded, but leaves its profile when being freed */
+    test_handshake();
+    ret = quicly_get_stats(server, &stats);
+    ok(ret == 0);
+    ok(stats.num_path_profile_seeded == 0);
+    min_rtt = stats.rtt.minimum;
+    ok(min_rtt != UINT32_MAX);
+    quicly_free(client);
+    quicly_free(server);
+
+    { /* second connection uses the RTT observed by the first connection as its initial RTT */
+        quicly_address_t dest, src;
+        struct iovec raw;
+        uint8_t rawbuf[quic_ctx.transport_params.max_udp_payload_size];
+        size_t num_packets;
+        quicly_decoded_packet_t decoded;
+
+        ret = quicly_connect(&client, &quic_ctx, "example.com", &fake_address.sa, NULL, new_master_id(), ptls_iovec_init(NULL, 0),
+                             NULL, NULL, NULL);
+        ok(ret == 0);
+        num_packets = 1;
+        ret = quicly_send(client, &dest, &src, &raw, &num_packets, rawbuf, sizeof(rawbuf));
+        ok(ret == 0);
+        decode_packets(&decoded, &raw, 1);
+        ret = quicly_accept(&server, &quic_ctx, NULL, &fake_address.sa, &decoded, NULL, new_master_id(), NULL, NULL);
+        ok(ret == 0);
+    }
+    ret = quicly_get_stats(server, &stats);
+    ok(ret == 0);
+    ok(stats.num_path_profile_seeded == 1);
+    ok(stats.rtt.smoothed == min_rtt);
+    ret = quicly_get_stats(client, &stats);
+    ok(ret == 0);
+    ok(stats.num_path_profile_seeded == 0); /* the cache is used only by servers */
+
+    quicly_free(client);
+    quicly_free(server);
+    client = NULL;
+    server = NULL;
+
+    quicly_free_default_path_profile_cache(quic_ctx.path_profile_cache);
+    quic_ctx.path_profile_cache = NULL;
+}
+
 void test_simple(void)
 {
     subtest("handshake", test_handshake);
@@ -603,7 +979,13 @@ void test_simple(void)
     subtest("send-then-close", test_send_then_close);
     subtest("reset-after-close", test_reset_after_close);
     subtest("tiny-stream-window", tiny_stream_window);
+    subtest("stream-window-autotune", stream_window_autotune);
+    subtest("receive-batch", receive_batch);
+    subtest("receive-batch-overflow", receive_batch_overflow);
     subtest("reset-during-loss", test_reset_during_loss);
     subtest("close", test_close);
     subtest("tiny-connection-window", tiny_connection_window);
+    subtest("connection-window-autotune", connection_window_autotune);
+    subtest("recvbuf-budget", recvbuf_budget);
+    subtest("path-profile-cache", path_profile_cache);
 }
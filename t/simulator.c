@@ -459,6 +459,8 @@ static void usage(const char *cmd)
            "  -d <delay_secs>     delay added between the sender and the botteneck\n"
            "                      (default: 0.1)\n"
            "  -i <packets>        sets initial CWND (default: %" PRIu32 ")\n"
+           "  -H                  turns on HyStart++ for the senders being added (reno and\n"
+           "                      cubic only)\n"
            "  -j <packets>        enables use of jumpstart using given window size\n"
            "  -l <seconds>        number of seconds to simulate (default: 100)\n"
            "  -p                  turns on pacing\n"
@@ -584,8 +586,8 @@ int main(int argc, char **argv)
     /* parse args */
     double delay = 0.1, bw = 1e6, depth = 0.1, start = 0, random_loss = 0;
     double length = 100;
-    int ch;
-    while ((ch = getopt(argc, argv, "n:b:d:i:j:l:pq:r:Rs:th")) != -1) {
+    int ch, use_hystart = 0;
+    while ((ch = getopt(argc, argv, "n:b:d:Hi:j:l:pq:r:Rs:th")) != -1) {
         switch (ch) {
         case 'n': {
             quicly_cc_type_t **cc;
@@ -598,6 +600,16 @@ int main(int argc, char **argv)
                 fprintf(stderr, "unknown congestion controller: %s\n", optarg);
                 exit(1);
             }
+            if (use_hystart) {
+                if (*cc == &quicly_cc_type_reno) {
+                    quicctx.init_cc = &quicly_cc_reno_hystart_init;
+                } else if (*cc == &quicly_cc_type_cubic) {
+                    quicctx.init_cc = &quicly_cc_cubic_hystart_init;
+                } else {
+                    fprintf(stderr, "HyStart++ cannot be used with %s\n", optarg);
+                    exit(1);
+                }
+            }
             struct net_delay *delay_node = malloc(sizeof(*delay_node));
             net_delay_init(delay_node, delay);
             delay_node->next_node = &bottleneck_node.super;
@@ -629,6 +641,9 @@ int main(int argc, char **argv)
                 exit(1);
             }
             break;
+        case 'H':
+            use_hystart = 1;
+            break;
         case 'i':
             if (sscanf(optarg, "%" PRIu32, &quicctx.initcwnd_packets) != 1) {
                 fprintf(stderr, "invalid INITCWND size: %s\n", optarg);
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2026 Fastly
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "quicly/streambuf.h"
+#include "test.h"
+
+static int open_test_file(size_t size)
+{
+    char path[] = "/tmp/quicly-test-streambuf-XXXXXX";
+    int fd;
+
+    if ((fd = mkstemp(path)) == -1)
+        return -1;
+    unlink(path);
+    for (size_t i = 0; i < size; ++i) {
+        uint8_t b = (uint8_t)(i * 7 + i / 251);
+        if (write(fd, &b, 1) != 1) {
+            close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+static int bytes_are(const uint8_t *bytes, uint64_t file_off, size_t len)
+{
+    for (size_t i = 0; i < len; ++i) {
+        uint64_t pos = file_off + i;
+        if (bytes[i] != (uint8_t)(pos * 7 + pos / 251))
+            return 0;
+    }
+    return 1;
+}
+
+static void test_file_vec(void)
+{
+    static const size_t file_size = 200000, vec_off = 5000, vec_len = 190000;
+    quicly_sendbuf_vec_t vec;
+    uint8_t buf[1500];
+    int fd;
+
+    if ((fd = open_test_file(file_size)) == -1) {
+        ok(!"failed to create test file");
+        return;
+    }
+    ok(quicly_sendbuf_init_file_vec(&vec, NULL, fd, vec_off, vec_len) == 0);
+    ok(vec.len == vec_len);
+
+    /* sequential emission */
+    for (size_t off = 0; off < 100000; off += sizeof(buf)) {
+        if (vec.cb->flatten_vec(&vec, buf, off, sizeof(buf)) != 0 || !bytes_are(buf, vec_off + off, sizeof(buf))) {
+            ok(!"unexpected bytes emitted");
+            break;
+        }
+    }
+
+    /* retire some data, then retransmit bytes that are still in flight */
+    vec.cb->shift_vec(&vec, 50000);
+    ok(vec.cb->flatten_vec(&vec, buf, 50000, sizeof(buf)) == 0);
+    ok(bytes_are(buf, vec_off + 50000, sizeof(buf)));
+
+    /* the tail of the vector */
+    ok(vec.cb->flatten_vec(&vec, buf, vec_len - 100, 100) == 0);
+    ok(bytes_are(buf, vec_off + vec_len - 100, 100));
+
+    /* retire nearly everything */
+    vec.cb->shift_vec(&vec, vec_len - 1);
+    ok(vec.cb->flatten_vec(&vec, buf, vec_len - 1, 1) == 0);
+    ok(bytes_are(buf, vec_off + vec_len - 1, 1));
+
+    vec.cb->discard_vec(&vec);
+}
+
+static void test_recvbuf_batch(void)
+{
+    ptls_buffer_t rb;
+    ptls_buffer_init(&rb, "", 0);
+
+    /* out-of-order chunks, including a gap that is filled later */
+    quicly_stream_recv_vec_t vecs1[] = {{6, "world", 5}, {0, "hello", 5}};
+    ok(quicly_recvbuf_receive_batch(NULL, &rb, vecs1, PTLS_ELEMENTSOF(vecs1)) == 0);
+    ok(rb.off == 11);
+    ok(memcmp(rb.base, "hello", 5) == 0);
+    ok(memcmp(rb.base + 6, "world", 5) == 0);
+
+    /* chunks ending before the current tail do not shrink the buffer; empty chunks (FIN) are accepted */
+    quicly_stream_recv_vec_t vecs2[] = {{5, " ", 1}, {11, "!", 1}, {12, NULL, 0}};
+    ok(quicly_recvbuf_receive_batch(NULL, &rb, vecs2, PTLS_ELEMENTSOF(vecs2)) == 0);
+    ok(rb.off == 12);
+    ok(memcmp(rb.base, "hello world!", 12) == 0);
+
+    ptls_buffer_dispose(&rb);
+}
+
+void test_streambuf(void)
+{
+    subtest("file-vec", test_file_vec);
+    subtest("recvbuf-batch", test_recvbuf_batch);
+}
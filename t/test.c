@@ -614,7 +614,7 @@ static void test_address_token_codec(void)
 static void do_test_record_receipt(size_t epoch)
 {
     struct st_quicly_pn_space_t *space =
-        alloc_pn_space(sizeof(*space), epoch == QUICLY_EPOCH_1RTT ? QUICLY_DEFAULT_PACKET_TOLERANCE : 1);
+        alloc_pn_space(NULL, sizeof(*space), epoch == QUICLY_EPOCH_1RTT ? QUICLY_DEFAULT_PACKET_TOLERANCE : 1);
     uint64_t pn = 0, out_of_order_cnt = 0;
     int64_t now = 12345, send_ack_at = INT64_MAX;
 
@@ -674,7 +674,7 @@ static void do_test_record_receipt(size_t epoch)
         now += 1;
     }
 
-    do_free_pn_space(space);
+    do_free_pn_space(NULL, space, sizeof(*space));
 }
 
 static void do_test_ack_frequency_ack_logic()
@@ -935,7 +935,7 @@ static void do_test_ack_frequency_ack_logic()
         uint64_t out_of_order_cnt = 0;
         int64_t send_ack_at = INT64_MAX;
 
-        struct st_quicly_pn_space_t *space = alloc_pn_space(sizeof(*space), QUICLY_DEFAULT_PACKET_TOLERANCE);
+        struct st_quicly_pn_space_t *space = alloc_pn_space(NULL, sizeof(*space), QUICLY_DEFAULT_PACKET_TOLERANCE);
         space->reordering_threshold = test_cases[i].reordering_threshold;
         space->packet_tolerance = test_cases[i].packet_tolerance;
 
@@ -955,7 +955,7 @@ static void do_test_ack_frequency_ack_logic()
             ok(row.expected_smallest_unreported_missing_after_receipt == space->smallest_unreported_missing);
         }
 
-        do_free_pn_space(space);
+        do_free_pn_space(NULL, space, sizeof(*space));
     }
 }
 
@@ -1043,10 +1043,293 @@ static void test_ack_frequency(void)
     quicly_free(server);
 }
 
+static void do_test_cid_batch(ptls_cipher_algorithm_t *cid_cipher)
+{
+    quicly_cid_encryptor_t *encryptor =
+        quicly_new_default_cid_encryptor(cid_cipher, &ptls_openssl_aes128ecb, &ptls_openssl_sha256, ptls_iovec_init("abc", 3));
+    quicly_cid_plaintext_t plaintexts[11], decrypted[PTLS_ELEMENTSOF(plaintexts)], *decrypted_ptrs[PTLS_ELEMENTSOF(plaintexts)];
+    quicly_cid_t cids[PTLS_ELEMENTSOF(plaintexts)], *cid_ptrs[PTLS_ELEMENTSOF(plaintexts)];
+    uint8_t tokens[PTLS_ELEMENTSOF(plaintexts)][QUICLY_STATELESS_RESET_TOKEN_LEN];
+    void *token_ptrs[PTLS_ELEMENTSOF(plaintexts)];
+    const void *encrypted_ptrs[PTLS_ELEMENTSOF(plaintexts)];
+    size_t lens[PTLS_ELEMENTSOF(plaintexts)];
+
+    /* encrypt in batch (the number of CIDs being chosen so that more than one batch is used), skipping one reset token */
+    for (size_t i = 0; i < PTLS_ELEMENTSOF(plaintexts); ++i) {
+        plaintexts[i] = (quicly_cid_plaintext_t){.master_id = 1000 + i, .path_id = i, .thread_id = 3 * i, .node_id = 12345};
+        cid_ptrs[i] = cids + i;
+        token_ptrs[i] = i == 5 ? NULL : tokens[i];
+    }
+    memset(tokens, 0, sizeof(tokens));
+    encryptor->encrypt_cid_batch(encryptor, cid_ptrs, token_ptrs, plaintexts, PTLS_ELEMENTSOF(plaintexts));
+
+    /* the result should be identical to that of the non-batched variant */
+    for (size_t i = 0; i < PTLS_ELEMENTSOF(plaintexts); ++i) {
+        quicly_cid_t expected_cid;
+        uint8_t expected_token[QUICLY_STATELESS_RESET_TOKEN_LEN] = {0};
+        encryptor->encrypt_cid(encryptor, &expected_cid, i == 5 ? NULL : expected_token, plaintexts + i);
+        ok(quicly_cid_is_equal(&expected_cid, ptls_iovec_init(cids[i].cid, cids[i].len)));
+        ok(memcmp(expected_token, tokens[i], sizeof(expected_token)) == 0);
+    }
+
+    /* generate reset tokens in batch */
+    for (size_t i = 0; i < PTLS_ELEMENTSOF(plaintexts); ++i) {
+        token_ptrs[i] = tokens[i];
+        encrypted_ptrs[i] = cids[i].cid;
+    }
+    memset(tokens, 0, sizeof(tokens));
+    ok(encryptor->generate_stateless_reset_token_batch(encryptor, token_ptrs, encrypted_ptrs, PTLS_ELEMENTSOF(plaintexts)));
+    for (size_t i = 0; i < PTLS_ELEMENTSOF(plaintexts); ++i) {
+        uint8_t expected_token[QUICLY_STATELESS_RESET_TOKEN_LEN];
+        ok(encryptor->generate_stateless_reset_token(encryptor, expected_token, cids[i].cid));
+        ok(memcmp(expected_token, tokens[i], sizeof(expected_token)) == 0);
+    }
+
+    /* decrypt in batch, with one CID having an unexpected length */
+    for (size_t i = 0; i < PTLS_ELEMENTSOF(plaintexts); ++i) {
+        decrypted_ptrs[i] = decrypted + i;
+        encrypted_ptrs[i] = cids[i].cid;
+        lens[i] = i % 2 == 0 ? 0 : cids[i].len;
+    }
+    lens[7] = cids[7].len - 1;
+    encryptor->decrypt_cid_batch(encryptor, decrypted_ptrs, encrypted_ptrs, lens, PTLS_ELEMENTSOF(plaintexts));
+    for (size_t i = 0; i < PTLS_ELEMENTSOF(plaintexts); ++i) {
+        if (i == 7) {
+            ok(lens[i] == SIZE_MAX);
+            continue;
+        }
+        ok(lens[i] == cids[i].len);
+        ok(decrypted[i].master_id == plaintexts[i].master_id);
+        ok(decrypted[i].path_id == plaintexts[i].path_id);
+        ok(decrypted[i].thread_id == plaintexts[i].thread_id);
+        ok(decrypted[i].node_id == (cids[i].len == 16 ? plaintexts[i].node_id : 0));
+    }
+
+    quicly_free_default_cid_encryptor(encryptor);
+}
+
+static void test_cid_batch(void)
+{
+    subtest("aes128ecb", do_test_cid_batch, &ptls_openssl_aes128ecb);
+}
+
+static void do_test_cid_quiclb(quicly_quiclb_config_t *config, ptls_cipher_algorithm_t *cid_cipher)
+{
+    static const uint8_t cid_key[16] = {0x8f, 0x95, 0xf0, 0x92, 0x45, 0x76, 0x5f, 0x80,
+                                        0x25, 0x69, 0x34, 0xe5, 0x0c, 0x66, 0x20, 0x7f};
+    size_t cid_len = 1 + config->server_id_len + config->nonce_len;
+    quicly_cid_encryptor_t *encryptor =
+        quicly_new_quiclb_cid_encryptor(config, cid_cipher, ptls_iovec_init(cid_key, sizeof(cid_key)), &ptls_openssl_aes128ecb,
+                                        &ptls_openssl_sha256, ptls_iovec_init("abc", 3));
+    quicly_cid_t cids[4];
+
+    ok(encryptor != NULL);
+    if (encryptor == NULL)
+        return;
+
+    for (size_t i = 0; i < PTLS_ELEMENTSOF(cids); ++i) {
+        quicly_cid_plaintext_t plaintext = {.master_id = 0x12345678, .path_id = i, .thread_id = 3, .node_id = 0x0102},
+                               decrypted;
+        uint8_t token[QUICLY_STATELESS_RESET_TOKEN_LEN], expected_token[QUICLY_STATELESS_RESET_TOKEN_LEN];
+        encryptor->encrypt_cid(encryptor, &cids[i], token, &plaintext);
+        ok(cids[i].len == cid_len);
+        ok(cids[i].cid[0] >> 5 == config->config_rotation);
+        if (config->encode_length)
+            ok((cids[i].cid[0] & 0x1f) == cid_len - 1);
+        /* server ID is visible only when the CIDs are not encrypted */
+        ok((memcmp(cids[i].cid + 1 + config->server_id_len - 2, "\x01\x02", 2) == 0) == (cid_cipher == NULL));
+        /* decrypt as a long header packet and as a short header packet */
+        ok(encryptor->decrypt_cid(encryptor, &decrypted, cids[i].cid, cids[i].len) == cid_len);
+        ok(decrypted.master_id == plaintext.master_id);
+        ok(decrypted.path_id == plaintext.path_id);
+        ok(decrypted.thread_id == plaintext.thread_id);
+        ok(decrypted.node_id == plaintext.node_id);
+        memset(&decrypted, 0, sizeof(decrypted));
+        ok(encryptor->decrypt_cid(encryptor, &decrypted, cids[i].cid, 0) == cid_len);
+        ok(decrypted.path_id == plaintext.path_id);
+        ok(decrypted.master_id == plaintext.master_id);
+        /* reset token */
+        ok(encryptor->generate_stateless_reset_token(encryptor, expected_token, cids[i].cid));
+        ok(memcmp(token, expected_token, sizeof(token)) == 0);
+        /* different CIDs are generated for different path IDs */
+        for (size_t j = 0; j < i; ++j)
+            ok(!quicly_cid_is_equal(&cids[i], ptls_iovec_init(cids[j].cid, cids[j].len)));
+    }
+
+    /* CIDs of unexpected length or config rotation bits are rejected */
+    quicly_cid_plaintext_t decrypted;
+    ok(encryptor->decrypt_cid(encryptor, &decrypted, cids[0].cid, cid_len - 1) == SIZE_MAX);
+    cids[0].cid[0] ^= 0x20;
+    ok(encryptor->decrypt_cid(encryptor, &decrypted, cids[0].cid, 0) == SIZE_MAX);
+
+    quicly_free_quiclb_cid_encryptor(encryptor);
+}
+
+/**
+ * Known-answer tests. The single-pass vector is the one of draft-ietf-quic-load-balancers Appendix B; the four-pass vectors, that
+ * cover both even and odd plaintext lengths, were cross-checked against an independent implementation of the algorithm.
+ */
+static void test_cid_quiclb_vectors(void)
+{
+    static const uint8_t cid_key[16] = {0x8f, 0x95, 0xf0, 0x92, 0x45, 0x76, 0x5f, 0x80,
+                                        0x25, 0x69, 0x34, 0xe5, 0x0c, 0x66, 0x20, 0x7f};
+    static const struct {
+        quicly_quiclb_config_t config;
+        quicly_cid_plaintext_t plaintext;
+        const char *expected;
+    } vectors[] = {
+        {{.config_rotation = 4, .encode_length = 1, .server_id_len = 8, .nonce_len = 8},
+         {.node_id = 0xed793a51d49b8f5f, .master_id = 0xee080dbf, .thread_id = 0x48c0d1, .path_id = 0xe5},
+         "\x90\x4d\xd2\xd0\x5a\x7b\x0d\xe9\xb2\xb9\x90\x7a\xfb\x5e\xcf\x8c\xc3"},
+        {{.config_rotation = 0, .encode_length = 1, .server_id_len = 4, .nonce_len = 6},
+         {.node_id = 0xed793a51, .master_id = 0xd49b8f5f, .thread_id = 0xab, .path_id = 0x65},
+         "\x0a\xc4\x58\xb5\x9f\xfd\xaa\xf5\xe2\x4c\x94"},
+        {{.config_rotation = 2, .server_id_len = 3, .nonce_len = 6},
+         {.node_id = 0xed793a, .master_id = 0x51d687d6, .thread_id = 0xee, .path_id = 0x08},
+         "\x56\x5c\xf7\xd3\xfd\x26\x00\x1a\x16\x56"},
+    };
+
+    for (size_t i = 0; i < PTLS_ELEMENTSOF(vectors); ++i) {
+        quicly_cid_encryptor_t *encryptor = quicly_new_quiclb_cid_encryptor(
+            &vectors[i].config, &ptls_openssl_aes128ecb, ptls_iovec_init(cid_key, sizeof(cid_key)), &ptls_openssl_aes128ecb,
+            &ptls_openssl_sha256, ptls_iovec_init("abc", 3));
+        size_t cid_len = 1 + vectors[i].config.server_id_len + vectors[i].config.nonce_len;
+        quicly_cid_t cid;
+        quicly_cid_plaintext_t decrypted;
+        encryptor->encrypt_cid(encryptor, &cid, NULL, &vectors[i].plaintext);
+        ok(cid.len == cid_len);
+        ok(memcmp(cid.cid, vectors[i].expected, cid_len) == 0);
+        ok(encryptor->decrypt_cid(encryptor, &decrypted, vectors[i].expected, cid_len) == cid_len);
+        ok(decrypted.node_id == vectors[i].plaintext.node_id);
+        ok(decrypted.master_id == vectors[i].plaintext.master_id);
+        ok(decrypted.thread_id == vectors[i].plaintext.thread_id);
+        ok(decrypted.path_id == vectors[i].plaintext.path_id);
+        quicly_free_quiclb_cid_encryptor(encryptor);
+    }
+}
+
+static void test_cid_quiclb(void)
+{
+    subtest("four-pass-even", do_test_cid_quiclb,
+            &(quicly_quiclb_config_t){.config_rotation = 1, .encode_length = 1, .server_id_len = 2, .nonce_len = 6},
+            &ptls_openssl_aes128ecb);
+    subtest("four-pass-odd", do_test_cid_quiclb,
+            &(quicly_quiclb_config_t){.config_rotation = 2, .server_id_len = 3, .nonce_len = 6}, &ptls_openssl_aes128ecb);
+    subtest("four-pass-max", do_test_cid_quiclb,
+            &(quicly_quiclb_config_t){.config_rotation = 6, .encode_length = 1, .server_id_len = 4, .nonce_len = 15},
+            &ptls_openssl_aes128ecb);
+    subtest("single-pass", do_test_cid_quiclb,
+            &(quicly_quiclb_config_t){.config_rotation = 0, .encode_length = 1, .server_id_len = 8, .nonce_len = 8},
+            &ptls_openssl_aes128ecb);
+    subtest("unencrypted", do_test_cid_quiclb, &(quicly_quiclb_config_t){.config_rotation = 3, .server_id_len = 2, .nonce_len = 7},
+            NULL);
+    subtest("vectors", test_cid_quiclb_vectors);
+
+    /* invalid configurations */
+    ok(quicly_new_quiclb_cid_encryptor(&(quicly_quiclb_config_t){.config_rotation = 7, .server_id_len = 2, .nonce_len = 6}, NULL,
+                                       ptls_iovec_init(NULL, 0), &ptls_openssl_aes128ecb, &ptls_openssl_sha256,
+                                       ptls_iovec_init("abc", 3)) == NULL);
+    ok(quicly_new_quiclb_cid_encryptor(&(quicly_quiclb_config_t){.server_id_len = 2, .nonce_len = 5}, NULL,
+                                       ptls_iovec_init(NULL, 0), &ptls_openssl_aes128ecb, &ptls_openssl_sha256,
+                                       ptls_iovec_init("abc", 3)) == NULL);
+    ok(quicly_new_quiclb_cid_encryptor(&(quicly_quiclb_config_t){.server_id_len = 4, .nonce_len = 16}, NULL,
+                                       ptls_iovec_init(NULL, 0), &ptls_openssl_aes128ecb, &ptls_openssl_sha256,
+                                       ptls_iovec_init("abc", 3)) == NULL);
+}
+
 static void test_cid(void)
 {
     subtest("received cid", test_received_cid);
     subtest("local cid", test_local_cid);
+    subtest("batch", test_cid_batch);
+    subtest("quic-lb", test_cid_quiclb);
+}
+
+static void test_stateless_batch(void)
+{
+    quicly_context_t ctx = quic_ctx;
+    quicly_stateless_ratelimit_t limiter;
+    quicly_cid_t cid;
+    uint8_t short_header = QUICLY_QUIC_BIT, long_header = QUICLY_LONG_HEADER_BIT | QUICLY_QUIC_BIT, buf[1500];
+    struct sockaddr_in addr = {.sin_family = AF_INET, .sin_addr.s_addr = htonl(0xc0000201)};
+    quicly_decoded_packet_t packets[6];
+    quicly_stateless_request_t requests[PTLS_ELEMENTSOF(packets)];
+    struct iovec datagrams[PTLS_ELEMENTSOF(packets)];
+    size_t num_built;
+
+    ctx.cid_encryptor = quicly_new_default_cid_encryptor(&ptls_openssl_aes128ecb, &ptls_openssl_aes128ecb, &ptls_openssl_sha256,
+                                                         ptls_iovec_init("abc", 3));
+    ctx.cid_encryptor->encrypt_cid(ctx.cid_encryptor, &cid, NULL, &(quicly_cid_plaintext_t){.master_id = 1});
+    quicly_stateless_ratelimit_init(&limiter, 1, 2, ctx.tls);
+
+    /* short header packets of a sufficient size, except for #1 (long header) and #2 (small) */
+    for (size_t i = 0; i < PTLS_ELEMENTSOF(packets); ++i) {
+        packets[i] = (quicly_decoded_packet_t){
+            .octets = ptls_iovec_init(i == 1 ? &long_header : &short_header, 1),
+            .cid.dest.encrypted = ptls_iovec_init(cid.cid, cid.len),
+            .version = i == 1 ? QUICLY_PROTOCOL_VERSION_1 : 0,
+            .datagram_size = i == 2 ? QUICLY_STATELESS_RESET_PACKET_MIN_LEN : 100,
+        };
+        requests[i] = (quicly_stateless_request_t){&packets[i], (struct sockaddr *)&addr};
+    }
+
+    /* #0 and #3 are responded to, then #4 is rate-limited as the burst is 2 */
+    num_built = quicly_send_stateless_reset_batch(&ctx, &limiter, 1000, requests, 5, datagrams, buf, sizeof(buf));
+    ok(num_built == 2);
+    ok(datagrams[0].iov_base == buf);
+    ok(datagrams[0].iov_len == QUICLY_STATELESS_RESET_PACKET_MIN_LEN);
+    ok(datagrams[1].iov_len == 0);
+    ok(datagrams[2].iov_len == 0);
+    ok(datagrams[3].iov_base == buf + QUICLY_STATELESS_RESET_PACKET_MIN_LEN);
+    ok(datagrams[3].iov_len == QUICLY_STATELESS_RESET_PACKET_MIN_LEN);
+    ok(datagrams[4].iov_len == 0);
+    ok(limiter.num_limited == 1);
+    for (size_t i = 0; i < 4; i += 3) {
+        const uint8_t *bytes = datagrams[i].iov_base;
+        uint8_t expected_token[QUICLY_STATELESS_RESET_TOKEN_LEN];
+        ctx.cid_encryptor->generate_stateless_reset_token(ctx.cid_encryptor, expected_token, cid.cid);
+        ok((bytes[0] & (QUICLY_LONG_HEADER_BIT | QUICLY_QUIC_BIT)) == QUICLY_QUIC_BIT);
+        ok(memcmp(bytes + QUICLY_STATELESS_RESET_PACKET_MIN_LEN - QUICLY_STATELESS_RESET_TOKEN_LEN, expected_token,
+                  sizeof(expected_token)) == 0);
+    }
+
+    /* a token is replenished after one second; the rest is subject to the size of the buffer */
+    num_built = quicly_send_stateless_reset_batch(&ctx, &limiter, 2000, requests + 4, 2, datagrams + 4, buf, sizeof(buf));
+    ok(num_built == 1);
+    ok(datagrams[4].iov_len == QUICLY_STATELESS_RESET_PACKET_MIN_LEN);
+    ok(datagrams[5].iov_len == 0);
+    num_built = quicly_send_stateless_reset_batch(&ctx, NULL, 2000, requests + 3, 3, datagrams + 3, buf,
+                                                  QUICLY_STATELESS_RESET_PACKET_MIN_LEN * 2 - 1);
+    ok(num_built == 1);
+    ok(datagrams[3].iov_len == QUICLY_STATELESS_RESET_PACKET_MIN_LEN);
+    ok(datagrams[4].iov_len == 0);
+    ok(datagrams[5].iov_len == 0);
+
+    /* version negotiation is sent only in response to long header packets carried by full-sized datagrams */
+    packets[0] = packets[1];
+    packets[0].version = 0xff000001;
+    packets[0].datagram_size = QUICLY_MIN_CLIENT_INITIAL_SIZE;
+    packets[0].cid.src = ptls_iovec_init("abcd", 4);
+    packets[1].datagram_size = QUICLY_MIN_CLIENT_INITIAL_SIZE;
+    packets[2] = packets[0];
+    packets[2].datagram_size = QUICLY_MIN_CLIENT_INITIAL_SIZE - 1;
+    packets[3] = packets[0];
+    packets[3].version = 0;
+    num_built = quicly_send_version_negotiation_batch(&ctx, NULL, 2000, requests, 4, quicly_supported_versions, datagrams, buf,
+                                                      sizeof(buf));
+    ok(num_built == 2);
+    ok(datagrams[2].iov_len == 0);
+    ok(datagrams[3].iov_len == 0);
+    {
+        uint8_t expected[256];
+        size_t expected_len = quicly_send_version_negotiation(&ctx, packets[0].cid.src, packets[0].cid.dest.encrypted,
+                                                              quicly_supported_versions, expected);
+        ok(datagrams[0].iov_len == expected_len);
+        ok(memcmp((uint8_t *)datagrams[0].iov_base + 1, expected + 1, expected_len - 1) == 0);
+        ok(datagrams[1].iov_base == buf + expected_len);
+    }
+
+    quicly_free_default_cid_encryptor(ctx.cid_encryptor);
 }
 
 /**
@@ -1182,6 +1465,49 @@ void test_ecn_index_from_bits(void)
     ok(get_ecn_index_from_bits(3) == 2);
 }
 
+static void test_nat_rebinding_detection(void)
+{
+    struct st_quicly_conn_path_t from = {}, to = {};
+    struct sockaddr_in sin = {.sin_family = AF_INET, .sin_addr.s_addr = htonl(0xc0000201), .sin_port = htons(12345)};
+    struct sockaddr_in6 sin6 = {.sin6_family = AF_INET6, .sin6_addr.s6_addr = {0x20, 0x01, 0x0d, 0xb8}, .sin6_port = htons(443)};
+
+    /* port change */
+    set_address(&from.address.remote, (void *)&sin);
+    sin.sin_port = htons(23456);
+    set_address(&to.address.remote, (void *)&sin);
+    ok(is_nat_rebinding(&from, &to));
+
+    /* address change within /24 */
+    sin.sin_addr.s_addr = htonl(0xc00002fe);
+    set_address(&to.address.remote, (void *)&sin);
+    ok(is_nat_rebinding(&from, &to));
+
+    /* different network */
+    sin.sin_addr.s_addr = htonl(0xc6336401);
+    set_address(&to.address.remote, (void *)&sin);
+    ok(!is_nat_rebinding(&from, &to));
+    set_address(&to.address.remote, (void *)&sin6);
+    ok(!is_nat_rebinding(&from, &to));
+
+    /* IPv6 address change within /64, or not */
+    set_address(&from.address.remote, (void *)&sin6);
+    sin6.sin6_addr.s6_addr[15] = 1;
+    set_address(&to.address.remote, (void *)&sin6);
+    ok(is_nat_rebinding(&from, &to));
+    sin6.sin6_addr.s6_addr[7] = 1;
+    set_address(&to.address.remote, (void *)&sin6);
+    ok(!is_nat_rebinding(&from, &to));
+
+    /* local address is also compared when known */
+    set_address(&to.address.remote, (void *)&from.address.remote.sa);
+    sin.sin_addr.s_addr = htonl(0xc0000201);
+    set_address(&from.address.local, (void *)&sin);
+    ok(is_nat_rebinding(&from, &to));
+    sin.sin_addr.s_addr = htonl(0xc6336401);
+    set_address(&to.address.local, (void *)&sin);
+    ok(!is_nat_rebinding(&from, &to));
+}
+
 static void test_jumpstart_cwnd(void)
 {
     quicly_context_t unbounded_max = {
@@ -1405,12 +1731,429 @@ static void do_test_migration_during_handshake(int second_flight_from_orig_addre
     quicly_free(server);
 }
 
+static void test_hibernate(void)
+{
+    quicly_conn_t *client, *server;
+    quicly_stream_t *client_stream, *server_stream;
+    test_streambuf_t *server_streambuf;
+    quicly_error_t ret;
+
+    test_setup_connected_peers(&client, &server);
+
+    /* cannot hibernate while there is something to be sent or to be acked */
+    ret = quicly_open_stream(client, &client_stream, 0);
+    ok(ret == 0);
+    quicly_streambuf_egress_write(client_stream, "hello", 5);
+    ok(!quicly_hibernate(client));
+    transmit(client, server);
+    ok(!quicly_hibernate(client));
+    exchange_until_idle(client, server);
+
+    /* both sides can hibernate once idle */
+    ok(quicly_hibernate(client));
+    ok(quicly_hibernate(server));
+    ok(client->egress.loss.sentmap.num_packets == 0);
+    ok(server->egress.loss.sentmap.num_packets == 0);
+    ok(client->application->super.ack_queue.capacity == 1 ||
+       client->application->super.ack_queue.capacity == client->application->super.ack_queue.num_ranges);
+    ok(server->application->super.ack_queue.capacity == 1 ||
+       server->application->super.ack_queue.capacity == server->application->super.ack_queue.num_ranges);
+    server_stream = quicly_get_stream(server, client_stream->stream_id);
+    ok(server_stream != NULL);
+    server_streambuf = server_stream->data;
+    ok(buffer_is(&server_streambuf->super.ingress, "hello"));
+    quicly_streambuf_ingress_shift(server_stream, 5);
+    quicly_streambuf_shrink(server_stream);
+    ok(server_streambuf->super.ingress.capacity == 0);
+
+    /* and can be used as usual thereafter */
+    quicly_streambuf_egress_write(client_stream, "world", 5);
+    exchange_until_idle(client, server);
+    ok(buffer_is(&server_streambuf->super.ingress, "world"));
+    ok(quicly_hibernate(client));
+    ok(quicly_hibernate(server));
+
+    quicly_free(client);
+    quicly_free(server);
+}
+
+struct st_test_counting_allocator_t {
+    quicly_allocator_t super;
+    size_t num_allocs[QUICLY_NUM_ALLOC_TAGS];
+    size_t bytes_in_use[QUICLY_NUM_ALLOC_TAGS];
+};
+
+static void *test_counting_alloc(quicly_allocator_t *_self, size_t size, quicly_alloc_tag_t tag)
+{
+    struct st_test_counting_allocator_t *self = (void *)_self;
+    ++self->num_allocs[tag];
+    self->bytes_in_use[tag] += size;
+    return malloc(size);
+}
+
+static void *test_counting_realloc(quicly_allocator_t *_self, void *p, size_t old_size, size_t new_size, quicly_alloc_tag_t tag)
+{
+    struct st_test_counting_allocator_t *self = (void *)_self;
+    void *newp;
+    if ((newp = realloc(p, new_size)) != NULL)
+        self->bytes_in_use[tag] += new_size - old_size;
+    return newp;
+}
+
+static void test_counting_free(quicly_allocator_t *_self, void *p, size_t size, quicly_alloc_tag_t tag)
+{
+    struct st_test_counting_allocator_t *self = (void *)_self;
+    self->bytes_in_use[tag] -= size;
+    free(p);
+}
+
+static void test_allocator(void)
+{
+    struct st_test_counting_allocator_t allocator = {{test_counting_alloc, test_counting_realloc, test_counting_free}};
+    quicly_conn_t *client, *server;
+    quicly_stream_t *client_stream, *server_stream;
+    quicly_error_t ret;
+
+    quic_ctx.allocator = &allocator.super;
+
+    test_setup_connected_peers(&client, &server);
+    ret = quicly_open_stream(client, &client_stream, 0);
+    ok(ret == 0);
+    quicly_streambuf_egress_write(client_stream, "hello", 5);
+    quicly_streambuf_egress_shutdown(client_stream);
+    exchange_until_idle(client, server);
+    server_stream = quicly_get_stream(server, client_stream->stream_id);
+    ok(server_stream != NULL);
+    ok(buffer_is(&((test_streambuf_t *)server_stream->data)->super.ingress, "hello"));
+
+    ok(allocator.num_allocs[QUICLY_ALLOC_TAG_CONN] == 2);
+    ok(allocator.num_allocs[QUICLY_ALLOC_TAG_PATH] >= 2);
+    ok(allocator.num_allocs[QUICLY_ALLOC_TAG_PN_SPACE] >= 6);
+    ok(allocator.num_allocs[QUICLY_ALLOC_TAG_STREAM] >= 2);
+    ok(allocator.num_allocs[QUICLY_ALLOC_TAG_SENTMAP] != 0);
+    ok(allocator.bytes_in_use[QUICLY_ALLOC_TAG_CONN] != 0);
+    ok(allocator.bytes_in_use[QUICLY_ALLOC_TAG_STREAMBUF] >= 2 * sizeof(test_streambuf_t));
+
+    void *stream_data[2] = {client_stream->data, server_stream->data};
+    quicly_free(client);
+    quicly_free(server);
+
+    /* `on_destroy` of the test retains the stream buffers; release them */
+    for (size_t i = 0; i < PTLS_ELEMENTSOF(stream_data); ++i) {
+        quicly_stream_t detached = {.data = stream_data[i]};
+        quicly_streambuf_destroy(&detached, 0);
+    }
+
+    /* every byte being allocated has been returned, with the size given at allocation */
+    for (size_t i = 0; i < QUICLY_NUM_ALLOC_TAGS; ++i)
+        ok(allocator.bytes_in_use[i] == 0);
+
+    quic_ctx.allocator = NULL;
+}
+
+static size_t test_counting_total(struct st_test_counting_allocator_t *allocator)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < QUICLY_NUM_ALLOC_TAGS; ++i)
+        total += allocator->bytes_in_use[i];
+    return total;
+}
+
+static void test_hibernate_memory(void)
+{
+    struct st_test_counting_allocator_t allocator = {{test_counting_alloc, test_counting_realloc, test_counting_free}};
+    quicly_conn_t *client, *server;
+    quicly_stream_t *client_stream, *server_stream;
+    size_t stream_bytes, total_bytes;
+    quicly_error_t ret;
+
+    quic_ctx.allocator = &allocator.super;
+
+    test_setup_connected_peers(&client, &server);
+    ret = quicly_open_stream(client, &client_stream, 0);
+    ok(ret == 0);
+    quicly_streambuf_egress_write(client_stream, "hello", 5);
+    exchange_until_idle(client, server);
+    server_stream = quicly_get_stream(server, client_stream->stream_id);
+    ok(server_stream != NULL);
+
+    /* hibernation releases the TLS objects and the 1-RTT crypto streams, in addition to the buffers being shrunk */
+    stream_bytes = allocator.bytes_in_use[QUICLY_ALLOC_TAG_STREAM];
+    total_bytes = test_counting_total(&allocator);
+    ok(quicly_hibernate(client));
+    ok(quicly_hibernate(server));
+    note("released %zu bytes, excluding those of the TLS objects", total_bytes - test_counting_total(&allocator));
+    ok(allocator.bytes_in_use[QUICLY_ALLOC_TAG_STREAM] == stream_bytes - 2 * sizeof(quicly_stream_t));
+    ok(test_counting_total(&allocator) < total_bytes);
+    ok(quicly_get_tls(client) == NULL);
+    ok(quicly_get_tls(server) == NULL);
+    ok(quicly_get_stream(client, -(quicly_stream_id_t)(1 + QUICLY_EPOCH_1RTT)) == NULL);
+
+    /* the properties of the handshake are retained */
+    ok(strcmp(quicly_get_server_name(client), "example.com") == 0);
+    ok(strcmp(quicly_get_server_name(server), "example.com") == 0);
+    ok(quicly_get_negotiated_protocol(client) == NULL);
+
+    /* keys can be updated without the TLS objects */
+    client->application->cipher.egress.key_update_pn.next = client->egress.packet_number;
+    quicly_streambuf_egress_write(client_stream, "world", 5);
+    exchange_until_idle(client, server);
+    ok(buffer_is(&((test_streambuf_t *)server_stream->data)->super.ingress, "helloworld"));
+    ok(client->application->cipher.egress.key_phase == 1);
+    ok(server->application->cipher.egress.key_phase == 1);
+
+    void *stream_data[2] = {client_stream->data, server_stream->data};
+    quicly_free(client);
+    quicly_free(server);
+    for (size_t i = 0; i < PTLS_ELEMENTSOF(stream_data); ++i) {
+        quicly_stream_t detached = {.data = stream_data[i]};
+        quicly_streambuf_destroy(&detached, 0);
+    }
+    ok(test_counting_total(&allocator) == 0);
+
+    quic_ctx.allocator = NULL;
+}
+
+static void test_conn_pool(void)
+{
+    quicly_conn_t *client, *server;
+    quicly_stream_t *client_stream;
+    void *pooled[2];
+    quicly_error_t ret;
+
+    quic_ctx.conn_pool = quicly_new_conn_pool(&quic_ctx, 2);
+    ok(quic_ctx.conn_pool != NULL);
+    ok(quic_ctx.conn_pool->count == 2);
+    pooled[0] = quic_ctx.conn_pool->entries[0].conn;
+    pooled[1] = quic_ctx.conn_pool->entries[1].conn;
+
+    /* connections are instantiated using the pooled objects */
+    test_setup_connected_peers(&client, &server);
+    ok(quic_ctx.conn_pool->count == 0);
+    ok((client == pooled[0] && server == pooled[1]) || (client == pooled[1] && server == pooled[0]));
+    ret = quicly_open_stream(client, &client_stream, 0);
+    ok(ret == 0);
+    quicly_streambuf_egress_write(client_stream, "hello", 5);
+    quicly_streambuf_egress_shutdown(client_stream);
+    exchange_until_idle(client, server);
+
+    /* the objects are returned to the pool, zero-cleared */
+    quicly_free(client);
+    quicly_free(server);
+    ok(quic_ctx.conn_pool->count == 2);
+    for (size_t i = 0; i < 2; ++i) {
+        struct st_quicly_conn_pool_entry_t *entry = &quic_ctx.conn_pool->entries[i];
+        ok(entry->conn->super.ctx == NULL);
+        ok(entry->conn->streams == NULL);
+        ok(entry->streams != NULL && kh_size(entry->streams) == 0);
+    }
+
+    /* and are reused */
+    test_setup_connected_peers(&client, &server);
+    ok((client == pooled[0] && server == pooled[1]) || (client == pooled[1] && server == pooled[0]));
+    ret = quicly_open_stream(client, &client_stream, 0);
+    ok(ret == 0);
+    quicly_streambuf_egress_write(client_stream, "world", 5);
+    exchange_until_idle(client, server);
+    ok(quicly_get_stream(server, client_stream->stream_id) != NULL);
+    quicly_free(client);
+    quicly_free(server);
+
+    quicly_free_conn_pool(quic_ctx.conn_pool);
+    quic_ctx.conn_pool = NULL;
+}
+
+static quicly_error_t test_admission_accept(quicly_conn_t **client, quicly_conn_t **server)
+{
+    quicly_address_t dest, src;
+    struct iovec datagram;
+    uint8_t packetbuf[quic_ctx.transport_params.max_udp_payload_size];
+    quicly_decoded_packet_t decoded;
+    size_t num_datagrams = 1;
+    quicly_error_t ret;
+
+    ret = quicly_connect(client, &quic_ctx, "example.com", &fake_address.sa, NULL, new_master_id(), ptls_iovec_init(NULL, 0), NULL,
+                         NULL, NULL);
+    ok(ret == 0);
+    ret = quicly_send(*client, &dest, &src, &datagram, &num_datagrams, packetbuf, sizeof(packetbuf));
+    ok(ret == 0);
+    ok(num_datagrams == 1);
+    ok(decode_packets(&decoded, &datagram, 1) == 1);
+    return quicly_accept(server, &quic_ctx, NULL, &fake_address.sa, &decoded, NULL, new_master_id(), NULL, NULL);
+}
+
+static void test_admission(void)
+{
+    quicly_admission_t admission = {.retry = {.handshakes = 1}};
+    quicly_conn_t *client, *server, *client2, *server2;
+    quicly_error_t ret;
+
+    quic_ctx.admission = &admission;
+
+    /* handshakes are tracked until being confirmed */
+    ok(quicly_admission_decide(&admission, quic_now, 0) == QUICLY_ADMISSION_ACCEPT);
+    test_setup_connected_peers(&client, &server);
+    ok(admission.num_handshakes == 0);
+    ok(admission.cpu_usec.total != 0);
+    quicly_free(client);
+    quicly_free(server);
+
+    /* Retry is recommended while a handshake is in progress, unless the address has been validated */
+    ret = test_admission_accept(&client, &server);
+    ok(ret == 0);
+    ok(admission.num_handshakes == 1);
+    ok(quicly_admission_decide(&admission, quic_now, 0) == QUICLY_ADMISSION_RETRY);
+    ok(quicly_admission_decide(&admission, quic_now, 1) == QUICLY_ADMISSION_ACCEPT);
+
+    /* and enforced by quicly_accept if requested */
+    admission.enforce = 1;
+    ret = test_admission_accept(&client2, &server2);
+    ok(ret == QUICLY_ERROR_RETRY_REQUIRED);
+    ok(server2 == NULL);
+    quicly_free(client2);
+    admission.refuse.handshakes = 1;
+    ret = test_admission_accept(&client2, &server2);
+    ok(ret == QUICLY_TRANSPORT_ERROR_CONNECTION_REFUSED);
+    quicly_free(client2);
+    admission.drop.memory = 1000;
+    admission.memory_in_use = 1000;
+    ret = test_admission_accept(&client2, &server2);
+    ok(ret == QUICLY_ERROR_PACKET_IGNORED);
+    quicly_free(client2);
+
+    ok(admission.num_decisions[QUICLY_ADMISSION_ACCEPT] == 2);
+    ok(admission.num_decisions[QUICLY_ADMISSION_RETRY] == 2);
+    ok(admission.num_decisions[QUICLY_ADMISSION_REFUSE] == 1);
+    ok(admission.num_decisions[QUICLY_ADMISSION_DROP] == 1);
+
+    /* the count is decremented when a connection is freed before the handshake is confirmed */
+    quicly_free(server);
+    quicly_free(client);
+    ok(admission.num_handshakes == 0);
+
+    quic_ctx.admission = NULL;
+}
+
 static void test_migration_during_handshake(void)
 {
     subtest("migrate-before-2nd", do_test_migration_during_handshake, 0);
     subtest("migrate-before-3nd", do_test_migration_during_handshake, 1);
 }
 
+/**
+ * sends packets from `src` to `dst` as if they were sent from `src_addr`
+ */
+static void transmit_from(quicly_conn_t *src, quicly_conn_t *dst, struct sockaddr *src_addr)
+{
+    quicly_address_t destaddr, srcaddr;
+    struct iovec datagrams[8];
+    uint8_t buf[PTLS_ELEMENTSOF(datagrams) * quic_ctx.transport_params.max_udp_payload_size];
+    quicly_decoded_packet_t decoded[PTLS_ELEMENTSOF(datagrams) * 2];
+    size_t num_datagrams = PTLS_ELEMENTSOF(datagrams), num_packets;
+    quicly_error_t ret;
+
+    ret = quicly_send(src, &destaddr, &srcaddr, datagrams, &num_datagrams, buf, sizeof(buf));
+    ok(ret == 0);
+    ok(num_datagrams != 0);
+    num_packets = decode_packets(decoded, datagrams, num_datagrams);
+    for (size_t i = 0; i != num_packets; ++i) {
+        ret = quicly_receive(dst, NULL, src_addr, decoded + i);
+        ok(ret == 0);
+    }
+}
+
+static void do_test_migration(int is_nat_rebinding)
+{
+    quicly_conn_t *client, *server;
+    quicly_stream_t *client_stream, *server_stream;
+    struct sockaddr_in newaddr = fake_address.sin;
+    uint8_t data[2400] = {0};
+    quicly_error_t ret;
+
+    if (is_nat_rebinding) {
+        newaddr.sin_port = htons(1234);
+    } else {
+        newaddr.sin_addr.s_addr = htonl(0xc6336401);
+        newaddr.sin_port = htons(1234);
+    }
+
+    test_setup_connected_peers(&client, &server);
+
+    /* build up congestion state and RTT samples on the original path, the RTT being 5ms */
+    ret = quicly_open_stream(server, &server_stream, 1);
+    ok(ret == 0);
+    for (size_t i = 0; i < 4; ++i) {
+        quicly_streambuf_egress_write(server_stream, data, sizeof(data));
+        transmit(server, client);
+        quic_now += 5;
+        transmit(client, server);
+    }
+
+    /* leave some packets in flight */
+    quicly_streambuf_egress_write(server_stream, data, sizeof(data));
+    {
+        quicly_address_t dest, src;
+        struct iovec datagrams[8];
+        uint8_t buf[PTLS_ELEMENTSOF(datagrams) * quic_ctx.transport_params.max_udp_payload_size];
+        size_t num_datagrams = PTLS_ELEMENTSOF(datagrams);
+        ret = quicly_send(server, &dest, &src, datagrams, &num_datagrams, buf, sizeof(buf));
+        ok(ret == 0);
+        ok(num_datagrams != 0);
+    }
+    ok(server_stream->sendstate.pending.num_ranges == 0);
+    uint32_t cwnd_before = server->egress.cc.cwnd, initcwnd = quicly_cc_calc_initial_cwnd(quic_ctx.initcwnd_packets,
+                                                                                          server->egress.max_udp_payload_size);
+    quicly_rtt_t rtt_before = server->egress.loss.rtt;
+    uint64_t inflight_before = server->egress.loss.sentmap.bytes_in_flight;
+    ok(cwnd_before > initcwnd);
+    ok(inflight_before != 0);
+
+    /* client sends a non-probing packet from the new address, server opens a new path and sends PATH_CHALLENGE */
+    ret = quicly_open_stream(client, &client_stream, 0);
+    ok(ret == 0);
+    quicly_streambuf_egress_write(client_stream, "hello", 5);
+    transmit_from(client, server, (void *)&newaddr);
+    ok(server->paths[1] != NULL);
+    ok(!server->paths[1]->probe_only);
+    transmit(server, client);
+    ok(server->paths[1]->path_challenge.num_sent == 1);
+
+    /* PATH_RESPONSE arrives 8ms later; the path is validated and promoted */
+    quic_now += 8;
+    transmit_from(client, server, (void *)&newaddr);
+    ok(server->super.stats.num_paths.validated == 1);
+    ok(server->super.stats.num_paths.promoted == 1);
+    ok(server->paths[1] == NULL);
+    ok(compare_socket_address(&server->paths[0]->address.remote.sa, (void *)&newaddr) == 0);
+
+    if (is_nat_rebinding) {
+        /* congestion state, the RTT estimate, and the packets in flight are retained */
+        ok(server->super.stats.num_paths.nat_rebinding == 1);
+        ok(server->egress.cc.cwnd >= cwnd_before);
+        ok(server->egress.loss.rtt.minimum == rtt_before.minimum);
+        ok(server->egress.loss.sentmap.bytes_in_flight >= inflight_before);
+        ok(server_stream->sendstate.pending.num_ranges == 0);
+    } else {
+        /* congestion state is reset, the packets in flight are deemed lost, and the RTT of PATH_CHALLENGE becomes the first
+         * sample */
+        ok(server->super.stats.num_paths.nat_rebinding == 0);
+        ok(server->egress.cc.cwnd == initcwnd);
+        ok(server->egress.loss.rtt.latest == 8);
+        ok(server->egress.loss.rtt.minimum == 8);
+        ok(server->egress.loss.rtt.smoothed == 8);
+        ok(server_stream->sendstate.pending.num_ranges != 0);
+    }
+
+    quicly_free(client);
+    quicly_free(server);
+}
+
+static void test_migration(void)
+{
+    subtest("nat-rebinding", do_test_migration, 1);
+    subtest("network-change", do_test_migration, 0);
+}
+
 static size_t test_stats_foreach_next_off;
 
 static void test_stats_foreach_field(size_t off, size_t size)
@@ -1525,6 +2268,7 @@ int main(int argc, char **argv)
     subtest("test-retry-aead", test_retry_aead);
     subtest("transport-parameters", test_transport_parameters);
     subtest("cid", test_cid);
+    subtest("stateless-batch", test_stateless_batch);
     subtest("simple", test_simple);
     subtest("stream-concurrency", test_stream_concurrency);
     subtest("lossy", test_lossy);
@@ -1535,9 +2279,20 @@ int main(int argc, char **argv)
     subtest("jumpstart", test_jumpstart);
     subtest("ack-frequency", test_ack_frequency);
     subtest("cc", test_cc);
+    subtest("streambuf", test_streambuf);
+    subtest("path-profile", test_path_profile);
+    subtest("mtserver", test_mtserver);
+    subtest("sessioncache", test_sessioncache);
 
     subtest("state-exhaustion", test_state_exhaustion);
     subtest("migration-during-handshake", test_migration_during_handshake);
+    subtest("hibernate", test_hibernate);
+    subtest("allocator", test_allocator);
+    subtest("hibernate-memory", test_hibernate_memory);
+    subtest("conn-pool", test_conn_pool);
+    subtest("admission", test_admission);
+    subtest("nat-rebinding-detection", test_nat_rebinding_detection);
+    subtest("migration", test_migration);
 
     subtest("stats-foreach", test_stats_foreach);
 
@@ -62,5 +62,9 @@ void test_received_cid(void);
 void test_local_cid(void);
 void test_jumpstart(void);
 void test_cc(void);
+void test_streambuf(void);
+void test_path_profile(void);
+void test_mtserver(void);
+void test_sessioncache(void);
 
 #endif